@@ -0,0 +1,195 @@
+// Copyright 2018 SICK AG. All rights reserved.
+
+#include "AsyncFrameWriter.h"
+#include "GenIRanger.h"
+
+namespace GenIRanger
+{
+
+AsyncFrameWriter::AsyncFrameWriter(size_t capacity,
+                                   size_t threadCount,
+                                   FullQueuePolicy policy)
+  : mCapacity(capacity == 0 ? 1 : capacity)
+  , mPolicy(policy)
+  , mStopping(false)
+{
+  Statistics empty = { 0, 0, 0, 0, 0, 0 };
+  mStatistics = empty;
+
+  if (threadCount == 0)
+  {
+    threadCount = 1;
+  }
+  for (size_t i = 0; i < threadCount; ++i)
+  {
+    mThreads.push_back(std::thread(&AsyncFrameWriter::writerLoop, this));
+  }
+}
+
+AsyncFrameWriter::~AsyncFrameWriter()
+{
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStopping = true;
+  }
+  mFrameQueued.notify_all();
+  for (size_t i = 0; i < mThreads.size(); ++i)
+  {
+    mThreads[i].join();
+  }
+}
+
+void AsyncFrameWriter::setCompletionCallback(CompletionCallback callback)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  mCompletionCallback = callback;
+}
+
+void AsyncFrameWriter::setBackpressureCallback(BackpressureCallback callback)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  mBackpressureCallback = callback;
+}
+
+bool AsyncFrameWriter::write(const RangeFrame& frame,
+                             const std::string& filePath,
+                             const std::string& arbitraryXml)
+{
+  Job job;
+  job.mFrame = frame;
+  job.mFilePath = filePath;
+  job.mRing = nullptr;
+  job.mArbitraryXml = arbitraryXml;
+  return enqueue(job);
+}
+
+bool AsyncFrameWriter::write(const RangeFrame& frame,
+                             FrameFileRing& ring,
+                             const std::string& arbitraryXml)
+{
+  Job job;
+  job.mFrame = frame;
+  job.mRing = &ring;
+  job.mArbitraryXml = arbitraryXml;
+  return enqueue(job);
+}
+
+bool AsyncFrameWriter::enqueue(const Job& job)
+{
+  std::unique_lock<std::mutex> lock(mMutex);
+  if (mStatistics.queueDepth >= mCapacity)
+  {
+    ++mStatistics.queueFullCount;
+    BackpressureCallback backpressureCallback = mBackpressureCallback;
+    if (backpressureCallback)
+    {
+      // Not holding the lock, the callback may ask for statistics
+      const size_t queueDepth = mStatistics.queueDepth;
+      lock.unlock();
+      backpressureCallback(queueDepth);
+      lock.lock();
+    }
+    if (mPolicy == FullQueuePolicy::Reject)
+    {
+      ++mStatistics.framesRejected;
+      return false;
+    }
+    while (mStatistics.queueDepth >= mCapacity)
+    {
+      mFrameDone.wait(lock);
+    }
+  }
+
+  mQueue.push_back(job);
+
+  ++mStatistics.queueDepth;
+  if (mStatistics.queueDepth > mStatistics.peakQueueDepth)
+  {
+    mStatistics.peakQueueDepth = mStatistics.queueDepth;
+  }
+  lock.unlock();
+  mFrameQueued.notify_one();
+  return true;
+}
+
+void AsyncFrameWriter::flush()
+{
+  std::unique_lock<std::mutex> lock(mMutex);
+  while (mStatistics.queueDepth > 0)
+  {
+    mFrameDone.wait(lock);
+  }
+}
+
+AsyncFrameWriter::Statistics AsyncFrameWriter::statistics() const
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  return mStatistics;
+}
+
+void AsyncFrameWriter::writerLoop()
+{
+  for (;;)
+  {
+    Job job;
+    CompletionCallback completionCallback;
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      while (!mStopping && mQueue.empty())
+      {
+        mFrameQueued.wait(lock);
+      }
+      if (mQueue.empty())
+      {
+        // Stopping and all frames are written
+        return;
+      }
+      job = mQueue.front();
+      mQueue.pop_front();
+      completionCallback = mCompletionCallback;
+    }
+
+    std::exception_ptr error;
+    try
+    {
+      if (job.mRing != nullptr)
+      {
+        // Until saved, report errors with the base path of the ring
+        job.mFilePath = job.mRing->basePath();
+        job.mFilePath = job.mRing->save(job.mFrame, job.mArbitraryXml);
+      }
+      else
+      {
+        saveMultipartRangeFrame(job.mFrame, job.mFilePath, job.mArbitraryXml);
+      }
+    }
+    catch (...)
+    {
+      error = std::current_exception();
+    }
+    // Release the data before reporting, so that any buffers viewed by the
+    // frame are returned by the time the callback is called
+    job.mFrame = RangeFrame();
+
+    if (completionCallback)
+    {
+      completionCallback(job.mFilePath, error);
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      --mStatistics.queueDepth;
+      if (error)
+      {
+        ++mStatistics.framesFailed;
+      }
+      else
+      {
+        ++mStatistics.framesWritten;
+      }
+    }
+    mFrameDone.notify_all();
+  }
+}
+
+}
@@ -0,0 +1,128 @@
+// Copyright 2016-2018 SICK AG. All rights reserved.
+
+#include "Exceptions.h"
+#include "GenIRanger.h"
+#include "PixelConversion.h"
+#include "ThreadPool.h"
+
+#include <memory>
+#include <mutex>
+#include <sstream>
+
+namespace GenIRanger
+{
+
+GENIRANGER_API void convert12pTo16(
+  const uint8_t* inBuffer,
+  const int64_t inSize,
+  uint8_t* outBuffer,
+  int64_t* inOutSize)
+{
+  const size_t size = inSize > 0 ? static_cast<size_t>(inSize) : 0;
+  const int64_t bytesToWrite
+    = static_cast<int64_t>(PixelConversion::unpacked12pSize(size));
+  if (bytesToWrite > *inOutSize)
+  {
+    std::stringstream ss;
+    ss << "Buffer overrun, provided buffer with size " << *inOutSize
+       << " cannot hold the unpacked data";
+    throw GenIRangerException(ss.str());
+  }
+
+  PixelConversion::unpack12pTo16(inBuffer, size, outBuffer);
+  *inOutSize = bytesToWrite;
+}
+
+// The conversion thread pool is created on first use
+static std::mutex gConversionPoolMutex;
+static std::shared_ptr<ThreadPool> gConversionPool;
+static size_t gConversionThreadCount = 0;
+
+std::shared_ptr<ThreadPool> getConversionPool()
+{
+  std::lock_guard<std::mutex> lock(gConversionPoolMutex);
+  if (!gConversionPool)
+  {
+    gConversionPool = std::make_shared<ThreadPool>(gConversionThreadCount);
+  }
+  return gConversionPool;
+}
+
+GENIRANGER_API void setConversionThreadCount(const size_t threadCount)
+{
+  // A pool that is in use by an ongoing conversion is destroyed when that
+  // conversion is done with it
+  std::lock_guard<std::mutex> lock(gConversionPoolMutex);
+  gConversionThreadCount = threadCount;
+  gConversionPool.reset();
+}
+
+GENIRANGER_API void convert12pTo16Parallel(
+  const uint8_t* inBuffer,
+  const int64_t inSize,
+  uint8_t* outBuffer,
+  int64_t* inOutSize,
+  const int64_t serialThreshold)
+{
+  // Too small to gain anything from splitting
+  if (inSize < serialThreshold || inSize < 3)
+  {
+    convert12pTo16(inBuffer, inSize, outBuffer, inOutSize);
+    return;
+  }
+
+  const size_t size = static_cast<size_t>(inSize);
+  const int64_t bytesToWrite
+    = static_cast<int64_t>(PixelConversion::unpacked12pSize(size));
+  if (bytesToWrite > *inOutSize)
+  {
+    std::stringstream ss;
+    ss << "Buffer overrun, provided buffer with size " << *inOutSize
+       << " cannot hold the unpacked data";
+    throw GenIRangerException(ss.str());
+  }
+
+  std::shared_ptr<ThreadPool> pool = getConversionPool();
+
+  // A few chunks per thread evens out the load if some threads are busy
+  const size_t chunkCount = pool->threadCount() * 4;
+  const size_t groupCount = size / 3;
+  const size_t groupsPerChunk = (groupCount + chunkCount - 1) / chunkCount;
+  const size_t chunkSize = groupsPerChunk * 3;
+  const size_t usedChunks = (size + chunkSize - 1) / chunkSize;
+
+  pool->parallelFor(usedChunks, [=](size_t chunk)
+  {
+    const size_t begin = chunk * chunkSize;
+    // The last chunk also handles a possible trailing pixel
+    const size_t length = chunk + 1 == usedChunks ? size - begin : chunkSize;
+    PixelConversion::unpack12pTo16(inBuffer + begin, length,
+                                   outBuffer + begin / 3 * 4);
+  });
+  *inOutSize = bytesToWrite;
+}
+
+GENIRANGER_API void convert16To12p(
+  const uint16_t* inBuffer,
+  const int64_t inSize,
+  uint8_t* outBuffer,
+  int64_t* inOutSize)
+{
+  if (inSize % 2 != 0)
+  {
+    throw GenIRangerException("Size of a 16 bit input buffer must be even");
+  }
+
+  const size_t pixelCount = inSize > 0 ? static_cast<size_t>(inSize / 2) : 0;
+  const int64_t bytesToWrite
+    = static_cast<int64_t>(PixelConversion::packed12pSize(pixelCount));
+  if (bytesToWrite > *inOutSize)
+  {
+    throw GenIRangerException("Output buffer size insufficient");
+  }
+
+  PixelConversion::pack16To12p(inBuffer, pixelCount, outBuffer);
+  *inOutSize = bytesToWrite;
+}
+
+}
@@ -0,0 +1,111 @@
+// Copyright 2018 SICK AG. All rights reserved.
+
+#include "CpuFeatures.h"
+
+#include <stdint.h>
+
+#if defined(GENIRANGER_X86)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace GenIRanger
+{
+
+#if defined(GENIRANGER_X86)
+
+static void cpuid(int leaf, int subLeaf, uint32_t registers[4])
+{
+#if defined(_MSC_VER)
+  int info[4];
+  __cpuidex(info, leaf, subLeaf);
+  for (int i = 0; i < 4; ++i)
+  {
+    registers[i] = static_cast<uint32_t>(info[i]);
+  }
+#else
+  __cpuid_count(leaf, subLeaf,
+                registers[0], registers[1], registers[2], registers[3]);
+#endif
+}
+
+/** Returns the extended control register XCR0, i.e., the register states the
+    operating system saves on context switches.
+*/
+static uint64_t xcr0()
+{
+#if defined(_MSC_VER)
+  return _xgetbv(0);
+#else
+  uint32_t eax;
+  uint32_t edx;
+  __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+  return (static_cast<uint64_t>(edx) << 32) | eax;
+#endif
+}
+
+static CpuFeatures detectCpuFeatures()
+{
+  CpuFeatures features = { false, false, false, false, false };
+
+  uint32_t registers[4];
+  cpuid(0, 0, registers);
+  const uint32_t maxLeaf = registers[0];
+  if (maxLeaf < 1)
+  {
+    return features;
+  }
+
+  cpuid(1, 0, registers);
+  const uint32_t ecx1 = registers[2];
+  const uint32_t edx1 = registers[3];
+  features.sse2 = (edx1 & (1u << 26)) != 0;
+  features.ssse3 = (ecx1 & (1u << 9)) != 0;
+  features.sse41 = (ecx1 & (1u << 19)) != 0;
+
+  // AVX state must be enabled by the operating system before any of the
+  // 256 or 512 bit instructions can be used
+  const bool osxsave = (ecx1 & (1u << 27)) != 0;
+  const bool avx = (ecx1 & (1u << 28)) != 0;
+  if (!osxsave || !avx || maxLeaf < 7)
+  {
+    return features;
+  }
+  const uint64_t xcr = xcr0();
+  // XMM and YMM state
+  const bool osAvx = (xcr & 0x06) == 0x06;
+  // Opmask, upper ZMM0-15 and ZMM16-31 state
+  const bool osAvx512 = (xcr & 0xE6) == 0xE6;
+
+  cpuid(7, 0, registers);
+  const uint32_t ebx7 = registers[1];
+  features.avx2 = osAvx && (ebx7 & (1u << 5)) != 0;
+  features.avx512bw = osAvx512
+    && (ebx7 & (1u << 16)) != 0   // AVX512F
+    && (ebx7 & (1u << 30)) != 0;  // AVX512BW
+
+  return features;
+}
+
+#else
+
+static CpuFeatures detectCpuFeatures()
+{
+  CpuFeatures features = { false, false, false, false, false };
+  return features;
+}
+
+#endif
+
+const CpuFeatures& cpuFeatures()
+{
+  // Function local to be safe to use from other static initializers, which
+  // is where the conversion routines pick their implementation.
+  static const CpuFeatures features = detectCpuFeatures();
+  return features;
+}
+
+}
@@ -0,0 +1,45 @@
+// Copyright 2018 SICK AG. All rights reserved.
+
+#ifndef GENIRANGER_CPUFEATURES_H
+#define GENIRANGER_CPUFEATURES_H
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define GENIRANGER_X86
+#endif
+
+// AVX-512 intrinsics are not available before Visual Studio 2017 (15.3)
+#if defined(GENIRANGER_X86) && (!defined(_MSC_VER) || _MSC_VER >= 1911)
+#define GENIRANGER_AVX512
+#endif
+
+// GCC and Clang only emit vector instructions for functions that are
+// explicitly compiled for the corresponding target. MSVC allows intrinsics
+// everywhere.
+#if defined(GENIRANGER_X86) && !defined(_MSC_VER)
+#define GENIRANGER_TARGET(isa) __attribute__((target(isa)))
+#else
+#define GENIRANGER_TARGET(isa)
+#endif
+
+namespace GenIRanger
+{
+
+/** Instruction set extensions supported by both the processor and the
+    operating system. Detected once using CPUID.
+*/
+struct CpuFeatures
+{
+  /** Always set on x64, but not on every 32 bit x86 processor */
+  bool sse2;
+  bool ssse3;
+  bool sse41;
+  bool avx2;
+  /** AVX-512 foundation and byte/word instructions */
+  bool avx512bw;
+};
+
+/** Returns the features of the processor the library is running on. */
+const CpuFeatures& cpuFeatures();
+
+}
+#endif
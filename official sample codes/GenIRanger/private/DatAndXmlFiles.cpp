@@ -5,45 +5,86 @@
 namespace GenIRanger {
 
 DatAndXmlFiles::DatAndXmlFiles(std::string filePathWithNoEnding)
-  : mDataStream(filePathWithNoEnding + ".dat", openMode)
+  : mDataFile(new PreallocatedFile(filePathWithNoEnding + ".dat", 0))
   , mXmlStream(filePathWithNoEnding + ".xml", openMode)
+  , mPreallocatedData(mDataFile.get())
+  , mDataOffset(0)
+  , mSyncToDisk(false)
 {
-  mDataStream.exceptions(std::ios::failbit | std::ios::badbit);
+  // Discard any previous contents, like the stream would
+  mDataFile->resize(0);
   mXmlStream.exceptions(std::ios::failbit | std::ios::badbit);
 }
 
+DatAndXmlFiles::DatAndXmlFiles(std::string filePathWithNoEnding,
+                               PreallocatedFile& preallocatedData,
+                               bool syncToDisk)
+  : mPreallocatedData(&preallocatedData)
+  , mDataOffset(0)
+  , mXmlPath(filePathWithNoEnding + ".xml")
+  , mSyncToDisk(syncToDisk)
+{
+}
+
 DatAndXmlFiles::~DatAndXmlFiles()
 {
-  mDataStream.close();
   mXmlStream.close();
 }
 
 void DatAndXmlFiles::writeData(ComponentPtr& component)
 {
-  writeData(component->data().data(), component->data().size());
+  writeData(component->bytes(), component->sizeInBytes());
 }
 
-void DatAndXmlFiles::writeMarkData(LineMetadataPtr encoderValues)
+void DatAndXmlFiles::writeData(const DataSpan* spans, const size_t count)
 {
-  const Metadata notUsed = 0;
-  for (auto encoderValue : *encoderValues)
+  uint64_t size = 0;
+  for (size_t i = 0; i < count; ++i)
   {
-    writeSingleMarkValue(encoderValue);
-    writeSingleMarkValue(notUsed);
-    writeSingleMarkValue(notUsed);
-    writeSingleMarkValue(notUsed);
-    writeSingleMarkValue(notUsed);
+    size += spans[i].size;
   }
+  mPreallocatedData->writeAt(mDataOffset, spans, count);
+  mDataOffset += size;
+}
+
+void DatAndXmlFiles::writeMarkData(const LineMarks& marks)
+{
+  writeData(reinterpret_cast<const uint8_t*>(marks.data()),
+            marks.size() * sizeof(LineMark));
 }
 
-void DatAndXmlFiles::writeSingleMarkValue(const Metadata value)
+void DatAndXmlFiles::formatMarkData(LineMetadataPtr encoderValues,
+                                    LineMarks& marks)
 {
-  writeData(reinterpret_cast<const uint8_t*>(&value), sizeof(Metadata));
+  const LineMark notUsed = {};
+  marks.assign(encoderValues->size(), notUsed);
+  for (size_t i = 0; i < encoderValues->size(); ++i)
+  {
+    marks[i].encoderValue = (*encoderValues)[i];
+  }
+}
+
+void DatAndXmlFiles::writeXml(const std::string& xml)
+{
+  if (!mXmlPath.empty())
+  {
+    // The XML-file must not describe data that could still be lost
+    if (mSyncToDisk)
+    {
+      mPreallocatedData->sync();
+    }
+    replaceFileAtomically(mXmlPath, xml, mSyncToDisk);
+  }
+  else
+  {
+    mXmlStream << xml;
+  }
 }
 
-void DatAndXmlFiles::writeXml(std::string& xml)
+void DatAndXmlFiles::writeBytes(const uint8_t* data, const size_t size)
 {
-  mXmlStream << xml;
+  mPreallocatedData->writeAt(mDataOffset, data, size);
+  mDataOffset += size;
 }
 
 }
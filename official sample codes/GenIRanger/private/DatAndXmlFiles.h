@@ -3,64 +3,90 @@
 #ifndef GENIRANGER_DATANDXMLFILES_H
 #define GENIRANGER_DATANDXMLFILES_H
 
+#include "PreallocatedFile.h"
 #include "StreamData.h"
 
 #include <fstream>
+#include <memory>
 #include <string>
+#include <vector>
 
 namespace GenIRanger
 {
 
 /** The file format written to requires two files. A DAT-file
- * for binary data and a XML-file for other information. */
+ * for binary data and a XML-file for other information.
+ *
+ * The DAT-file is written through a PreallocatedFile, without a stream buffer
+ * in between. Several blocks of data written together with
+ * writeData(const DataSpan*, size_t) are passed to the kernel in one call
+ * where the platform allows it, otherwise one call is made per block. */
 class DatAndXmlFiles
 {
 private:
-  std::ofstream mDataStream;
+  std::unique_ptr<PreallocatedFile> mDataFile;
   std::ofstream mXmlStream;
   static const auto openMode = std::ios::binary | std::ios::trunc | std::ios::out;
 
+  // Either mDataFile or a preallocated DAT-file rewritten in place
+  PreallocatedFile* mPreallocatedData;
+  uint64_t mDataOffset;
+  // Only set when the XML-file is to be replaced atomically
+  std::string mXmlPath;
+  bool mSyncToDisk;
+
 public:
   DatAndXmlFiles(std::string filePathWithNoEnding);
 
+  /** Rewrites an already open DAT-file from its start, without truncating
+      it. The XML-file is replaced atomically when written.
+
+      If syncToDisk, the DAT-file is flushed to disk before the XML-file is
+      replaced, and the XML-file is flushed as well. The pair is then intact
+      after a power loss. Otherwise nothing waits for the disk.
+  */
+  DatAndXmlFiles(std::string filePathWithNoEnding,
+                 PreallocatedFile& preallocatedData,
+                 bool syncToDisk);
+
   virtual ~DatAndXmlFiles();
 
   /** Write data to DAT-file. */
   template<class SIZE>
   void writeData(const uint8_t* data, const SIZE size)
   {
-    mDataStream.write(
-      reinterpret_cast<const char*>(data),
-      static_cast<const size_t>(size));
+    writeBytes(data, static_cast<const size_t>(size));
   }
 
   /** Write Component data to DAT-file. */
   void writeData(ComponentPtr& component);
 
+  /** Write several blocks of data back to back to DAT-file. */
+  void writeData(const DataSpan* spans, const size_t count);
+
   /** Write line mark data, a.k.a GigEVision line chunk data, to DAT-file.
-  * Each line mark data consists of 5 values, each 4 bytes (32 bits) in size.
-  * They are ordered in the following sequence for each line (profile) in data:
-  *
-  * <ol>
-  * <li>Encoder value
-  * <li>Status bits (zero-indexed from lsb):
-  *     <ul>
-  *     <li> Bit 16-23: Overtrig
-  *     <li> Bit 27: Encoder B
-  *     <li> Bit 28: Encoder A
-  *     <li> Bit 30: Enable
-  *     </ul>
-  * <li>Sample time stamp
-  * <li>Encoder pulse time stamp
-  * <li>Camera scan ID
-  * </ol>
+  * Each line mark data consists of 5 values, each 4 bytes (32 bits) in size,
+  * ordered as in LineMark. All lines are written in one go.
   */
-  void writeMarkData(LineMetadataPtr encoderValues);
+  void writeMarkData(const LineMarks& marks);
 
-  void writeSingleMarkValue(const Metadata value);
+  /** Formats line mark data from encoder values only. The other values of
+  * each line are zero. */
+  static void formatMarkData(LineMetadataPtr encoderValues, LineMarks& marks);
 
   /** Write XML string content to XML-file. */
-  void writeXml(std::string& xml);
+  void writeXml(const std::string& xml);
+
+  /** Number of bytes written to the DAT-file. */
+  uint64_t dataSize() const { return mDataOffset; }
+
+  /** Continues writing the DAT-file at an earlier size, e.g., to discard a
+      partially written frame. Data after it is overwritten by later writes.
+  */
+  void rewindData(uint64_t size) { mDataOffset = size; }
+
+private:
+  void writeBytes(const uint8_t* data, const size_t size);
 };
 
 }
@@ -0,0 +1,716 @@
+// Copyright 2018 SICK AG. All rights reserved.
+
+#include "DatXmlReader.h"
+#include "Exceptions.h"
+#include "FrameIndexFile.h"
+#include "MappedFile.h"
+#include "PixelConversion.h"
+#include "RangeCodec.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <stdint.h>
+
+namespace GenIRanger
+{
+
+namespace
+{
+
+/** An element of the XML-file, with the text of all its content. */
+struct XmlElement
+{
+  std::string mTag;
+  std::map<std::string, std::string> mAttributes;
+  std::string mText;
+  std::vector<XmlElement> mChildren;
+};
+
+/** A minimal XML parser, sufficient for the icon_data_format files written
+    by DatXmlWriter and any arbitrary XML added to them. Entities, DTDs and
+    CDATA sections are not supported.
+*/
+class XmlParser
+{
+public:
+  XmlParser(const std::string& xml) : mXml(xml), mPos(0) {}
+
+  XmlElement parseDocument()
+  {
+    skipProlog();
+    XmlElement root;
+    parseElement(root);
+    return root;
+  }
+
+private:
+  void fail()
+  {
+    std::stringstream ss;
+    ss << "Invalid XML at character " << mPos;
+    throw LoadException(ss.str());
+  }
+
+  bool startsWith(const char* text) const
+  {
+    return mXml.compare(mPos, std::char_traits<char>::length(text), text) == 0;
+  }
+
+  void skipPast(const char* text)
+  {
+    size_t end = mXml.find(text, mPos);
+    if (end == std::string::npos)
+    {
+      fail();
+    }
+    mPos = end + std::char_traits<char>::length(text);
+  }
+
+  void skipSpace()
+  {
+    while (mPos < mXml.size() && isspace(static_cast<unsigned char>(mXml[mPos])))
+    {
+      ++mPos;
+    }
+  }
+
+  void skipProlog()
+  {
+    for (;;)
+    {
+      skipSpace();
+      if (startsWith("<?"))
+      {
+        skipPast("?>");
+      }
+      else if (startsWith("<!--"))
+      {
+        skipPast("-->");
+      }
+      else
+      {
+        return;
+      }
+    }
+  }
+
+  void expect(char c)
+  {
+    if (mPos >= mXml.size() || mXml[mPos] != c)
+    {
+      fail();
+    }
+    ++mPos;
+  }
+
+  std::string parseName()
+  {
+    size_t begin = mPos;
+    while (mPos < mXml.size()
+           && !isspace(static_cast<unsigned char>(mXml[mPos]))
+           && mXml[mPos] != '>' && mXml[mPos] != '/' && mXml[mPos] != '=')
+    {
+      ++mPos;
+    }
+    if (mPos == begin)
+    {
+      fail();
+    }
+    return mXml.substr(begin, mPos - begin);
+  }
+
+  void parseElement(XmlElement& element)
+  {
+    expect('<');
+    element.mTag = parseName();
+
+    // Attributes
+    for (;;)
+    {
+      skipSpace();
+      if (startsWith("/>"))
+      {
+        mPos += 2;
+        return;
+      }
+      if (startsWith(">"))
+      {
+        ++mPos;
+        break;
+      }
+      std::string name = parseName();
+      skipSpace();
+      expect('=');
+      skipSpace();
+      if (mPos >= mXml.size() || (mXml[mPos] != '"' && mXml[mPos] != '\''))
+      {
+        fail();
+      }
+      const char quote = mXml[mPos++];
+      size_t end = mXml.find(quote, mPos);
+      if (end == std::string::npos)
+      {
+        fail();
+      }
+      element.mAttributes[name] = mXml.substr(mPos, end - mPos);
+      mPos = end + 1;
+    }
+
+    // Content
+    for (;;)
+    {
+      if (mPos >= mXml.size())
+      {
+        fail();
+      }
+      if (startsWith("</"))
+      {
+        mPos += 2;
+        if (parseName() != element.mTag)
+        {
+          fail();
+        }
+        skipSpace();
+        expect('>');
+        return;
+      }
+      if (startsWith("<!--"))
+      {
+        skipPast("-->");
+      }
+      else if (startsWith("<?"))
+      {
+        skipPast("?>");
+      }
+      else if (mXml[mPos] == '<')
+      {
+        element.mChildren.push_back(XmlElement());
+        parseElement(element.mChildren.back());
+      }
+      else
+      {
+        size_t end = mXml.find('<', mPos);
+        if (end == std::string::npos)
+        {
+          fail();
+        }
+        element.mText += mXml.substr(mPos, end - mPos);
+        mPos = end;
+      }
+    }
+  }
+
+private:
+  const std::string& mXml;
+  size_t mPos;
+};
+
+std::string attribute(const XmlElement& element, const std::string& name)
+{
+  auto it = element.mAttributes.find(name);
+  return it == element.mAttributes.end() ? std::string() : it->second;
+}
+
+/** Returns the first child with the tag, or nullptr. */
+const XmlElement* findChild(const XmlElement& element, const std::string& tag)
+{
+  for (size_t i = 0; i < element.mChildren.size(); ++i)
+  {
+    if (element.mChildren[i].mTag == tag)
+    {
+      return &element.mChildren[i];
+    }
+  }
+  return nullptr;
+}
+
+const XmlElement* findParameter(const XmlElement& element,
+                                const std::string& name)
+{
+  for (size_t i = 0; i < element.mChildren.size(); ++i)
+  {
+    const XmlElement& child = element.mChildren[i];
+    if (child.mTag == "parameter" && attribute(child, "name") == name)
+    {
+      return &child;
+    }
+  }
+  return nullptr;
+}
+
+uint64_t numberParameter(const XmlElement& element, const std::string& name)
+{
+  const XmlElement* parameter = findParameter(element, name);
+  if (parameter == nullptr)
+  {
+    throw LoadException("Missing parameter in XML-file: '" + name + "'");
+  }
+  std::stringstream ss(parameter->mText);
+  uint64_t value = 0;
+  ss >> value;
+  if (ss.fail())
+  {
+    throw LoadException("Invalid value of parameter in XML-file: '"
+                        + name + "'");
+  }
+  return value;
+}
+
+}
+
+DatXmlReader::DatXmlReader(const std::string& filePath)
+  : mWidth(0)
+  , mAoiHeight(0)
+  , mAoiOffsetX(0)
+  , mAoiOffsetY(0)
+  , mRangeWidth(PixelWidth::PW16)
+  , mLinesPerFrame(0)
+  , mFrameCount(0)
+  , mFrameSize(0)
+  , mFrameIndex(nullptr)
+{
+  const std::string xmlPath = filePath + ".xml";
+  std::ifstream xmlFile(xmlPath, std::ios::binary);
+  if (!xmlFile)
+  {
+    throw LoadException("Unable to open file for reading: '" + xmlPath + "'");
+  }
+  std::stringstream xml;
+  xml << xmlFile.rdbuf();
+  const std::string xmlString = xml.str();
+  XmlElement root = XmlParser(xmlString).parseDocument();
+
+  if (root.mTag != "icon_data_format")
+  {
+    throw LoadException("Not a dat/xml description: '" + xmlPath + "'");
+  }
+  const XmlElement* layout = findParameter(root, "layout");
+  const XmlElement* component = findChild(root, "component");
+  if (layout == nullptr || layout->mText != "SUBCOMPONENT"
+      || component == nullptr || attribute(*component, "valuetype") != "Hi3D")
+  {
+    throw LoadException("Not range data: '" + xmlPath + "'");
+  }
+
+  const XmlElement* traits = findChild(*component, "sensorrangetraits");
+  if (traits == nullptr)
+  {
+    throw LoadException("Missing sensor range traits: '" + xmlPath + "'");
+  }
+  // The z range covers the AOI height with 1/16 sub-pixel accuracy
+  mAoiHeight = static_cast<size_t>((numberParameter(*traits, "fov z2") + 1) / 16);
+  mAoiOffsetX = static_cast<size_t>(numberParameter(*traits, "origin x"));
+  mAoiOffsetY = static_cast<size_t>(numberParameter(*traits, "origin z"));
+
+  // Offsets are per line until the number of lines per frame is known
+  uint64_t lineSize = 0;
+  for (size_t i = 0; i < component->mChildren.size(); ++i)
+  {
+    const XmlElement& child = component->mChildren[i];
+    if (child.mTag != "subcomponent")
+    {
+      continue;
+    }
+    SubComponent subComponent;
+    subComponent.mName = attribute(child, "name");
+    subComponent.mSize = static_cast<size_t>(numberParameter(child, "size"));
+    subComponent.mOffset = lineSize;
+    subComponent.mEncoding = Encoding::Raw;
+    const XmlElement* encoding = findParameter(child, "encoding");
+    if (encoding != nullptr)
+    {
+      if (encoding->mText != "LINEDELTA" || subComponent.mName == "Mark"
+          || attribute(child, "valuetype") == "WORD12P")
+      {
+        throw LoadException("Unsupported " + subComponent.mName
+                            + " encoding: '" + xmlPath + "'");
+      }
+      subComponent.mEncoding = Encoding::LineDelta;
+    }
+    mSubComponents.push_back(subComponent);
+    lineSize += subComponent.mSize;
+
+    if (subComponent.mName == "Range")
+    {
+      mWidth = static_cast<size_t>(numberParameter(child, "width"));
+      const std::string valueType = attribute(child, "valuetype");
+      if (valueType == "WORD" && subComponent.mSize == mWidth * 2)
+      {
+        mRangeWidth = PixelWidth::PW16;
+      }
+      else if (valueType == "WORD12P" && mWidth % 2 == 0
+               && subComponent.mSize == mWidth * 3 / 2)
+      {
+        mRangeWidth = PixelWidth::PW12;
+      }
+      else
+      {
+        throw LoadException("Unsupported range format: '" + xmlPath + "'");
+      }
+    }
+    else if ((subComponent.mName == "Intensity"
+              || subComponent.mName == "Scatter")
+             && subComponent.mSize != mWidth)
+    {
+      throw LoadException("Unsupported " + subComponent.mName + " format: '"
+                          + xmlPath + "'");
+    }
+    else if (subComponent.mName == "Mark"
+             && subComponent.mSize != sizeof(LineMark))
+    {
+      throw LoadException("Unsupported mark format: '" + xmlPath + "'");
+    }
+  }
+  if (findSubComponent("Range") == nullptr)
+  {
+    throw LoadException("Missing range data: '" + xmlPath + "'");
+  }
+  if (lineSize != numberParameter(root, "size") || lineSize == 0)
+  {
+    throw LoadException("Inconsistent line size: '" + xmlPath + "'");
+  }
+
+  bool isEncoded = false;
+  for (size_t i = 0; i < mSubComponents.size(); ++i)
+  {
+    isEncoded = isEncoded || mSubComponents[i].mEncoding != Encoding::Raw;
+  }
+  if (isEncoded
+      && (mWidth == 0 || findParameter(root, "line count") == nullptr))
+  {
+    throw LoadException("Unsupported compressed data: '" + xmlPath + "'");
+  }
+
+  mDatFile = std::make_shared<MappedFile>(filePath + ".dat");
+
+  // A recording, or a compressed frame, states its line count and stores one
+  // block of subcomponents per frame. Otherwise the whole file is a single
+  // frame.
+  uint64_t lineCount = 0;
+  if (findParameter(root, "line count") != nullptr)
+  {
+    lineCount = numberParameter(root, "line count");
+    mLinesPerFrame = static_cast<size_t>(numberParameter(*component, "height"));
+  }
+  else
+  {
+    lineCount = mDatFile->size() / lineSize;
+    mLinesPerFrame = static_cast<size_t>(lineCount);
+  }
+  if (!isEncoded && lineCount * lineSize > mDatFile->size())
+  {
+    throw LoadException("DAT-file is smaller than described: '"
+                        + mDatFile->path() + "'");
+  }
+  mFrameCount = mLinesPerFrame == 0
+    ? 0 : static_cast<size_t>(lineCount / mLinesPerFrame);
+  mFrameSize = mLinesPerFrame * lineSize;
+  for (size_t i = 0; i < mSubComponents.size(); ++i)
+  {
+    mSubComponents[i].mOffset *= mLinesPerFrame;
+  }
+  if (isEncoded)
+  {
+    locateEncodedBlocks();
+  }
+
+  uint64_t indexCount = 0;
+  mFrameIndex = FrameIndexFile::find(mDatFile->data(), mDatFile->size(),
+                                     indexCount);
+  if (mFrameIndex != nullptr && indexCount != mFrameCount)
+  {
+    throw LoadException("Frame index does not match the XML-file: '"
+                        + mDatFile->path() + "'");
+  }
+}
+
+void DatXmlReader::locateEncodedBlocks()
+{
+  // Compressed blocks vary in size, so the blocks are located by stepping
+  // through the file, reading only the header of each compressed block
+  const uint8_t* data = mDatFile->data();
+  const uint64_t fileSize = mDatFile->size();
+  uint64_t offset = 0;
+  mBlockOffsets.reserve(mFrameCount * mSubComponents.size() + 1);
+  for (size_t frame = 0; frame < mFrameCount; ++frame)
+  {
+    for (size_t i = 0; i < mSubComponents.size(); ++i)
+    {
+      const SubComponent& subComponent = mSubComponents[i];
+      mBlockOffsets.push_back(offset);
+      uint64_t size = subComponent.mSize * mLinesPerFrame;
+      if (subComponent.mEncoding != Encoding::Raw)
+      {
+        size = RangeCodec::encodedSize(data + offset, fileSize - offset);
+      }
+      if (size > fileSize - offset)
+      {
+        throw LoadException("DAT-file is smaller than described: '"
+                            + mDatFile->path() + "'");
+      }
+      offset += size;
+    }
+  }
+  mBlockOffsets.push_back(offset);
+}
+
+DatXmlReader::~DatXmlReader()
+{
+  // Empty
+}
+
+size_t DatXmlReader::frameCount() const
+{
+  return mFrameCount;
+}
+
+size_t DatXmlReader::linesPerFrame() const
+{
+  return mLinesPerFrame;
+}
+
+Size2D DatXmlReader::aoiSize() const
+{
+  return Size2D(mWidth, mAoiHeight);
+}
+
+Size2D DatXmlReader::aoiOffset() const
+{
+  return Size2D(mAoiOffsetX, mAoiOffsetY);
+}
+
+PixelWidth DatXmlReader::rangePixelWidth() const
+{
+  return mRangeWidth;
+}
+
+bool DatXmlReader::hasReflectance() const
+{
+  return findSubComponent("Intensity") != nullptr;
+}
+
+bool DatXmlReader::hasScatter() const
+{
+  return findSubComponent("Scatter") != nullptr;
+}
+
+bool DatXmlReader::hasMarkData() const
+{
+  return findSubComponent("Mark") != nullptr;
+}
+
+RangeFrame DatXmlReader::frame(size_t index) const
+{
+  if (index >= mFrameCount)
+  {
+    throw LoadException("Frame index out of range");
+  }
+
+  // Each view keeps the mapping alive
+  std::shared_ptr<MappedFile> datFile = mDatFile;
+  ReleaseCallback release = [datFile](uint8_t*) {};
+
+  RangeFrame frame;
+  frame
+    .aoiOffset(mAoiOffsetX, mAoiOffsetY)
+    .aoiSize(mWidth, mAoiHeight);
+
+  // Compressed components are decoded to data owned by the frame, with the
+  // encoding kept so that saving the frame compresses them again
+  const SubComponent* range = findSubComponent("Range");
+  if (range->mEncoding != Encoding::Raw)
+  {
+    frame.createRange(decodeBlock(index, range), mRangeWidth);
+    frame.range()->encoding(range->mEncoding);
+  }
+  else
+  {
+    frame.createRangeView(blockData(index, range),
+                          range->mSize * mLinesPerFrame,
+                          mRangeWidth,
+                          release);
+  }
+  const SubComponent* reflectance = findSubComponent("Intensity");
+  if (reflectance != nullptr && reflectance->mEncoding != Encoding::Raw)
+  {
+    frame.createReflectance(decodeBlock(index, reflectance), PixelWidth::PW8);
+    frame.reflectance()->encoding(reflectance->mEncoding);
+  }
+  else if (reflectance != nullptr)
+  {
+    frame.createReflectanceView(blockData(index, reflectance),
+                                reflectance->mSize * mLinesPerFrame,
+                                PixelWidth::PW8,
+                                release);
+  }
+  const SubComponent* scatter = findSubComponent("Scatter");
+  if (scatter != nullptr && scatter->mEncoding != Encoding::Raw)
+  {
+    frame.createScatter(decodeBlock(index, scatter), PixelWidth::PW8);
+    frame.scatter()->encoding(scatter->mEncoding);
+  }
+  else if (scatter != nullptr)
+  {
+    frame.createScatterView(blockData(index, scatter),
+                            scatter->mSize * mLinesPerFrame,
+                            PixelWidth::PW8,
+                            release);
+  }
+  const SubComponent* mark = findSubComponent("Mark");
+  if (mark != nullptr)
+  {
+    // The marks follow the other components, so they are only aligned if
+    // those happen to end on a multiple of 4 bytes. Otherwise they are
+    // copied, since LineMark values must not be read unaligned.
+    uint8_t* marks = blockData(index, mark);
+    if (reinterpret_cast<uintptr_t>(marks) % sizeof(Metadata) == 0)
+    {
+      frame.createLineMarksView(reinterpret_cast<LineMark*>(marks),
+                                mLinesPerFrame,
+                                release);
+    }
+    else
+    {
+      frame.createLineMarks(mLinesPerFrame);
+      std::copy(marks, marks + mLinesPerFrame * sizeof(LineMark),
+                reinterpret_cast<uint8_t*>(frame.lineMarkData()));
+    }
+  }
+  return frame;
+}
+
+void DatXmlReader::readRange16(size_t frameIndex,
+                               size_t firstLine,
+                               size_t lineCount,
+                               uint16_t* range16) const
+{
+  if (frameIndex >= mFrameCount || firstLine > mLinesPerFrame
+      || lineCount > mLinesPerFrame - firstLine)
+  {
+    throw LoadException("Range lines out of range");
+  }
+
+  const SubComponent* range = findSubComponent("Range");
+  const size_t size = lineCount * range->mSize;
+  if (range->mEncoding != Encoding::Raw)
+  {
+    // Lines depend on the lines before, so the whole frame is decoded
+    DataVector decoded = decodeBlock(frameIndex, range);
+    const uint8_t* lines = decoded.data() + firstLine * range->mSize;
+    std::copy(lines, lines + size, reinterpret_cast<uint8_t*>(range16));
+    return;
+  }
+
+  const uint8_t* lines = blockData(frameIndex, range)
+    + firstLine * range->mSize;
+  if (mRangeWidth == PixelWidth::PW12)
+  {
+    // The width is even, so every line starts with a complete pixel pair
+    PixelConversion::unpack12pTo16(lines, size,
+                                   reinterpret_cast<uint8_t*>(range16));
+  }
+  else
+  {
+    std::copy(lines, lines + size, reinterpret_cast<uint8_t*>(range16));
+  }
+}
+
+bool DatXmlReader::hasFrameIndex() const
+{
+  return mFrameIndex != nullptr;
+}
+
+FrameIndexEntry DatXmlReader::frameIndexEntry(size_t index) const
+{
+  if (index >= mFrameCount)
+  {
+    throw LoadException("Frame index out of range");
+  }
+  return frameIndex()[index];
+}
+
+size_t DatXmlReader::findFrameByEncoderValue(Metadata encoderValue) const
+{
+  return FrameIndexFile::search(frameIndex(), mFrameCount,
+                                &FrameIndexEntry::firstEncoderValue,
+                                &FrameIndexEntry::lastEncoderValue,
+                                encoderValue);
+}
+
+size_t DatXmlReader::findFrameByTimestamp(Metadata timestamp) const
+{
+  return FrameIndexFile::search(frameIndex(), mFrameCount,
+                                &FrameIndexEntry::firstTimestamp,
+                                &FrameIndexEntry::lastTimestamp,
+                                timestamp);
+}
+
+size_t DatXmlReader::findFrameById(Metadata frameId) const
+{
+  // Frame IDs increase, with gaps for lost frames
+  const size_t index = FrameIndexFile::search(frameIndex(), mFrameCount,
+                                              &FrameIndexEntry::frameId,
+                                              &FrameIndexEntry::frameId,
+                                              frameId);
+  return index < mFrameCount && frameIndex()[index].frameId == frameId
+    ? index : mFrameCount;
+}
+
+const FrameIndexEntry* DatXmlReader::frameIndex() const
+{
+  if (mFrameIndex == nullptr)
+  {
+    throw LoadException("The DAT-file has no frame index: '"
+                        + mDatFile->path() + "'");
+  }
+  return mFrameIndex;
+}
+
+uint8_t* DatXmlReader::blockData(size_t frameIndex,
+                                  const SubComponent* subComponent) const
+{
+  if (mBlockOffsets.empty())
+  {
+    return mDatFile->data() + frameIndex * mFrameSize + subComponent->mOffset;
+  }
+  const size_t block = frameIndex * mSubComponents.size()
+    + (subComponent - mSubComponents.data());
+  return mDatFile->data() + mBlockOffsets[block];
+}
+
+DataVector DatXmlReader::decodeBlock(size_t frameIndex,
+                                     const SubComponent* subComponent) const
+{
+  const size_t block = frameIndex * mSubComponents.size()
+    + (subComponent - mSubComponents.data());
+  const size_t bytesPerValue = subComponent->mSize / mWidth;
+  DataVector decoded(subComponent->mSize * mLinesPerFrame);
+  std::shared_ptr<ThreadPool> pool = getConversionPool();
+  RangeCodec::decode(mDatFile->data() + mBlockOffsets[block],
+                     mBlockOffsets[block + 1] - mBlockOffsets[block],
+                     mWidth,
+                     mLinesPerFrame,
+                     bytesPerValue,
+                     decoded.data(),
+                     pool.get());
+  return decoded;
+}
+
+const DatXmlReader::SubComponent*
+DatXmlReader::findSubComponent(const std::string& name) const
+{
+  for (size_t i = 0; i < mSubComponents.size(); ++i)
+  {
+    if (mSubComponents[i].mName == name)
+    {
+      return &mSubComponents[i];
+    }
+  }
+  return nullptr;
+}
+
+}
@@ -18,6 +18,7 @@ namespace GenIRanger
     Parameter: size, <size>
     Parameter: version, 1
     Parameter: layout, SUBCOMPONENT
+    Parameter: line count, <lines> (optional)
     Component 1: HorThr, <name>
       Parameter: size, <size>
       Parameter: height, <height>
@@ -35,9 +36,10 @@ namespace GenIRanger
         Parameter: scale x, <scale-x>
         Parameter: origin z, <origin z>
         Parameter: scale z, <scale z>
-      Subcomponent 1: WORD, Range
+      Subcomponent 1: WORD, Range (WORD12P if 12 bit packed)
         Parameter: size, <size>
         Parameter: width, <width>
+        Parameter: encoding, LINEDELTA (only if compressed)
     Component N ...
 
 */
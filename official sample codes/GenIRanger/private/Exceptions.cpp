@@ -6,11 +6,16 @@ namespace GenIRanger
 {
 
 GenIRangerException::GenIRangerException(const std::string& message)
-  : std::exception(message.c_str())
+  : mMessage(message)
 {
   // Empty
 }
 
+const char* GenIRangerException::what() const throw()
+{
+  return mMessage.c_str();
+}
+
 ImportException::ImportException(const std::string& message)
   : GenIRangerException(message)
 {
@@ -41,4 +46,10 @@ SaveException::SaveException(const std::string& message)
   // Empty
 }
 
+LoadException::LoadException(const std::string& message)
+  : GenIRangerException(message)
+{
+  // Empty
+}
+
 }
\ No newline at end of file
@@ -0,0 +1,123 @@
+// Copyright 2018 SICK AG. All rights reserved.
+
+#include "FrameFileRing.h"
+#include "DatAndXmlFiles.h"
+#include "Exceptions.h"
+#include "PreallocatedFile.h"
+#include "SaveBuffer.h"
+
+#include <condition_variable>
+
+namespace GenIRanger
+{
+
+/** One dat/xml file pair. The mutex is held while the pair is written.
+
+    Each save to the pair draws a ticket while the ring is locked, and waits
+    for its turn before writing, since std::mutex does not wake waiting
+    threads in order.
+*/
+struct FrameFileRing::Slot
+{
+  std::string mPath;
+  std::unique_ptr<PreallocatedFile> mDatFile;
+  std::mutex mMutex;
+  std::condition_variable mTurnChanged;
+  uint64_t mNextTicket;
+  uint64_t mTurn;
+};
+
+FrameFileRing::FrameFileRing(const std::string& basePath,
+                             size_t fileCount,
+                             uint64_t datFileSize,
+                             size_t syncInterval)
+  : mBasePath(basePath)
+  , mSyncInterval(syncInterval)
+  , mSaveCount(0)
+{
+  if (fileCount == 0)
+  {
+    throw SaveException("A file ring must have at least one file.");
+  }
+  for (size_t i = 0; i < fileCount; ++i)
+  {
+    std::unique_ptr<Slot> slot(new Slot);
+    slot->mPath = basePath + "-" + std::to_string(i + 1);
+    slot->mNextTicket = 0;
+    slot->mTurn = 0;
+    if (datFileSize > 0)
+    {
+      slot->mDatFile.reset(
+        new PreallocatedFile(slot->mPath + ".dat", datFileSize));
+    }
+    mSlots.push_back(std::move(slot));
+  }
+}
+
+FrameFileRing::~FrameFileRing()
+{
+}
+
+std::string FrameFileRing::save(RangeFrame& frame,
+                                const std::string& arbitraryXml)
+{
+  validateRangeFrame(frame);
+
+  Slot* slot;
+  uint64_t ticket;
+  bool syncToDisk;
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    slot = mSlots[mSaveCount % mSlots.size()].get();
+    ticket = slot->mNextTicket++;
+    ++mSaveCount;
+    syncToDisk = mSyncInterval != 0 && mSaveCount % mSyncInterval == 0;
+  }
+
+  std::unique_lock<std::mutex> lock(slot->mMutex);
+  while (slot->mTurn != ticket)
+  {
+    slot->mTurnChanged.wait(lock);
+  }
+  try
+  {
+    // The file only grows, for a frame larger than any before. A smaller
+    // frame leaves older data after its end, the XML-file states the line
+    // count.
+    const uint64_t frameDataSize = rangeFrameDataSize(frame);
+    if (!slot->mDatFile)
+    {
+      slot->mDatFile.reset(
+        new PreallocatedFile(slot->mPath + ".dat", frameDataSize));
+    }
+    else
+    {
+      slot->mDatFile->reserve(frameDataSize);
+    }
+
+    DatAndXmlFiles files(slot->mPath, *slot->mDatFile, syncToDisk);
+    writeRangeFrame(files, frame, arbitraryXml, PixelWidth::PW16, true);
+  }
+  catch (...)
+  {
+    // Let the next save to the pair go ahead anyway
+    ++slot->mTurn;
+    slot->mTurnChanged.notify_all();
+    throw;
+  }
+  ++slot->mTurn;
+  slot->mTurnChanged.notify_all();
+  return slot->mPath;
+}
+
+const std::string& FrameFileRing::basePath() const
+{
+  return mBasePath;
+}
+
+size_t FrameFileRing::fileCount() const
+{
+  return mSlots.size();
+}
+
+}
@@ -0,0 +1,133 @@
+// Copyright 2018 SICK AG. All rights reserved.
+
+#include "FrameIndexFile.h"
+#include "Exceptions.h"
+
+#include <string.h>
+
+namespace GenIRanger
+{
+
+namespace FrameIndexFile
+{
+
+static const char MAGIC[8] = { 'R', '3', 'I', 'N', 'D', 'E', 'X', '1' };
+
+FrameIndexEntry entryFor(RangeFrame& frame,
+                         uint64_t offset,
+                         uint64_t frameNumber)
+{
+  FrameIndexEntry entry = {};
+  entry.offset = offset;
+  entry.frameId = static_cast<Metadata>(frameNumber);
+  if (frame.hasLineMarks() && frame.lineMarkCount() > 0)
+  {
+    const LineMark& first = frame.lineMarkData()[0];
+    const LineMark& last = frame.lineMarkData()[frame.lineMarkCount() - 1];
+    entry.frameId = first.scanId;
+    entry.firstEncoderValue = first.encoderValue;
+    entry.lastEncoderValue = last.encoderValue;
+    entry.firstTimestamp = first.sampleTimestamp;
+    entry.lastTimestamp = last.sampleTimestamp;
+  }
+  else if (frame.lineEncoderValues() && !frame.lineEncoderValues()->empty())
+  {
+    entry.firstEncoderValue = frame.lineEncoderValues()->front();
+    entry.lastEncoderValue = frame.lineEncoderValues()->back();
+  }
+  return entry;
+}
+
+void write(DatAndXmlFiles& files,
+           const std::vector<FrameIndexEntry>& entries)
+{
+  const uint8_t padding[8] = {};
+  const size_t paddingSize = (8 - files.dataSize() % 8) % 8;
+  const uint64_t indexOffset = files.dataSize() + paddingSize;
+
+  uint8_t footer[FOOTER_SIZE];
+  const uint64_t entryCount = entries.size();
+  memcpy(footer, &entryCount, 8);
+  memcpy(footer + 8, &indexOffset, 8);
+  memcpy(footer + 16, MAGIC, 8);
+
+  DataSpan spans[3] = {
+    { padding, paddingSize },
+    { reinterpret_cast<const uint8_t*>(entries.data()),
+      entries.size() * sizeof(FrameIndexEntry) },
+    { footer, FOOTER_SIZE }
+  };
+  files.writeData(spans, 3);
+}
+
+const FrameIndexEntry* find(const uint8_t* data,
+                            uint64_t size,
+                            uint64_t& entryCount)
+{
+  entryCount = 0;
+  if (size < FOOTER_SIZE
+      || memcmp(data + size - 8, MAGIC, sizeof(MAGIC)) != 0)
+  {
+    return nullptr;
+  }
+  uint64_t count;
+  uint64_t indexOffset;
+  memcpy(&count, data + size - FOOTER_SIZE, 8);
+  memcpy(&indexOffset, data + size - FOOTER_SIZE + 8, 8);
+  if (indexOffset % 8 != 0
+      || indexOffset > size - FOOTER_SIZE
+      || count != (size - FOOTER_SIZE - indexOffset) / sizeof(FrameIndexEntry)
+      || (size - FOOTER_SIZE - indexOffset) % sizeof(FrameIndexEntry) != 0)
+  {
+    throw LoadException("Frame index is corrupt.");
+  }
+  entryCount = count;
+  return reinterpret_cast<const FrameIndexEntry*>(data + indexOffset);
+}
+
+size_t search(const FrameIndexEntry* entries,
+              size_t entryCount,
+              Metadata FrameIndexEntry::*first,
+              Metadata FrameIndexEntry::*last,
+              Metadata value)
+{
+  if (entryCount == 0)
+  {
+    return 0;
+  }
+  // Values are compared by their distance from the start, in the direction
+  // the values move, which handles wrapping around
+  const Metadata start = entries[0].*first;
+  const bool decreasing
+    = static_cast<int32_t>(entries[entryCount - 1].*last - start) < 0;
+  auto distance = [=](Metadata v) -> Metadata
+  {
+    return decreasing ? start - v : v - start;
+  };
+
+  const Metadata target = distance(value);
+  // Find the first entry starting after the value
+  size_t low = 0;
+  size_t high = entryCount;
+  while (low < high)
+  {
+    const size_t middle = low + (high - low) / 2;
+    if (distance(entries[middle].*first) <= target)
+    {
+      low = middle + 1;
+    }
+    else
+    {
+      high = middle;
+    }
+  }
+  if (low == 0 || distance(entries[low - 1].*last) < target)
+  {
+    return entryCount;
+  }
+  return low - 1;
+}
+
+}
+
+}
@@ -0,0 +1,62 @@
+// Copyright 2018 SICK AG. All rights reserved.
+
+#ifndef GENIRANGER_FRAMEINDEXFILE_H
+#define GENIRANGER_FRAMEINDEXFILE_H
+
+#include "DatAndXmlFiles.h"
+#include "StreamData.h"
+
+#include <vector>
+
+namespace GenIRanger
+{
+
+/** The frame index at the end of a recorded DAT-file.
+
+    The index follows the last frame, padded to start at a multiple of 8
+    bytes, so that it can be used in place when the file is mapped:
+
+      FrameIndexEntry entries[entryCount]
+      uint64 entryCount
+      uint64 byte offset of the first entry
+      char[8] "R3INDEX1"
+
+    The index is only written when a recording is closed. Since the footer
+    is at the very end of the file, a file without it, e.g., after a crash,
+    is recognized as having no index.
+*/
+namespace FrameIndexFile
+{
+  /** Size of the fixed part following the entries. */
+  const size_t FOOTER_SIZE = 24;
+
+  /** Summarizes the line marks or encoder values of a frame. */
+  FrameIndexEntry entryFor(RangeFrame& frame,
+                           uint64_t offset,
+                           uint64_t frameNumber);
+
+  /** Appends the index to the DAT-file. */
+  void write(DatAndXmlFiles& files,
+             const std::vector<FrameIndexEntry>& entries);
+
+  /** Returns the entries of the index at the end of the data, or nullptr if
+      there is none. Throws LoadException if the index is corrupt.
+  */
+  const FrameIndexEntry* find(const uint8_t* data,
+                              uint64_t size,
+                              uint64_t& entryCount);
+
+  /** Binary search for the last entry where the first value is at or before
+      value, with values increasing or decreasing from the first entry and
+      wrapping around at 32 bits. Returns entryCount if value is before the
+      first entry or after the last value of the entry found.
+  */
+  size_t search(const FrameIndexEntry* entries,
+                size_t entryCount,
+                Metadata FrameIndexEntry::*first,
+                Metadata FrameIndexEntry::*last,
+                Metadata value);
+}
+
+}
+#endif
@@ -0,0 +1,190 @@
+// Copyright 2018 SICK AG. All rights reserved.
+
+#include "FramePool.h"
+#include "Exceptions.h"
+#include "PixelConversion.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+namespace GenIRanger
+{
+
+namespace
+{
+
+// Components start on a cache line, which also suits the vector kernels
+const size_t COMPONENT_ALIGNMENT = 64;
+
+size_t aligned(size_t size)
+{
+  return (size + COMPONENT_ALIGNMENT - 1) / COMPONENT_ALIGNMENT
+         * COMPONENT_ALIGNMENT;
+}
+
+}
+
+struct FramePool::Slot
+{
+  // Allocated with new[] without (), so that it is never zeroed
+  std::unique_ptr<uint8_t[]> mStorage;
+  LineMarks mLineMarks;
+};
+
+struct FramePool::State
+{
+  std::vector<std::unique_ptr<Slot>> mSlots;
+  std::vector<Slot*> mFree;
+  mutable std::mutex mMutex;
+  std::condition_variable mReleased;
+
+  void release(Slot* slot)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mFree.push_back(slot);
+    }
+    mReleased.notify_one();
+  }
+};
+
+FramePool::FramePool(size_t frameCount,
+                     size_t width,
+                     size_t lineCount,
+                     size_t aoiHeight,
+                     PixelWidth rangeWidth,
+                     bool reflectance,
+                     bool scatter,
+                     bool lineMarks)
+  : mWidth(width)
+  , mLineCount(lineCount)
+  , mAoiHeight(aoiHeight)
+  , mRangeWidth(rangeWidth)
+  , mReflectance(reflectance)
+  , mScatter(scatter)
+  , mLineMarks(lineMarks)
+  , mState(std::make_shared<State>())
+{
+  if (rangeWidth != PixelWidth::PW16 && rangeWidth != PixelWidth::PW12)
+  {
+    throw GenIRangerException(
+      "Frame pool range data must have pixel width 16 or 12.");
+  }
+  if (frameCount == 0 || width == 0 || lineCount == 0)
+  {
+    throw GenIRangerException(
+      "Frame pool must have at least one frame of at least one pixel.");
+  }
+
+  const size_t pixelCount = width * lineCount;
+  const size_t rangeSize = rangeWidth == PixelWidth::PW16
+    ? pixelCount * 2
+    : PixelConversion::packed12pSize(pixelCount);
+  const size_t storageSize = aligned(rangeSize)
+                             + (reflectance ? aligned(pixelCount) : 0)
+                             + (scatter ? aligned(pixelCount) : 0);
+
+  mState->mSlots.reserve(frameCount);
+  mState->mFree.reserve(frameCount);
+  for (size_t i = 0; i < frameCount; ++i)
+  {
+    std::unique_ptr<Slot> slot(new Slot);
+    // Room to align the start, new[] only guarantees the alignment of the
+    // largest fundamental type
+    slot->mStorage.reset(new uint8_t[storageSize + COMPONENT_ALIGNMENT]);
+    if (lineMarks)
+    {
+      slot->mLineMarks.resize(lineCount);
+    }
+    mState->mFree.push_back(slot.get());
+    mState->mSlots.push_back(std::move(slot));
+  }
+}
+
+FramePool::~FramePool()
+{
+  // Empty, frames in use keep the state alive
+}
+
+RangeFrame FramePool::acquire()
+{
+  Slot* slot;
+  {
+    std::unique_lock<std::mutex> lock(mState->mMutex);
+    mState->mReleased.wait(lock, [this] { return !mState->mFree.empty(); });
+    slot = mState->mFree.back();
+    mState->mFree.pop_back();
+  }
+  return frameFor(slot);
+}
+
+bool FramePool::tryAcquire(RangeFrame& frame)
+{
+  Slot* slot;
+  {
+    std::lock_guard<std::mutex> lock(mState->mMutex);
+    if (mState->mFree.empty())
+    {
+      return false;
+    }
+    slot = mState->mFree.back();
+    mState->mFree.pop_back();
+  }
+  frame = frameFor(slot);
+  return true;
+}
+
+size_t FramePool::available() const
+{
+  std::lock_guard<std::mutex> lock(mState->mMutex);
+  return mState->mFree.size();
+}
+
+size_t FramePool::frameCount() const
+{
+  return mState->mSlots.size();
+}
+
+RangeFrame FramePool::frameFor(Slot* slot)
+{
+  // The slot returns to the pool when the last component or line marks
+  // referring to it is released
+  std::shared_ptr<State> state = mState;
+  std::shared_ptr<Slot> token(slot, [state](Slot* s) { state->release(s); });
+  ReleaseCallback release = [token](uint8_t*) {};
+
+  const size_t pixelCount = mWidth * mLineCount;
+  const size_t rangeSize = mRangeWidth == PixelWidth::PW16
+    ? pixelCount * 2
+    : PixelConversion::packed12pSize(pixelCount);
+  uint8_t* storage = slot->mStorage.get();
+  storage += (COMPONENT_ALIGNMENT
+              - reinterpret_cast<uintptr_t>(storage) % COMPONENT_ALIGNMENT)
+             % COMPONENT_ALIGNMENT;
+
+  RangeFrame frame;
+  frame.aoiSize(mWidth, mAoiHeight);
+  frame.createRangeView(storage, rangeSize, mRangeWidth, release);
+  storage += aligned(rangeSize);
+  if (mReflectance)
+  {
+    frame.createReflectanceView(storage, pixelCount, PixelWidth::PW8, release);
+    storage += aligned(pixelCount);
+  }
+  if (mScatter)
+  {
+    frame.createScatterView(storage, pixelCount, PixelWidth::PW8, release);
+  }
+  if (mLineMarks)
+  {
+    // Shares ownership with the token, the vector itself stays in the slot.
+    // A previous user may have resized it, which does not reallocate.
+    slot->mLineMarks.resize(mLineCount);
+    LineMarksPtr lineMarks(token, &slot->mLineMarks);
+    frame.lineMarks(lineMarks);
+  }
+  return frame;
+}
+
+}
@@ -108,98 +108,4 @@ GENIRANGER_API void importDeviceParameters(INodeMap* const nodeMap,
 
 }
 
-GENIRANGER_API void convert12pTo16(
-  const uint8_t* inBuffer,
-  const int64_t inSize,
-  uint8_t* outBuffer,
-  int64_t* inOutSize)
-{
-  int64_t i = 0;
-  int64_t bytesWritten = 0;
-  do
-  {
-    uint8_t b1 = *inBuffer++;
-    uint8_t b2 = *inBuffer++;
-    uint8_t b3 = *inBuffer++;
-
-    // Pixel 1
-    uint8_t bo1 = b1;
-    uint8_t bo2 = b2 & 0x0F;
-
-    // Pixel 2
-    uint8_t bo3 = ((b2 & 0xF0) >> 4) | (b3 & 0x0F) << 4;
-    uint8_t bo4 = (b3 & 0xF0) >> 4;
-
-    bytesWritten = bytesWritten + 4;
-    if (bytesWritten > *inOutSize)
-    {
-      std::stringstream ss;
-      ss << "Buffer overrun, provided buffer with size " << *inOutSize
-         << " cannot hold the unpacked data";
-      throw GenIRangerException(ss.str());
-    }
-    *outBuffer++ = bo1;
-    *outBuffer++ = bo2;
-    *outBuffer++ = bo3;
-    *outBuffer++ = bo4;
-
-    i = i + 3;
-  } while (i < inSize);
-  *inOutSize = bytesWritten;
-}
-
-GENIRANGER_API void convert16To12p(
-  const uint16_t* inBuffer,
-  const int64_t inSize,
-  uint8_t* outBuffer,
-  int64_t* inOutSize)
-{
-  if (inSize % 2 != 0)
-  {
-    throw GenIRangerException("Size of a 16 bit input buffer must be even");
-  }
-
-  uint8_t packedBytes[3];
-  int64_t outsize = 0;
-  int64_t numBytes = 0;
-  uint8_t packed = 0;
-
-  do
-  {
-    // LSB oriented version
-    if (packed == 0)
-    {
-      // 8 lsb bits to byte 0
-      packedBytes[0] = *inBuffer & 0x00FF;
-
-      // 4 msb bits to byte 1, low nibble
-      packedBytes[1] = (*inBuffer & 0x0F00) >> 8;
-      packed = 2;
-    }
-    else
-    {
-      // 4 lsb bits to byte 1, high nibble
-      packedBytes[1] = packedBytes[1] | (*inBuffer & 0x000F) << 4;
-
-      // 8 msb bits to byte 2
-      packedBytes[2] = (*inBuffer & 0xFFF0) >> 4;
-
-      outsize = outsize + 3;
-      if (outsize > *inOutSize)
-      {
-        throw GenIRangerException("Output buffer size insufficient");
-      }
-      // 3 bytes ready, write out
-      for (uint8_t k = 0; k < 3; ++k)
-      {
-        *outBuffer++ = packedBytes[k];
-      }
-      packed = 0;
-    }
-    inBuffer++;
-    numBytes = numBytes + 2;
-  } while (numBytes < inSize);
-  *inOutSize = outsize;
-}
-
 }
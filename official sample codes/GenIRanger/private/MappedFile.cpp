@@ -0,0 +1,137 @@
+// Copyright 2018 SICK AG. All rights reserved.
+
+#include "MappedFile.h"
+#include "Exceptions.h"
+
+#include <sstream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace GenIRanger
+{
+
+namespace
+{
+
+void throwFileError(const std::string& what, const std::string& path)
+{
+  std::stringstream ss;
+  ss << what << ": '" << path << "'";
+  throw LoadException(ss.str());
+}
+
+}
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string& path)
+  : mPath(path)
+  , mData(nullptr)
+  , mSize(0)
+  , mMapping(nullptr)
+{
+  // Allow the file to be read while it is still being written, e.g., by a
+  // ScanRecorder
+  HANDLE file = CreateFileA(path.c_str(),
+                            GENERIC_READ,
+                            FILE_SHARE_READ | FILE_SHARE_WRITE,
+                            nullptr,
+                            OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL,
+                            nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+  {
+    throwFileError("Unable to open file for reading", path);
+  }
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size))
+  {
+    CloseHandle(file);
+    throwFileError("Unable to tell file size", path);
+  }
+  mSize = static_cast<uint64_t>(size.QuadPart);
+  if (mSize == 0)
+  {
+    CloseHandle(file);
+    return;
+  }
+
+  // The mapping keeps the file open
+  mMapping = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+  CloseHandle(file);
+  if (mMapping == nullptr)
+  {
+    throwFileError("Unable to map file", path);
+  }
+  mData = static_cast<uint8_t*>(MapViewOfFile(mMapping, FILE_MAP_COPY,
+                                              0, 0, 0));
+  if (mData == nullptr)
+  {
+    CloseHandle(mMapping);
+    throwFileError("Unable to map file", path);
+  }
+}
+
+MappedFile::~MappedFile()
+{
+  if (mData != nullptr)
+  {
+    UnmapViewOfFile(mData);
+    CloseHandle(mMapping);
+  }
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& path)
+  : mPath(path)
+  , mData(nullptr)
+  , mSize(0)
+{
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+  {
+    throwFileError("Unable to open file for reading", path);
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0)
+  {
+    close(fd);
+    throwFileError("Unable to tell file size", path);
+  }
+  mSize = static_cast<uint64_t>(info.st_size);
+  if (mSize == 0)
+  {
+    close(fd);
+    return;
+  }
+
+  // The mapping keeps the file open
+  void* data = mmap(nullptr, static_cast<size_t>(mSize),
+                    PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED)
+  {
+    throwFileError("Unable to map file", path);
+  }
+  mData = static_cast<uint8_t*>(data);
+}
+
+MappedFile::~MappedFile()
+{
+  if (mData != nullptr)
+  {
+    munmap(mData, static_cast<size_t>(mSize));
+  }
+}
+
+#endif
+
+}
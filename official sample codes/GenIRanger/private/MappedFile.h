@@ -0,0 +1,49 @@
+// Copyright 2018 SICK AG. All rights reserved.
+
+#ifndef GENIRANGER_MAPPEDFILE_H
+#define GENIRANGER_MAPPEDFILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+namespace GenIRanger
+{
+
+/** A whole file mapped into memory for reading.
+
+    Mapping is immediate regardless of the file size, pages are read from disk
+    only when they are first accessed. The mapping is copy-on-write, so the
+    data may be modified in memory without changing the file. Throws
+    LoadException on errors.
+*/
+class MappedFile
+{
+public:
+  explicit MappedFile(const std::string& path);
+
+  ~MappedFile();
+
+  const std::string& path() const { return mPath; }
+
+  /** The start of the file contents, nullptr for an empty file. */
+  uint8_t* data() const { return mData; }
+
+  /** The size of the file in bytes, when it was mapped. */
+  uint64_t size() const { return mSize; }
+
+private:
+  MappedFile(const MappedFile&);
+  MappedFile& operator=(const MappedFile&);
+
+private:
+  std::string mPath;
+  uint8_t* mData;
+  uint64_t mSize;
+#ifdef _WIN32
+  void* mMapping;
+#endif
+};
+
+}
+#endif
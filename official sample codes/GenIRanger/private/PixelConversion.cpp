@@ -0,0 +1,380 @@
+// Copyright 2018 SICK AG. All rights reserved.
+
+#include "PixelConversion.h"
+#include "CpuFeatures.h"
+
+#include <string.h>
+
+#if defined(GENIRANGER_X86)
+#include <immintrin.h>
+#endif
+
+namespace GenIRanger
+{
+
+namespace PixelConversion
+{
+
+/** Signature of the kernels converting complete 3 byte groups. */
+typedef void (*Unpack12pGroups)(const uint8_t* in, uint8_t* out,
+                                size_t groupCount);
+
+static void unpack12pGroupsScalar(const uint8_t* in, uint8_t* out,
+                                  size_t groupCount)
+{
+  for (size_t i = 0; i < groupCount; ++i)
+  {
+    uint8_t b1 = *in++;
+    uint8_t b2 = *in++;
+    uint8_t b3 = *in++;
+
+    // Pixel 1
+    *out++ = b1;
+    *out++ = b2 & 0x0F;
+
+    // Pixel 2
+    *out++ = ((b2 & 0xF0) >> 4) | (b3 & 0x0F) << 4;
+    *out++ = (b3 & 0xF0) >> 4;
+  }
+}
+
+#if defined(GENIRANGER_X86)
+
+/*
+  The vectorized versions all use the same principle. Each 3 byte group
+  (b0, b1, b2) is shuffled into two 16 bit lanes (b0, b1) and (b1, b2). The
+  first pixel is then the 12 LSB of the even lane and the second pixel is the
+  odd lane shifted 4 bits to the right.
+
+  A vector load reads a few bytes more than the groups converted, the loops
+  stop early enough to never read past the end of the input.
+*/
+
+#define SHUFFLE_12P_TO_16 \
+  11, 10, 10, 9, 8, 7, 7, 6, 5, 4, 4, 3, 2, 1, 1, 0
+
+GENIRANGER_TARGET("ssse3")
+static void unpack12pGroupsSsse3(const uint8_t* in, uint8_t* out,
+                                 size_t groupCount)
+{
+  const __m128i shuffle = _mm_set_epi8(SHUFFLE_12P_TO_16);
+  const __m128i evenMask = _mm_set1_epi32(0x00000FFF);
+  const __m128i oddMask = _mm_set1_epi32(0xFFFF0000);
+
+  // 4 groups are converted per iteration, but 16 bytes are loaded
+  size_t i = 0;
+  for (; i + 6 <= groupCount; i += 4)
+  {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+    v = _mm_shuffle_epi8(v, shuffle);
+    __m128i even = _mm_and_si128(v, evenMask);
+    __m128i odd = _mm_and_si128(_mm_srli_epi16(v, 4), oddMask);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_or_si128(even, odd));
+    in += 12;
+    out += 16;
+  }
+  unpack12pGroupsScalar(in, out, groupCount - i);
+}
+
+GENIRANGER_TARGET("avx2")
+static void unpack12pGroupsAvx2(const uint8_t* in, uint8_t* out,
+                                size_t groupCount)
+{
+  const __m256i shuffle = _mm256_set_epi8(SHUFFLE_12P_TO_16,
+                                          SHUFFLE_12P_TO_16);
+  const __m256i evenMask = _mm256_set1_epi32(0x00000FFF);
+  const __m256i oddMask = _mm256_set1_epi32(0xFFFF0000);
+
+  // 8 groups are converted per iteration, the last load ends at byte 28
+  size_t i = 0;
+  for (; i + 10 <= groupCount; i += 8)
+  {
+    __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+    __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 12));
+    __m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+    v = _mm256_shuffle_epi8(v, shuffle);
+    __m256i even = _mm256_and_si256(v, evenMask);
+    __m256i odd = _mm256_and_si256(_mm256_srli_epi16(v, 4), oddMask);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out),
+                        _mm256_or_si256(even, odd));
+    in += 24;
+    out += 32;
+  }
+  _mm256_zeroupper();
+  unpack12pGroupsSsse3(in, out, groupCount - i);
+}
+
+#if defined(GENIRANGER_AVX512)
+
+GENIRANGER_TARGET("avx512f,avx512bw")
+static void unpack12pGroupsAvx512(const uint8_t* in, uint8_t* out,
+                                  size_t groupCount)
+{
+  // SHUFFLE_12P_TO_16 in every 128 bit lane, as 32 bit words
+  const __m512i shuffle = _mm512_set4_epi32(
+    0x0B0A0A09, 0x08070706, 0x05040403, 0x02010100);
+  const __m512i evenMask = _mm512_set1_epi32(0x00000FFF);
+  const __m512i oddMask = _mm512_set1_epi32(0xFFFF0000);
+
+  // 16 groups are converted per iteration, the last load ends at byte 52
+  size_t i = 0;
+  for (; i + 18 <= groupCount; i += 16)
+  {
+    __m512i v = _mm512_castsi128_si512(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(in)));
+    v = _mm512_inserti32x4(
+      v, _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 12)), 1);
+    v = _mm512_inserti32x4(
+      v, _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 24)), 2);
+    v = _mm512_inserti32x4(
+      v, _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 36)), 3);
+    v = _mm512_shuffle_epi8(v, shuffle);
+    __m512i even = _mm512_and_si512(v, evenMask);
+    __m512i odd = _mm512_and_si512(_mm512_srli_epi16(v, 4), oddMask);
+    _mm512_storeu_si512(out, _mm512_or_si512(even, odd));
+    in += 48;
+    out += 64;
+  }
+  _mm256_zeroupper();
+  unpack12pGroupsSsse3(in, out, groupCount - i);
+}
+
+#endif
+
+#undef SHUFFLE_12P_TO_16
+
+#endif
+
+struct Unpack12pImplementation
+{
+  Unpack12pGroups function;
+  const char* name;
+};
+
+static Unpack12pImplementation selectUnpack12p()
+{
+  Unpack12pImplementation selected = { &unpack12pGroupsScalar, "Scalar" };
+#if defined(GENIRANGER_X86)
+  const CpuFeatures& cpu = cpuFeatures();
+#if defined(GENIRANGER_AVX512)
+  if (cpu.avx512bw)
+  {
+    selected.function = &unpack12pGroupsAvx512;
+    selected.name = "AVX-512";
+    return selected;
+  }
+#endif
+  if (cpu.avx2)
+  {
+    selected.function = &unpack12pGroupsAvx2;
+    selected.name = "AVX2";
+  }
+  else if (cpu.ssse3)
+  {
+    selected.function = &unpack12pGroupsSsse3;
+    selected.name = "SSSE3";
+  }
+#endif
+  return selected;
+}
+
+// Picked during static initialization, i.e., when the library is loaded
+static const Unpack12pImplementation gUnpack12p = selectUnpack12p();
+
+/** Unpacks the pixel in a trailing pair of bytes, if any. */
+static void unpack12pTail(const uint8_t* in, size_t inSize, uint8_t* out)
+{
+  if (inSize % 3 == 2)
+  {
+    size_t groupCount = inSize / 3;
+    in += groupCount * 3;
+    out += groupCount * 4;
+    *out++ = in[0];
+    *out++ = in[1] & 0x0F;
+  }
+}
+
+size_t unpacked12pSize(size_t inSize)
+{
+  return inSize / 3 * 4 + (inSize % 3 == 2 ? 2 : 0);
+}
+
+void unpack12pTo16(const uint8_t* in, size_t inSize, uint8_t* out)
+{
+  gUnpack12p.function(in, out, inSize / 3);
+  unpack12pTail(in, inSize, out);
+}
+
+void unpack12pTo16Reference(const uint8_t* in, size_t inSize, uint8_t* out)
+{
+  unpack12pGroupsScalar(in, out, inSize / 3);
+  unpack12pTail(in, inSize, out);
+}
+
+const char* unpack12pTo16Implementation()
+{
+  return gUnpack12p.name;
+}
+
+/** Signature of the kernels converting complete pixel pairs. */
+typedef void (*Pack12pPairs)(const uint16_t* in, uint8_t* out,
+                             size_t pairCount);
+
+static void pack12pPairsScalar(const uint16_t* in, uint8_t* out,
+                               size_t pairCount)
+{
+  for (size_t i = 0; i < pairCount; ++i)
+  {
+    uint16_t p1 = *in++;
+    uint16_t p2 = *in++;
+
+    // 8 lsb bits of pixel 1 to byte 0
+    *out++ = static_cast<uint8_t>(p1 & 0x00FF);
+    // 4 msb bits of pixel 1 to low nibble and 4 lsb bits of pixel 2 to high
+    // nibble of byte 1
+    *out++ = static_cast<uint8_t>((p1 & 0x0F00) >> 8 | (p2 & 0x000F) << 4);
+    // 8 msb bits of pixel 2 to byte 2
+    *out++ = static_cast<uint8_t>((p2 & 0x0FF0) >> 4);
+  }
+}
+
+#if defined(GENIRANGER_X86)
+
+/*
+  The vectorized versions treat each pixel pair as a 32 bit lane and merge
+  the 12 LSB of both pixels into the 24 LSB of the lane. A byte shuffle then
+  drops the fourth byte of every lane, leaving 3 bytes per pixel pair.
+*/
+
+#define SHUFFLE_16_TO_12P \
+  -1, -1, -1, -1, 14, 13, 12, 10, 9, 8, 6, 5, 4, 2, 1, 0
+
+GENIRANGER_TARGET("sse4.1")
+static void pack12pPairsSse41(const uint16_t* in, uint8_t* out,
+                              size_t pairCount)
+{
+  const __m128i shuffle = _mm_set_epi8(SHUFFLE_16_TO_12P);
+  const __m128i firstMask = _mm_set1_epi32(0x00000FFF);
+  const __m128i secondMask = _mm_set1_epi32(0x0FFF0000);
+
+  // 4 pairs are converted per iteration
+  size_t i = 0;
+  for (; i + 4 <= pairCount; i += 4)
+  {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+    __m128i first = _mm_and_si128(v, firstMask);
+    __m128i second = _mm_srli_epi32(_mm_and_si128(v, secondMask), 4);
+    __m128i packed = _mm_shuffle_epi8(_mm_or_si128(first, second), shuffle);
+    // Store exactly 12 bytes to never write past the end of the output
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(out), packed);
+    int32_t last = _mm_extract_epi32(packed, 2);
+    memcpy(out + 8, &last, sizeof(last));
+    in += 8;
+    out += 12;
+  }
+  pack12pPairsScalar(in, out, pairCount - i);
+}
+
+GENIRANGER_TARGET("avx2")
+static void pack12pPairsAvx2(const uint16_t* in, uint8_t* out,
+                             size_t pairCount)
+{
+  const __m256i shuffle = _mm256_set_epi8(SHUFFLE_16_TO_12P,
+                                          SHUFFLE_16_TO_12P);
+  // Moves the 12 bytes of the upper 128 bit lane next to the lower ones
+  const __m256i compact = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7);
+  const __m256i firstMask = _mm256_set1_epi32(0x00000FFF);
+  const __m256i secondMask = _mm256_set1_epi32(0x0FFF0000);
+
+  // 8 pairs are converted per iteration
+  size_t i = 0;
+  for (; i + 8 <= pairCount; i += 8)
+  {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in));
+    __m256i first = _mm256_and_si256(v, firstMask);
+    __m256i second = _mm256_srli_epi32(_mm256_and_si256(v, secondMask), 4);
+    __m256i packed = _mm256_shuffle_epi8(_mm256_or_si256(first, second),
+                                         shuffle);
+    packed = _mm256_permutevar8x32_epi32(packed, compact);
+    // Store exactly 24 bytes to never write past the end of the output
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out),
+                     _mm256_castsi256_si128(packed));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(out + 16),
+                     _mm256_extracti128_si256(packed, 1));
+    in += 16;
+    out += 24;
+  }
+  _mm256_zeroupper();
+  pack12pPairsSse41(in, out, pairCount - i);
+}
+
+#undef SHUFFLE_16_TO_12P
+
+#endif
+
+struct Pack12pImplementation
+{
+  Pack12pPairs function;
+  const char* name;
+};
+
+static Pack12pImplementation selectPack12p()
+{
+  Pack12pImplementation selected = { &pack12pPairsScalar, "Scalar" };
+#if defined(GENIRANGER_X86)
+  const CpuFeatures& cpu = cpuFeatures();
+  if (cpu.avx2)
+  {
+    selected.function = &pack12pPairsAvx2;
+    selected.name = "AVX2";
+  }
+  else if (cpu.sse41)
+  {
+    selected.function = &pack12pPairsSse41;
+    selected.name = "SSE4.1";
+  }
+#endif
+  return selected;
+}
+
+// Picked during static initialization, i.e., when the library is loaded
+static const Pack12pImplementation gPack12p = selectPack12p();
+
+/** Packs an odd trailing pixel, if any, into two bytes. */
+static void pack12pTail(const uint16_t* in, size_t pixelCount, uint8_t* out)
+{
+  if (pixelCount % 2 != 0)
+  {
+    size_t pairCount = pixelCount / 2;
+    uint16_t p1 = in[pairCount * 2];
+    out += pairCount * 3;
+    *out++ = static_cast<uint8_t>(p1 & 0x00FF);
+    *out++ = static_cast<uint8_t>((p1 & 0x0F00) >> 8);
+  }
+}
+
+size_t packed12pSize(size_t pixelCount)
+{
+  return pixelCount / 2 * 3 + (pixelCount % 2 != 0 ? 2 : 0);
+}
+
+void pack16To12p(const uint16_t* in, size_t pixelCount, uint8_t* out)
+{
+  gPack12p.function(in, out, pixelCount / 2);
+  pack12pTail(in, pixelCount, out);
+}
+
+void pack16To12pReference(const uint16_t* in, size_t pixelCount, uint8_t* out)
+{
+  pack12pPairsScalar(in, out, pixelCount / 2);
+  pack12pTail(in, pixelCount, out);
+}
+
+const char* pack16To12pImplementation()
+{
+  return gPack12p.name;
+}
+
+}
+
+}
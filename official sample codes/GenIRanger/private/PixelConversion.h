@@ -0,0 +1,66 @@
+// Copyright 2018 SICK AG. All rights reserved.
+
+#ifndef GENIRANGER_PIXELCONVERSION_H
+#define GENIRANGER_PIXELCONVERSION_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace GenIRanger
+{
+
+/** Low level pixel format conversion kernels. The functions do no validation
+    of buffer sizes, that is the responsibility of the caller.
+
+    Two 12 bit pixels are packed into three bytes (12p, LSB first):
+
+      byte 0: pixel 0 bits 0-7
+      byte 1: pixel 0 bits 8-11 (low nibble), pixel 1 bits 0-3 (high nibble)
+      byte 2: pixel 1 bits 4-11
+*/
+namespace PixelConversion
+{
+  /** Returns the number of bytes needed to unpack inSize bytes of 12p data.
+      A trailing pair of bytes holds one complete pixel and is unpacked. A
+      single trailing byte is an incomplete pixel and is ignored.
+  */
+  size_t unpacked12pSize(size_t inSize);
+
+  /** Unpacks inSize bytes of 12p data to 16 bit pixels using the fastest
+      implementation supported by the processor. The implementation is picked
+      once, when the library is loaded.
+  */
+  void unpack12pTo16(const uint8_t* in, size_t inSize, uint8_t* out);
+
+  /** Plain C++ version of unpack12pTo16, the reference for the vectorized
+      implementations.
+  */
+  void unpack12pTo16Reference(const uint8_t* in, size_t inSize, uint8_t* out);
+
+  /** Returns the name of the instruction set used by unpack12pTo16. */
+  const char* unpack12pTo16Implementation();
+
+  /** Returns the number of bytes needed to pack pixelCount 16 bit pixels to
+      12p. An odd trailing pixel occupies two bytes, where the high nibble of
+      the second byte is zero.
+  */
+  size_t packed12pSize(size_t pixelCount);
+
+  /** Packs the 12 LSB of pixelCount 16 bit pixels to 12p using the fastest
+      implementation supported by the processor. The implementation is picked
+      once, when the library is loaded.
+  */
+  void pack16To12p(const uint16_t* in, size_t pixelCount, uint8_t* out);
+
+  /** Plain C++ version of pack16To12p, the reference for the vectorized
+      implementations.
+  */
+  void pack16To12pReference(const uint16_t* in, size_t pixelCount,
+                            uint8_t* out);
+
+  /** Returns the name of the instruction set used by pack16To12p. */
+  const char* pack16To12pImplementation();
+}
+
+}
+#endif
@@ -0,0 +1,214 @@
+// Copyright 2018 SICK AG. All rights reserved.
+
+#include "Exceptions.h"
+#include "GenIRanger.h"
+#include "PixelConversion.h"
+#include "SaveBuffer.h"
+
+#include <algorithm>
+#include <sstream>
+#include <string.h>
+#include <vector>
+
+namespace GenIRanger
+{
+
+namespace
+{
+
+// Roughly the number of pixels converted and written at a time, small enough
+// for the block to stay in the CPU cache
+const size_t BLOCK_PIXELS = 64 * 1024;
+
+// Same traits as written by writeSensorRangeTraits
+const float SCALE_X = 1.0f;
+const float SCALE_Z = 0.0625f;
+
+/** Provides the range data of a frame as 16 bit, a block of lines at a time,
+    unpacking 12 bit packed data as needed.
+*/
+class RangeLines
+{
+public:
+  RangeLines(const Component& range, size_t width)
+    : mRange(range)
+    , mWidth(width)
+  {
+  }
+
+  const uint16_t* read(size_t firstLine, size_t lineCount)
+  {
+    const size_t firstPixel = firstLine * mWidth;
+    const size_t pixelCount = lineCount * mWidth;
+    if (mRange.pixelWidth() == PixelWidth::PW16)
+    {
+      return reinterpret_cast<const uint16_t*>(mRange.bytes()) + firstPixel;
+    }
+    // Blocks start on an even pixel, i.e., at a complete 3 byte group
+    const size_t begin = firstPixel / 2 * 3;
+    const size_t size = std::min(PixelConversion::packed12pSize(pixelCount),
+                                 mRange.sizeInBytes() - begin);
+    mUnpacked.resize(pixelCount);
+    uint8_t* unpacked = reinterpret_cast<uint8_t*>(mUnpacked.data());
+    PixelConversion::unpack12pTo16(mRange.bytes() + begin, size, unpacked);
+    return mUnpacked.data();
+  }
+
+private:
+  const Component& mRange;
+  const size_t mWidth;
+  std::vector<uint16_t> mUnpacked;
+};
+
+size_t countValid(const uint16_t* range, size_t count)
+{
+  size_t valid = 0;
+  for (size_t i = 0; i < count; ++i)
+  {
+    valid += range[i] != 0;
+  }
+  return valid;
+}
+
+}
+
+GENIRANGER_API void writePointCloudPly(RangeFrame& frame,
+                                       std::ostream& output,
+                                       const double yScale)
+{
+  validateRangeFrame(frame);
+  ComponentPtr range = frame.range();
+  ComponentPtr reflectance = frame.reflectance();
+  const size_t width = frame.aoiSize().x();
+  const size_t lineCount = rangeLineCount(frame);
+  if (width == 0 || lineCount * width * 2 != unpackedRangeSize(*range)
+      || (reflectance && reflectance->sizeInBytes() != lineCount * width))
+  {
+    throw SaveException("Components must hold complete lines of the same "
+                        "count, when exporting.");
+  }
+
+  // The y coordinate follows the encoder if there are values for all lines
+  const Metadata* encoderValues = nullptr;
+  size_t encoderStride = 0;
+  if (frame.hasLineMarks())
+  {
+    encoderValues = &frame.lineMarkData()->encoderValue;
+    encoderStride = sizeof(LineMark) / sizeof(Metadata);
+    if (frame.lineMarkCount() < lineCount)
+    {
+      throw SaveException("Line marks must cover all lines, when exporting.");
+    }
+  }
+  else if (frame.lineEncoderValues())
+  {
+    encoderValues = frame.lineEncoderValues()->data();
+    encoderStride = 1;
+    if (frame.lineEncoderValues()->size() < lineCount)
+    {
+      throw SaveException(
+        "Encoder values must cover all lines, when exporting.");
+    }
+  }
+
+  // Complete lines per block, even for an odd width to keep 12p blocks on a
+  // byte boundary
+  size_t linesPerBlock = std::max<size_t>(1, BLOCK_PIXELS / width);
+  if (width % 2 != 0 && linesPerBlock % 2 != 0)
+  {
+    ++linesPerBlock;
+  }
+
+  // The vertex count goes in the header, so the valid pixels are counted
+  // before any point is written
+  RangeLines rangeLines(*range, width);
+  uint64_t vertexCount = 0;
+  for (size_t line = 0; line < lineCount; line += linesPerBlock)
+  {
+    const size_t lines = std::min(linesPerBlock, lineCount - line);
+    vertexCount += countValid(rangeLines.read(line, lines), lines * width);
+  }
+
+  std::stringstream header;
+  header << "ply\n"
+         << "format binary_little_endian 1.0\n"
+         << "comment Ranger3 range data in sensor coordinates\n"
+         << "element vertex " << vertexCount << "\n"
+         << "property float x\n"
+         << "property float y\n"
+         << "property float z\n";
+  if (reflectance)
+  {
+    header << "property uchar intensity\n";
+  }
+  header << "end_header\n";
+  const std::string headerString = header.str();
+  output.write(headerString.data(), headerString.size());
+
+  const float originX = static_cast<float>(frame.aoiOffset().x());
+  const float originZ = static_cast<float>(frame.aoiOffset().y());
+  std::vector<float> x(width);
+  for (size_t column = 0; column < width; ++column)
+  {
+    x[column] = originX + SCALE_X * column;
+  }
+  std::vector<float> z(width);
+
+  const size_t vertexSize = 3 * sizeof(float) + (reflectance ? 1 : 0);
+  // Room for one more vertex, since every pixel is written before it is known
+  // whether to keep it
+  std::vector<uint8_t> block((linesPerBlock * width + 1) * vertexSize);
+  const uint8_t* intensity = reflectance ? reflectance->bytes() : nullptr;
+  const Metadata firstEncoderValue
+    = encoderValues != nullptr ? encoderValues[0] : 0;
+
+  for (size_t line = 0; line < lineCount; line += linesPerBlock)
+  {
+    const size_t lines = std::min(linesPerBlock, lineCount - line);
+    const uint16_t* rangeBlock = rangeLines.read(line, lines);
+    uint8_t* out = block.data();
+    for (size_t i = 0; i < lines; ++i)
+    {
+      const size_t lineIndex = line + i;
+      const uint16_t* rangeLine = rangeBlock + i * width;
+      // Relative to the first line, as signed to allow for either direction
+      const double position = encoderValues != nullptr
+        ? static_cast<int32_t>(encoderValues[lineIndex * encoderStride]
+                               - firstEncoderValue)
+        : static_cast<double>(lineIndex);
+      const float y = static_cast<float>(position * yScale);
+
+      // Separate loop without dependencies, for the compiler to vectorize
+      for (size_t column = 0; column < width; ++column)
+      {
+        z[column] = originZ + SCALE_Z * rangeLine[column];
+      }
+      // Every pixel is written, but the output only advances past valid ones
+      const uint8_t* intensityLine
+        = intensity != nullptr ? intensity + lineIndex * width : nullptr;
+      for (size_t column = 0; column < width; ++column)
+      {
+        const float vertex[3] = { x[column], y, z[column] };
+        memcpy(out, vertex, sizeof(vertex));
+        if (intensityLine != nullptr)
+        {
+          out[sizeof(vertex)] = intensityLine[column];
+        }
+        out += vertexSize * (rangeLine[column] != 0);
+      }
+    }
+    output.write(reinterpret_cast<const char*>(block.data()),
+                 out - block.data());
+  }
+}
+
+GENIRANGER_API void savePointCloudPly(RangeFrame& frame,
+                                      const std::string& filePath,
+                                      const double yScale)
+{
+  std::ofstream output(filePath, std::ios::binary | std::ios::trunc);
+  output.exceptions(std::ios::failbit | std::ios::badbit);
+  writePointCloudPly(frame, output, yScale);
+}
+
+}
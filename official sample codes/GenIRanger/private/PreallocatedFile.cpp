@@ -0,0 +1,407 @@
+// Copyright 2018 SICK AG. All rights reserved.
+
+#include "PreallocatedFile.h"
+#include "Exceptions.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace GenIRanger
+{
+
+namespace
+{
+
+void throwFileError(const std::string& what, const std::string& path)
+{
+  std::stringstream ss;
+  ss << what << ": '" << path << "'";
+  throw SaveException(ss.str());
+}
+
+#ifndef _WIN32
+/** Flushes the directory holding a file, which makes a rename or removal of
+    the file durable.
+*/
+void syncDirectoryOf(const std::string& path)
+{
+  const size_t separator = path.rfind('/');
+  const std::string directory = separator == std::string::npos
+    ? std::string(".")
+    : path.substr(0, separator + 1);
+  const int directoryFd = open(directory.c_str(), O_RDONLY);
+  if (directoryFd < 0)
+  {
+    throwFileError("Unable to open directory", directory);
+  }
+  const bool synced = fsync(directoryFd) == 0;
+  close(directoryFd);
+  if (!synced)
+  {
+    throwFileError("Unable to flush directory", directory);
+  }
+}
+#endif
+
+}
+
+#ifdef _WIN32
+
+PreallocatedFile::PreallocatedFile(const std::string& path, uint64_t size)
+  : mPath(path)
+  , mSize(0)
+  , mHandle(INVALID_HANDLE_VALUE)
+{
+  mHandle = CreateFileA(path.c_str(),
+                        GENERIC_WRITE,
+                        FILE_SHARE_READ,
+                        nullptr,
+                        OPEN_ALWAYS,
+                        FILE_ATTRIBUTE_NORMAL,
+                        nullptr);
+  if (mHandle == INVALID_HANDLE_VALUE)
+  {
+    throwFileError("Unable to open file for writing", path);
+  }
+  LARGE_INTEGER currentSize;
+  if (!GetFileSizeEx(mHandle, &currentSize))
+  {
+    CloseHandle(mHandle);
+    throwFileError("Unable to tell file size", path);
+  }
+  mSize = static_cast<uint64_t>(currentSize.QuadPart);
+  if (mSize < size)
+  {
+    try
+    {
+      allocate(size);
+    }
+    catch (...)
+    {
+      CloseHandle(mHandle);
+      throw;
+    }
+  }
+}
+
+PreallocatedFile::~PreallocatedFile()
+{
+  CloseHandle(mHandle);
+}
+
+void PreallocatedFile::allocate(uint64_t size)
+{
+  // Reserve the clusters in one go, then move the end of file
+  FILE_ALLOCATION_INFO allocation;
+  allocation.AllocationSize.QuadPart = static_cast<LONGLONG>(size);
+  SetFileInformationByHandle(mHandle, FileAllocationInfo,
+                             &allocation, sizeof(allocation));
+  resize(size);
+}
+
+void PreallocatedFile::writeAt(uint64_t offset, const uint8_t* data,
+                               size_t size)
+{
+  while (size > 0)
+  {
+    OVERLAPPED position = {};
+    position.Offset = static_cast<DWORD>(offset);
+    position.OffsetHigh = static_cast<DWORD>(offset >> 32);
+    const DWORD chunk = size > 0x40000000 ? 0x40000000
+                                          : static_cast<DWORD>(size);
+    DWORD written = 0;
+    if (!WriteFile(mHandle, data, chunk, &written, &position) || written == 0)
+    {
+      throwFileError("Unable to write to file", mPath);
+    }
+    offset += written;
+    data += written;
+    size -= written;
+  }
+  if (offset > mSize)
+  {
+    mSize = offset;
+  }
+}
+
+void PreallocatedFile::writeAt(uint64_t offset, const DataSpan* spans,
+                               size_t count)
+{
+  // WriteFileGather requires unbuffered, page aligned I/O, so the blocks are
+  // written one at a time
+  for (size_t i = 0; i < count; ++i)
+  {
+    writeAt(offset, spans[i].data, spans[i].size);
+    offset += spans[i].size;
+  }
+}
+
+void PreallocatedFile::resize(uint64_t size)
+{
+  if (size == mSize)
+  {
+    return;
+  }
+  LARGE_INTEGER end;
+  end.QuadPart = static_cast<LONGLONG>(size);
+  if (!SetFilePointerEx(mHandle, end, nullptr, FILE_BEGIN)
+      || !SetEndOfFile(mHandle))
+  {
+    throwFileError("Unable to set file size", mPath);
+  }
+  mSize = size;
+}
+
+void PreallocatedFile::sync()
+{
+  if (!FlushFileBuffers(mHandle))
+  {
+    throwFileError("Unable to flush file", mPath);
+  }
+}
+
+#else
+
+PreallocatedFile::PreallocatedFile(const std::string& path, uint64_t size)
+  : mPath(path)
+  , mSize(0)
+  , mFd(-1)
+{
+  mFd = open(path.c_str(), O_WRONLY | O_CREAT, 0644);
+  if (mFd < 0)
+  {
+    throwFileError("Unable to open file for writing", path);
+  }
+  struct stat info;
+  if (fstat(mFd, &info) != 0)
+  {
+    close(mFd);
+    throwFileError("Unable to tell file size", path);
+  }
+  mSize = static_cast<uint64_t>(info.st_size);
+  if (mSize < size)
+  {
+    try
+    {
+      allocate(size);
+    }
+    catch (...)
+    {
+      close(mFd);
+      throw;
+    }
+  }
+}
+
+PreallocatedFile::~PreallocatedFile()
+{
+  close(mFd);
+}
+
+void PreallocatedFile::allocate(uint64_t size)
+{
+#ifdef __linux__
+  // Not supported by all file systems, a plain resize is good enough then
+  if (posix_fallocate(mFd, 0, static_cast<off_t>(size)) == 0)
+  {
+    mSize = size;
+    return;
+  }
+#endif
+  resize(size);
+}
+
+void PreallocatedFile::writeAt(uint64_t offset, const uint8_t* data,
+                               size_t size)
+{
+  while (size > 0)
+  {
+    ssize_t written = pwrite(mFd, data, size, static_cast<off_t>(offset));
+    if (written < 0 && errno == EINTR)
+    {
+      continue;
+    }
+    if (written <= 0)
+    {
+      throwFileError("Unable to write to file", mPath);
+    }
+    offset += static_cast<uint64_t>(written);
+    data += written;
+    size -= static_cast<size_t>(written);
+  }
+  if (offset > mSize)
+  {
+    mSize = offset;
+  }
+}
+
+void PreallocatedFile::writeAt(uint64_t offset, const DataSpan* spans,
+                               size_t count)
+{
+#ifdef __linux__
+  std::vector<struct iovec> vectors;
+  vectors.reserve(count);
+  for (size_t i = 0; i < count; ++i)
+  {
+    if (spans[i].size > 0)
+    {
+      struct iovec vector;
+      vector.iov_base = const_cast<uint8_t*>(spans[i].data);
+      vector.iov_len = spans[i].size;
+      vectors.push_back(vector);
+    }
+  }
+
+  size_t first = 0;
+  while (first < vectors.size())
+  {
+    const size_t batch = std::min(vectors.size() - first,
+                                  static_cast<size_t>(IOV_MAX));
+    ssize_t written = pwritev(mFd, &vectors[first], static_cast<int>(batch),
+                              static_cast<off_t>(offset));
+    if (written < 0 && errno == EINTR)
+    {
+      continue;
+    }
+    if (written <= 0)
+    {
+      throwFileError("Unable to write to file", mPath);
+    }
+    offset += static_cast<uint64_t>(written);
+    // Skip the completely written blocks and continue within a partially
+    // written one
+    size_t remaining = static_cast<size_t>(written);
+    while (first < vectors.size() && remaining >= vectors[first].iov_len)
+    {
+      remaining -= vectors[first].iov_len;
+      ++first;
+    }
+    if (remaining > 0)
+    {
+      vectors[first].iov_base =
+        static_cast<uint8_t*>(vectors[first].iov_base) + remaining;
+      vectors[first].iov_len -= remaining;
+    }
+  }
+  if (offset > mSize)
+  {
+    mSize = offset;
+  }
+#else
+  for (size_t i = 0; i < count; ++i)
+  {
+    writeAt(offset, spans[i].data, spans[i].size);
+    offset += spans[i].size;
+  }
+#endif
+}
+
+void PreallocatedFile::resize(uint64_t size)
+{
+  if (size == mSize)
+  {
+    return;
+  }
+  if (ftruncate(mFd, static_cast<off_t>(size)) != 0)
+  {
+    throwFileError("Unable to set file size", mPath);
+  }
+  mSize = size;
+}
+
+void PreallocatedFile::sync()
+{
+#ifdef __linux__
+  const int result = fdatasync(mFd);
+#else
+  const int result = fsync(mFd);
+#endif
+  if (result != 0)
+  {
+    throwFileError("Unable to flush file", mPath);
+  }
+}
+
+#endif
+
+void PreallocatedFile::reserve(uint64_t size)
+{
+  if (size > mSize)
+  {
+    allocate(size);
+  }
+}
+
+void replaceFileAtomically(const std::string& path,
+                           const std::string& contents,
+                           bool durable)
+{
+  const std::string temporaryPath = path + ".tmp";
+  {
+    // The data must be on disk before the rename, or a power loss could leave
+    // the new name pointing to an empty file
+    PreallocatedFile file(temporaryPath, 0);
+    file.resize(0);
+    file.writeAt(0, reinterpret_cast<const uint8_t*>(contents.data()),
+                 contents.size());
+    if (durable)
+    {
+      file.sync();
+    }
+  }
+#ifdef _WIN32
+  const DWORD flags = durable
+    ? MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH
+    : MOVEFILE_REPLACE_EXISTING;
+  const BOOL renamed = MoveFileExA(temporaryPath.c_str(), path.c_str(), flags);
+#else
+  const bool renamed = std::rename(temporaryPath.c_str(), path.c_str()) == 0;
+#endif
+  if (!renamed)
+  {
+    std::remove(temporaryPath.c_str());
+    throwFileError("Unable to replace file", path);
+  }
+#ifndef _WIN32
+  // The rename itself is only durable once the directory is flushed
+  if (durable)
+  {
+    syncDirectoryOf(path);
+  }
+#endif
+}
+
+void removeFileDurably(const std::string& path)
+{
+#ifdef _WIN32
+  if (!DeleteFileA(path.c_str()) && GetLastError() != ERROR_FILE_NOT_FOUND)
+  {
+    throwFileError("Unable to remove file", path);
+  }
+#else
+  if (unlink(path.c_str()) != 0)
+  {
+    if (errno == ENOENT)
+    {
+      return;
+    }
+    throwFileError("Unable to remove file", path);
+  }
+  syncDirectoryOf(path);
+#endif
+}
+
+}
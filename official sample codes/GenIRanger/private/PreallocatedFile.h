@@ -0,0 +1,92 @@
+// Copyright 2018 SICK AG. All rights reserved.
+
+#ifndef GENIRANGER_PREALLOCATEDFILE_H
+#define GENIRANGER_PREALLOCATEDFILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+namespace GenIRanger
+{
+
+/** A contiguous block of bytes to write, one of several written together. */
+struct DataSpan
+{
+  const uint8_t* data;
+  size_t size;
+};
+
+/** A binary file that is kept open and rewritten in place.
+
+    The disk space is allocated up front, so that rewriting the file with the
+    same amount of data does not cause any allocation or file size changes,
+    only data writes. Throws SaveException on errors.
+*/
+class PreallocatedFile
+{
+public:
+  /** Opens the file, creating it if needed, without discarding its contents.
+      The file is extended to at least size bytes.
+  */
+  PreallocatedFile(const std::string& path, uint64_t size);
+
+  ~PreallocatedFile();
+
+  const std::string& path() const { return mPath; }
+
+  /** The current size of the file in bytes. */
+  uint64_t size() const { return mSize; }
+
+  /** Writes data at a byte offset from the start of the file. */
+  void writeAt(uint64_t offset, const uint8_t* data, size_t size);
+
+  /** Writes several blocks of data back to back at a byte offset, with as
+      few system calls as the platform allows.
+  */
+  void writeAt(uint64_t offset, const DataSpan* spans, size_t count);
+
+  /** Sets the size of the file. Nothing is done if the size is unchanged. */
+  void resize(uint64_t size);
+
+  /** Extends the file to at least size bytes, allocating the disk space. */
+  void reserve(uint64_t size);
+
+  /** Waits until written data has reached the disk. */
+  void sync();
+
+private:
+  PreallocatedFile(const PreallocatedFile&);
+  PreallocatedFile& operator=(const PreallocatedFile&);
+
+  void allocate(uint64_t size);
+
+private:
+  std::string mPath;
+  uint64_t mSize;
+#ifdef _WIN32
+  void* mHandle;
+#else
+  int mFd;
+#endif
+};
+
+/** Replaces the contents of a file, such that a reader sees either the old or
+    the new contents but never a partially written file. The contents are
+    written to a temporary file which is then renamed.
+
+    If durable, the temporary file is flushed to disk before the rename and
+    the rename is flushed to disk as well, before returning. Otherwise a
+    power loss may leave either file empty.
+*/
+void replaceFileAtomically(const std::string& path,
+                           const std::string& contents,
+                           bool durable);
+
+/** Removes a file, if it exists, and flushes the removal to disk before
+    returning.
+*/
+void removeFileDurably(const std::string& path);
+
+}
+#endif
@@ -0,0 +1,317 @@
+// Copyright 2018 SICK AG. All rights reserved.
+
+#include "RangeCalibration.h"
+#include "CpuFeatures.h"
+#include "Exceptions.h"
+#include "PixelConversion.h"
+#include "SaveBuffer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <sstream>
+
+#if defined(GENIRANGER_X86)
+#include <immintrin.h>
+#endif
+
+namespace GenIRanger
+{
+
+namespace
+{
+
+const float MISSING = std::numeric_limits<float>::quiet_NaN();
+
+// Pixels of 12p data unpacked at a time, small enough to stay in the CPU
+// cache until converted
+const size_t BLOCK_PIXELS = 16 * 1024;
+
+typedef void (*ConvertTraits)(const uint16_t* range, size_t count,
+                              float origin, float scale, float* z);
+typedef void (*ConvertPerColumn)(const uint16_t* range, size_t count,
+                                 const float* offsets, const float* scales,
+                                 float* z);
+
+void convertTraitsScalar(const uint16_t* range, size_t count,
+                         float origin, float scale, float* z)
+{
+  for (size_t i = 0; i < count; ++i)
+  {
+    z[i] = range[i] != 0 ? origin + scale * range[i] : MISSING;
+  }
+}
+
+void convertPerColumnScalar(const uint16_t* range, size_t count,
+                            const float* offsets, const float* scales,
+                            float* z)
+{
+  for (size_t i = 0; i < count; ++i)
+  {
+    z[i] = range[i] != 0 ? offsets[i] + scales[i] * range[i] : MISSING;
+  }
+}
+
+#if defined(GENIRANGER_X86)
+
+/*
+  Eight range values are widened to 32 bit integers and converted to float.
+  Missing data is replaced by NaN with a blend, using a compare of the
+  integers as mask. The per column factors are plain vector loads, since the
+  columns are processed in order.
+*/
+
+GENIRANGER_TARGET("avx2")
+void convertTraitsAvx2(const uint16_t* range, size_t count,
+                       float origin, float scale, float* z)
+{
+  const __m256 originVector = _mm256_set1_ps(origin);
+  const __m256 scaleVector = _mm256_set1_ps(scale);
+  const __m256 missing = _mm256_set1_ps(MISSING);
+  const __m256i zero = _mm256_setzero_si256();
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8)
+  {
+    __m256i r = _mm256_cvtepu16_epi32(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(range + i)));
+    __m256 value = _mm256_add_ps(
+      originVector, _mm256_mul_ps(scaleVector, _mm256_cvtepi32_ps(r)));
+    __m256 isMissing = _mm256_castsi256_ps(_mm256_cmpeq_epi32(r, zero));
+    _mm256_storeu_ps(z + i, _mm256_blendv_ps(value, missing, isMissing));
+  }
+  convertTraitsScalar(range + i, count - i, origin, scale, z + i);
+}
+
+GENIRANGER_TARGET("avx2")
+void convertPerColumnAvx2(const uint16_t* range, size_t count,
+                          const float* offsets, const float* scales,
+                          float* z)
+{
+  const __m256 missing = _mm256_set1_ps(MISSING);
+  const __m256i zero = _mm256_setzero_si256();
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8)
+  {
+    __m256i r = _mm256_cvtepu16_epi32(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(range + i)));
+    __m256 value = _mm256_add_ps(
+      _mm256_loadu_ps(offsets + i),
+      _mm256_mul_ps(_mm256_loadu_ps(scales + i), _mm256_cvtepi32_ps(r)));
+    __m256 isMissing = _mm256_castsi256_ps(_mm256_cmpeq_epi32(r, zero));
+    _mm256_storeu_ps(z + i, _mm256_blendv_ps(value, missing, isMissing));
+  }
+  convertPerColumnScalar(range + i, count - i, offsets + i, scales + i,
+                         z + i);
+}
+
+#endif
+
+struct Kernels
+{
+  ConvertTraits traits;
+  ConvertPerColumn perColumn;
+  const char* name;
+};
+
+Kernels selectKernels()
+{
+  Kernels selected = { &convertTraitsScalar, &convertPerColumnScalar,
+                       "Scalar" };
+#if defined(GENIRANGER_X86)
+  if (cpuFeatures().avx2)
+  {
+    selected.traits = &convertTraitsAvx2;
+    selected.perColumn = &convertPerColumnAvx2;
+    selected.name = "AVX2";
+  }
+#endif
+  return selected;
+}
+
+// Picked during static initialization, i.e., when the library is loaded
+const Kernels gKernels = selectKernels();
+
+}
+
+RangeCalibration::RangeCalibration(float originZ, float scaleZ)
+  : mMode(Mode::Traits)
+  , mOriginZ(originZ)
+  , mScaleZ(scaleZ)
+  , mWidth(0)
+  , mRangeStep(0)
+  , mTableRows(0)
+{
+}
+
+RangeCalibration::RangeCalibration(const std::vector<float>& offsets,
+                                   const std::vector<float>& scales)
+  : mMode(Mode::PerColumn)
+  , mOriginZ(0.0f)
+  , mScaleZ(0.0f)
+  , mWidth(offsets.size())
+  , mRangeStep(0)
+  , mTableRows(0)
+  , mOffsets(offsets)
+  , mScales(scales)
+{
+  if (offsets.size() != scales.size())
+  {
+    throw GenIRangerException(
+      "Calibration must have as many offsets as scales.");
+  }
+}
+
+RangeCalibration::RangeCalibration(size_t width,
+                                   uint16_t rangeStep,
+                                   const std::vector<float>& table)
+  : mMode(Mode::Table)
+  , mOriginZ(0.0f)
+  , mScaleZ(0.0f)
+  , mWidth(width)
+  , mRangeStep(rangeStep)
+  , mTableRows(width == 0 ? 0 : table.size() / width)
+  , mTable(table)
+{
+  if (width == 0 || rangeStep == 0 || mTableRows < 2
+      || table.size() % width != 0)
+  {
+    throw GenIRangerException(
+      "Calibration table must have at least two complete rows.");
+  }
+}
+
+RangeCalibration::~RangeCalibration()
+{
+  // Empty
+}
+
+void RangeCalibration::checkWidth(size_t width) const
+{
+  if (mMode != Mode::Traits && width != mWidth)
+  {
+    std::stringstream ss;
+    ss << "Calibration is for width " << mWidth << ", not " << width;
+    throw GenIRangerException(ss.str());
+  }
+}
+
+void RangeCalibration::convertLine(const uint16_t* range, float* z) const
+{
+  switch (mMode)
+  {
+  case Mode::PerColumn:
+    gKernels.perColumn(range, mWidth, mOffsets.data(), mScales.data(), z);
+    break;
+  case Mode::Table:
+  {
+    // Interpolates between the rows around the range value, the last pair of
+    // rows is extrapolated to clamp at the last row
+    const float rowsPerUnit = 1.0f / mRangeStep;
+    const float lastPair = static_cast<float>(mTableRows - 2);
+    const float* table = mTable.data();
+    for (size_t x = 0; x < mWidth; ++x)
+    {
+      // Multiplying by the rounded reciprocal of the step, rather than
+      // dividing, gives a position with a relative error of at most 2^-23.
+      // At a row boundary the row below may then be used with a fraction just
+      // below 1, which interpolates to nearly the same value.
+      const float position = std::min(range[x] * rowsPerUnit, lastPair + 1);
+      const float row = std::min(std::floor(position), lastPair);
+      const float fraction = position - row;
+      const float* low = table + static_cast<size_t>(row) * mWidth + x;
+      const float lowValue = low[0];
+      const float highValue = low[mWidth];
+      z[x] = range[x] != 0 ? lowValue + fraction * (highValue - lowValue)
+                           : MISSING;
+    }
+    break;
+  }
+  default:
+    break;
+  }
+}
+
+void RangeCalibration::convert(const uint16_t* range,
+                               size_t width,
+                               size_t lineCount,
+                               float* z) const
+{
+  checkWidth(width);
+  if (mMode == Mode::Traits)
+  {
+    // Independent of the column, so all lines are converted in one go
+    gKernels.traits(range, width * lineCount, mOriginZ, mScaleZ, z);
+    return;
+  }
+  for (size_t line = 0; line < lineCount; ++line)
+  {
+    convertLine(range + line * width, z + line * width);
+  }
+}
+
+void RangeCalibration::convert12p(const uint8_t* range12p,
+                                  size_t width,
+                                  size_t lineCount,
+                                  float* z) const
+{
+  checkWidth(width);
+  if (width % 2 != 0)
+  {
+    throw GenIRangerException(
+      "Width of 12 bit packed range data must be even.");
+  }
+  const size_t linesPerBlock = std::max<size_t>(1, BLOCK_PIXELS / width);
+  const size_t lineBytes = width / 2 * 3;
+  std::vector<uint16_t> block(linesPerBlock * width);
+  for (size_t line = 0; line < lineCount; line += linesPerBlock)
+  {
+    const size_t lines = std::min(linesPerBlock, lineCount - line);
+    PixelConversion::unpack12pTo16(range12p + line * lineBytes,
+                                   lines * lineBytes,
+                                   reinterpret_cast<uint8_t*>(block.data()));
+    convert(block.data(), width, lines, z + line * width);
+  }
+}
+
+ComponentPtr RangeCalibration::convert(RangeFrame& frame) const
+{
+  ComponentPtr range = frame.range();
+  if (!range || (range->pixelWidth() != PixelWidth::PW16
+                 && range->pixelWidth() != PixelWidth::PW12))
+  {
+    throw GenIRangerException(
+      "Range component must have pixel width 16 or 12, when converting.");
+  }
+  const size_t width = frame.aoiSize().x();
+  const size_t lineCount = rangeLineCount(frame);
+  ComponentPtr z = std::make_shared<Component>(
+    width * lineCount * sizeof(float), PixelWidth::PW32F);
+  float* zData = reinterpret_cast<float*>(z->bytes());
+  if (range->pixelWidth() == PixelWidth::PW16)
+  {
+    convert(reinterpret_cast<const uint16_t*>(range->bytes()), width,
+            lineCount, zData);
+  }
+  else if (width % 2 == 0)
+  {
+    convert12p(range->bytes(), width, lineCount, zData);
+  }
+  else
+  {
+    // Lines do not start on a byte boundary, so everything is unpacked first
+    std::vector<uint16_t> range16(
+      PixelConversion::unpacked12pSize(range->sizeInBytes())
+      / sizeof(uint16_t));
+    PixelConversion::unpack12pTo16(range->bytes(), range->sizeInBytes(),
+                                   reinterpret_cast<uint8_t*>(range16.data()));
+    convert(range16.data(), width, lineCount, zData);
+  }
+  return z;
+}
+
+const char* RangeCalibration::implementation() const
+{
+  return mMode == Mode::Table ? "Scalar" : gKernels.name;
+}
+
+}
@@ -0,0 +1,768 @@
+// Copyright 2018 SICK AG. All rights reserved.
+
+#include "RangeCodec.h"
+#include "CpuFeatures.h"
+#include "Exceptions.h"
+#include "ThreadPool.h"
+
+#include <string.h>
+#include <vector>
+
+#if defined(GENIRANGER_X86)
+#include <emmintrin.h>
+#endif
+
+namespace GenIRanger
+{
+
+namespace RangeCodec
+{
+
+// Small enough to give every thread a few strips of a typical frame, large
+// enough to make the horizontally predicted first lines insignificant
+static const size_t LINES_PER_STRIP = 64;
+static const size_t GROUP_SIZE = 32;
+
+static size_t groupsPerLine(size_t width)
+{
+  return (width + GROUP_SIZE - 1) / GROUP_SIZE;
+}
+
+static size_t stripCountFor(size_t width, size_t lineCount,
+                            size_t linesPerStrip)
+{
+  // Empty lines are not worth any strips
+  return width == 0 ? 0 : (lineCount + linesPerStrip - 1) / linesPerStrip;
+}
+
+static size_t maxLineSize(size_t width, size_t bytesPerValue)
+{
+  // Bit count byte plus the values at full width
+  return groupsPerLine(width) * (1 + GROUP_SIZE * bytesPerValue);
+}
+
+static void store32(uint8_t* p, uint32_t value)
+{
+  memcpy(p, &value, sizeof(value));
+}
+
+static void store64(uint8_t* p, uint64_t value)
+{
+  memcpy(p, &value, sizeof(value));
+}
+
+static uint32_t load32(const uint8_t* p)
+{
+  uint32_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+static uint64_t load64(const uint8_t* p)
+{
+  uint64_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+static bool selectSse2()
+{
+#if defined(GENIRANGER_X86)
+  // Part of x64, but not of every 32 bit x86 processor
+  return cpuFeatures().sse2;
+#else
+  return false;
+#endif
+}
+
+// Picked during static initialization, i.e., when the library is loaded
+static const bool gSse2 = selectSse2();
+
+/*
+  Prediction. The residual of each value is the difference to the reference
+  value in the same position, wrapping around, zigzag mapped to an unsigned
+  value: 0, -1, 1, -2, ... becomes 0, 1, 2, 3, ...
+*/
+
+static void predictScalar(const uint16_t* line, const uint16_t* reference,
+                          size_t count, uint16_t* residuals)
+{
+  for (size_t i = 0; i < count; ++i)
+  {
+    uint16_t d = static_cast<uint16_t>(line[i] - reference[i]);
+    residuals[i] = static_cast<uint16_t>((d << 1) ^ (0 - (d >> 15)));
+  }
+}
+
+static void predictScalar(const uint8_t* line, const uint8_t* reference,
+                          size_t count, uint16_t* residuals)
+{
+  for (size_t i = 0; i < count; ++i)
+  {
+    uint8_t d = static_cast<uint8_t>(line[i] - reference[i]);
+    residuals[i] = static_cast<uint8_t>((d << 1) ^ (0 - (d >> 7)));
+  }
+}
+
+static void reconstructScalar(const uint16_t* residuals,
+                              const uint16_t* reference,
+                              size_t count, uint16_t* line)
+{
+  for (size_t i = 0; i < count; ++i)
+  {
+    uint16_t r = residuals[i];
+    int d = (r >> 1) ^ (0 - (r & 1));
+    line[i] = static_cast<uint16_t>(reference[i] + d);
+  }
+}
+
+static void reconstructScalar(const uint16_t* residuals,
+                              const uint8_t* reference,
+                              size_t count, uint8_t* line)
+{
+  for (size_t i = 0; i < count; ++i)
+  {
+    uint16_t r = residuals[i];
+    int d = (r >> 1) ^ (0 - (r & 1));
+    line[i] = static_cast<uint8_t>(reference[i] + d);
+  }
+}
+
+#if defined(GENIRANGER_X86)
+
+GENIRANGER_TARGET("sse2")
+static void predictSse2(const uint16_t* line, const uint16_t* reference,
+                        size_t count, uint16_t* residuals)
+{
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8)
+  {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(line + i));
+    __m128i r = _mm_loadu_si128(
+      reinterpret_cast<const __m128i*>(reference + i));
+    __m128i d = _mm_sub_epi16(x, r);
+    __m128i z = _mm_xor_si128(_mm_slli_epi16(d, 1), _mm_srai_epi16(d, 15));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(residuals + i), z);
+  }
+  predictScalar(line + i, reference + i, count - i, residuals + i);
+}
+
+GENIRANGER_TARGET("sse2")
+static void predictSse2(const uint8_t* line, const uint8_t* reference,
+                        size_t count, uint16_t* residuals)
+{
+  const __m128i zero = _mm_setzero_si128();
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16)
+  {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(line + i));
+    __m128i r = _mm_loadu_si128(
+      reinterpret_cast<const __m128i*>(reference + i));
+    __m128i d = _mm_sub_epi8(x, r);
+    // There are no 8 bit shifts, d + d is d << 1 and the sign mask is a compare
+    __m128i z = _mm_xor_si128(_mm_add_epi8(d, d), _mm_cmpgt_epi8(zero, d));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(residuals + i),
+                     _mm_unpacklo_epi8(z, zero));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(residuals + i + 8),
+                     _mm_unpackhi_epi8(z, zero));
+  }
+  predictScalar(line + i, reference + i, count - i, residuals + i);
+}
+
+GENIRANGER_TARGET("sse2")
+static __m128i unzigzag(__m128i z)
+{
+  const __m128i one = _mm_set1_epi16(1);
+  const __m128i sign = _mm_sub_epi16(_mm_setzero_si128(),
+                                     _mm_and_si128(z, one));
+  return _mm_xor_si128(_mm_srli_epi16(z, 1), sign);
+}
+
+GENIRANGER_TARGET("sse2")
+static void reconstructSse2(const uint16_t* residuals,
+                            const uint16_t* reference,
+                            size_t count, uint16_t* line)
+{
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8)
+  {
+    __m128i z = _mm_loadu_si128(
+      reinterpret_cast<const __m128i*>(residuals + i));
+    __m128i r = _mm_loadu_si128(
+      reinterpret_cast<const __m128i*>(reference + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(line + i),
+                     _mm_add_epi16(r, unzigzag(z)));
+  }
+  reconstructScalar(residuals + i, reference + i, count - i, line + i);
+}
+
+GENIRANGER_TARGET("sse2")
+static void reconstructSse2(const uint16_t* residuals,
+                            const uint8_t* reference,
+                            size_t count, uint8_t* line)
+{
+  const __m128i lowByte = _mm_set1_epi16(0x00FF);
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16)
+  {
+    __m128i z0 = _mm_loadu_si128(
+      reinterpret_cast<const __m128i*>(residuals + i));
+    __m128i z1 = _mm_loadu_si128(
+      reinterpret_cast<const __m128i*>(residuals + i + 8));
+    // Differences are computed as 16 bit and truncated to 8 bit
+    __m128i d = _mm_packus_epi16(_mm_and_si128(unzigzag(z0), lowByte),
+                                 _mm_and_si128(unzigzag(z1), lowByte));
+    __m128i r = _mm_loadu_si128(
+      reinterpret_cast<const __m128i*>(reference + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(line + i),
+                     _mm_add_epi8(r, d));
+  }
+  reconstructScalar(residuals + i, reference + i, count - i, line + i);
+}
+
+#endif
+
+template<typename T>
+static void predict(const T* line, const T* reference, size_t count,
+                    uint16_t* residuals)
+{
+#if defined(GENIRANGER_X86)
+  if (gSse2)
+  {
+    predictSse2(line, reference, count, residuals);
+    return;
+  }
+#endif
+  predictScalar(line, reference, count, residuals);
+}
+
+template<typename T>
+static void reconstruct(const uint16_t* residuals, const T* reference,
+                        size_t count, T* line)
+{
+#if defined(GENIRANGER_X86)
+  if (gSse2)
+  {
+    reconstructSse2(residuals, reference, count, line);
+    return;
+  }
+#endif
+  reconstructScalar(residuals, reference, count, line);
+}
+
+/** Predicts the first line of a strip from the value to the left. */
+template<typename T>
+static void predictHorizontal(const T* line, size_t width, uint16_t* residuals)
+{
+  const T zero = 0;
+  predict(line, &zero, 1, residuals);
+  predict(line + 1, line, width - 1, residuals + 1);
+}
+
+template<typename T>
+static void reconstructHorizontal(const uint16_t* residuals, size_t width,
+                                  T* line)
+{
+  // Each value depends on the one before, which rules out vectorization
+  const T zero = 0;
+  reconstructScalar(residuals, &zero, 1, line);
+  for (size_t i = 1; i < width; ++i)
+  {
+    reconstructScalar(residuals + i, line + i - 1, 1, line + i);
+  }
+}
+
+/*
+  Bit-packing
+*/
+
+static unsigned bitWidth(uint32_t value)
+{
+  unsigned bits = 0;
+  while (value != 0)
+  {
+    ++bits;
+    value >>= 1;
+  }
+  return bits;
+}
+
+/** Returns the number of bits needed for the largest value of a group. */
+static unsigned groupBitsScalar(const uint16_t* values)
+{
+  uint32_t combined = 0;
+  for (size_t i = 0; i < GROUP_SIZE; ++i)
+  {
+    combined |= values[i];
+  }
+  return bitWidth(combined);
+}
+
+/** Packs the 32 values of a group, which are known to fit in bits bits, to
+    exactly bits 32 bit words. Returns the end of the output.
+*/
+static uint8_t* packGroupScalar(const uint16_t* values, unsigned bits,
+                                uint8_t* out)
+{
+  uint64_t accumulator = 0;
+  unsigned pending = 0;
+  for (size_t i = 0; i < GROUP_SIZE; ++i)
+  {
+    accumulator |= static_cast<uint64_t>(values[i]) << pending;
+    pending += bits;
+    if (pending >= 32)
+    {
+      store32(out, static_cast<uint32_t>(accumulator));
+      out += 4;
+      accumulator >>= 32;
+      pending -= 32;
+    }
+  }
+  return out;
+}
+
+/** Unpacks the 32 values of a group of bits bits. Returns the end of the
+    input.
+*/
+static const uint8_t* unpackGroupScalar(const uint8_t* in, unsigned bits,
+                                        uint16_t* values)
+{
+  const uint32_t mask = (1u << bits) - 1;
+  uint64_t accumulator = 0;
+  unsigned available = 0;
+  for (size_t i = 0; i < GROUP_SIZE; ++i)
+  {
+    if (available < bits)
+    {
+      accumulator |= static_cast<uint64_t>(load32(in)) << available;
+      in += 4;
+      available += 32;
+    }
+    values[i] = static_cast<uint16_t>(accumulator & mask);
+    accumulator >>= bits;
+    available -= bits;
+  }
+  return in;
+}
+
+#if defined(GENIRANGER_X86)
+
+/*
+  There are no SSE2 shifts with a count per lane, but neighbouring values are
+  all shifted by the same count. Merging pairs of 16 bit lanes, then pairs of
+  32 bit lanes, gives 8 units of 4 values each, 4 * b bits long, so only 8
+  steps, or 16 for units longer than 32 bits, are left for the bit stream.
+*/
+
+/** Appends the count lowest bits of chunk to the bit stream, count <= 32. */
+static void putBits(uint64_t& accumulator, unsigned& pending, uint64_t chunk,
+                    unsigned count, uint8_t*& out)
+{
+  accumulator |= chunk << pending;
+  pending += count;
+  if (pending >= 32)
+  {
+    store32(out, static_cast<uint32_t>(accumulator));
+    out += 4;
+    accumulator >>= 32;
+    pending -= 32;
+  }
+}
+
+/** Takes count bits from the bit stream, count <= 32. */
+static uint64_t getBits(uint64_t& accumulator, unsigned& available,
+                        unsigned count, const uint8_t*& in)
+{
+  if (available < count)
+  {
+    accumulator |= static_cast<uint64_t>(load32(in)) << available;
+    in += 4;
+    available += 32;
+  }
+  const uint64_t mask = (static_cast<uint64_t>(1) << count) - 1;
+  const uint64_t chunk = accumulator & mask;
+  accumulator >>= count;
+  available -= count;
+  return chunk;
+}
+
+GENIRANGER_TARGET("sse2")
+static unsigned groupBitsSse2(const uint16_t* values)
+{
+  const __m128i* v = reinterpret_cast<const __m128i*>(values);
+  __m128i combined = _mm_or_si128(
+    _mm_or_si128(_mm_loadu_si128(v), _mm_loadu_si128(v + 1)),
+    _mm_or_si128(_mm_loadu_si128(v + 2), _mm_loadu_si128(v + 3)));
+  combined = _mm_or_si128(combined, _mm_srli_si128(combined, 8));
+  combined = _mm_or_si128(combined, _mm_srli_si128(combined, 4));
+  combined = _mm_or_si128(combined, _mm_srli_si128(combined, 2));
+  return bitWidth(static_cast<uint32_t>(_mm_cvtsi128_si32(combined)) & 0xFFFF);
+}
+
+GENIRANGER_TARGET("sse2")
+static uint8_t* packGroupSse2(const uint16_t* values, unsigned bits,
+                              uint8_t* out)
+{
+  const __m128i low16 = _mm_set1_epi32(0xFFFF);
+  const __m128i low32 = _mm_set_epi32(0, -1, 0, -1);
+  const __m128i shift = _mm_cvtsi32_si128(static_cast<int>(bits));
+  const __m128i shift2 = _mm_cvtsi32_si128(static_cast<int>(2 * bits));
+  uint64_t units[GROUP_SIZE / 4];
+  for (size_t i = 0; i < GROUP_SIZE / 8; ++i)
+  {
+    __m128i x = _mm_loadu_si128(
+      reinterpret_cast<const __m128i*>(values + 8 * i));
+    x = _mm_or_si128(_mm_and_si128(x, low16),
+                     _mm_sll_epi32(_mm_srli_epi32(x, 16), shift));
+    x = _mm_or_si128(_mm_and_si128(x, low32),
+                     _mm_sll_epi64(_mm_srli_epi64(x, 32), shift2));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(units + 2 * i), x);
+  }
+
+  const unsigned unitBits = 4 * bits;
+  uint64_t accumulator = 0;
+  unsigned pending = 0;
+  for (size_t i = 0; i < GROUP_SIZE / 4; ++i)
+  {
+    if (unitBits > 32)
+    {
+      putBits(accumulator, pending, units[i] & 0xFFFFFFFF, 32, out);
+      putBits(accumulator, pending, units[i] >> 32, unitBits - 32, out);
+    }
+    else
+    {
+      putBits(accumulator, pending, units[i], unitBits, out);
+    }
+  }
+  return out;
+}
+
+GENIRANGER_TARGET("sse2")
+static const uint8_t* unpackGroupSse2(const uint8_t* in, unsigned bits,
+                                      uint16_t* values)
+{
+  const unsigned unitBits = 4 * bits;
+  uint64_t units[GROUP_SIZE / 4];
+  uint64_t accumulator = 0;
+  unsigned available = 0;
+  for (size_t i = 0; i < GROUP_SIZE / 4; ++i)
+  {
+    if (unitBits > 32)
+    {
+      const uint64_t low = getBits(accumulator, available, 32, in);
+      units[i] = low | getBits(accumulator, available, unitBits - 32, in) << 32;
+    }
+    else
+    {
+      units[i] = getBits(accumulator, available, unitBits, in);
+    }
+  }
+
+  // The merges of packGroupSse2 in reverse
+  const uint32_t mask2 = bits == 16 ? 0xFFFFFFFF : (1u << (2 * bits)) - 1;
+  const __m128i low2 = _mm_set_epi32(0, static_cast<int>(mask2),
+                                     0, static_cast<int>(mask2));
+  const __m128i low = _mm_set1_epi32(static_cast<int>((1u << bits) - 1));
+  const __m128i shift = _mm_cvtsi32_si128(static_cast<int>(bits));
+  const __m128i shift2 = _mm_cvtsi32_si128(static_cast<int>(2 * bits));
+  for (size_t i = 0; i < GROUP_SIZE / 8; ++i)
+  {
+    __m128i x = _mm_loadu_si128(
+      reinterpret_cast<const __m128i*>(units + 2 * i));
+    x = _mm_or_si128(_mm_and_si128(x, low2),
+                     _mm_slli_epi64(_mm_srl_epi64(x, shift2), 32));
+    x = _mm_or_si128(_mm_and_si128(x, low),
+                     _mm_slli_epi32(_mm_srl_epi32(x, shift), 16));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(values + 8 * i), x);
+  }
+  return in;
+}
+
+#endif
+
+static unsigned groupBits(const uint16_t* values)
+{
+#if defined(GENIRANGER_X86)
+  if (gSse2)
+  {
+    return groupBitsSse2(values);
+  }
+#endif
+  return groupBitsScalar(values);
+}
+
+static uint8_t* packGroup(const uint16_t* values, unsigned bits, uint8_t* out)
+{
+#if defined(GENIRANGER_X86)
+  if (gSse2)
+  {
+    return packGroupSse2(values, bits, out);
+  }
+#endif
+  return packGroupScalar(values, bits, out);
+}
+
+static const uint8_t* unpackGroup(const uint8_t* in, unsigned bits,
+                                  uint16_t* values)
+{
+#if defined(GENIRANGER_X86)
+  if (gSse2)
+  {
+    return unpackGroupSse2(in, bits, values);
+  }
+#endif
+  return unpackGroupScalar(in, bits, values);
+}
+
+/** Packs complete groups of residuals, returns the end of the output. */
+static uint8_t* packLine(const uint16_t* residuals, size_t groupCount,
+                         uint8_t* out)
+{
+  for (size_t g = 0; g < groupCount; ++g)
+  {
+    const uint16_t* values = residuals + g * GROUP_SIZE;
+    const unsigned bits = groupBits(values);
+    *out++ = static_cast<uint8_t>(bits);
+    if (bits != 0)
+    {
+      // 32 values of b bits fill exactly b 32 bit words
+      out = packGroup(values, bits, out);
+    }
+  }
+  return out;
+}
+
+/** Unpacks complete groups of residuals, returns the end of the input. */
+static const uint8_t* unpackLine(const uint8_t* in, const uint8_t* end,
+                                 size_t groupCount, unsigned maxBits,
+                                 uint16_t* residuals)
+{
+  for (size_t g = 0; g < groupCount; ++g)
+  {
+    uint16_t* values = residuals + g * GROUP_SIZE;
+    if (in == end)
+    {
+      throw LoadException("Compressed data ends unexpectedly.");
+    }
+    const unsigned bits = *in++;
+    if (bits > maxBits || static_cast<size_t>(end - in) < 4 * bits)
+    {
+      throw LoadException("Compressed data is corrupt.");
+    }
+    if (bits == 0)
+    {
+      memset(values, 0, GROUP_SIZE * sizeof(uint16_t));
+      continue;
+    }
+    in = unpackGroup(in, bits, values);
+  }
+  return in;
+}
+
+/*
+  Strips
+*/
+
+template<typename T>
+static uint8_t* encodeStrip(const T* in, size_t width, size_t lineCount,
+                            uint8_t* out)
+{
+  const size_t groupCount = groupsPerLine(width);
+  // Padded to complete groups, the padding stays zero
+  std::vector<uint16_t> residuals(groupCount * GROUP_SIZE);
+  predictHorizontal(in, width, residuals.data());
+  out = packLine(residuals.data(), groupCount, out);
+  for (size_t line = 1; line < lineCount; ++line)
+  {
+    const T* current = in + line * width;
+    predict(current, current - width, width, residuals.data());
+    out = packLine(residuals.data(), groupCount, out);
+  }
+  return out;
+}
+
+template<typename T>
+static void decodeStrip(const uint8_t* in, const uint8_t* end, size_t width,
+                        size_t lineCount, T* out)
+{
+  const size_t groupCount = groupsPerLine(width);
+  const unsigned maxBits = 8 * sizeof(T);
+  std::vector<uint16_t> residuals(groupCount * GROUP_SIZE);
+  in = unpackLine(in, end, groupCount, maxBits, residuals.data());
+  reconstructHorizontal(residuals.data(), width, out);
+  for (size_t line = 1; line < lineCount; ++line)
+  {
+    T* current = out + line * width;
+    in = unpackLine(in, end, groupCount, maxBits, residuals.data());
+    reconstruct(residuals.data(), current - width, width, current);
+  }
+  if (in != end)
+  {
+    throw LoadException("Compressed data is corrupt.");
+  }
+}
+
+static void forEachStrip(size_t stripCount, ThreadPool* pool,
+                         const std::function<void(size_t)>& task)
+{
+  if (pool != nullptr && stripCount > 1)
+  {
+    pool->parallelFor(stripCount, task);
+  }
+  else
+  {
+    for (size_t strip = 0; strip < stripCount; ++strip)
+    {
+      task(strip);
+    }
+  }
+}
+
+size_t maxEncodedSize(size_t width, size_t lineCount, size_t bytesPerValue)
+{
+  const size_t stripCount
+    = stripCountFor(width, lineCount, LINES_PER_STRIP);
+  return HEADER_SIZE
+    + stripCount * sizeof(uint64_t)
+    + lineCount * maxLineSize(width, bytesPerValue);
+}
+
+size_t encode(const uint8_t* in,
+              size_t width,
+              size_t lineCount,
+              size_t bytesPerValue,
+              uint8_t* out,
+              ThreadPool* pool)
+{
+  const size_t stripCount
+    = stripCountFor(width, lineCount, LINES_PER_STRIP);
+  const size_t dataOffset = HEADER_SIZE + stripCount * sizeof(uint64_t);
+  const size_t maxStripSize = LINES_PER_STRIP
+    * maxLineSize(width, bytesPerValue);
+  const size_t stripBytes = LINES_PER_STRIP * width * bytesPerValue;
+
+  // Each strip is first encoded to its own worst case sized slot, then the
+  // strips are moved together
+  std::vector<size_t> stripSizes(stripCount);
+  forEachStrip(stripCount, pool, [&](size_t strip)
+  {
+    const size_t lines = strip + 1 == stripCount
+      ? lineCount - strip * LINES_PER_STRIP
+      : LINES_PER_STRIP;
+    uint8_t* stripOut = out + dataOffset + strip * maxStripSize;
+    uint8_t* stripEnd;
+    if (bytesPerValue == 2)
+    {
+      const uint16_t* stripIn
+        = reinterpret_cast<const uint16_t*>(in + strip * stripBytes);
+      stripEnd = encodeStrip(stripIn, width, lines, stripOut);
+    }
+    else
+    {
+      stripEnd = encodeStrip(in + strip * stripBytes, width, lines, stripOut);
+    }
+    stripSizes[strip] = stripEnd - stripOut;
+  });
+
+  size_t offset = dataOffset;
+  for (size_t strip = 0; strip < stripCount; ++strip)
+  {
+    memmove(out + offset, out + dataOffset + strip * maxStripSize,
+            stripSizes[strip]);
+    offset += stripSizes[strip];
+    store64(out + HEADER_SIZE + strip * sizeof(uint64_t), offset);
+  }
+
+  store64(out, offset);
+  store32(out + 8, static_cast<uint32_t>(width));
+  store32(out + 12, static_cast<uint32_t>(lineCount));
+  store32(out + 16, static_cast<uint32_t>(bytesPerValue));
+  store32(out + 20, static_cast<uint32_t>(LINES_PER_STRIP));
+  store32(out + 24, static_cast<uint32_t>(stripCount));
+  store32(out + 28, 0);
+  return offset;
+}
+
+uint64_t encodedSize(const uint8_t* in, uint64_t available)
+{
+  if (available < HEADER_SIZE)
+  {
+    throw LoadException("Compressed data ends unexpectedly.");
+  }
+  const uint64_t size = load64(in);
+  if (size < HEADER_SIZE || size > available)
+  {
+    throw LoadException("Compressed data ends unexpectedly.");
+  }
+  return size;
+}
+
+void decode(const uint8_t* in,
+            uint64_t inSize,
+            size_t width,
+            size_t lineCount,
+            size_t bytesPerValue,
+            uint8_t* out,
+            ThreadPool* pool)
+{
+  const uint64_t blockSize = encodedSize(in, inSize);
+  if (load32(in + 8) != width
+      || load32(in + 12) != lineCount
+      || load32(in + 16) != bytesPerValue
+      || (bytesPerValue != 1 && bytesPerValue != 2))
+  {
+    throw LoadException(
+      "Compressed data does not match the size described by the XML-file.");
+  }
+  const size_t linesPerStrip = load32(in + 20);
+  const size_t stripCount = load32(in + 24);
+  if (linesPerStrip == 0
+      || stripCount != stripCountFor(width, lineCount, linesPerStrip)
+      || HEADER_SIZE + stripCount * sizeof(uint64_t) > blockSize)
+  {
+    throw LoadException("Compressed data is corrupt.");
+  }
+
+  // Strip boundaries are validated up front, so the strips can be decoded
+  // independently without reading outside the block
+  std::vector<uint64_t> stripBegin(stripCount + 1);
+  stripBegin[0] = HEADER_SIZE + stripCount * sizeof(uint64_t);
+  for (size_t strip = 0; strip < stripCount; ++strip)
+  {
+    stripBegin[strip + 1] = load64(in + HEADER_SIZE + strip * sizeof(uint64_t));
+    if (stripBegin[strip + 1] < stripBegin[strip]
+        || stripBegin[strip + 1] > blockSize)
+    {
+      throw LoadException("Compressed data is corrupt.");
+    }
+  }
+
+  const size_t stripBytes = linesPerStrip * width * bytesPerValue;
+  forEachStrip(stripCount, pool, [&](size_t strip)
+  {
+    const size_t lines = strip + 1 == stripCount
+      ? lineCount - strip * linesPerStrip
+      : linesPerStrip;
+    const uint8_t* stripIn = in + stripBegin[strip];
+    const uint8_t* stripEnd = in + stripBegin[strip + 1];
+    if (bytesPerValue == 2)
+    {
+      uint16_t* stripOut
+        = reinterpret_cast<uint16_t*>(out + strip * stripBytes);
+      decodeStrip(stripIn, stripEnd, width, lines, stripOut);
+    }
+    else
+    {
+      decodeStrip(stripIn, stripEnd, width, lines, out + strip * stripBytes);
+    }
+  });
+}
+
+const char* implementation()
+{
+  return gSse2 ? "SSE2" : "Scalar";
+}
+
+}
+
+}
@@ -0,0 +1,86 @@
+// Copyright 2018 SICK AG. All rights reserved.
+
+#ifndef GENIRANGER_RANGECODEC_H
+#define GENIRANGER_RANGECODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace GenIRanger
+{
+
+class ThreadPool;
+
+/** Lossless compression of 8 and 16 bit component data, Encoding::LineDelta.
+
+    Consecutive profiles of a scan are similar, so each value is predicted by
+    the value in the same column of the line before. The residuals are zigzag
+    mapped, to make small negative values small positive ones, and bit-packed
+    in groups of 32 values using the fewest bits that hold the largest value
+    of the group.
+
+    The lines are split into strips which are encoded independently, so that
+    strips can be encoded and decoded in parallel. The first line of a strip
+    is predicted from the value to the left instead.
+
+    An encoded block is self-contained and little endian:
+
+      uint64 block size in bytes, including this header
+      uint32 width, number of values per line
+      uint32 line count
+      uint32 bytes per value, 1 or 2
+      uint32 lines per strip
+      uint32 strip count
+      uint32 reserved, zero
+      uint64 end offset of each strip, relative to the start of the block
+      strip data
+
+    Each line of a strip is stored as ceil(width / 32) groups. A group is one
+    byte holding the number of bits b, 0-16, followed by 4 * b bytes with the
+    32 values, LSB first.
+*/
+namespace RangeCodec
+{
+  /** Size of the fixed part of the block header. */
+  const size_t HEADER_SIZE = 32;
+
+  /** Returns the largest possible size of an encoded block. */
+  size_t maxEncodedSize(size_t width, size_t lineCount, size_t bytesPerValue);
+
+  /** Encodes width * lineCount values of 1 or 2 bytes to out, which must hold
+      maxEncodedSize bytes. Strips are encoded on the pool if it is not
+      nullptr. Returns the size of the encoded block.
+  */
+  size_t encode(const uint8_t* in,
+                size_t width,
+                size_t lineCount,
+                size_t bytesPerValue,
+                uint8_t* out,
+                ThreadPool* pool);
+
+  /** Returns the size of the block starting at in, read from its header.
+      Throws LoadException if the available bytes cannot hold it.
+  */
+  uint64_t encodedSize(const uint8_t* in, uint64_t available);
+
+  /** Decodes a block of inSize bytes to out, which must hold width *
+      lineCount * bytesPerValue bytes. Strips are decoded on the pool if it is
+      not nullptr. Throws LoadException if the block does not hold data of the
+      expected dimensions or is corrupt.
+  */
+  void decode(const uint8_t* in,
+              uint64_t inSize,
+              size_t width,
+              size_t lineCount,
+              size_t bytesPerValue,
+              uint8_t* out,
+              ThreadPool* pool);
+
+  /** Returns the name of the instruction set used for the prediction and
+      the bit-packing.
+  */
+  const char* implementation();
+}
+
+}
+#endif
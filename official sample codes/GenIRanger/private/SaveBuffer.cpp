@@ -4,6 +4,14 @@
 #include "DatAndXmlFiles.h"
 #include "Exceptions.h"
 #include "GenIRanger.h"
+#include "PixelConversion.h"
+#include "RangeCodec.h"
+#include "SaveBuffer.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
 
 using namespace GenApi;
 
@@ -42,45 +50,62 @@ void writeSensorRangeTraits(DatXmlWriter& xml, const int64_t bufferWidth,
   xml.closeSensorRangeTraits();
 }
 
-void writeSensorRangeTraits(DatXmlWriter& xml, RangeFrame& frame)
+void writeEncoding(DatXmlWriter& xml, const Encoding encoding)
 {
-  writeSensorRangeTraits(
-    xml,
-    frame.aoiSize().x(),
-    frame.aoiSize().y(),
-    frame.aoiOffset().x(),
-    frame.aoiOffset().y());
+  // Only written for compressed data, to keep raw files exactly as before
+  if (encoding == Encoding::LineDelta)
+  {
+    xml.addParameter("encoding", "LINEDELTA");
+  }
 }
 
-void writeSubComponentRange16(DatXmlWriter& xml, const int64_t bufferWidth)
+void writeSubComponentRange16(DatXmlWriter& xml, const int64_t bufferWidth,
+                              const Encoding encoding)
 {
   // XML file write use { } brackets to indicate element structure
   xml.openSubComponent("WORD", "Range");
   {
     xml.addParameter("size", std::to_string(bufferWidth * 2));
     xml.addParameter("width", std::to_string(bufferWidth));
+    writeEncoding(xml, encoding);
   }
   xml.closeSubComponent();
 }
 
-void writeSubComponentReflectance(DatXmlWriter& xml, const int64_t bufferWidth)
+void writeSubComponentRange12p(DatXmlWriter& xml, const int64_t bufferWidth)
+{
+  // Two pixels in three bytes, exactly as received from the camera
+  xml.openSubComponent("WORD12P", "Range");
+  {
+    xml.addParameter("size", std::to_string(bufferWidth * 3 / 2));
+    xml.addParameter("width", std::to_string(bufferWidth));
+  }
+  xml.closeSubComponent();
+}
+
+void writeSubComponentReflectance(DatXmlWriter& xml,
+                                  const int64_t bufferWidth,
+                                  const Encoding encoding)
 {
   // XML file write use { } brackets to indicate element structure
   xml.openSubComponent("BYTE", "Intensity");
   {
     xml.addParameter("size", std::to_string(bufferWidth));
     xml.addParameter("width", std::to_string(bufferWidth));
+    writeEncoding(xml, encoding);
   }
   xml.closeSubComponent();
 }
 
-void writeSubComponentScatter(DatXmlWriter& xml, const int64_t bufferWidth)
+void writeSubComponentScatter(DatXmlWriter& xml, const int64_t bufferWidth,
+                              const Encoding encoding)
 {
   // XML file write use { } brackets to indicate element structure
   xml.openSubComponent("BYTE", "Scatter");
   {
     xml.addParameter("size", std::to_string(bufferWidth));
     xml.addParameter("width", std::to_string(bufferWidth));
+    writeEncoding(xml, encoding);
   }
   xml.closeSubComponent();
 }
@@ -95,6 +120,140 @@ void writeSubComponentMarkData(DatXmlWriter& xml, const int64_t bufferWidth)
   xml.closeSubComponent();
 }
 
+void writeRangeXml(DatAndXmlFiles& files,
+                   const int64_t aoiWidth,
+                   const int64_t aoiHeight,
+                   const int64_t aoiOffsetX,
+                   const int64_t aoiOffsetY,
+                   const bool hasReflectance,
+                   const bool hasScatter,
+                   const bool hasMarkData,
+                   const std::string& arbitraryXml,
+                   const int64_t linesPerScan,
+                   const uint64_t lineCount,
+                   const PixelWidth rangeWidth,
+                   const Encoding rangeEncoding,
+                   const Encoding reflectanceEncoding,
+                   const Encoding scatterEncoding)
+{
+  // Size in bytes of one line of data, i.e., all subcomponents
+  int64_t totalSize = rangeWidth == PixelWidth::PW12
+    ? aoiWidth * 3 / 2
+    : sizeof(uint16_t) * aoiWidth;
+  if (hasReflectance)
+  {
+    totalSize += sizeof(uint8_t) * aoiWidth;
+  }
+  if (hasScatter)
+  {
+    totalSize += sizeof(uint8_t) * aoiWidth;
+  }
+  if (hasMarkData)
+  {
+    totalSize += sizeof(LineMark);
+  }
+
+  DatXmlWriter xml;
+  xml.open();
+  {
+    xml.addParameter("size", std::to_string(totalSize));
+    xml.addParameter("version", "1");
+    xml.addParameter("layout", "SUBCOMPONENT");
+    if (lineCount > 0)
+    {
+      xml.addParameter("line count", std::to_string(lineCount));
+    }
+    xml.openComponent("Hi3D", "Ranger3Range");
+    {
+      xml.addParameter("size", std::to_string(totalSize));
+      xml.addParameter("height", std::to_string(linesPerScan));
+      writeSensorRangeTraits(xml, aoiWidth, aoiHeight, aoiOffsetX, aoiOffsetY);
+
+      if (rangeWidth == PixelWidth::PW12)
+      {
+        writeSubComponentRange12p(xml, aoiWidth);
+      }
+      else
+      {
+        writeSubComponentRange16(xml, aoiWidth, rangeEncoding);
+      }
+      if (hasReflectance)
+      {
+        writeSubComponentReflectance(xml, aoiWidth, reflectanceEncoding);
+      }
+      if (hasScatter)
+      {
+        writeSubComponentScatter(xml, aoiWidth, scatterEncoding);
+      }
+      if (hasMarkData)
+      {
+        writeSubComponentMarkData(xml, aoiWidth);
+      }
+    }
+    xml.closeComponent();
+    xml.addArbitraryXml(arbitraryXml);
+  }
+  xml.close();
+
+  std::string xmlString = xml.toString();
+  files.writeXml(xmlString);
+}
+
+/** Unpacks 12p range data to 16 bit while writing it to the DAT-file. */
+void writeRange12pAs16(DatAndXmlFiles& files,
+                       const uint8_t* range12p,
+                       const size_t range12pSize)
+{
+  // Unpack in blocks small enough to stay in the CPU cache between the
+  // conversion and the write, instead of unpacking the whole buffer first.
+  // The block size is a multiple of 3 to convert complete pixel pairs.
+  const size_t blockSize = 3 * 8 * 1024;
+  std::vector<uint8_t> block(PixelConversion::unpacked12pSize(blockSize));
+  for (size_t offset = 0; offset < range12pSize; offset += blockSize)
+  {
+    const size_t length = std::min(blockSize, range12pSize - offset);
+    PixelConversion::unpack12pTo16(range12p + offset, length, block.data());
+    files.writeData(block.data(), PixelConversion::unpacked12pSize(length));
+  }
+}
+
+/** Packs 16 bit range data to 12p while writing it to the DAT-file. */
+void writeRange16As12p(DatAndXmlFiles& files,
+                       const uint8_t* range16,
+                       const size_t range16Size)
+{
+  // Same block approach as when unpacking, an even number of pixels per block
+  const size_t blockPixels = 2 * 8 * 1024;
+  const size_t pixelCount = range16Size / sizeof(uint16_t);
+  const uint16_t* pixels = reinterpret_cast<const uint16_t*>(range16);
+  std::vector<uint8_t> block(PixelConversion::packed12pSize(blockPixels));
+  for (size_t offset = 0; offset < pixelCount; offset += blockPixels)
+  {
+    const size_t length = std::min(blockPixels, pixelCount - offset);
+    PixelConversion::pack16To12p(pixels + offset, length, block.data());
+    files.writeData(block.data(), PixelConversion::packed12pSize(length));
+  }
+}
+
+/** Compresses lineCount lines of a component on the conversion pool. The
+    encoded block is kept in encoded until it has been written.
+*/
+DataSpan encodeComponent(const uint8_t* data,
+                         const size_t width,
+                         const size_t lineCount,
+                         const size_t bytesPerValue,
+                         std::unique_ptr<uint8_t[]>& encoded)
+{
+  // Not value-initialized, only the encoded part is ever read
+  encoded.reset(new uint8_t[
+    RangeCodec::maxEncodedSize(width, lineCount, bytesPerValue)]);
+  std::shared_ptr<ThreadPool> pool = getConversionPool();
+  DataSpan span = { encoded.get(),
+                    RangeCodec::encode(data, width, lineCount, bytesPerValue,
+                                       encoded.get(), pool.get()) };
+  return span;
+}
+
 GENIRANGER_API void saveBuffer16(
   const uint8_t* buffer,
   const int64_t bufferWidth,
@@ -130,22 +289,62 @@ GENIRANGER_API void saveMultiPartBuffer(
     .aoiOffset((size_t)aoiOffsetX, (size_t)aoiOffsetY)
     .aoiSize((size_t)bufferWidth, (size_t)aoiHeight);
 
-  frame.createRange(bufferSize * 2, PixelWidth::PW16);
-  frame.range()->data().assign(bufferRange16, bufferRange16 + 2 * bufferSize);
-
+  // The components only view the buffers, which are never written to. The
+  // frame does not outlive this call, so no release callback is needed.
+  frame.createRangeView(const_cast<uint8_t*>(bufferRange16), bufferSize * 2,
+                        PixelWidth::PW16);
   if (bufferReflectance8 != nullptr)
   {
-    frame.createReflectance(bufferSize, PixelWidth::PW8);
-    frame.reflectance()->data().assign(bufferReflectance8, bufferReflectance8 + bufferSize);
+    frame.createReflectanceView(const_cast<uint8_t*>(bufferReflectance8),
+                                bufferSize, PixelWidth::PW8);
   }
   if (bufferScatter8 != nullptr)
   {
-    frame.createScatter(bufferSize, PixelWidth::PW8);
-    frame.scatter()->data().assign(bufferScatter8, bufferScatter8 + bufferSize);
+    frame.createScatterView(const_cast<uint8_t*>(bufferScatter8),
+                            bufferSize, PixelWidth::PW8);
   }
   saveMultipartRangeFrame(frame, filePath, arbitraryXml);
 }
 
+GENIRANGER_API void saveMultiPartBuffer12p(
+  const uint8_t* bufferRange12p,
+  const uint8_t* bufferReflectance8,
+  const uint8_t* bufferScatter8,
+  const int64_t bufferWidth,
+  const int64_t bufferHeight,
+  const int64_t aoiHeight,
+  const int64_t aoiOffsetX,
+  const int64_t aoiOffsetY,
+  const std::string& filePath,
+  const std::string& arbitraryXml)
+{
+  const size_t pixelCount = static_cast<size_t>(bufferWidth * bufferHeight);
+  const size_t range12pSize = PixelConversion::packed12pSize(pixelCount);
+
+  DatAndXmlFiles files(filePath);
+
+  writeRange12pAs16(files, bufferRange12p, range12pSize);
+
+  if (bufferReflectance8 != nullptr)
+  {
+    files.writeData(bufferReflectance8, pixelCount);
+  }
+  if (bufferScatter8 != nullptr)
+  {
+    files.writeData(bufferScatter8, pixelCount);
+  }
+
+  writeRangeXml(files,
+                bufferWidth,
+                aoiHeight,
+                aoiOffsetX,
+                aoiOffsetY,
+                bufferReflectance8 != nullptr,
+                bufferScatter8 != nullptr,
+                false,
+                arbitraryXml);
+}
+
 GENIRANGER_API void saveBuffer8(
   const uint8_t* buffer,
   const int64_t bufferWidth,
@@ -187,26 +386,36 @@ GENIRANGER_API void saveBuffer8(
 
   DatAndXmlFiles files(filePath);
   files.writeData(buffer, bufferWidth * bufferHeight);
-  files.writeXml(xml.toString());
+  std::string xmlString = xml.toString();
+  files.writeXml(xmlString);
 }
 
-GENIRANGER_API void saveMultipartRangeFrame(
-  RangeFrame& frame,
-  const std::string& filePath,
-  const std::string& arbitraryXml)
+void validateRangeFrame(RangeFrame& frame, const PixelWidth savedRangeWidth)
 {
   ComponentPtr range = frame.range();
   ComponentPtr reflectance = frame.reflectance();
   ComponentPtr scatter = frame.scatter();
-  LineMetadataPtr lineEncoderValues = frame.lineEncoderValues();
 
   if (!range)
   {
     throw SaveException("Range component must exist, when saving.");
   }
-  if (range->pixelWidth() != PixelWidth::PW16)
+  if (range->pixelWidth() != PixelWidth::PW16
+      && range->pixelWidth() != PixelWidth::PW12)
+  {
+    throw SaveException(
+      "Range component must have pixel width 16 or 12, when saving.");
+  }
+  if (savedRangeWidth != PixelWidth::PW16
+      && savedRangeWidth != PixelWidth::PW12)
+  {
+    throw SaveException("Range data can only be saved as 16 or 12 bit.");
+  }
+  if (savedRangeWidth == PixelWidth::PW12 && frame.aoiSize().x() % 2 != 0)
   {
-    throw SaveException("Range component must have pixel width 16, when saving.");
+    // Otherwise lines would not start on a byte boundary
+    throw SaveException(
+      "Range data can only be saved as 12 bit if the width is even.");
   }
   if (scatter && scatter->pixelWidth() != PixelWidth::PW8)
   {
@@ -216,61 +425,245 @@ GENIRANGER_API void saveMultipartRangeFrame(
   {
     throw SaveException("Reflectance component must have pixel width 8, when saving.");
   }
+  if (range->encoding() != Encoding::Raw
+      && savedRangeWidth == PixelWidth::PW12)
+  {
+    throw SaveException(
+      "Compressed range data can only be saved as 16 bit.");
+  }
+  if (isEncoded(frame))
+  {
+    // Compression works on complete lines
+    const size_t width = frame.aoiSize().x();
+    const size_t lineCount = rangeLineCount(frame);
+    if (width == 0
+        || lineCount * width * 2 != unpackedRangeSize(*range)
+        || (reflectance && reflectance->sizeInBytes() != lineCount * width)
+        || (scatter && scatter->sizeInBytes() != lineCount * width))
+    {
+      throw SaveException("Components must hold complete lines of the same "
+                          "count, when saving compressed.");
+    }
+  }
+}
 
-  const size_t aoiWidth = frame.aoiSize().x();
-  DatAndXmlFiles files(filePath);
+bool isEncoded(RangeFrame& frame)
+{
+  ComponentPtr range = frame.range();
+  ComponentPtr reflectance = frame.reflectance();
+  ComponentPtr scatter = frame.scatter();
+  return (range && range->encoding() != Encoding::Raw)
+    || (reflectance && reflectance->encoding() != Encoding::Raw)
+    || (scatter && scatter->encoding() != Encoding::Raw);
+}
 
-  files.writeData(range);
-  size_t totalSize = sizeof(uint16_t) * aoiWidth;
+size_t unpackedRangeSize(const Component& range)
+{
+  return range.pixelWidth() == PixelWidth::PW12
+    ? PixelConversion::unpacked12pSize(range.sizeInBytes())
+    : range.sizeInBytes();
+}
 
-  if (reflectance)
+size_t rangeLineCount(RangeFrame& frame)
+{
+  const size_t width = frame.aoiSize().x();
+  return width == 0
+    ? 0
+    : unpackedRangeSize(*frame.range()) / sizeof(uint16_t) / width;
+}
+
+bool hasLineMarkData(RangeFrame& frame)
+{
+  return frame.hasLineMarks() || frame.lineEncoderValues() != nullptr;
+}
+
+void writeRangeFrameData(DatAndXmlFiles& files,
+                         RangeFrame& frame,
+                         const PixelWidth savedRangeWidth)
+{
+  ComponentPtr range = frame.range();
+  ComponentPtr reflectance = frame.reflectance();
+  ComponentPtr scatter = frame.scatter();
+  LineMetadataPtr lineEncoderValues = frame.lineEncoderValues();
+
+  // All components are handed to the DAT-file together, which lets it write
+  // them with a single system call where supported
+  DataSpan spans[4];
+  size_t spanCount = 0;
+  const size_t width = frame.aoiSize().x();
+  const size_t lineCount = rangeLineCount(frame);
+  std::unique_ptr<uint8_t[]> unpackedRange;
+  std::unique_ptr<uint8_t[]> encodedRange;
+  std::unique_ptr<uint8_t[]> encodedReflectance;
+  std::unique_ptr<uint8_t[]> encodedScatter;
+  if (range->encoding() != Encoding::Raw)
   {
-    files.writeData(reflectance);
-    totalSize += sizeof(uint8_t) * aoiWidth;
+    const uint8_t* range16 = range->bytes();
+    if (range->pixelWidth() == PixelWidth::PW12)
+    {
+      // Predicted on the 16 bit values, so unpack everything first
+      unpackedRange.reset(new uint8_t[unpackedRangeSize(*range)]);
+      PixelConversion::unpack12pTo16(range->bytes(), range->sizeInBytes(),
+                                     unpackedRange.get());
+      range16 = unpackedRange.get();
+    }
+    spans[spanCount++] = encodeComponent(range16, width, lineCount,
+                                         sizeof(uint16_t), encodedRange);
+    // The unpacked data is not needed once encoded
+    unpackedRange.reset();
   }
-  if (scatter)
+  else if (range->pixelWidth() == PixelWidth::PW12
+           && savedRangeWidth == PixelWidth::PW16)
   {
-    files.writeData(scatter);
-    totalSize += sizeof(uint8_t) * aoiWidth;
+    writeRange12pAs16(files, range->bytes(), range->sizeInBytes());
+  }
+  else if (range->pixelWidth() == PixelWidth::PW16
+           && savedRangeWidth == PixelWidth::PW12)
+  {
+    writeRange16As12p(files, range->bytes(), range->sizeInBytes());
+  }
+  else
+  {
+    DataSpan span = { range->bytes(), range->sizeInBytes() };
+    spans[spanCount++] = span;
+  }
+  if (reflectance && reflectance->encoding() != Encoding::Raw)
+  {
+    spans[spanCount++] = encodeComponent(reflectance->bytes(), width,
+                                         lineCount, sizeof(uint8_t),
+                                         encodedReflectance);
+  }
+  else if (reflectance)
+  {
+    DataSpan span = { reflectance->bytes(), reflectance->sizeInBytes() };
+    spans[spanCount++] = span;
   }
-  if (lineEncoderValues)
+  if (scatter && scatter->encoding() != Encoding::Raw)
   {
-    files.writeMarkData(lineEncoderValues);
-    totalSize += sizeof(Metadata) * 5;
+    spans[spanCount++] = encodeComponent(scatter->bytes(), width, lineCount,
+                                         sizeof(uint8_t), encodedScatter);
   }
+  else if (scatter)
+  {
+    DataSpan span = { scatter->bytes(), scatter->sizeInBytes() };
+    spans[spanCount++] = span;
+  }
+  // Line marks are already laid out as in the file, only encoder values
+  // have to be formatted
+  LineMarks formattedMarks;
+  if (frame.hasLineMarks())
+  {
+    DataSpan span = { reinterpret_cast<const uint8_t*>(frame.lineMarkData()),
+                      frame.lineMarkCount() * sizeof(LineMark) };
+    spans[spanCount++] = span;
+  }
+  else if (lineEncoderValues)
+  {
+    DatAndXmlFiles::formatMarkData(lineEncoderValues, formattedMarks);
+    DataSpan span = { reinterpret_cast<const uint8_t*>(formattedMarks.data()),
+                      formattedMarks.size() * sizeof(LineMark) };
+    spans[spanCount++] = span;
+  }
+  files.writeData(spans, spanCount);
+}
 
-  DatXmlWriter xml;
-  xml.open();
+void writeRangeFrame(DatAndXmlFiles& files,
+                     RangeFrame& frame,
+                     const std::string& arbitraryXml,
+                     const PixelWidth savedRangeWidth,
+                     const bool statesLineCount)
+{
+  ComponentPtr reflectance = frame.reflectance();
+  ComponentPtr scatter = frame.scatter();
+
+  // Compressed data is stored as one block of all lines per subcomponent,
+  // instead of one line per block. Stating the line count describes the
+  // blocks the same way, which is equivalent for uncompressed data.
+  int64_t linesPerScan = 1;
+  uint64_t lineCount = 0;
+  if (isEncoded(frame) || statesLineCount)
   {
-    xml.addParameter("size", std::to_string(totalSize));
-    xml.addParameter("version", "1");
-    xml.addParameter("layout", "SUBCOMPONENT");
-    xml.openComponent("Hi3D", "Ranger3Range");
-    {
-      xml.addParameter("size", std::to_string(totalSize));
-      xml.addParameter("height", "1");
-      writeSensorRangeTraits(xml, frame);
+    linesPerScan = static_cast<int64_t>(rangeLineCount(frame));
+    lineCount = rangeLineCount(frame);
+  }
 
-      writeSubComponentRange16(xml, aoiWidth);
-      if (reflectance)
-      {
-        writeSubComponentReflectance(xml, aoiWidth);
-      }
-      if (scatter)
-      {
-        writeSubComponentScatter(xml, aoiWidth);
-      }
-      if (lineEncoderValues)
-      {
-        writeSubComponentMarkData(xml, aoiWidth);
-      }
-    }
-    xml.closeComponent();
-    xml.addArbitraryXml(arbitraryXml);
+  writeRangeFrameData(files, frame, savedRangeWidth);
+  writeRangeXml(files,
+                frame.aoiSize().x(),
+                frame.aoiSize().y(),
+                frame.aoiOffset().x(),
+                frame.aoiOffset().y(),
+                reflectance != nullptr,
+                scatter != nullptr,
+                hasLineMarkData(frame),
+                arbitraryXml,
+                linesPerScan,
+                lineCount,
+                savedRangeWidth,
+                frame.range()->encoding(),
+                reflectance ? reflectance->encoding() : Encoding::Raw,
+                scatter ? scatter->encoding() : Encoding::Raw);
+}
+
+uint64_t rangeFrameDataSize(RangeFrame& frame,
+                            const PixelWidth savedRangeWidth)
+{
+  ComponentPtr range = frame.range();
+  ComponentPtr reflectance = frame.reflectance();
+  ComponentPtr scatter = frame.scatter();
+  LineMetadataPtr lineEncoderValues = frame.lineEncoderValues();
+
+  const size_t width = frame.aoiSize().x();
+  const size_t lineCount = rangeLineCount(frame);
+
+  uint64_t size = range->sizeInBytes();
+  if (range->encoding() != Encoding::Raw)
+  {
+    size = RangeCodec::maxEncodedSize(width, lineCount, sizeof(uint16_t));
   }
-  xml.close();
+  else if (range->pixelWidth() == PixelWidth::PW12
+           && savedRangeWidth == PixelWidth::PW16)
+  {
+    size = PixelConversion::unpacked12pSize(range->sizeInBytes());
+  }
+  else if (range->pixelWidth() == PixelWidth::PW16
+           && savedRangeWidth == PixelWidth::PW12)
+  {
+    size = PixelConversion::packed12pSize(range->sizeInBytes() / 2);
+  }
+  if (reflectance)
+  {
+    size += reflectance->encoding() != Encoding::Raw
+      ? RangeCodec::maxEncodedSize(width, lineCount, sizeof(uint8_t))
+      : reflectance->sizeInBytes();
+  }
+  if (scatter)
+  {
+    size += scatter->encoding() != Encoding::Raw
+      ? RangeCodec::maxEncodedSize(width, lineCount, sizeof(uint8_t))
+      : scatter->sizeInBytes();
+  }
+  if (frame.hasLineMarks())
+  {
+    size += frame.lineMarkCount() * sizeof(LineMark);
+  }
+  else if (lineEncoderValues)
+  {
+    size += lineEncoderValues->size() * sizeof(LineMark);
+  }
+  return size;
+}
 
-  files.writeXml(xml.toString());
+GENIRANGER_API void saveMultipartRangeFrame(
+  RangeFrame& frame,
+  const std::string& filePath,
+  const std::string& arbitraryXml,
+  const PixelWidth savedRangeWidth)
+{
+  validateRangeFrame(frame, savedRangeWidth);
+
+  DatAndXmlFiles files(filePath);
+  writeRangeFrame(files, frame, arbitraryXml, savedRangeWidth);
 }
 
 }
@@ -0,0 +1,80 @@
+// Copyright 2018 SICK AG. All rights reserved.
+
+#ifndef GENIRANGER_SAVEBUFFER_H
+#define GENIRANGER_SAVEBUFFER_H
+
+#include "DatAndXmlFiles.h"
+#include "StreamData.h"
+
+#include <string>
+
+namespace GenIRanger
+{
+
+/** Writes the XML describing 16 bit range data and the optional components
+    that follow it in the DAT-file.
+
+    \param linesPerScan Number of lines in each block of subcomponents
+    \param lineCount Total number of lines in the DAT-file, if known
+    \param rangeWidth PW12 if the range data is stored 12 bit packed
+    \param rangeEncoding How each block of range data is stored, and likewise
+                         for reflectance and scatter
+*/
+void writeRangeXml(DatAndXmlFiles& files,
+                   const int64_t aoiWidth,
+                   const int64_t aoiHeight,
+                   const int64_t aoiOffsetX,
+                   const int64_t aoiOffsetY,
+                   const bool hasReflectance,
+                   const bool hasScatter,
+                   const bool hasMarkData,
+                   const std::string& arbitraryXml,
+                   const int64_t linesPerScan = 1,
+                   const uint64_t lineCount = 0,
+                   const PixelWidth rangeWidth = PixelWidth::PW16,
+                   const Encoding rangeEncoding = Encoding::Raw,
+                   const Encoding reflectanceEncoding = Encoding::Raw,
+                   const Encoding scatterEncoding = Encoding::Raw);
+
+/** Throws SaveException if the frame cannot be saved by writeRangeFrame. */
+void validateRangeFrame(RangeFrame& frame,
+                        const PixelWidth savedRangeWidth = PixelWidth::PW16);
+
+/** Writes a validated frame and its XML description. The range data is
+    unpacked or packed as needed to be stored with savedRangeWidth. Components
+    are compressed according to their encoding.
+
+    \param statesLineCount Set if the DAT-file may be larger than the frame,
+                           so that its size cannot tell the number of lines
+*/
+void writeRangeFrame(DatAndXmlFiles& files,
+                     RangeFrame& frame,
+                     const std::string& arbitraryXml,
+                     const PixelWidth savedRangeWidth = PixelWidth::PW16,
+                     const bool statesLineCount = false);
+
+/** True if any component of the frame is saved compressed. */
+bool isEncoded(RangeFrame& frame);
+
+/** Size in bytes of range data when unpacked to 16 bit. */
+size_t unpackedRangeSize(const Component& range);
+
+/** Number of complete lines of range data in the frame. */
+size_t rangeLineCount(RangeFrame& frame);
+
+/** True if the frame has line marks or encoder values to save as mark data. */
+bool hasLineMarkData(RangeFrame& frame);
+
+/** Writes the components of a validated frame, without any XML. */
+void writeRangeFrameData(DatAndXmlFiles& files,
+                         RangeFrame& frame,
+                         const PixelWidth savedRangeWidth = PixelWidth::PW16);
+
+/** Returns the number of bytes writeRangeFrame writes to the DAT-file. For
+    compressed components it is the largest possible size.
+*/
+uint64_t rangeFrameDataSize(RangeFrame& frame,
+                            const PixelWidth savedRangeWidth = PixelWidth::PW16);
+
+}
+#endif
@@ -0,0 +1,222 @@
+// Copyright 2018 SICK AG. All rights reserved.
+
+#include "ScanRecorder.h"
+#include "DatAndXmlFiles.h"
+#include "Exceptions.h"
+#include "FrameIndexFile.h"
+#include "PixelConversion.h"
+#include "PreallocatedFile.h"
+#include "SaveBuffer.h"
+
+namespace GenIRanger
+{
+
+namespace
+{
+
+/** Returns the number of lines in a validated frame. */
+size_t frameLineCount(RangeFrame& frame)
+{
+  const size_t width = frame.aoiSize().x();
+  if (width == 0)
+  {
+    throw SaveException("Frame width must not be 0, when recording.");
+  }
+  ComponentPtr range = frame.range();
+  size_t pixelCount = range->sizeInBytes() / sizeof(uint16_t);
+  if (range->pixelWidth() == PixelWidth::PW12)
+  {
+    pixelCount = PixelConversion::unpacked12pSize(range->sizeInBytes())
+      / sizeof(uint16_t);
+  }
+  if (pixelCount % width != 0)
+  {
+    throw SaveException("Range component must hold complete lines, "
+                        "when recording.");
+  }
+  return pixelCount / width;
+}
+
+}
+
+ScanRecorder::ScanRecorder(const std::string& filePath,
+                           size_t checkpointInterval,
+                           const std::string& arbitraryXml)
+  : mDatFile(new PreallocatedFile(filePath + ".dat", 0))
+  , mArbitraryXml(arbitraryXml)
+  , mCheckpointInterval(checkpointInterval)
+  , mFrameCount(0)
+  , mLineCount(0)
+  , mCheckpointFrameCount(0)
+  , mAoiSize(0, 0)
+  , mAoiOffset(0, 0)
+  , mRangePixelWidth(PixelWidth::PW16)
+  , mHasReflectance(false)
+  , mHasScatter(false)
+  , mHasMarkData(false)
+  , mRangeEncoding(Encoding::Raw)
+  , mReflectanceEncoding(Encoding::Raw)
+  , mScatterEncoding(Encoding::Raw)
+  , mFrameDataSize(0)
+  , mLinesPerFrame(0)
+{
+  // Discard any previous recording. The XML-file goes first, or it would
+  // describe the new data after a crash before the first checkpoint.
+  removeFileDurably(filePath + ".xml");
+  mDatFile->resize(0);
+  mFiles.reset(new DatAndXmlFiles(filePath, *mDatFile, true));
+}
+
+ScanRecorder::~ScanRecorder()
+{
+  try
+  {
+    close();
+  }
+  catch (...)
+  {
+  }
+}
+
+void ScanRecorder::append(RangeFrame& frame)
+{
+  if (!mFiles)
+  {
+    throw SaveException("The recording is closed.");
+  }
+  validateRangeFrame(frame);
+
+  const uint64_t frameDataSize = rangeFrameDataSize(frame);
+  const bool hasReflectance = frame.reflectance() != nullptr;
+  const bool hasScatter = frame.scatter() != nullptr;
+  const bool hasMarkData = hasLineMarkData(frame);
+  const Encoding rangeEncoding = frame.range()->encoding();
+  const Encoding reflectanceEncoding
+    = hasReflectance ? frame.reflectance()->encoding() : Encoding::Raw;
+  const Encoding scatterEncoding
+    = hasScatter ? frame.scatter()->encoding() : Encoding::Raw;
+  if (mFrameCount == 0)
+  {
+    mLinesPerFrame = frameLineCount(frame);
+    mAoiSize = frame.aoiSize();
+    mAoiOffset = frame.aoiOffset();
+    mRangePixelWidth = frame.range()->pixelWidth();
+    mHasReflectance = hasReflectance;
+    mHasScatter = hasScatter;
+    mHasMarkData = hasMarkData;
+    mRangeEncoding = rangeEncoding;
+    mReflectanceEncoding = reflectanceEncoding;
+    mScatterEncoding = scatterEncoding;
+    mFrameDataSize = frameDataSize;
+  }
+  else if (frameDataSize != mFrameDataSize
+           || !(frame.aoiSize() == mAoiSize)
+           || !(frame.aoiOffset() == mAoiOffset)
+           || frame.range()->pixelWidth() != mRangePixelWidth
+           || hasReflectance != mHasReflectance
+           || hasScatter != mHasScatter
+           || hasMarkData != mHasMarkData
+           || rangeEncoding != mRangeEncoding
+           || reflectanceEncoding != mReflectanceEncoding
+           || scatterEncoding != mScatterEncoding)
+  {
+    throw SaveException("All frames must have the same size and components, "
+                        "when recording.");
+  }
+
+  // Grow the file a checkpoint interval at a time, rather than a frame at a
+  // time. The unused part is cut off when closing. The frame data size is an
+  // upper bound for compressed frames.
+  const uint64_t end = mFiles->dataSize() + frameDataSize;
+  if (end > mDatFile->size())
+  {
+    const uint64_t frames = mCheckpointInterval > 0 ? mCheckpointInterval : 16;
+    mDatFile->reserve(mFiles->dataSize() + frames * frameDataSize);
+  }
+
+  // The frame is only counted and indexed once completely written. A failed
+  // write is overwritten by the next frame, or cut off when closing.
+  const uint64_t frameOffset = mFiles->dataSize();
+  try
+  {
+    writeRangeFrameData(*mFiles, frame);
+    mFrameIndex.push_back(
+      FrameIndexFile::entryFor(frame, frameOffset, mFrameCount));
+  }
+  catch (...)
+  {
+    mFiles->rewindData(frameOffset);
+    throw;
+  }
+  ++mFrameCount;
+  mLineCount += mLinesPerFrame;
+
+  if (mCheckpointInterval > 0
+      && mFrameCount - mCheckpointFrameCount >= mCheckpointInterval)
+  {
+    checkpoint();
+  }
+}
+
+void ScanRecorder::checkpoint()
+{
+  if (!mFiles)
+  {
+    return;
+  }
+  // The DAT-file is flushed to disk before the XML-file is replaced
+  writeXml();
+  mCheckpointFrameCount = mFrameCount;
+}
+
+void ScanRecorder::close()
+{
+  if (!mFiles)
+  {
+    return;
+  }
+  if (mFrameCount > 0)
+  {
+    FrameIndexFile::write(*mFiles, mFrameIndex);
+  }
+  mDatFile->resize(mFiles->dataSize());
+  checkpoint();
+  mFiles.reset();
+  mDatFile.reset();
+}
+
+uint64_t ScanRecorder::frameCount() const
+{
+  return mFrameCount;
+}
+
+uint64_t ScanRecorder::lineCount() const
+{
+  return mLineCount;
+}
+
+void ScanRecorder::writeXml()
+{
+  if (mFrameCount == 0)
+  {
+    // Nothing known about the data yet
+    return;
+  }
+  writeRangeXml(*mFiles,
+                mAoiSize.x(),
+                mAoiSize.y(),
+                mAoiOffset.x(),
+                mAoiOffset.y(),
+                mHasReflectance,
+                mHasScatter,
+                mHasMarkData,
+                mArbitraryXml,
+                mLinesPerFrame,
+                mLineCount,
+                PixelWidth::PW16,
+                mRangeEncoding,
+                mReflectanceEncoding,
+                mScatterEncoding);
+}
+
+}
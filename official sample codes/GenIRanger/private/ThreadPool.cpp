@@ -0,0 +1,162 @@
+// Copyright 2018 SICK AG. All rights reserved.
+
+#include "ThreadPool.h"
+
+#include <atomic>
+#include <exception>
+#include <memory>
+
+namespace GenIRanger
+{
+
+ThreadPool::ThreadPool(size_t threadCount)
+  : mStopping(false)
+{
+  if (threadCount == 0)
+  {
+    threadCount = std::thread::hardware_concurrency();
+  }
+  if (threadCount == 0)
+  {
+    threadCount = 1;
+  }
+  for (size_t i = 0; i < threadCount; ++i)
+  {
+    mThreads.push_back(std::thread(&ThreadPool::workerLoop, this));
+  }
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStopping = true;
+  }
+  mTaskAvailable.notify_all();
+  for (size_t i = 0; i < mThreads.size(); ++i)
+  {
+    mThreads[i].join();
+  }
+}
+
+size_t ThreadPool::threadCount() const
+{
+  return mThreads.size();
+}
+
+void ThreadPool::submit(Task task)
+{
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mTasks.push_back(std::move(task));
+  }
+  mTaskAvailable.notify_one();
+}
+
+void ThreadPool::workerLoop()
+{
+  for (;;)
+  {
+    Task task;
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      while (!mStopping && mTasks.empty())
+      {
+        mTaskAvailable.wait(lock);
+      }
+      if (mTasks.empty())
+      {
+        // Stopping and all tasks are done
+        return;
+      }
+      task = std::move(mTasks.front());
+      mTasks.pop_front();
+    }
+    task();
+  }
+}
+
+namespace
+{
+
+/** Book keeping shared between the threads taking part in a parallelFor. */
+struct Batch
+{
+  Batch(size_t count) : taskCount(count), next(0), finished(0) {}
+
+  const size_t taskCount;
+  std::atomic<size_t> next;
+  std::atomic<size_t> finished;
+  std::mutex mutex;
+  std::condition_variable done;
+  std::exception_ptr error;
+};
+
+void runBatch(std::shared_ptr<Batch> batch,
+              const std::function<void(size_t)>* task)
+{
+  for (;;)
+  {
+    size_t i = batch->next++;
+    if (i >= batch->taskCount)
+    {
+      // The task is not referenced again once all indices are claimed, it may
+      // already have gone out of scope in the calling thread
+      return;
+    }
+    try
+    {
+      (*task)(i);
+    }
+    catch (...)
+    {
+      std::lock_guard<std::mutex> lock(batch->mutex);
+      if (!batch->error)
+      {
+        batch->error = std::current_exception();
+      }
+    }
+    if (++batch->finished == batch->taskCount)
+    {
+      std::lock_guard<std::mutex> lock(batch->mutex);
+      batch->done.notify_all();
+    }
+  }
+}
+
+}
+
+void ThreadPool::parallelFor(size_t taskCount,
+                             const std::function<void(size_t)>& task)
+{
+  if (taskCount == 0)
+  {
+    return;
+  }
+
+  std::shared_ptr<Batch> batch = std::make_shared<Batch>(taskCount);
+  const std::function<void(size_t)>* taskPointer = &task;
+
+  size_t helpers = taskCount - 1;
+  if (helpers > mThreads.size())
+  {
+    helpers = mThreads.size();
+  }
+  for (size_t i = 0; i < helpers; ++i)
+  {
+    submit([batch, taskPointer]() { runBatch(batch, taskPointer); });
+  }
+  runBatch(batch, taskPointer);
+
+  std::unique_lock<std::mutex> lock(batch->mutex);
+  while (batch->finished < taskCount)
+  {
+    batch->done.wait(lock);
+  }
+  if (batch->error)
+  {
+    std::rethrow_exception(batch->error);
+  }
+}
+
+}
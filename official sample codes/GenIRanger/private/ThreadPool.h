@@ -0,0 +1,67 @@
+// Copyright 2018 SICK AG. All rights reserved.
+
+#ifndef GENIRANGER_THREADPOOL_H
+#define GENIRANGER_THREADPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace GenIRanger
+{
+
+/** A fixed number of worker threads executing tasks from a shared queue.
+
+    The pool may be used from several threads at the same time, e.g., one
+    acquisition thread per camera.
+*/
+class ThreadPool
+{
+public:
+  typedef std::function<void()> Task;
+
+  /** \param threadCount Number of worker threads, 0 means one per hardware
+                         thread.
+  */
+  explicit ThreadPool(size_t threadCount);
+
+  /** Waits for all queued tasks to finish before the threads are joined. */
+  ~ThreadPool();
+
+  size_t threadCount() const;
+
+  /** Queues a task to be executed by one of the worker threads. */
+  void submit(Task task);
+
+  /** Executes task(i) for all i in [0, taskCount) and returns when all of
+      them are finished. The calling thread participates in the work. If any
+      task throws, the first exception is rethrown once all tasks are done.
+  */
+  void parallelFor(size_t taskCount, const std::function<void(size_t)>& task);
+
+private:
+  ThreadPool(const ThreadPool&);
+  ThreadPool& operator=(const ThreadPool&);
+
+  void workerLoop();
+
+private:
+  std::vector<std::thread> mThreads;
+  std::deque<Task> mTasks;
+  std::mutex mMutex;
+  std::condition_variable mTaskAvailable;
+  bool mStopping;
+};
+
+/** Returns the pool shared by the data conversions of the library, e.g.,
+    convert12pTo16Parallel and compression of saved components. The size is
+    set with setConversionThreadCount.
+*/
+std::shared_ptr<ThreadPool> getConversionPool();
+
+}
+#endif
@@ -0,0 +1,150 @@
+// Copyright 2018 SICK AG. All rights reserved.
+
+#ifndef GENIRANGER_ASYNC_FRAME_WRITER_H
+#define GENIRANGER_ASYNC_FRAME_WRITER_H
+
+#include "FrameFileRing.h"
+#include "GenIRangerDll.h"
+#include "StreamData.h"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace GenIRanger
+{
+
+/** Saves RangeFrames to dat/xml files on background threads, so that an
+    acquisition loop does not have to wait for the disk.
+
+    Frames are written with saveMultipartRangeFrame, or to a FrameFileRing,
+    in the order they are queued. With more than one thread several frames are
+    written at the same time, so the file paths of queued frames must then be
+    unique.
+
+    A frame may hold views of acquisition buffers, see Component. The frame is
+    released as soon as it has been written, which lets a release callback
+    re-queue the buffer to the producer.
+
+    The queue is bounded, a frame counts against the capacity until it has
+    been written. What happens when the queue is full is decided by the
+    FullQueuePolicy.
+*/
+class AsyncFrameWriter
+{
+public:
+  /** What write() does when the queue is full. */
+  enum class FullQueuePolicy
+  {
+    /** Wait until there is room in the queue. */
+    Block,
+    /** Return immediately without queueing the frame. */
+    Reject
+  };
+
+  /** Called from a writer thread when a frame has been written, or failed to
+      be written. error is empty on success. Must not throw.
+  */
+  typedef std::function<void(const std::string& filePath,
+                             std::exception_ptr error)> CompletionCallback;
+
+  /** Called from the thread calling write() when the queue is full, before
+      blocking or rejecting the frame. Must not throw.
+  */
+  typedef std::function<void(size_t queueDepth)> BackpressureCallback;
+
+  struct Statistics
+  {
+    /** Frames queued or being written. */
+    size_t queueDepth;
+    /** The highest queue depth so far. */
+    size_t peakQueueDepth;
+    uint64_t framesWritten;
+    uint64_t framesFailed;
+    /** Frames not queued since the queue was full. */
+    uint64_t framesRejected;
+    /** Number of calls to write() that found the queue full. */
+    uint64_t queueFullCount;
+  };
+
+  /** Starts the writer threads.
+      \param capacity Maximum number of frames queued or being written.
+      \param threadCount Number of writer threads.
+      \param policy What write() does when the queue is full.
+  */
+  GENIRANGER_API AsyncFrameWriter(
+    size_t capacity,
+    size_t threadCount = 1,
+    FullQueuePolicy policy = FullQueuePolicy::Block);
+
+  /** Writes all queued frames before the threads are stopped. */
+  GENIRANGER_API ~AsyncFrameWriter();
+
+  GENIRANGER_API void setCompletionCallback(CompletionCallback callback);
+  GENIRANGER_API void setBackpressureCallback(BackpressureCallback callback);
+
+  /** Queues a frame to be saved.
+      \param frame Frame data abstraction containing data to save.
+      \param filePath Name and location of resulting dat/xml files
+      \param arbitraryXml Optional arbitrary xml content to add to xml file
+      \return False if the frame was rejected since the queue was full.
+  */
+  GENIRANGER_API bool write(
+    const RangeFrame& frame,
+    const std::string& filePath,
+    const std::string& arbitraryXml = "");
+
+  /** Queues a frame to be saved to the next file pair of a ring. The ring
+      must outlive the writer, or at least the last flush().
+      \param frame Frame data abstraction containing data to save.
+      \param ring The file ring to save the frame in
+      \param arbitraryXml Optional arbitrary xml content to add to xml file
+      \return False if the frame was rejected since the queue was full.
+  */
+  GENIRANGER_API bool write(
+    const RangeFrame& frame,
+    FrameFileRing& ring,
+    const std::string& arbitraryXml = "");
+
+  /** Blocks until all queued frames have been written. */
+  GENIRANGER_API void flush();
+
+  GENIRANGER_API Statistics statistics() const;
+
+private:
+  AsyncFrameWriter(const AsyncFrameWriter&);
+  AsyncFrameWriter& operator=(const AsyncFrameWriter&);
+
+  struct Job
+  {
+    RangeFrame mFrame;
+    // Either a file path or a ring to save in
+    std::string mFilePath;
+    FrameFileRing* mRing;
+    std::string mArbitraryXml;
+  };
+
+  bool enqueue(const Job& job);
+  void writerLoop();
+
+private:
+  const size_t mCapacity;
+  const FullQueuePolicy mPolicy;
+  std::vector<std::thread> mThreads;
+  std::deque<Job> mQueue;
+  mutable std::mutex mMutex;
+  std::condition_variable mFrameQueued;
+  std::condition_variable mFrameDone;
+  bool mStopping;
+  Statistics mStatistics;
+  CompletionCallback mCompletionCallback;
+  BackpressureCallback mBackpressureCallback;
+};
+
+}
+#endif
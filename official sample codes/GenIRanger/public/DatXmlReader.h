@@ -0,0 +1,162 @@
+// Copyright 2018 SICK AG. All rights reserved.
+
+#ifndef GENIRANGER_DAT_XML_READER_H
+#define GENIRANGER_DAT_XML_READER_H
+
+#include "GenIRangerDll.h"
+#include "StreamData.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace GenIRanger
+{
+
+class MappedFile;
+
+/** Reads range data saved as a dat/xml file pair, by saveBuffer16,
+    saveMultiPartBuffer, saveMultipartRangeFrame, a FrameFileRing or a
+    ScanRecorder.
+
+    The XML-file is parsed when the reader is created and the DAT-file is
+    mapped into memory, which takes the same short time regardless of the file
+    size. The frames returned are views of the mapped file, no data is copied
+    and pages are read from disk only when the data is accessed.
+
+    The DAT-file consists of one or more frames, each stored as one block per
+    subcomponent. A file pair saved from a single frame holds exactly one
+    frame, a ScanRecorder file holds one frame per appended frame.
+
+    Range data saved 12 bit packed is viewed as such. It is only unpacked when
+    asked for with readRange16, so the cost is paid for the lines accessed.
+
+    A ScanRecorder file that was closed ends with an index of its frames.
+    Frames are then found by encoder value, timestamp or frame ID with a
+    binary search in the mapped index, reading only a few pages of the file.
+
+    Compressed components, see Encoding, are decoded when a frame is asked
+    for, on the conversion thread pool. Their blocks are located when the
+    reader is created.
+
+    Throws LoadException if the files cannot be read or do not describe range
+    data.
+*/
+class DatXmlReader
+{
+public:
+  /** Opens a dat/xml file pair.
+      \param filePath Name and location of the dat/xml files, without
+                      extension
+  */
+  GENIRANGER_API DatXmlReader(const std::string& filePath);
+
+  GENIRANGER_API ~DatXmlReader();
+
+  /** Number of complete frames in the DAT-file. */
+  GENIRANGER_API size_t frameCount() const;
+
+  /** Number of lines in each frame. */
+  GENIRANGER_API size_t linesPerFrame() const;
+
+  /** Width of the AOI, i.e., the number of pixels per line, and the height of
+      the sensor AOI the data was extracted from.
+  */
+  GENIRANGER_API Size2D aoiSize() const;
+
+  GENIRANGER_API Size2D aoiOffset() const;
+
+  /** PW16, or PW12 if the range data is stored 12 bit packed. */
+  GENIRANGER_API PixelWidth rangePixelWidth() const;
+
+  GENIRANGER_API bool hasReflectance() const;
+  GENIRANGER_API bool hasScatter() const;
+  GENIRANGER_API bool hasMarkData() const;
+
+  /** Returns a frame with the components as views of the mapped DAT-file.
+      The components may be modified, which does not change the file. The
+      mapping is kept until the reader and all frames are destroyed.
+      Compressed components are instead decoded to data owned by the frame,
+      and line marks not aligned in the file are copied.
+  */
+  GENIRANGER_API RangeFrame frame(size_t index) const;
+
+  /** Reads lines of the range data of a frame as 16 bit values, unpacking
+      12 bit packed data. Only the lines read are accessed in the file, unless
+      the range data is compressed.
+      \param frameIndex The frame to read from
+      \param firstLine The first line within the frame
+      \param lineCount Number of lines to read
+      \param range16 Receives lineCount * aoiSize().x() values
+  */
+  GENIRANGER_API void readRange16(size_t frameIndex,
+                                  size_t firstLine,
+                                  size_t lineCount,
+                                  uint16_t* range16) const;
+
+  /** True if the DAT-file ends with an index of its frames. The functions
+      below throw LoadException if not.
+  */
+  GENIRANGER_API bool hasFrameIndex() const;
+
+  GENIRANGER_API FrameIndexEntry frameIndexEntry(size_t index) const;
+
+  /** Returns the frame where the encoder value is between the first and last
+      encoder value of the frame, or frameCount() if there is none. The
+      encoder must move in one direction during the recording, wrapping
+      around is allowed.
+  */
+  GENIRANGER_API size_t findFrameByEncoderValue(Metadata encoderValue) const;
+
+  /** Returns the frame where the timestamp is between the first and last
+      timestamp of the frame, or frameCount() if there is none.
+  */
+  GENIRANGER_API size_t findFrameByTimestamp(Metadata timestamp) const;
+
+  /** Returns the frame with the frame ID, or frameCount() if there is none,
+      e.g., since the frame was lost.
+  */
+  GENIRANGER_API size_t findFrameById(Metadata frameId) const;
+
+private:
+  DatXmlReader(const DatXmlReader&);
+  DatXmlReader& operator=(const DatXmlReader&);
+
+  /** Placement of a subcomponent within each frame. */
+  struct SubComponent
+  {
+    std::string mName;
+    // Bytes per line
+    size_t mSize;
+    // Byte offset from the start of a frame, if not compressed
+    uint64_t mOffset;
+    Encoding mEncoding;
+  };
+
+  void locateEncodedBlocks();
+  uint8_t* blockData(size_t frameIndex, const SubComponent* subComponent) const;
+  DataVector decodeBlock(size_t frameIndex,
+                         const SubComponent* subComponent) const;
+  const SubComponent* findSubComponent(const std::string& name) const;
+  const FrameIndexEntry* frameIndex() const;
+
+private:
+  std::shared_ptr<MappedFile> mDatFile;
+  std::vector<SubComponent> mSubComponents;
+  size_t mWidth;
+  size_t mAoiHeight;
+  size_t mAoiOffsetX;
+  size_t mAoiOffsetY;
+  PixelWidth mRangeWidth;
+  size_t mLinesPerFrame;
+  size_t mFrameCount;
+  uint64_t mFrameSize;
+  // Start of each block of subcomponents, and the end of the last block, if
+  // any subcomponent is compressed. Empty otherwise.
+  std::vector<uint64_t> mBlockOffsets;
+  // Points into the mapped DAT-file, nullptr if there is no index
+  const FrameIndexEntry* mFrameIndex;
+};
+
+}
+#endif
@@ -16,6 +16,11 @@ class GenIRangerException : public std::exception
 {
 public:
   GenIRangerException(const std::string& message);
+
+  virtual const char* what() const throw();
+
+private:
+  std::string mMessage;
 };
 
 /** Indicates that something went wrong during import configuration to device. */
@@ -53,5 +58,12 @@ public:
   SaveException(const std::string& message);
 };
 
+/** Indicates that there is some problem when loading saved data from disk. */
+class LoadException : public GenIRangerException
+{
+public:
+  LoadException(const std::string& message);
+};
+
 }
 #endif
\ No newline at end of file
@@ -0,0 +1,85 @@
+// Copyright 2018 SICK AG. All rights reserved.
+
+#ifndef GENIRANGER_FRAME_FILE_RING_H
+#define GENIRANGER_FRAME_FILE_RING_H
+
+#include "GenIRangerDll.h"
+#include "StreamData.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace GenIRanger
+{
+
+/** Saves frames to a fixed number of dat/xml file pairs, named
+    "<basePath>-1" to "<basePath>-<fileCount>", overwriting the oldest pair
+    once all of them have been used.
+
+    The DAT-files are kept open and their space is preallocated, so frames
+    are written in place without the file system allocating space or changing
+    file sizes. A DAT-file only grows, when a frame is larger than any before,
+    and is never truncated. It may thus hold older data after the end of the
+    frame, the XML-file states the number of lines of the frame. The small
+    XML-files are replaced atomically, a reader never sees a partially written
+    one. This keeps the time to save a frame flat over long recordings,
+    compared to recreating the files for every frame.
+
+    By default nothing waits for the disk, so a power loss may lose or damage
+    the last frames saved. With a sync interval, every n:th frame saved is
+    flushed to disk before save() returns.
+
+    save() may be called from several threads, e.g., by an AsyncFrameWriter.
+    Frames saved to the same file pair are written in the order save() was
+    called, so an older frame never overwrites a newer one.
+*/
+class FrameFileRing
+{
+public:
+  /** \param basePath Name and location of the files, without index and ending
+      \param fileCount Number of dat/xml file pairs in the ring
+      \param datFileSize Size in bytes to preallocate for each DAT-file. If 0,
+                         a DAT-file is allocated the size of the first frame
+                         written to it.
+      \param syncInterval Flush every syncInterval:th frame to disk, e.g., 1
+                          for every frame. If 0, no frame is flushed.
+  */
+  GENIRANGER_API FrameFileRing(
+    const std::string& basePath,
+    size_t fileCount,
+    uint64_t datFileSize = 0,
+    size_t syncInterval = 0);
+
+  GENIRANGER_API ~FrameFileRing();
+
+  /** Saves a frame to the next file pair in the ring. The frame has the same
+      requirements as for saveMultipartRangeFrame.
+
+      \param frame Frame data abstraction containing data to save.
+      \param arbitraryXml Optional arbitrary xml content to add to xml file
+      \return Name and location of the dat/xml files written
+  */
+  GENIRANGER_API std::string save(
+    RangeFrame& frame,
+    const std::string& arbitraryXml = "");
+
+  GENIRANGER_API const std::string& basePath() const;
+  GENIRANGER_API size_t fileCount() const;
+
+private:
+  FrameFileRing(const FrameFileRing&);
+  FrameFileRing& operator=(const FrameFileRing&);
+
+  struct Slot;
+
+  std::string mBasePath;
+  std::vector<std::unique_ptr<Slot>> mSlots;
+  size_t mSyncInterval;
+  uint64_t mSaveCount;
+  std::mutex mMutex;
+};
+
+}
+#endif
@@ -0,0 +1,95 @@
+// Copyright 2018 SICK AG. All rights reserved.
+
+#ifndef GENIRANGER_FRAME_POOL_H
+#define GENIRANGER_FRAME_POOL_H
+
+#include "GenIRangerDll.h"
+#include "StreamData.h"
+
+#include <memory>
+
+namespace GenIRanger
+{
+
+/** A fixed number of RangeFrames of one geometry, allocated once and
+    recycled, for frames that must own their data, e.g., when copying out of
+    acquisition buffers that are re-queued at once.
+
+    The components of an acquired frame are views of storage owned by the
+    pool, see Component, and the line marks are a vector kept by the pool.
+    The frame returns to the pool when the last ComponentPtr and LineMarksPtr
+    referring to it is released. Copies of the frame, e.g., queued to an
+    AsyncFrameWriter, keep it out of the pool until they are destroyed too.
+
+    The storage is never value-initialized, so the data of an acquired frame
+    is whatever was last written to it. Only the small Component objects are
+    allocated per frame.
+
+    Frames may be acquired and released from any thread. The pool may be
+    destroyed before the frames acquired from it, the storage is freed when
+    the last frame is released.
+*/
+class FramePool
+{
+public:
+  /** Allocates the frames.
+      \param frameCount Number of frames in the pool
+      \param width AOI width in pixels
+      \param lineCount Number of lines per frame
+      \param aoiHeight Height of the sensor AOI in rows, which is not related
+                       to the number of lines
+      \param rangeWidth Pixel width of the range data, PW16 or PW12
+      \param reflectance True to give the frames 8 bit reflectance data
+      \param scatter True to give the frames 8 bit scatter data
+      \param lineMarks True to give the frames a LineMark per line
+  */
+  GENIRANGER_API FramePool(size_t frameCount,
+                           size_t width,
+                           size_t lineCount,
+                           size_t aoiHeight,
+                           PixelWidth rangeWidth = PixelWidth::PW16,
+                           bool reflectance = true,
+                           bool scatter = false,
+                           bool lineMarks = true);
+
+  GENIRANGER_API ~FramePool();
+
+  /** Returns a frame from the pool, waiting until one is released if all
+      frames are in use. The AOI size is set, the AOI offset is zero and must
+      be set by the caller for an offset AOI.
+  */
+  GENIRANGER_API RangeFrame acquire();
+
+  /** Gets a frame from the pool without waiting.
+      \return False if all frames are in use.
+  */
+  GENIRANGER_API bool tryAcquire(RangeFrame& frame);
+
+  /** Number of frames not in use. */
+  GENIRANGER_API size_t available() const;
+
+  GENIRANGER_API size_t frameCount() const;
+
+private:
+  FramePool(const FramePool&);
+  FramePool& operator=(const FramePool&);
+
+  struct Slot;
+  struct State;
+
+  RangeFrame frameFor(Slot* slot);
+
+private:
+  const size_t mWidth;
+  const size_t mLineCount;
+  const size_t mAoiHeight;
+  const PixelWidth mRangeWidth;
+  const bool mReflectance;
+  const bool mScatter;
+  const bool mLineMarks;
+  // Shared with the frames in use, which return their slots to it
+  std::shared_ptr<State> mState;
+};
+
+}
+#endif
@@ -32,6 +32,10 @@ GENIRANGER_API void importDeviceParameters(
 /** Unpacks a buffer using a 12 bit packed pixel format into a 16 bit pixel
     format. The 4 MSB will be set to zero.
 
+    The conversion is vectorized using the widest instruction set (SSSE3, AVX2
+    or AVX-512) supported by the processor. If the input size is not a
+    multiple of 3 bytes, a trailing pair of bytes is unpacked as a single pixel.
+
     \param inBuffer Buffer containing 12p data to be converted
     \param inSize Size of data in 12p data buffer in bytes
     \param outBuffer Buffer which resulting data will be stored
@@ -44,8 +48,41 @@ GENIRANGER_API void convert12pTo16(
   uint8_t* outBuffer,
   int64_t* inOutSize);
 
+/** Unpacks a buffer using a 12 bit packed pixel format into a 16 bit pixel
+    format, splitting the work across the conversion thread pool. The buffer
+    is divided on 3 byte boundaries so that each thread converts complete
+    pixel pairs. Buffers smaller than serialThreshold are converted on the
+    calling thread only.
+
+    \param inBuffer Buffer containing 12p data to be converted
+    \param inSize Size of data in 12p data buffer in bytes
+    \param outBuffer Buffer which resulting data will be stored
+    \param inOutSize Size of the provided buffer in bytes. After unpacking
+                     this parameter holds the number of bytes actually written.
+    \param serialThreshold Size in bytes of 12p data below which the
+                           conversion is not split
+*/
+GENIRANGER_API void convert12pTo16Parallel(
+  const uint8_t* inBuffer,
+  const int64_t inSize,
+  uint8_t* outBuffer,
+  int64_t* inOutSize,
+  const int64_t serialThreshold = 512 * 1024);
+
+/** Sets the number of threads used by convert12pTo16Parallel and to compress
+    and decompress components, see Encoding. The pool is shared by all
+    callers. By default one thread per hardware thread is used.
+
+    \param threadCount Number of threads, 0 means one per hardware thread
+*/
+GENIRANGER_API void setConversionThreadCount(const size_t threadCount);
+
 /** Packs a buffer from a 16 bit to 12 bit packed pixel format using the 12 LSB.
 
+    The conversion is vectorized using SSE4.1 or AVX2 if supported by the
+    processor. An odd number of pixels is allowed, the last pixel is then
+    packed into two bytes where the high nibble of the second byte is zero.
+
     \param inBuffer Buffer containing 16 bit data to be converted
     \param inSize Size of data in 16 bit data buffer in bytes
     \param outBuffer Buffer which resulting data will be stored
@@ -113,6 +150,41 @@ GENIRANGER_API void saveMultiPartBuffer(
   const std::string& filePath,
   const std::string& arbitraryXml = "");
 
+/** Saves a 12 bit packed buffer of range data and possible 8 bit reflectance
+    data and/or scatter data. The range data is stored as 16 bit, exactly as
+    saveMultiPartBuffer does, but it is unpacked block by block while writing.
+    No intermediate 16 bit buffer is needed, so the GenTL buffer part can be
+    passed as is.
+
+    \param bufferRange12p Buffer containing 12 bit packed data, e.g.,
+                          Coord3D_C12p
+    \param bufferReflectance8 Buffer containing 8 bit reflectance data, or
+                              nullptr if not present.
+    \param bufferScatter8 Buffer containing 8 bit scatter data, or nullptr if
+                          not present
+    \param bufferWidth Width of the data in the buffer in number of pixels
+    \param bufferHeight Height of the data in the buffer in number of pixels
+    \param aoiHeight Height of the area of interest used for extracting the
+                      buffer data in number of pixels
+    \param aoiOffsetX Offset in X of the data in the buffer in number of pixels
+                      from the image origin to areas of interest
+    \param aoiOffsetY Offset in Y of the data in the buffer in number of pixels
+                      from the image origin to area of interest
+    \param filePath Name and location of resulting dat/xml files
+    \param arbitraryXml Optional arbitrary xml content to add to xml file
+*/
+GENIRANGER_API void saveMultiPartBuffer12p(
+  const uint8_t* bufferRange12p,
+  const uint8_t* bufferReflectance8,
+  const uint8_t* bufferScatter8,
+  const int64_t bufferWidth,
+  const int64_t bufferHeight,
+  const int64_t aoiHeight,
+  const int64_t aoiOffsetX,
+  const int64_t aoiOffsetY,
+  const std::string& filePath,
+  const std::string& arbitraryXml = "");
+
 /** Saves a 8 bit pixel format sensor image buffer to specified file path.
 
     \param buffer Buffer containing 8 bit data to be saved to disk
@@ -140,14 +212,63 @@ GENIRANGER_API void saveBuffer8(
     additional line meta data. Not complying with these requirements will thow
     an ValidationException.
 
+    Range data may also be 12 bit packed, e.g., a view of the range part of an
+    acquisition buffer. By default it is unpacked to 16 bit while being
+    written. Saving with PixelWidth::PW12 instead writes 12 bit packed data as
+    received, packing 16 bit range data if needed, which saves a quarter of
+    the range data size. The AOI width must then be even. Such files can be
+    read with DatXmlReader.
+
+    Components with Encoding::LineDelta are compressed losslessly, in parallel
+    on the conversion thread pool. The compressed range data is always 16 bit.
+    The components must then hold complete lines. Such files can only be read
+    with DatXmlReader.
+
     \param frame Frame data abstraction containing data to save.
     \param filePath Name and location of resulting dat/xml files
     \param arbitraryXml Optional arbitrary xml content to add to xml file
+    \param savedRangeWidth Pixel width of the range data in the file, PW16 or
+                           PW12
 */
 GENIRANGER_API void saveMultipartRangeFrame(
   RangeFrame& frame,
   const std::string& filePath,
-  const std::string& arbitraryXml = "");
+  const std::string& arbitraryXml = "",
+  const PixelWidth savedRangeWidth = PixelWidth::PW16);
+
+/** Exports the range data of a frame as a point cloud in binary little endian
+    PLY format, one vertex per pixel with valid range data.
+
+    The coordinates are in sensor units, using the same range traits as
+    written to the XML-file by saveMultipartRangeFrame. x is the AOI x offset
+    plus the column. z is the AOI y offset plus the range value / 16. y is the
+    encoder value of the line, relative to the first line, times yScale if the
+    frame has line marks or encoder values. Otherwise it is the line number
+    times yScale. The reflectance is added as the intensity, if present.
+
+    Pixels with range 0, i.e., missing data, are left out. The points are
+    converted and written a block of lines at a time, so the whole point cloud
+    is never held in memory.
+
+    \param frame Frame with 16 bit or 12 bit packed range data
+    \param output Stream to write to, opened in binary mode
+    \param yScale Distance in y between two encoder ticks, or lines
+*/
+GENIRANGER_API void writePointCloudPly(
+  RangeFrame& frame,
+  std::ostream& output,
+  const double yScale = 1.0);
+
+/** Saves the range data of a frame as a PLY-file, see writePointCloudPly.
+
+    \param frame Frame with 16 bit or 12 bit packed range data
+    \param filePath Name and location of the PLY-file, including extension
+    \param yScale Distance in y between two encoder ticks, or lines
+*/
+GENIRANGER_API void savePointCloudPly(
+  RangeFrame& frame,
+  const std::string& filePath,
+  const double yScale = 1.0);
 
 }
 
@@ -1,5 +1,8 @@
 // Copyright 2017-2018 SICK AG. All rights reserved.
-#ifdef GENIRANGER_EXPORTS
+// GENIRANGER_STATIC is set when GenIRanger is linked as a static library
+#if defined(GENIRANGER_STATIC) || !defined(_WIN32)
+#define GENIRANGER_API
+#elif defined(GENIRANGER_EXPORTS)
 #define GENIRANGER_API __declspec(dllexport)
 #else
 #define GENIRANGER_API __declspec(dllimport)
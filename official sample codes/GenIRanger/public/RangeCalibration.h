@@ -0,0 +1,116 @@
+// Copyright 2018 SICK AG. All rights reserved.
+
+#ifndef GENIRANGER_RANGE_CALIBRATION_H
+#define GENIRANGER_RANGE_CALIBRATION_H
+
+#include "GenIRangerDll.h"
+#include "StreamData.h"
+
+#include <vector>
+
+namespace GenIRanger
+{
+
+/** Converts range data to 32 bit float z values, e.g., millimetres.
+
+    The conversion is one of
+    <ul>
+    <li> The range traits, z = origin + scale * range. With the AOI offset
+         as origin and scale 0.0625, as written by saveMultipartRangeFrame,
+         z is in sensor rows.
+    <li> A linear conversion per column, z = offset[x] + scale[x] * range,
+         e.g., to correct for lens distortion.
+    <li> A 2D table of z values per column for range values at a fixed step,
+         interpolated linearly in between.
+    </ul>
+    Missing data, i.e., range 0, is converted to NaN.
+
+    The tables are set up once and reused for every frame converted. The
+    range traits and per column conversions are vectorized using AVX2 if
+    supported by the processor, without any gathers. The 2D table needs a
+    lookup per pixel and is converted by plain C++.
+
+    A RangeCalibration is not modified by converting, so the same object may
+    be used from several threads.
+*/
+class RangeCalibration
+{
+public:
+  /** Converts using the range traits.
+      \param originZ Value of z for range 0
+      \param scaleZ Change of z per range unit
+  */
+  GENIRANGER_API RangeCalibration(float originZ = 0.0f,
+                                  float scaleZ = 0.0625f);
+
+  /** Converts using a linear conversion per column.
+      \param offsets Value of z for range 0, one per column
+      \param scales Change of z per range unit, one per column
+  */
+  GENIRANGER_API RangeCalibration(const std::vector<float>& offsets,
+                                  const std::vector<float>& scales);
+
+  /** Converts using a 2D table. Range values beyond the last row use the
+      last row.
+      \param width Number of columns
+      \param rangeStep Range units between two rows of the table
+      \param table z values, row by row. Row i holds the values for range
+                   i * rangeStep, width values per row. At least two rows.
+  */
+  GENIRANGER_API RangeCalibration(size_t width,
+                                  uint16_t rangeStep,
+                                  const std::vector<float>& table);
+
+  GENIRANGER_API ~RangeCalibration();
+
+  /** Converts lineCount lines of width 16 bit range values.
+      Throws GenIRangerException if the width does not match the tables.
+  */
+  GENIRANGER_API void convert(const uint16_t* range,
+                              size_t width,
+                              size_t lineCount,
+                              float* z) const;
+
+  /** Converts lineCount lines of width 12 bit packed range values, the width
+      must be even. The data is unpacked a block at a time, which stays in
+      the CPU cache until converted.
+  */
+  GENIRANGER_API void convert12p(const uint8_t* range12p,
+                                 size_t width,
+                                 size_t lineCount,
+                                 float* z) const;
+
+  /** Converts the 16 bit or 12 bit packed range component of a frame to a
+      new PW32F component.
+  */
+  GENIRANGER_API ComponentPtr convert(RangeFrame& frame) const;
+
+  /** Returns the name of the instruction set used by the conversion. */
+  GENIRANGER_API const char* implementation() const;
+
+private:
+  enum class Mode
+  {
+    Traits,
+    PerColumn,
+    Table
+  };
+
+  void convertLine(const uint16_t* range, float* z) const;
+  void checkWidth(size_t width) const;
+
+private:
+  Mode mMode;
+  float mOriginZ;
+  float mScaleZ;
+  size_t mWidth;
+  uint16_t mRangeStep;
+  size_t mTableRows;
+  // Per column offsets and scales, or the 2D table
+  std::vector<float> mOffsets;
+  std::vector<float> mScales;
+  std::vector<float> mTable;
+};
+
+}
+#endif
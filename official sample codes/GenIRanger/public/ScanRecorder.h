@@ -0,0 +1,106 @@
+// Copyright 2018 SICK AG. All rights reserved.
+
+#ifndef GENIRANGER_SCAN_RECORDER_H
+#define GENIRANGER_SCAN_RECORDER_H
+
+#include "GenIRangerDll.h"
+#include "StreamData.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace GenIRanger
+{
+
+class DatAndXmlFiles;
+class PreallocatedFile;
+
+/** Records a continuous scan as a single dat/xml file pair, instead of one
+    file pair per frame.
+
+    Frames are appended to the DAT-file as they arrive. Each frame is stored
+    as one block of subcomponents, so the XML component height is the number
+    of lines per frame. All frames must therefore have the same size and the
+    same components as the first one, with the same encoding. Compressed
+    frames take up different amounts of space in the DAT-file.
+
+    The XML-file holds the total number of lines recorded. It is replaced
+    atomically at every checkpoint, after the data has been flushed to disk,
+    so after a crash the files describe at least all frames up to the last
+    checkpoint. The XML-file of a previous recording is removed when the
+    recording is created, so there is none until the first checkpoint.
+
+    When the recording is closed an index of the frames is appended to the
+    DAT-file, with the offset, frame ID and first and last encoder value and
+    timestamp of each frame taken from the line marks. DatXmlReader uses it to
+    find frames by encoder value, timestamp or frame ID without reading them.
+
+    Not thread-safe, append frames from one thread only.
+*/
+class ScanRecorder
+{
+public:
+  /** Creates the dat/xml files, replacing any existing ones.
+      \param filePath Name and location of the dat/xml files
+      \param checkpointInterval Number of frames between checkpoints, 0 means
+                                only on checkpoint() and close().
+      \param arbitraryXml Optional arbitrary xml content to add to xml file
+  */
+  GENIRANGER_API ScanRecorder(
+    const std::string& filePath,
+    size_t checkpointInterval = 100,
+    const std::string& arbitraryXml = "");
+
+  /** Closes the recording, errors are ignored. Call close() to catch them. */
+  GENIRANGER_API ~ScanRecorder();
+
+  /** Appends a frame to the recording. The frame has the same requirements
+      as for saveMultipartRangeFrame. If writing fails, e.g., when the disk is
+      full, the frame is not part of the recording and the earlier frames are
+      kept.
+  */
+  GENIRANGER_API void append(RangeFrame& frame);
+
+  /** Flushes the data to disk and updates the XML-file. */
+  GENIRANGER_API void checkpoint();
+
+  /** Makes a final checkpoint and closes the files. */
+  GENIRANGER_API void close();
+
+  GENIRANGER_API uint64_t frameCount() const;
+  GENIRANGER_API uint64_t lineCount() const;
+
+private:
+  ScanRecorder(const ScanRecorder&);
+  ScanRecorder& operator=(const ScanRecorder&);
+
+  void writeXml();
+
+private:
+  std::unique_ptr<PreallocatedFile> mDatFile;
+  std::unique_ptr<DatAndXmlFiles> mFiles;
+  std::string mArbitraryXml;
+  size_t mCheckpointInterval;
+  uint64_t mFrameCount;
+  uint64_t mLineCount;
+  uint64_t mCheckpointFrameCount;
+
+  // The layout of the first frame, which all frames must have
+  Size2D mAoiSize;
+  Size2D mAoiOffset;
+  PixelWidth mRangePixelWidth;
+  bool mHasReflectance;
+  bool mHasScatter;
+  bool mHasMarkData;
+  Encoding mRangeEncoding;
+  Encoding mReflectanceEncoding;
+  Encoding mScatterEncoding;
+  uint64_t mFrameDataSize;
+  size_t mLinesPerFrame;
+
+  std::vector<FrameIndexEntry> mFrameIndex;
+};
+
+}
+#endif
@@ -3,9 +3,11 @@
 #ifndef STREAM_DATA_H
 #define STREAM_DATA_H
 
+#include <functional>
 #include <map>
 #include <memory>
 #include <stdint.h>
+#include <utility>
 #include <vector>
 
 namespace GenIRanger {
@@ -33,36 +35,155 @@ enum class PixelWidth
 {
   PW8 = 8,
   PW12 = 12,
-  PW16 = 16
+  PW16 = 16,
+  /** 32 bit float, e.g., range converted by RangeCalibration. */
+  PW32F = 32
+};
+
+/** How a Component is stored when saved to a DAT-file. */
+enum class Encoding
+{
+  /** The data is stored as is. */
+  Raw,
+  /** The data is compressed losslessly. Each value is predicted from the
+      same column of the line before and the differences are bit-packed.
+      Smooth surfaces compress well, noise and missing data less so.
+  */
+  LineDelta
 };
 
 /** Container for raw payload data (bytes). */
 typedef std::vector<uint8_t> DataVector;
 
-/** Data payload of specific component type. */
+/** Called with the external data pointer when a Component view over memory it
+    does not own is no longer referenced, e.g., to requeue a GenTL buffer.
+*/
+typedef std::function<void(uint8_t*)> ReleaseCallback;
+
+/** Data payload of specific component type.
+
+    The payload is either owned by the Component, or the Component is a
+    non-owning view of external memory, e.g., a part of an acquisition buffer.
+    A view never copies the data. The external memory must stay valid until the
+    release callback is called, which happens when the last copy of the
+    Component referencing it is destroyed or given other data.
+*/
 class Component
 {
 private:
   DataVector mData;
+  // Only set for views, the release callback is the deleter
+  std::shared_ptr<uint8_t> mExternal;
+  size_t mExternalSize;
   PixelWidth mPixelWidth;
+  Encoding mEncoding;
+
+  static std::shared_ptr<uint8_t> wrap(uint8_t* data, ReleaseCallback release)
+  {
+    return std::shared_ptr<uint8_t>(data, [release](uint8_t* p)
+    {
+      if (release)
+      {
+        release(p);
+      }
+    });
+  }
+
 public:
   Component(size_t sizeInBytes, PixelWidth pw)
     : mData(sizeInBytes)
-    , mPixelWidth(pw) {}
+    , mExternalSize(0)
+    , mPixelWidth(pw)
+    , mEncoding(Encoding::Raw) {}
 
   Component(const DataVector& data, PixelWidth pw)
     : mData(data)
-    , mPixelWidth(pw) {}
+    , mExternalSize(0)
+    , mPixelWidth(pw)
+    , mEncoding(Encoding::Raw) {}
+
+  Component(DataVector&& data, PixelWidth pw)
+    : mData(std::move(data))
+    , mExternalSize(0)
+    , mPixelWidth(pw)
+    , mEncoding(Encoding::Raw) {}
+
+  /** Creates a view of sizeInBytes bytes of external data. */
+  Component(uint8_t* externalData, size_t sizeInBytes, PixelWidth pw,
+            ReleaseCallback release = ReleaseCallback())
+    : mExternal(wrap(externalData, release))
+    , mExternalSize(sizeInBytes)
+    , mPixelWidth(pw)
+    , mEncoding(Encoding::Raw) {}
 
   Component(size_t sizeInBytes) : Component(sizeInBytes, PixelWidth::PW8) {}
 
   Component() : Component(0) {}
 
-  Component& data(DataVector& data) { mData = data; return *this; }
-  DataVector& data() { return mData; }
+  Component& data(DataVector& data)
+  {
+    mData = data;
+    view(nullptr, 0);
+    return *this;
+  }
+
+  Component& data(DataVector&& data)
+  {
+    mData = std::move(data);
+    view(nullptr, 0);
+    return *this;
+  }
+
+  /** Access to the payload as a vector. A view is first turned into owned
+      data by copying the external data, which also releases it. Use bytes()
+      and sizeInBytes() to access the payload without copying.
+  */
+  DataVector& data()
+  {
+    if (mExternal)
+    {
+      mData.assign(mExternal.get(), mExternal.get() + mExternalSize);
+      view(nullptr, 0);
+    }
+    return mData;
+  }
+
+  /** Makes the Component a view of external data, releasing previous data. */
+  Component& view(uint8_t* externalData, size_t sizeInBytes,
+                  ReleaseCallback release = ReleaseCallback())
+  {
+    if (externalData == nullptr)
+    {
+      mExternal.reset();
+      mExternalSize = 0;
+    }
+    else
+    {
+      mExternal = wrap(externalData, release);
+      mExternalSize = sizeInBytes;
+      DataVector().swap(mData);
+    }
+    return *this;
+  }
+
+  /** True if the payload is external data not owned by the Component. */
+  bool isView() const { return static_cast<bool>(mExternal); }
+
+  uint8_t* bytes() { return mExternal ? mExternal.get() : mData.data(); }
+  const uint8_t* bytes() const
+  {
+    return mExternal ? mExternal.get() : mData.data();
+  }
+  size_t sizeInBytes() const { return mExternal ? mExternalSize : mData.size(); }
 
   PixelWidth pixelWidth() const { return mPixelWidth; }
   Component& pixelWidth(PixelWidth pw) { mPixelWidth = pw; return *this; }
+
+  /** The encoding used when the Component is saved, the data in memory is
+      always raw.
+  */
+  Encoding encoding() const { return mEncoding; }
+  Component& encoding(Encoding e) { mEncoding = e; return *this; }
 };
 
 /** One chunk metadata value. */
@@ -74,6 +195,58 @@ typedef std::vector<Metadata> LineMetadata;
 /** Pointer to LineMetadata. */
 typedef std::shared_ptr<LineMetadata> LineMetadataPtr;
 
+/** Line mark data, a.k.a GigEVision line chunk data, for one line (profile).
+    The values are stored in the order they are saved in the DAT-file, so that
+    a series of LineMarks can be written as one contiguous block.
+*/
+struct LineMark
+{
+  Metadata encoderValue;
+  /** Status bits (zero-indexed from lsb):
+      <ul>
+      <li> Bit 16-23: Overtrig
+      <li> Bit 27: Encoder B
+      <li> Bit 28: Encoder A
+      <li> Bit 30: Enable
+      </ul>
+  */
+  Metadata status;
+  Metadata sampleTimestamp;
+  Metadata encoderTimestamp;
+  Metadata scanId;
+};
+
+static_assert(sizeof(LineMark) == 5 * sizeof(Metadata),
+              "LineMark must not contain any padding");
+
+/** Container for LineMarks for a series of lines. */
+typedef std::vector<LineMark> LineMarks;
+
+/** Pointer to LineMarks. */
+typedef std::shared_ptr<LineMarks> LineMarksPtr;
+
+/** Summary of the line marks of a recorded frame, one entry of the index a
+    ScanRecorder writes at the end of its DAT-file. See DatXmlReader.
+*/
+struct FrameIndexEntry
+{
+  /** Byte offset of the frame in the DAT-file. */
+  uint64_t offset;
+  /** The scan id of the first line, i.e., the GenTL frame ID when the line
+      marks are read by the samples. The frame number if there are no line
+      marks.
+  */
+  Metadata frameId;
+  Metadata firstEncoderValue;
+  Metadata lastEncoderValue;
+  Metadata firstTimestamp;
+  Metadata lastTimestamp;
+  Metadata reserved;
+};
+
+static_assert(sizeof(FrameIndexEntry) == 32,
+              "FrameIndexEntry must not contain any padding");
+
 /** Pointer to Component. */
 typedef std::shared_ptr<Component> ComponentPtr;
 
@@ -85,6 +258,10 @@ private:
   Size2D mAoiOffset;
 
   LineMetadataPtr mLineEncoderValues;
+  LineMarksPtr mLineMarks;
+  // Only set when the line marks are a view of external data
+  std::shared_ptr<LineMark> mLineMarkView;
+  size_t mLineMarkViewCount;
 
   ComponentPtr mRange;
   ComponentPtr mReflectance;
@@ -94,6 +271,9 @@ public:
     : mAoiSize(Size2D(0, 0))
     , mAoiOffset(Size2D(0, 0))
     , mLineEncoderValues()
+    , mLineMarks()
+    , mLineMarkView()
+    , mLineMarkViewCount(0)
     , mRange()
     , mReflectance()
     , mScatter() {}
@@ -106,6 +286,10 @@ public:
   RangeFrame& aoiSize(Size2D size) { mAoiSize = size; return *this; }
   RangeFrame& aoiSize(size_t x, size_t y) { return aoiSize(Size2D(x, y)); }
 
+  /** Encoder values only, for frames without full line mark data. When
+      saving, the other line mark values are written as zero. Ignored if the
+      frame has line marks.
+  */
   LineMetadataPtr lineEncoderValues() { return mLineEncoderValues; }
 
   RangeFrame& lineEncoderValues(LineMetadataPtr& lineEncoderValues)
@@ -120,6 +304,62 @@ public:
     return *this;
   }
 
+  /** All line mark values, one LineMark per line. Not set if the line
+      marks are a view, use lineMarkData() to access either kind.
+  */
+  LineMarksPtr lineMarks() { return mLineMarks; }
+
+  RangeFrame& lineMarks(LineMarksPtr& lineMarks)
+  {
+    mLineMarks = lineMarks;
+    mLineMarkView.reset();
+    mLineMarkViewCount = 0;
+    return *this;
+  }
+
+  RangeFrame& createLineMarks(size_t lineCount)
+  {
+    LineMarksPtr lineMarks = std::make_shared<LineMarks>(lineCount);
+    return this->lineMarks(lineMarks);
+  }
+
+  /** Creates the line marks as a view of lineCount LineMarks of external
+      data, see Component.
+  */
+  RangeFrame& createLineMarksView(LineMark* marks, size_t lineCount,
+                                  ReleaseCallback release = ReleaseCallback())
+  {
+    mLineMarks.reset();
+    mLineMarkView = std::shared_ptr<LineMark>(marks, [release](LineMark* p)
+    {
+      if (release)
+      {
+        release(reinterpret_cast<uint8_t*>(p));
+      }
+    });
+    mLineMarkViewCount = lineCount;
+    return *this;
+  }
+
+  /** True if the frame has line marks, owned or viewed. */
+  bool hasLineMarks() const
+  {
+    return mLineMarks || mLineMarkView;
+  }
+
+  /** The line marks, owned or viewed, without copying. */
+  LineMark* lineMarkData()
+  {
+    return mLineMarkView ? mLineMarkView.get()
+                         : mLineMarks ? mLineMarks->data() : nullptr;
+  }
+
+  size_t lineMarkCount() const
+  {
+    return mLineMarkView ? mLineMarkViewCount
+                         : mLineMarks ? mLineMarks->size() : 0;
+  }
+
   ComponentPtr& range() { return mRange; }
   ComponentPtr& reflectance() { return mReflectance; }
   ComponentPtr& scatter() { return mScatter; }
@@ -136,6 +376,20 @@ public:
     return *this;
   }
 
+  RangeFrame& createRange(DataVector&& data, PixelWidth pw)
+  {
+    mRange = std::make_shared<Component>(std::move(data), pw);
+    return *this;
+  }
+
+  /** Creates the range as a view of external data, see Component. */
+  RangeFrame& createRangeView(uint8_t* data, size_t bytes, PixelWidth pw,
+                              ReleaseCallback release = ReleaseCallback())
+  {
+    mRange = std::make_shared<Component>(data, bytes, pw, release);
+    return *this;
+  }
+
   RangeFrame& createReflectance(size_t bytes, PixelWidth pw)
   {
     mReflectance = std::make_shared<Component>(bytes, pw);
@@ -148,6 +402,20 @@ public:
     return *this;
   }
 
+  RangeFrame& createReflectance(DataVector&& data, PixelWidth pw)
+  {
+    mReflectance = std::make_shared<Component>(std::move(data), pw);
+    return *this;
+  }
+
+  /** Creates the reflectance as a view of external data, see Component. */
+  RangeFrame& createReflectanceView(uint8_t* data, size_t bytes, PixelWidth pw,
+                                    ReleaseCallback release = ReleaseCallback())
+  {
+    mReflectance = std::make_shared<Component>(data, bytes, pw, release);
+    return *this;
+  }
+
   RangeFrame& createScatter(size_t bytes, PixelWidth pw)
   {
     mScatter = std::make_shared<Component>(bytes, pw);
@@ -159,6 +427,20 @@ public:
     mScatter = std::make_shared<Component>(data, pw);
     return *this;
   }
+
+  RangeFrame& createScatter(DataVector&& data, PixelWidth pw)
+  {
+    mScatter = std::make_shared<Component>(std::move(data), pw);
+    return *this;
+  }
+
+  /** Creates the scatter as a view of external data, see Component. */
+  RangeFrame& createScatterView(uint8_t* data, size_t bytes, PixelWidth pw,
+                                ReleaseCallback release = ReleaseCallback())
+  {
+    mScatter = std::make_shared<Component>(data, bytes, pw, release);
+    return *this;
+  }
 };
 
 }
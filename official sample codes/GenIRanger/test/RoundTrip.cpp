@@ -0,0 +1,235 @@
+// Copyright 2018 SICK AG. All rights reserved.
+
+#include "DatXmlReader.h"
+#include "Exceptions.h"
+#include "GenIRanger.h"
+#include "PixelConversion.h"
+#include "RangeCodec.h"
+#include "ThreadPool.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+int gFailures = 0;
+
+void check(bool ok, const std::string& what)
+{
+  if (!ok)
+  {
+    std::cout << "FAILED: " << what << std::endl;
+    ++gFailures;
+  }
+}
+
+/** Values that change a little from line to line, like a scanned surface,
+    with noise of the given number of bits.
+*/
+std::vector<uint8_t> surface(size_t width,
+                             size_t lineCount,
+                             size_t bytesPerValue,
+                             unsigned noiseBits,
+                             std::mt19937& random)
+{
+  std::vector<uint8_t> data(width * lineCount * bytesPerValue);
+  const uint32_t noiseMask = (1u << noiseBits) - 1;
+  for (size_t line = 0; line < lineCount; ++line)
+  {
+    for (size_t x = 0; x < width; ++x)
+    {
+      const uint32_t value = static_cast<uint32_t>(x * 3 + line)
+        + (random() & noiseMask);
+      const size_t i = line * width + x;
+      if (bytesPerValue == 2)
+      {
+        const uint16_t value16 = static_cast<uint16_t>(value);
+        memcpy(&data[i * 2], &value16, 2);
+      }
+      else
+      {
+        data[i] = static_cast<uint8_t>(value);
+      }
+    }
+  }
+  return data;
+}
+
+/** Encodes and decodes with RangeCodec, with and without a pool, for widths
+    that do and do not fill the last group of a line.
+*/
+void checkRangeCodec(GenIRanger::ThreadPool& pool, std::mt19937& random)
+{
+  const size_t widths[] = { 1, 31, 32, 33, 2560 };
+  const size_t lineCounts[] = { 1, 64, 130 };
+  const unsigned noiseBits[] = { 0, 3, 16 };
+  for (size_t bytesPerValue = 1; bytesPerValue <= 2; ++bytesPerValue)
+  {
+    for (size_t width : widths)
+    {
+      for (size_t lineCount : lineCounts)
+      {
+        for (unsigned bits : noiseBits)
+        {
+          const std::vector<uint8_t> in
+            = surface(width, lineCount, bytesPerValue, bits, random);
+          std::vector<uint8_t> encoded(GenIRanger::RangeCodec::maxEncodedSize(
+            width, lineCount, bytesPerValue));
+          std::vector<uint8_t> decoded(in.size());
+          const size_t size = GenIRanger::RangeCodec::encode(
+            in.data(), width, lineCount, bytesPerValue, encoded.data(), &pool);
+          GenIRanger::RangeCodec::decode(encoded.data(), size, width,
+                                         lineCount, bytesPerValue,
+                                         decoded.data(), nullptr);
+          check(decoded == in,
+                "RangeCodec round trip, width " + std::to_string(width)
+                + ", " + std::to_string(lineCount) + " lines, "
+                + std::to_string(bytesPerValue) + " byte(s) per value, "
+                + std::to_string(bits) + " bit noise");
+        }
+      }
+    }
+  }
+
+  // A block cut short must be rejected, not read beyond
+  const size_t width = 100;
+  const size_t lineCount = 10;
+  const std::vector<uint8_t> in = surface(width, lineCount, 2, 4, random);
+  std::vector<uint8_t> encoded(
+    GenIRanger::RangeCodec::maxEncodedSize(width, lineCount, 2));
+  const size_t size = GenIRanger::RangeCodec::encode(
+    in.data(), width, lineCount, 2, encoded.data(), nullptr);
+  std::vector<uint8_t> decoded(in.size());
+  bool rejected = false;
+  try
+  {
+    GenIRanger::RangeCodec::decode(encoded.data(), size - 1, width, lineCount,
+                                   2, decoded.data(), nullptr);
+  }
+  catch (const GenIRanger::LoadException&)
+  {
+    rejected = true;
+  }
+  check(rejected, "RangeCodec rejects a truncated block");
+}
+
+/** Saves a compressed frame and reads it back, i.e., the encoding when
+    saving and the decoding when loading.
+*/
+void checkSavedFrame(const std::string& filePath, std::mt19937& random)
+{
+  const size_t width = 1000;
+  const size_t lineCount = 200;
+  GenIRanger::RangeFrame frame;
+  frame.aoiSize(width, 832).aoiOffset(0, 0);
+  frame.createRange(surface(width, lineCount, 2, 5, random),
+                    GenIRanger::PixelWidth::PW16);
+  frame.createReflectance(surface(width, lineCount, 1, 6, random),
+                          GenIRanger::PixelWidth::PW8);
+  frame.range()->encoding(GenIRanger::Encoding::LineDelta);
+  frame.reflectance()->encoding(GenIRanger::Encoding::LineDelta);
+  GenIRanger::saveMultipartRangeFrame(frame, filePath);
+
+  GenIRanger::DatXmlReader reader(filePath);
+  GenIRanger::RangeFrame loaded = reader.frame(0);
+  check(loaded.range()->sizeInBytes() == frame.range()->sizeInBytes()
+        && memcmp(loaded.range()->bytes(), frame.range()->bytes(),
+                  frame.range()->sizeInBytes()) == 0,
+        "Saved and loaded compressed range");
+  check(loaded.reflectance()->sizeInBytes()
+          == frame.reflectance()->sizeInBytes()
+        && memcmp(loaded.reflectance()->bytes(), frame.reflectance()->bytes(),
+                  frame.reflectance()->sizeInBytes()) == 0,
+        "Saved and loaded compressed reflectance");
+}
+
+/** Packs and unpacks 12p buffers, compared with the scalar reference, for
+    even and odd pixel counts.
+*/
+void checkPixelConversion(std::mt19937& random)
+{
+  const size_t pixelCounts[] = { 1, 2, 15, 16, 17, 1001, 2560 * 64 };
+  for (size_t pixelCount : pixelCounts)
+  {
+    std::vector<uint16_t> pixels(pixelCount);
+    for (size_t i = 0; i < pixelCount; ++i)
+    {
+      pixels[i] = static_cast<uint16_t>(random() & 0x0FFF);
+    }
+    const std::string suffix = ", " + std::to_string(pixelCount) + " pixels";
+
+    const size_t packedSize
+      = GenIRanger::PixelConversion::packed12pSize(pixelCount);
+    std::vector<uint8_t> packed(packedSize);
+    int64_t packedOutSize = static_cast<int64_t>(packed.size());
+    GenIRanger::convert16To12p(pixels.data(),
+                               static_cast<int64_t>(pixelCount * 2),
+                               packed.data(),
+                               &packedOutSize);
+    std::vector<uint8_t> reference(packedSize);
+    GenIRanger::PixelConversion::pack16To12pReference(pixels.data(),
+                                                      pixelCount,
+                                                      reference.data());
+    check(static_cast<size_t>(packedOutSize) == packedSize
+          && packed == reference,
+          "convert16To12p compared with the reference" + suffix);
+
+    std::vector<uint16_t> unpacked(pixelCount);
+    int64_t unpackedOutSize = static_cast<int64_t>(pixelCount * 2);
+    GenIRanger::convert12pTo16(packed.data(),
+                               static_cast<int64_t>(packedSize),
+                               reinterpret_cast<uint8_t*>(unpacked.data()),
+                               &unpackedOutSize);
+    std::vector<uint16_t> unpackedReference(pixelCount);
+    GenIRanger::PixelConversion::unpack12pTo16Reference(
+      packed.data(), packedSize,
+      reinterpret_cast<uint8_t*>(unpackedReference.data()));
+    check(static_cast<size_t>(unpackedOutSize) == pixelCount * 2
+          && unpacked == unpackedReference && unpacked == pixels,
+          "convert12pTo16 compared with the reference" + suffix);
+
+    std::vector<uint16_t> parallel(pixelCount);
+    int64_t parallelOutSize = static_cast<int64_t>(pixelCount * 2);
+    GenIRanger::convert12pTo16Parallel(
+      packed.data(), static_cast<int64_t>(packedSize),
+      reinterpret_cast<uint8_t*>(parallel.data()), &parallelOutSize, 0);
+    check(parallelOutSize == unpackedOutSize && parallel == unpacked,
+          "convert12pTo16Parallel compared with convert12pTo16" + suffix);
+  }
+}
+
+}
+
+/**
+   Checks that compressed components and 12p conversions give back exactly
+   the data they were given, using the vectorized implementations picked for
+   this processor. The optional command line argument is the file path to
+   save a frame to, without extension. Exits with 1 on any difference.
+*/
+int main(int argc, char* argv[])
+{
+  const std::string filePath = argc > 1 ? argv[1] : "round_trip";
+  std::mt19937 random(2018);
+  GenIRanger::ThreadPool pool(4);
+
+  std::cout << "RangeCodec: " << GenIRanger::RangeCodec::implementation()
+            << ", 16 to 12p: "
+            << GenIRanger::PixelConversion::pack16To12pImplementation()
+            << ", 12p to 16: "
+            << GenIRanger::PixelConversion::unpack12pTo16Implementation()
+            << std::endl;
+
+  checkRangeCodec(pool, random);
+  checkSavedFrame(filePath, random);
+  checkPixelConversion(random);
+
+  std::cout << (gFailures == 0 ? "All round trips exact"
+                               : std::to_string(gFailures) + " failure(s)")
+            << std::endl;
+  return gFailures == 0 ? 0 : 1;
+}
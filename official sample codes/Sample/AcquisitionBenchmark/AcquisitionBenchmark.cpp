@@ -0,0 +1,284 @@
+// Copyright 2018 SICK AG. All rights reserved.
+
+#include "AcquisitionPipeline.h"
+#include "BufferDescriptor.h"
+#include "Consumer.h"
+#include "TaskPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+void usage(int, char* argv[])
+{
+  std::cout << "Usage:" << std::endl
+            << argv[0] << " [seconds] [workers]" << std::endl
+            << "The producer is given by SICK_GENTL_PRODUCER, e.g., the path "
+            << "to SimulatedRanger3.cti" << std::endl << std::endl;
+}
+
+/** A device acquiring into its own data stream of the pipeline. */
+struct Camera
+{
+  GenTL::DEV_HANDLE mDeviceHandle;
+  GenTL::DS_HANDLE mDataStreamHandle;
+  std::unique_ptr<Sample::GenTLPort> mPort;
+  GenApi::CNodeMapRef mDevice;
+  std::unique_ptr<Sample::BufferDescriptorReader> mBufferReader;
+  std::vector<GenTL::BUFFER_HANDLE> mBufferHandles;
+
+  std::atomic<uint64_t> mFramesIncomplete;
+  // Only touched by the ordered stage
+  uint64_t mLastFrameId;
+  uint64_t mFramesMissing;
+  uint64_t mFramesOutOfOrder;
+};
+
+/** Sets up the device for 3D with reflectance and chunk metadata, and
+    announces buffers for it.
+*/
+void configure(GenTLApi* tl, Camera& camera, size_t bufferCount)
+{
+  GenApi::CEnumerationPtr deviceType
+    = camera.mDevice._GetNode("DeviceScanType");
+  *deviceType = "Linescan3D";
+
+  GenApi::CBooleanPtr chunkModeActive
+    = camera.mDevice._GetNode("ChunkModeActive");
+  *chunkModeActive = true;
+
+  GenApi::CEnumerationPtr regionSelector
+    = camera.mDevice._GetNode("RegionSelector");
+  *regionSelector = "Scan3dExtraction1";
+  GenApi::CEnumerationPtr componentSelector
+    = camera.mDevice._GetNode("ComponentSelector");
+  *componentSelector = "Reflectance";
+  GenApi::CBooleanPtr reflectanceEnable
+    = camera.mDevice._GetNode("ComponentEnable");
+  *reflectanceEnable = true;
+
+  GenApi::CIntegerPtr payload = camera.mDevice._GetNode("PayloadSize");
+  const size_t payloadSize = static_cast<size_t>(payload->GetValue());
+  camera.mBufferHandles.resize(bufferCount);
+  for (size_t i = 0; i < bufferCount; ++i)
+  {
+    CC(tl, tl->DSAllocAndAnnounceBuffer(camera.mDataStreamHandle,
+                                        payloadSize,
+                                        nullptr,
+                                        &camera.mBufferHandles[i]));
+    CC(tl, tl->DSQueueBuffer(camera.mDataStreamHandle,
+                             camera.mBufferHandles[i]));
+  }
+}
+
+void releaseBuffers(GenTLApi* tl, Camera& camera)
+{
+  CC(tl, tl->DSFlushQueue(camera.mDataStreamHandle,
+                          GenTL::ACQ_QUEUE_ALL_DISCARD));
+  for (GenTL::BUFFER_HANDLE bufferHandle : camera.mBufferHandles)
+  {
+    void* data = nullptr;
+    void* userPointer = nullptr;
+    CC(tl, tl->DSRevokeBuffer(camera.mDataStreamHandle, bufferHandle, &data,
+                              &userPointer));
+  }
+  camera.mBufferHandles.clear();
+}
+
+
+/**
+   This sample acquires from all devices of the first interface through one
+   AcquisitionPipeline, for measuring the throughput of the consumer side.
+   It needs no console input and runs on Linux as well as Windows, e.g.,
+   against SimulatedRanger3.cti, which is then set in SICK_GENTL_PRODUCER.
+
+   Each device is a data stream of the pipeline and all streams share one
+   TaskPool. The buffer parts are described in parallel on the workers, and
+   an ordered stage checks that the frames of each device arrive in order.
+
+   The program takes two optional command line arguments: The number of
+   seconds to acquire, 5 by default, and the number of workers, by default
+   the number of cores. It exits with 1 if nothing was processed, a stage
+   failed or a frame was out of order.
+*/
+int main(int argc, char* argv[])
+{
+  const int seconds = argc > 1 ? std::atoi(argv[1]) : 5;
+  const size_t workerCount = argc > 2
+    ? static_cast<size_t>(std::atoi(argv[2]))
+    : std::max(1u, std::thread::hardware_concurrency());
+  const char* producer = std::getenv("SICK_GENTL_PRODUCER");
+  if (seconds <= 0 || workerCount == 0
+      || producer == nullptr || *producer == '\0')
+  {
+    usage(argc, argv);
+    return 1;
+  }
+
+  std::string ctiFile(producer);
+  Sample::Consumer consumer(ctiFile);
+  // Initialize GenTL and open transport layer
+  GenTL::TL_HANDLE tlHandle = consumer.open();
+  if (tlHandle == GENTL_INVALID_HANDLE)
+  {
+    return 1;
+  }
+  GenTLApi* tl = consumer.tl();
+
+  Sample::InterfaceList interfaces = consumer.getInterfaces(tlHandle);
+  Sample::InterfaceId interfaceId
+    = consumer.findInterfaceByIndex(interfaces, 0);
+  GenTL::IF_HANDLE interfaceHandle = consumer.openInterfaceById(interfaceId);
+  if (interfaceHandle == GENTL_INVALID_HANDLE)
+  {
+    return 1;
+  }
+
+  const size_t buffersPerDevice = 16;
+  Sample::DeviceList devices = consumer.getDevices(interfaceHandle);
+  std::vector<std::unique_ptr<Camera>> cameras;
+  for (uint32_t i = 0; i < devices.size(); ++i)
+  {
+    Sample::DeviceId deviceId = consumer.findDeviceByIndex(devices, i);
+    std::unique_ptr<Camera> camera(new Camera());
+    camera->mDeviceHandle
+      = consumer.openDeviceById(interfaceHandle, deviceId);
+    if (camera->mDeviceHandle == GENTL_INVALID_HANDLE)
+    {
+      return 1;
+    }
+    camera->mDataStreamHandle
+      = consumer.openDataStream(camera->mDeviceHandle);
+
+    GenTL::PORT_HANDLE devicePort;
+    CC(tl, tl->DevGetPort(camera->mDeviceHandle, &devicePort));
+    camera->mPort.reset(new Sample::GenTLPort(devicePort, tl));
+    camera->mDevice = consumer.getNodeMap(camera->mPort.get());
+    configure(tl, *camera, buffersPerDevice);
+
+    camera->mBufferReader.reset(
+      new Sample::BufferDescriptorReader(tl, camera->mDataStreamHandle));
+    camera->mFramesIncomplete = 0;
+    camera->mLastFrameId = 0;
+    camera->mFramesMissing = 0;
+    camera->mFramesOutOfOrder = 0;
+    cameras.push_back(std::move(camera));
+  }
+  if (cameras.empty())
+  {
+    std::cout << "No devices found." << std::endl;
+    return 1;
+  }
+
+  Sample::TaskPool pool(workerCount);
+  Sample::AcquisitionPipeline::Options options;
+  options.queueCapacity = buffersPerDevice / 2 * cameras.size();
+  options.policy = Sample::AcquisitionPipeline::BackpressurePolicy::Block;
+  Sample::AcquisitionPipeline pipeline(consumer, pool, options);
+  for (auto& camera : cameras)
+  {
+    pipeline.addDataStream(camera->mDataStreamHandle);
+  }
+
+  // Parallel, the reader is thread safe and each buffer has its own parts
+  pipeline.addStage("Describe", [&](Sample::AcquiredBuffer& buffer)
+  {
+    Camera& camera = *cameras[buffer.mStreamIndex];
+    Sample::BufferDescriptor descriptor;
+    camera.mBufferReader->read(buffer.mBufferHandle, descriptor);
+    // Range and reflectance are expected
+    if (descriptor.mIncomplete || descriptor.mPartCount < 2)
+    {
+      ++camera.mFramesIncomplete;
+    }
+    return true;
+  });
+
+  // One buffer at a time per device, in the order received
+  pipeline.addOrderedStage("Sequence", [&](Sample::AcquiredBuffer& buffer)
+  {
+    Camera& camera = *cameras[buffer.mStreamIndex];
+    if (camera.mLastFrameId != 0 && buffer.mFrameId <= camera.mLastFrameId)
+    {
+      ++camera.mFramesOutOfOrder;
+    }
+    else if (camera.mLastFrameId != 0)
+    {
+      camera.mFramesMissing += buffer.mFrameId - camera.mLastFrameId - 1;
+    }
+    camera.mLastFrameId = buffer.mFrameId;
+    return true;
+  });
+
+  pipeline.start();
+  for (auto& camera : cameras)
+  {
+    GenApi::CIntegerPtr paramLock = camera->mDevice._GetNode("TLParamsLocked");
+    paramLock->SetValue(1);
+    CC(tl, tl->DSStartAcquisition(camera->mDataStreamHandle,
+                                  GenTL::ACQ_START_FLAGS_DEFAULT,
+                                  GENTL_INFINITE));
+    GenApi::CCommandPtr start = camera->mDevice._GetNode("AcquisitionStart");
+    start->Execute();
+  }
+  std::cout << "Acquiring from " << cameras.size() << " device(s) on "
+            << workerCount << " worker(s) for " << seconds << " s..."
+            << std::endl;
+  std::this_thread::sleep_for(std::chrono::seconds(seconds));
+
+  for (auto& camera : cameras)
+  {
+    GenApi::CCommandPtr stop = camera->mDevice._GetNode("AcquisitionStop");
+    stop->Execute();
+  }
+  pipeline.stop();
+
+  int returnCode = 0;
+  Sample::AcquisitionPipeline::Statistics statistics = pipeline.statistics();
+  std::cout << "Received: " << statistics.mBuffersReceived
+            << ", processed: " << statistics.mBuffersProcessed
+            << ", dropped: " << statistics.mBuffersDropped
+            << ", stage errors: " << statistics.mStageErrors << std::endl;
+  std::cout << "Buffers per second: "
+            << statistics.mBuffersProcessed / seconds << std::endl;
+  for (const auto& stage : statistics.mStages)
+  {
+    std::cout << stage.mName << ": mean "
+              << (stage.mCount == 0 ? 0 : stage.mTotalUs / stage.mCount)
+              << " us, max " << stage.mMaxUs << " us" << std::endl;
+  }
+  if (statistics.mBuffersProcessed == 0 || statistics.mStageErrors != 0)
+  {
+    returnCode = 1;
+  }
+
+  for (size_t i = 0; i < cameras.size(); ++i)
+  {
+    Camera& camera = *cameras[i];
+    std::cout << "Device " << i << ": missing frames "
+              << camera.mFramesMissing << ", out of order "
+              << camera.mFramesOutOfOrder << ", incomplete "
+              << camera.mFramesIncomplete << std::endl;
+    if (camera.mFramesOutOfOrder != 0)
+    {
+      returnCode = 1;
+    }
+
+    CC(tl, tl->DSStopAcquisition(camera.mDataStreamHandle,
+                                 GenTL::ACQ_STOP_FLAGS_DEFAULT));
+    GenApi::CIntegerPtr paramLock = camera.mDevice._GetNode("TLParamsLocked");
+    paramLock->SetValue(0);
+    releaseBuffers(tl, camera);
+    consumer.closeDataStream(camera.mDataStreamHandle);
+    consumer.closeDevice(camera.mDeviceHandle);
+  }
+  consumer.closeInterface(interfaceHandle);
+  consumer.close();
+  return returnCode;
+}
@@ -129,19 +129,31 @@ int main(int argc, char* argv[])
   GenApi::CIntegerPtr chunkHeight = device._GetNode("ChunkHeight");
   std::cout << "Chunk width: " << chunkWidth->GetValue()
     << ", height: " << chunkHeight->GetValue() << std::endl;
-  GenApi::CIntegerPtr chunkScanLineSelector =
-    device._GetNode("ChunkScanLineSelector");
-  GenApi::CIntegerPtr chunkTimestamp = device._GetNode("ChunkTimestamp");
-  GenApi::CIntegerPtr chunkEncoderValue = device._GetNode("ChunkEncoderValue");
-  for (int64_t i = chunkScanLineSelector->GetMin();
-       i <= chunkScanLineSelector->GetMax(); ++i)
+
+  // The line metadata is decoded directly from the buffer, using the chunk
+  // layout the adapter learned from the node map when attaching the buffer.
+  // Reading it through the node map instead, line by line, is much slower
+  // but gives the same values.
+  Sample::LineMetadata metadata;
+  chunkAdapter.readLineMetadata(metadata);
+  Sample::LineMetadata reference;
+  chunkAdapter.readLineMetadataFromNodeMap(reference);
+  std::cout << "Metadata decoded "
+    << (chunkAdapter.hasDirectLayout() ? "directly" : "through node map")
+    << std::endl;
+  for (size_t i = 0; i < metadata.lineCount(); ++i)
   {
-    chunkScanLineSelector->SetValue(i);
     std::cout << "Line: " << i
-      << ", timestamp: " << chunkTimestamp->GetValue()
+      << ", timestamp: " << metadata.mTimestamp[i]
       // Encoder is not used to trigger lines in this sample but a
       // connected encoder's value will be in the metadata anyway.
-      << ", encoder: " << chunkEncoderValue->GetValue() << std::endl;
+      << ", encoder: " << metadata.mEncoderValue[i];
+    if (metadata.mTimestamp[i] != reference.mTimestamp[i]
+        || metadata.mEncoderValue[i] != reference.mEncoderValue[i])
+    {
+      std::cout << " (node map differs)";
+    }
+    std::cout << std::endl;
   }
 
   chunkAdapter.detachBuffer();
@@ -0,0 +1,370 @@
+// Copyright 2018 SICK AG. All rights reserved.
+
+#include "AcquisitionPipeline.h"
+
+namespace Sample
+{
+
+namespace
+{
+
+// How long a receive thread waits for a worker to take a buffer, when
+// blocking
+const std::chrono::microseconds BLOCK_SLEEP(100);
+
+template<typename T>
+bool getBufferInfo(GenTLApi* tl,
+                   GenTL::DS_HANDLE dataStreamHandle,
+                   GenTL::BUFFER_HANDLE bufferHandle,
+                   GenTL::BUFFER_INFO_CMD command,
+                   T& value)
+{
+  GenTL::INFO_DATATYPE type;
+  size_t size = sizeof(value);
+  return tl->DSGetBufferInfo(dataStreamHandle, bufferHandle, command, &type,
+                             &value, &size) == GenTL::GC_ERR_SUCCESS;
+}
+
+}
+
+AcquisitionPipeline::LatencyCounter::LatencyCounter()
+  : mCount(0)
+  , mTotalUs(0)
+  , mMaxUs(0)
+{
+  // Empty
+}
+
+void AcquisitionPipeline::LatencyCounter::add(
+  std::chrono::steady_clock::duration latency)
+{
+  const uint64_t us = static_cast<uint64_t>(
+    std::chrono::duration_cast<std::chrono::microseconds>(latency).count());
+  mCount.fetch_add(1, std::memory_order_relaxed);
+  mTotalUs.fetch_add(us, std::memory_order_relaxed);
+  uint64_t max = mMaxUs.load(std::memory_order_relaxed);
+  while (us > max
+         && !mMaxUs.compare_exchange_weak(max, us, std::memory_order_relaxed))
+  {
+    // max is updated by the failed exchange
+  }
+}
+
+AcquisitionPipeline::StageStatistics
+AcquisitionPipeline::LatencyCounter::read(const std::string& name) const
+{
+  StageStatistics statistics;
+  statistics.mName = name;
+  statistics.mCount = mCount.load(std::memory_order_relaxed);
+  statistics.mTotalUs = mTotalUs.load(std::memory_order_relaxed);
+  statistics.mMaxUs = mMaxUs.load(std::memory_order_relaxed);
+  return statistics;
+}
+
+AcquisitionPipeline::AcquisitionPipeline(Consumer& consumer,
+                                         TaskPool& pool,
+                                         const Options& options)
+  : mTl(consumer.tl())
+  , mPool(pool)
+  , mOptions(options)
+  , mStopReceiving(false)
+  , mWaitingJobCount(0)
+  , mBuffersReceived(0)
+  , mBuffersProcessed(0)
+  , mBuffersDropped(0)
+  , mStageErrors(0)
+{
+  // Empty
+}
+
+AcquisitionPipeline::~AcquisitionPipeline()
+{
+  try
+  {
+    stop();
+  }
+  catch (const std::exception&)
+  {
+    // Nothing more to do when unregistering the events fails
+  }
+}
+
+size_t AcquisitionPipeline::addDataStream(GenTL::DS_HANDLE dataStreamHandle)
+{
+  DataStream dataStream;
+  dataStream.mHandle = dataStreamHandle;
+  dataStream.mSequence = std::make_shared<TaskSequence>(mPool);
+  CC(mTl, mTl->GCRegisterEvent(dataStreamHandle,
+                               GenTL::EVENT_NEW_BUFFER,
+                               &dataStream.mNewBufferEvent));
+  mDataStreams.push_back(dataStream);
+  return mDataStreams.size() - 1;
+}
+
+void AcquisitionPipeline::addStage(const std::string& name, Stage stage)
+{
+  mStageNames.push_back(name);
+  mStages.push_back(stage);
+  mStageOrdered.push_back(false);
+  mStageLatency.push_back(
+    std::unique_ptr<LatencyCounter>(new LatencyCounter()));
+}
+
+void AcquisitionPipeline::addOrderedStage(const std::string& name,
+                                          Stage stage)
+{
+  addStage(name, stage);
+  mStageOrdered.back() = true;
+}
+
+void AcquisitionPipeline::start()
+{
+  mStopReceiving = false;
+  for (size_t i = 0; i < mDataStreams.size(); ++i)
+  {
+    mReceiveThreads.push_back(
+      std::thread(&AcquisitionPipeline::receiveLoop, this, i));
+  }
+}
+
+void AcquisitionPipeline::stop()
+{
+  mStopReceiving = true;
+  for (size_t i = 0; i < mReceiveThreads.size(); ++i)
+  {
+    // Wakes up the receive thread without waiting for the timeout
+    mTl->EventKill(mDataStreams[i].mNewBufferEvent);
+    mReceiveThreads[i].join();
+  }
+  mReceiveThreads.clear();
+
+  // Nothing is submitted from now on, the jobs of other pipelines in the pool
+  // are not waited for
+  for (size_t i = 0; i < mDataStreams.size(); ++i)
+  {
+    mDataStreams[i].mSequence->waitIdle();
+  }
+  mWaitingJobs.clear();
+
+  for (size_t i = 0; i < mDataStreams.size(); ++i)
+  {
+    CC(mTl, mTl->GCUnregisterEvent(mDataStreams[i].mHandle,
+                                   GenTL::EVENT_NEW_BUFFER));
+  }
+  mDataStreams.clear();
+}
+
+AcquisitionPipeline::Statistics AcquisitionPipeline::statistics() const
+{
+  Statistics statistics;
+  statistics.mBuffersReceived = mBuffersReceived.load();
+  statistics.mBuffersProcessed = mBuffersProcessed.load();
+  statistics.mBuffersDropped = mBuffersDropped.load();
+  statistics.mStageErrors = mStageErrors.load();
+  statistics.mQueueWait = mQueueWait.read("Queue");
+  for (size_t i = 0; i < mStages.size(); ++i)
+  {
+    statistics.mStages.push_back(mStageLatency[i]->read(mStageNames[i]));
+  }
+  return statistics;
+}
+
+void AcquisitionPipeline::receiveLoop(size_t streamIndex)
+{
+  const DataStream& dataStream = mDataStreams[streamIndex];
+  while (!mStopReceiving)
+  {
+    GenTL::EVENT_NEW_BUFFER_DATA event;
+    size_t eventSize = sizeof(event);
+    GenTL::GC_ERROR result = mTl->EventGetData(dataStream.mNewBufferEvent,
+                                               &event,
+                                               &eventSize,
+                                               mOptions.eventTimeoutMs);
+    if (result != GenTL::GC_ERR_SUCCESS)
+    {
+      // Timeout, or aborted by stop()
+      continue;
+    }
+    Received received;
+    received.mStreamIndex = streamIndex;
+    received.mBufferHandle = event.BufferHandle;
+    received.mReceiveTime = std::chrono::steady_clock::now();
+    mBuffersReceived.fetch_add(1, std::memory_order_relaxed);
+    handOver(received);
+  }
+}
+
+void AcquisitionPipeline::handOver(const Received& received)
+{
+  while (mWaitingJobCount.load() >= mOptions.queueCapacity)
+  {
+    switch (mOptions.policy)
+    {
+    case BackpressurePolicy::DropNewest:
+      requeue(received.mStreamIndex, received.mBufferHandle);
+      mBuffersDropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    case BackpressurePolicy::DropOldest:
+      // A worker may take the oldest buffer first, then there is room anyway
+      dropOldest();
+      break;
+    default:
+      std::this_thread::sleep_for(BLOCK_SLEEP);
+      break;
+    }
+  }
+
+  std::shared_ptr<Job> job = std::make_shared<Job>();
+  job->mReceived = received;
+  job->mTaken = false;
+  job->mStarted = false;
+  job->mProceed = false;
+  ++mWaitingJobCount;
+  if (mOptions.policy == BackpressurePolicy::DropOldest)
+  {
+    std::lock_guard<std::mutex> lock(mWaitingJobsMutex);
+    // Forget the jobs taken since, the ones in the middle are dropped later
+    while (!mWaitingJobs.empty() && mWaitingJobs.front()->mTaken)
+    {
+      mWaitingJobs.pop_front();
+    }
+    mWaitingJobs.push_back(job);
+  }
+  mDataStreams[received.mStreamIndex].mSequence->submit(
+    [this, job] { process(*job); },
+    [this, job] { complete(*job); });
+}
+
+void AcquisitionPipeline::dropOldest()
+{
+  std::lock_guard<std::mutex> lock(mWaitingJobsMutex);
+  while (!mWaitingJobs.empty())
+  {
+    std::shared_ptr<Job> oldest = mWaitingJobs.front();
+    mWaitingJobs.pop_front();
+    if (take(*oldest))
+    {
+      // The job still runs, in turn, but finds the buffer taken
+      requeue(oldest->mReceived.mStreamIndex,
+              oldest->mReceived.mBufferHandle);
+      mBuffersDropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+  }
+}
+
+bool AcquisitionPipeline::take(Job& job)
+{
+  bool expected = false;
+  if (!job.mTaken.compare_exchange_strong(expected, true))
+  {
+    return false;
+  }
+  --mWaitingJobCount;
+  return true;
+}
+
+void AcquisitionPipeline::process(Job& job)
+{
+  if (!take(job))
+  {
+    // Dropped
+    return;
+  }
+  const Received& received = job.mReceived;
+  const std::chrono::steady_clock::time_point start
+    = std::chrono::steady_clock::now();
+  mQueueWait.add(start - received.mReceiveTime);
+
+  AcquiredBuffer& buffer = job.mBuffer;
+  buffer.mStreamIndex = received.mStreamIndex;
+  buffer.mDataStreamHandle = mDataStreams[received.mStreamIndex].mHandle;
+  buffer.mBufferHandle = received.mBufferHandle;
+  buffer.mReceiveTime = received.mReceiveTime;
+  buffer.mData = nullptr;
+  buffer.mSizeFilled = 0;
+  buffer.mFrameId = 0;
+  buffer.mIncomplete = false;
+
+  // The token may outlive the pipeline in a retaining stage, so it must not
+  // refer to the pipeline
+  GenTLApi* tl = mTl;
+  GenTL::DS_HANDLE dataStreamHandle = buffer.mDataStreamHandle;
+  buffer.mRequeueToken = std::shared_ptr<void>(
+    received.mBufferHandle,
+    [tl, dataStreamHandle](void* bufferHandle)
+    {
+      tl->DSQueueBuffer(dataStreamHandle, bufferHandle);
+    });
+
+  void* data = nullptr;
+  bool8_t incomplete = 0;
+  if (!getBufferInfo(mTl, dataStreamHandle, buffer.mBufferHandle,
+                     GenTL::BUFFER_INFO_BASE, data)
+      || !getBufferInfo(mTl, dataStreamHandle, buffer.mBufferHandle,
+                        GenTL::BUFFER_INFO_SIZE_FILLED, buffer.mSizeFilled)
+      || !getBufferInfo(mTl, dataStreamHandle, buffer.mBufferHandle,
+                        GenTL::BUFFER_INFO_FRAMEID, buffer.mFrameId)
+      || !getBufferInfo(mTl, dataStreamHandle, buffer.mBufferHandle,
+                        GenTL::BUFFER_INFO_IS_INCOMPLETE, incomplete))
+  {
+    mStageErrors.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  buffer.mData = static_cast<uint8_t*>(data);
+  buffer.mIncomplete = incomplete != 0;
+  job.mStarted = true;
+  job.mProceed = runStages(buffer, false);
+}
+
+void AcquisitionPipeline::complete(Job& job)
+{
+  if (job.mStarted)
+  {
+    if (job.mProceed)
+    {
+      runStages(job.mBuffer, true);
+    }
+    mBuffersProcessed.fetch_add(1, std::memory_order_relaxed);
+  }
+  // The buffer is re-queued here, unless a stage has retained it
+  job.mBuffer.mFrame = GenIRanger::RangeFrame();
+  job.mBuffer.mRequeueToken.reset();
+}
+
+bool AcquisitionPipeline::runStages(AcquiredBuffer& buffer, bool ordered)
+{
+  for (size_t i = 0; i < mStages.size(); ++i)
+  {
+    if (mStageOrdered[i] != ordered)
+    {
+      continue;
+    }
+    const std::chrono::steady_clock::time_point stageStart
+      = std::chrono::steady_clock::now();
+    bool proceed;
+    try
+    {
+      proceed = mStages[i](buffer);
+    }
+    catch (const std::exception&)
+    {
+      mStageErrors.fetch_add(1, std::memory_order_relaxed);
+      proceed = false;
+    }
+    mStageLatency[i]->add(std::chrono::steady_clock::now() - stageStart);
+    if (!proceed)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+void AcquisitionPipeline::requeue(size_t streamIndex,
+                                  GenTL::BUFFER_HANDLE bufferHandle)
+{
+  mTl->DSQueueBuffer(mDataStreams[streamIndex].mHandle, bufferHandle);
+}
+
+}
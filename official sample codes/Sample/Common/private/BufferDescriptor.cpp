@@ -0,0 +1,144 @@
+// Copyright 2018 SICK AG. All rights reserved.
+
+#include "BufferDescriptor.h"
+
+#include <stdexcept>
+
+namespace Sample
+{
+
+BufferDescriptorReader::BufferDescriptorReader(
+  GenTLApi* tl,
+  GenTL::DS_HANDLE dataStreamHandle)
+  : mTl(tl)
+  , mDataStreamHandle(dataStreamHandle)
+  , mHasLayout(false)
+{
+  // Empty
+}
+
+void BufferDescriptorReader::read(GenTL::BUFFER_HANDLE bufferHandle,
+                                  BufferDescriptor& descriptor)
+{
+  BufferMemory memory;
+  {
+    // The producer is only called with the lock held for the first buffer,
+    // and for the first time a buffer handle is seen
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (!mHasLayout)
+    {
+      readLayout(bufferHandle, mLayout);
+      mHasLayout = true;
+    }
+    descriptor = mLayout;
+
+    std::map<GenTL::BUFFER_HANDLE, BufferMemory>::const_iterator found =
+      mMemory.find(bufferHandle);
+    if (found == mMemory.end())
+    {
+      memory = readMemory(bufferHandle);
+      mMemory[bufferHandle] = memory;
+    }
+    else
+    {
+      memory = found->second;
+    }
+  }
+
+  descriptor.mHandle = bufferHandle;
+  descriptor.mData = memory.mData;
+  descriptor.mBufferSize = memory.mSize;
+
+  bool8_t incomplete = 0;
+  getInfo(bufferHandle, GenTL::BUFFER_INFO_IS_INCOMPLETE, incomplete);
+  descriptor.mIncomplete = incomplete != 0;
+  getInfo(bufferHandle, GenTL::BUFFER_INFO_SIZE_FILLED, descriptor.mSizeFilled);
+  getInfo(bufferHandle, GenTL::BUFFER_INFO_DATA_SIZE, descriptor.mDataSize);
+  getInfo(bufferHandle, GenTL::BUFFER_INFO_FRAMEID, descriptor.mFrameId);
+
+  if (descriptor.mPayloadType != GenTL::PAYLOAD_TYPE_MULTI_PART)
+  {
+    getInfo(bufferHandle, GenTL::BUFFER_INFO_HEIGHT, descriptor.mHeight);
+    return;
+  }
+  for (uint32_t i = 0; i < descriptor.mPartCount; ++i)
+  {
+    BufferPartDescriptor& part = descriptor.mParts[i];
+    getPartInfo(bufferHandle, i, GenTL::BUFFER_PART_INFO_BASE, part.mData);
+    getPartInfo(bufferHandle, i, GenTL::BUFFER_PART_INFO_DATA_SIZE,
+                part.mDataSize);
+    getPartInfo(bufferHandle, i, GenTL::BUFFER_PART_INFO_HEIGHT,
+                part.mHeight);
+  }
+}
+
+void BufferDescriptorReader::reset()
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  mHasLayout = false;
+  mMemory.clear();
+}
+
+void BufferDescriptorReader::readLayout(GenTL::BUFFER_HANDLE bufferHandle,
+                                        BufferDescriptor& layout)
+{
+  layout = BufferDescriptor();
+  getInfo(bufferHandle, GenTL::BUFFER_INFO_PAYLOADTYPE, layout.mPayloadType);
+  if (layout.mPayloadType != GenTL::PAYLOAD_TYPE_MULTI_PART)
+  {
+    getInfo(bufferHandle, GenTL::BUFFER_INFO_WIDTH, layout.mWidth);
+    return;
+  }
+
+  CC(mTl, mTl->DSGetNumBufferParts(mDataStreamHandle,
+                                   bufferHandle,
+                                   &layout.mPartCount));
+  if (layout.mPartCount > BufferDescriptor::MAX_PARTS)
+  {
+    throw std::runtime_error("Too many parts in buffer");
+  }
+  for (uint32_t i = 0; i < layout.mPartCount; ++i)
+  {
+    BufferPartDescriptor& part = layout.mParts[i];
+    getPartInfo(bufferHandle, i, GenTL::BUFFER_PART_INFO_DATA_TYPE,
+                part.mDataType);
+    getPartInfo(bufferHandle, i, GenTL::BUFFER_PART_INFO_DATA_FORMAT,
+                part.mDataFormat);
+    getPartInfo(bufferHandle, i, GenTL::BUFFER_PART_INFO_WIDTH, part.mWidth);
+  }
+}
+
+BufferDescriptorReader::BufferMemory
+BufferDescriptorReader::readMemory(GenTL::BUFFER_HANDLE bufferHandle)
+{
+  BufferMemory memory;
+  getInfo(bufferHandle, GenTL::BUFFER_INFO_BASE, memory.mData);
+  getInfo(bufferHandle, GenTL::BUFFER_INFO_SIZE, memory.mSize);
+  return memory;
+}
+
+template<typename T>
+void BufferDescriptorReader::getInfo(GenTL::BUFFER_HANDLE bufferHandle,
+                                     GenTL::BUFFER_INFO_CMD command,
+                                     T& value)
+{
+  GenTL::INFO_DATATYPE infoType = GenTL::INFO_DATATYPE_UNKNOWN;
+  size_t infoSize = sizeof(value);
+  CC(mTl, mTl->DSGetBufferInfo(mDataStreamHandle, bufferHandle, command,
+                               &infoType, &value, &infoSize));
+}
+
+template<typename T>
+void BufferDescriptorReader::getPartInfo(GenTL::BUFFER_HANDLE bufferHandle,
+                                         uint32_t partNumber,
+                                         GenTL::BUFFER_PART_INFO_CMD command,
+                                         T& value)
+{
+  GenTL::INFO_DATATYPE infoType = GenTL::INFO_DATATYPE_UNKNOWN;
+  size_t infoSize = sizeof(value);
+  CC(mTl, mTl->DSGetBufferPartInfo(mDataStreamHandle, bufferHandle,
+                                   partNumber, command,
+                                   &infoType, &value, &infoSize));
+}
+
+}
@@ -0,0 +1,257 @@
+// Copyright 2018 SICK AG. All rights reserved.
+
+#include "BufferPool.h"
+
+#include <stdexcept>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace Sample
+{
+
+namespace
+{
+
+const size_t PAGE_SIZE_4K = 4096;
+const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+size_t roundUp(size_t size, size_t multiple)
+{
+  return (size + multiple - 1) / multiple * multiple;
+}
+
+#ifdef _WIN32
+
+/** Large pages can only be allocated with the privilege enabled, which it is
+    not by default even if the user holds it.
+*/
+bool enableLockMemoryPrivilege()
+{
+  HANDLE token;
+  if (!OpenProcessToken(GetCurrentProcess(),
+                        TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY,
+                        &token))
+  {
+    return false;
+  }
+  TOKEN_PRIVILEGES privileges;
+  privileges.PrivilegeCount = 1;
+  privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+  // AdjustTokenPrivileges succeeds even if the privilege is not held, which
+  // is only told by the last error
+  bool enabled = LookupPrivilegeValueA(nullptr,
+                                       "SeLockMemoryPrivilege",
+                                       &privileges.Privileges[0].Luid)
+    && AdjustTokenPrivileges(token, FALSE, &privileges, 0, nullptr, nullptr)
+    && GetLastError() == ERROR_SUCCESS;
+  CloseHandle(token);
+  return enabled;
+}
+
+uint8_t* allocatePages(size_t size, DWORD flags, int numaNode)
+{
+  void* region = numaNode >= 0
+    ? VirtualAllocExNuma(GetCurrentProcess(), nullptr, size, flags,
+                         PAGE_READWRITE, static_cast<DWORD>(numaNode))
+    : VirtualAlloc(nullptr, size, flags, PAGE_READWRITE);
+  return static_cast<uint8_t*>(region);
+}
+
+#else
+
+/** Prefers the node for the pages of the region, using the system call
+    directly to avoid a dependency on libnuma.
+*/
+void preferNumaNode(uint8_t* region, size_t size, int numaNode)
+{
+  const int MPOL_PREFERRED_MODE = 1;
+  const size_t bitsPerWord = 8 * sizeof(unsigned long);
+  // One spare word, the kernel ignores the last bit of the mask
+  std::vector<unsigned long> mask(numaNode / bitsPerWord + 2, 0);
+  mask[numaNode / bitsPerWord] = 1UL << (numaNode % bitsPerWord);
+  // Failing leaves the default policy, which is still usable memory
+  syscall(SYS_mbind, region, size, MPOL_PREFERRED_MODE, mask.data(),
+          mask.size() * bitsPerWord, 0);
+}
+
+#endif
+
+}
+
+BufferPool::BufferPool(size_t bufferCount,
+                       size_t bufferSize,
+                       const Options& options)
+  : mBufferCount(bufferCount)
+  , mBufferSize(bufferSize)
+  , mStride(0)
+  , mRegion(nullptr)
+  , mRegionSize(0)
+  , mHugePages(false)
+  , mLocked(false)
+{
+  if (options.alignment == 0
+      || (options.alignment & (options.alignment - 1)) != 0
+      || options.alignment > PAGE_SIZE_4K)
+  {
+    throw std::invalid_argument(
+      "Buffer alignment must be a power of two, at most 4096");
+  }
+  if (bufferCount == 0 || bufferSize == 0)
+  {
+    throw std::invalid_argument("Buffer pool must not be empty");
+  }
+  mStride = roundUp(bufferSize, options.alignment);
+
+  allocate(options);
+  // The node policy applies when a page is first touched, so this must come
+  // after the allocation
+  preFault();
+  if (options.lockMemory)
+  {
+    lock();
+  }
+}
+
+BufferPool::~BufferPool()
+{
+  release();
+}
+
+uint8_t* BufferPool::buffer(size_t index) const
+{
+  return mRegion + index * mStride;
+}
+
+void BufferPool::preFault()
+{
+  // Writing a byte per page makes the system map all of them
+  volatile uint8_t* region = mRegion;
+  for (size_t offset = 0; offset < mRegionSize; offset += PAGE_SIZE_4K)
+  {
+    region[offset] = 0;
+  }
+}
+
+#ifdef _WIN32
+
+void BufferPool::allocate(const Options& options)
+{
+  const size_t totalSize = mStride * mBufferCount;
+  if (options.hugePages)
+  {
+    const size_t largePageSize = GetLargePageMinimum();
+    if (largePageSize != 0 && enableLockMemoryPrivilege())
+    {
+      mRegionSize = roundUp(totalSize, largePageSize);
+      mRegion = allocatePages(mRegionSize,
+                              MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES,
+                              options.numaNode);
+      // Large pages are never paged out
+      mHugePages = mRegion != nullptr;
+      mLocked = mHugePages;
+    }
+  }
+  if (mRegion == nullptr)
+  {
+    mRegionSize = roundUp(totalSize, PAGE_SIZE_4K);
+    mRegion = allocatePages(mRegionSize, MEM_RESERVE | MEM_COMMIT,
+                            options.numaNode);
+  }
+  if (mRegion == nullptr)
+  {
+    throw std::runtime_error("Could not allocate memory for buffers");
+  }
+}
+
+void BufferPool::lock()
+{
+  if (mLocked)
+  {
+    return;
+  }
+  // Locked pages count against the working set, which is too small for
+  // acquisition buffers by default
+  SIZE_T minimumSize;
+  SIZE_T maximumSize;
+  if (GetProcessWorkingSetSize(GetCurrentProcess(), &minimumSize,
+                               &maximumSize))
+  {
+    SetProcessWorkingSetSize(GetCurrentProcess(),
+                             minimumSize + mRegionSize,
+                             maximumSize + mRegionSize);
+  }
+  mLocked = VirtualLock(mRegion, mRegionSize) != FALSE;
+}
+
+void BufferPool::release()
+{
+  if (mRegion != nullptr)
+  {
+    VirtualFree(mRegion, 0, MEM_RELEASE);
+    mRegion = nullptr;
+  }
+}
+
+#else
+
+void BufferPool::allocate(const Options& options)
+{
+  const size_t totalSize = mStride * mBufferCount;
+  void* region = MAP_FAILED;
+  if (options.hugePages)
+  {
+    mRegionSize = roundUp(totalSize, HUGE_PAGE_SIZE);
+    region = mmap(nullptr, mRegionSize, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    mHugePages = region != MAP_FAILED;
+  }
+  if (region == MAP_FAILED)
+  {
+    mRegionSize = roundUp(totalSize, PAGE_SIZE_4K);
+    region = mmap(nullptr, mRegionSize, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (region == MAP_FAILED)
+    {
+      throw std::runtime_error("Could not allocate memory for buffers");
+    }
+    if (options.hugePages)
+    {
+      // No huge pages reserved, ask for transparent huge pages instead
+      mHugePages = madvise(region, mRegionSize, MADV_HUGEPAGE) == 0;
+    }
+  }
+  mRegion = static_cast<uint8_t*>(region);
+  if (options.numaNode >= 0)
+  {
+    preferNumaNode(mRegion, mRegionSize, options.numaNode);
+  }
+}
+
+void BufferPool::lock()
+{
+  // Limited by RLIMIT_MEMLOCK for unprivileged users
+  mLocked = mlock(mRegion, mRegionSize) == 0;
+}
+
+void BufferPool::release()
+{
+  if (mRegion != nullptr)
+  {
+    munmap(mRegion, mRegionSize);
+    mRegion = nullptr;
+  }
+}
+
+#endif
+
+}
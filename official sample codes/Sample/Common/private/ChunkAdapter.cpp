@@ -2,14 +2,140 @@
 
 #include "ChunkAdapter.h"
 
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+
 namespace Sample
 {
 
+namespace
+{
+
+// Each GigE Vision chunk is followed by a trailer with its id and length,
+// both big endian, so the chunks are found from the end of the payload
+const size_t CHUNK_TRAILER_SIZE = 8;
+
+uint32_t readBigEndian32(const uint8_t* data)
+{
+  return static_cast<uint32_t>(data[0]) << 24
+    | static_cast<uint32_t>(data[1]) << 16
+    | static_cast<uint32_t>(data[2]) << 8
+    | static_cast<uint32_t>(data[3]);
+}
+
+bool getProperty(GenApi::INode* node,
+                 const char* name,
+                 GenICam::gcstring& value)
+{
+  GenICam::gcstring attribute;
+  return node->GetProperty(name, value, attribute) && !value.empty();
+}
+
+/** The register a feature reads its value from, the feature itself or the
+    node its pValue refers to.
+*/
+GenApi::INode* findRegister(GenApi::INodeMap* nodeMap, GenApi::INode* node)
+{
+  if (GenApi::CRegisterPtr(node).IsValid())
+  {
+    return node;
+  }
+  GenICam::gcstring valueName;
+  if (!getProperty(node, "pValue", valueName))
+  {
+    return nullptr;
+  }
+  GenApi::INode* valueNode = nodeMap->GetNode(valueName);
+  if (valueNode == nullptr || !GenApi::CRegisterPtr(valueNode).IsValid())
+  {
+    return nullptr;
+  }
+  return valueNode;
+}
+
+inline int64_t decodeValue(const uint8_t* data,
+                           size_t length,
+                           bool bigEndian,
+                           bool isSigned,
+                           unsigned lsb,
+                           unsigned msb)
+{
+  uint64_t raw = 0;
+  if (bigEndian)
+  {
+    for (size_t i = 0; i < length; ++i)
+    {
+      raw = raw << 8 | data[i];
+    }
+  }
+  else
+  {
+    for (size_t i = length; i > 0; --i)
+    {
+      raw = raw << 8 | data[i - 1];
+    }
+  }
+  const unsigned width = msb - lsb + 1;
+  uint64_t value = raw >> lsb;
+  if (width < 64)
+  {
+    value &= (uint64_t(1) << width) - 1;
+    if (isSigned && (value >> (width - 1)) != 0)
+    {
+      value |= ~uint64_t(0) << width;
+    }
+  }
+  return static_cast<int64_t>(value);
+}
+
+}
+
+void LineMetadata::resize(size_t lineCount)
+{
+  mTimestamp.resize(lineCount);
+  mEncoderValue.resize(lineCount);
+  mOvertriggerCount.resize(lineCount);
+  mEncoderA.resize(lineCount);
+  mEncoderB.resize(lineCount);
+  mFrameTriggerActive.resize(lineCount);
+}
+
+ChunkAdapter::Field::Field()
+  : mValid(false)
+  , mOffset(0)
+  , mStride(0)
+  , mLength(0)
+  , mBigEndian(false)
+  , mSigned(false)
+  , mLsb(0)
+  , mMsb(0)
+  , mOnValue(1)
+{
+  // Empty
+}
+
+ChunkAdapter::Layout::Layout()
+  : mValid(false)
+  , mChunkPayloadSize(0)
+  , mChunkOffset(0)
+  , mChunkLength(0)
+  , mFirstLine(0)
+  , mLineCount(0)
+{
+  // Empty
+}
+
 ChunkAdapter::ChunkAdapter(GenTLApi* tl,
                            GenTL::DS_HANDLE dataStreamHandle)
   : mTl(tl)
   , mDataStreamHandle(dataStreamHandle)
   , mAdapter(new GenApi::CChunkAdapterGEV())
+  , mNodeMap(nullptr)
+  , mBuffer(nullptr)
+  , mAdapterAttached(false)
+  , mLayoutLocked(false)
+  , mValidatedPayloadSize(0)
 {
   // Empty
 }
@@ -17,47 +143,454 @@ ChunkAdapter::ChunkAdapter(GenTLApi* tl,
 void ChunkAdapter::attachNodeMap(GenApi::INodeMap* nodeMap)
 {
   mAdapter->AttachNodeMap(nodeMap);
+  mNodeMap = nodeMap;
+  mLayout = Layout();
+
+  mScanLineSelector = nodeMap->GetNode("ChunkScanLineSelector");
+  mEncoderValue = nodeMap->GetNode("ChunkEncoderValue");
+  mTimestamp = nodeMap->GetNode("ChunkTimestamp");
+  mOvertriggerCount = nodeMap->GetNode("ChunkOvertriggerCount");
+  mEncoderA = nodeMap->GetNode("ChunkEncoderA");
+  mEncoderB = nodeMap->GetNode("ChunkEncoderB");
+  mFrameTriggerActive = nodeMap->GetNode("ChunkFrameTriggerActive");
 }
 
 void ChunkAdapter::detachNodeMap()
 {
+  if (mAdapterAttached)
+  {
+    mAdapter->DetachBuffer();
+    mAdapterAttached = false;
+  }
+  mBuffer = nullptr;
+  mValidatedPayloadSize = 0;
   mAdapter->DetachNodeMap();
+  mNodeMap = nullptr;
+  mLayout = Layout();
+
+  mScanLineSelector.Release();
+  mEncoderValue.Release();
+  mTimestamp.Release();
+  mOvertriggerCount.Release();
+  mEncoderA.Release();
+  mEncoderB.Release();
+  mFrameTriggerActive.Release();
 }
 
 void ChunkAdapter::attachBuffer(GenTL::BUFFER_HANDLE handle,
                                 uint8_t* buffer)
 {
-  GenApi::AttachStatistics_t statistics;
   size_t chunkPayloadSize = getChunkPayloadSize(handle);
+  if (mLayoutLocked && mAdapterAttached
+      && chunkPayloadSize == mValidatedPayloadSize)
+  {
+    // Same layout as the validated buffer, only the address differs
+    mAdapter->UpdateBuffer(buffer);
+    mBuffer = buffer;
+    return;
+  }
+
+  if (mAdapterAttached)
+  {
+    mAdapter->DetachBuffer();
+    mAdapterAttached = false;
+  }
+  mBuffer = nullptr;
+  mValidatedPayloadSize = 0;
+
+  GenApi::AttachStatistics_t statistics;
   if (!mAdapter->CheckBufferLayout(buffer, chunkPayloadSize))
   {
-    throw std::exception("Buffer has unknown chunk layout");
+    throw std::runtime_error("Buffer has unknown chunk layout");
   }
   mAdapter->AttachBuffer(buffer, chunkPayloadSize, &statistics);
+  mAdapterAttached = true;
 
   // Ranger3 uses a single chunk port for all metadata.
   if (statistics.NumChunkPorts != 1)
   {
-    throw std::exception("A single chunk port was expected");
+    throw std::runtime_error("A single chunk port was expected");
   }
 
   // There should be one chunk for the metadata port and one for
   // wrapping the image data.
   if (statistics.NumChunks != 2)
   {
-    throw std::exception("Two chunks were expected");
+    throw std::runtime_error("Two chunks were expected");
   }
 
   // Only the metadata chunk should be attached.
   if (statistics.NumAttachedChunks != 1)
   {
-    throw std::exception("A single attached chunk was expected");
+    throw std::runtime_error("A single attached chunk was expected");
+  }
+
+  mBuffer = buffer;
+  if (mScanLineSelector.IsValid()
+      && chunkPayloadSize != mLayout.mChunkPayloadSize)
+  {
+    learnLayout(buffer, chunkPayloadSize);
+  }
+  if (mLayoutLocked)
+  {
+    mValidatedPayloadSize = chunkPayloadSize;
   }
 }
 
 void ChunkAdapter::detachBuffer()
 {
-  mAdapter->DetachBuffer();
+  mBuffer = nullptr;
+  if (!mLayoutLocked && mAdapterAttached)
+  {
+    mAdapter->DetachBuffer();
+    mAdapterAttached = false;
+  }
+}
+
+void ChunkAdapter::lockLayout()
+{
+  mLayoutLocked = true;
+  mValidatedPayloadSize = 0;
+}
+
+void ChunkAdapter::unlockLayout()
+{
+  mLayoutLocked = false;
+  mValidatedPayloadSize = 0;
+  if (mAdapterAttached && mBuffer == nullptr)
+  {
+    mAdapter->DetachBuffer();
+    mAdapterAttached = false;
+  }
+}
+
+void ChunkAdapter::readLineMarks(GenIRanger::LineMarks& marks,
+                                 uint32_t scanId)
+{
+  readLineMetadata(mMetadata);
+  const size_t lineCount = mMetadata.lineCount();
+  marks.resize(lineCount);
+
+  // Fill the marks in place, they are then saved as one block
+  GenIRanger::LineMark* mark = marks.data();
+  for (size_t line = 0; line < lineCount; ++line, ++mark)
+  {
+    GenIRanger::Metadata status =
+      (mMetadata.mOvertriggerCount[line] & 0xff) << 16;
+    if (mMetadata.mEncoderB[line])
+    {
+      status |= 1u << 27;
+    }
+    if (mMetadata.mEncoderA[line])
+    {
+      status |= 1u << 28;
+    }
+    if (mMetadata.mFrameTriggerActive[line])
+    {
+      status |= 1u << 30;
+    }
+
+    mark->encoderValue =
+      static_cast<GenIRanger::Metadata>(mMetadata.mEncoderValue[line]);
+    mark->status = status;
+    mark->sampleTimestamp =
+      static_cast<GenIRanger::Metadata>(mMetadata.mTimestamp[line]);
+    // Ranger3 has no separate encoder pulse time stamp
+    mark->encoderTimestamp = 0;
+    mark->scanId = scanId;
+  }
+}
+
+void ChunkAdapter::readLineMetadata(LineMetadata& metadata)
+{
+  if (!mLayout.mValid || mBuffer == nullptr)
+  {
+    readLineMetadataFromNodeMap(metadata);
+    return;
+  }
+
+  metadata.resize(mLayout.mLineCount);
+  const uint8_t* chunk = mBuffer + mLayout.mChunkOffset;
+  // One pass per field keeps each loop simple enough to be unrolled
+  decodeColumn(chunk, mLayout.mTimestamp, metadata.mTimestamp);
+  decodeColumn(chunk, mLayout.mEncoderValue, metadata.mEncoderValue);
+  decodeColumn(chunk, mLayout.mOvertriggerCount, metadata.mOvertriggerCount);
+  decodeFlags(chunk, mLayout.mEncoderA, metadata.mEncoderA);
+  decodeFlags(chunk, mLayout.mEncoderB, metadata.mEncoderB);
+  decodeFlags(chunk, mLayout.mFrameTriggerActive,
+              metadata.mFrameTriggerActive);
+}
+
+template<typename T>
+void ChunkAdapter::decodeColumn(const uint8_t* chunk,
+                                const Field& field,
+                                std::vector<T>& column)
+{
+  if (!field.mValid)
+  {
+    std::fill(column.begin(), column.end(), T(0));
+    return;
+  }
+  const uint8_t* data = chunk + field.mOffset;
+  for (size_t line = 0; line < column.size(); ++line, data += field.mStride)
+  {
+    column[line] = static_cast<T>(decodeValue(data, field.mLength,
+                                              field.mBigEndian, field.mSigned,
+                                              field.mLsb, field.mMsb));
+  }
+}
+
+void ChunkAdapter::decodeFlags(const uint8_t* chunk,
+                               const Field& field,
+                               std::vector<uint8_t>& column)
+{
+  if (!field.mValid)
+  {
+    std::fill(column.begin(), column.end(), uint8_t(0));
+    return;
+  }
+  const uint8_t* data = chunk + field.mOffset;
+  for (size_t line = 0; line < column.size(); ++line, data += field.mStride)
+  {
+    column[line] = decodeValue(data, field.mLength, field.mBigEndian,
+                               field.mSigned, field.mLsb, field.mMsb)
+      == field.mOnValue;
+  }
+}
+
+void ChunkAdapter::readLineMetadataFromNodeMap(LineMetadata& metadata)
+{
+  if (!mScanLineSelector.IsValid())
+  {
+    throw std::runtime_error("No node map with line chunk data attached");
+  }
+
+  const int64_t firstLine = mScanLineSelector->GetMin();
+  const int64_t lastLine = mScanLineSelector->GetMax();
+  metadata.resize(static_cast<size_t>(lastLine - firstLine + 1));
+  for (int64_t line = firstLine; line <= lastLine; ++line)
+  {
+    readLineFromNodeMap(line, metadata, static_cast<size_t>(line - firstLine));
+  }
+}
+
+void ChunkAdapter::readLineFromNodeMap(int64_t line,
+                                       LineMetadata& metadata,
+                                       size_t index)
+{
+  mScanLineSelector->SetValue(line);
+  metadata.mTimestamp[index] = mTimestamp.IsValid()
+    ? static_cast<uint64_t>(mTimestamp->GetValue()) : 0;
+  metadata.mEncoderValue[index] = mEncoderValue.IsValid()
+    ? mEncoderValue->GetValue() : 0;
+  metadata.mOvertriggerCount[index] = mOvertriggerCount.IsValid()
+    ? static_cast<uint32_t>(mOvertriggerCount->GetValue()) : 0;
+  metadata.mEncoderA[index] = mEncoderA.IsValid() && mEncoderA->GetValue();
+  metadata.mEncoderB[index] = mEncoderB.IsValid() && mEncoderB->GetValue();
+  metadata.mFrameTriggerActive[index] =
+    mFrameTriggerActive.IsValid() && mFrameTriggerActive->GetValue();
+}
+
+/**
+   Learn where the metadata chunk is in a buffer and where each chunk
+   feature is in it. The node map knows the address of a feature in the chunk
+   for the selected line, so selecting two lines gives the offset and the
+   stride. The layout is only used if it decodes the same values as the node
+   map for this buffer.
+*/
+void ChunkAdapter::learnLayout(const uint8_t* buffer, size_t chunkPayloadSize)
+{
+  mLayout = Layout();
+  mLayout.mChunkPayloadSize = chunkPayloadSize;
+
+  if (!findMetadataChunk(buffer, chunkPayloadSize))
+  {
+    return;
+  }
+
+  mLayout.mFirstLine = mScanLineSelector->GetMin();
+  mLayout.mLineCount = static_cast<size_t>(
+    mScanLineSelector->GetMax() - mLayout.mFirstLine + 1);
+
+  const int64_t selectedLine = mScanLineSelector->GetValue();
+  const bool learned =
+    learnField(mTimestamp, false, mLayout.mTimestamp)
+    && learnField(mEncoderValue, false, mLayout.mEncoderValue)
+    && learnField(mOvertriggerCount, false, mLayout.mOvertriggerCount)
+    && learnField(mEncoderA, true, mLayout.mEncoderA)
+    && learnField(mEncoderB, true, mLayout.mEncoderB)
+    && learnField(mFrameTriggerActive, true, mLayout.mFrameTriggerActive);
+  mScanLineSelector->SetValue(selectedLine);
+
+  mLayout.mValid = learned && validateLayout();
+}
+
+bool ChunkAdapter::findMetadataChunk(const uint8_t* buffer,
+                                     size_t chunkPayloadSize)
+{
+  // The chunk id is a property of the chunk port the features are read from
+  GenApi::INode* feature = mTimestamp.IsValid()
+    ? mTimestamp->GetNode()
+    : mScanLineSelector->GetNode();
+  GenApi::INode* registerNode = findRegister(mNodeMap, feature);
+  GenICam::gcstring portName;
+  GenICam::gcstring chunkIdString;
+  if (registerNode == nullptr
+      || !getProperty(registerNode, "pPort", portName)
+      || mNodeMap->GetNode(portName) == nullptr
+      || !getProperty(mNodeMap->GetNode(portName), "ChunkID", chunkIdString))
+  {
+    return false;
+  }
+  const uint32_t chunkId =
+    static_cast<uint32_t>(std::strtoul(chunkIdString.c_str(), nullptr, 16));
+
+  size_t end = chunkPayloadSize;
+  while (end >= CHUNK_TRAILER_SIZE)
+  {
+    const uint32_t id = readBigEndian32(buffer + end - 8);
+    const size_t length = readBigEndian32(buffer + end - 4);
+    if (length > end - CHUNK_TRAILER_SIZE)
+    {
+      return false;
+    }
+    const size_t start = end - CHUNK_TRAILER_SIZE - length;
+    if (id == chunkId)
+    {
+      mLayout.mChunkOffset = start;
+      mLayout.mChunkLength = length;
+      return true;
+    }
+    end = start;
+  }
+  return false;
+}
+
+/**
+   Learn where a chunk feature is found, given that the first line is
+   selected. A feature missing from the node map is skipped, a feature that
+   is not a plain register of at most 64 bits cannot be decoded.
+*/
+bool ChunkAdapter::learnField(GenApi::IValue* value,
+                              bool isBoolean,
+                              Field& field)
+{
+  field = Field();
+  if (value == nullptr)
+  {
+    return true;
+  }
+  GenApi::INode* feature = value->GetNode();
+  GenApi::INode* registerNode = findRegister(mNodeMap, feature);
+  if (registerNode == nullptr)
+  {
+    return false;
+  }
+  GenApi::CRegisterPtr reg(registerNode);
+  const int64_t length = reg->GetLength();
+  if (length < 1 || length > 8)
+  {
+    return false;
+  }
+  field.mLength = static_cast<size_t>(length);
+
+  mScanLineSelector->SetValue(mLayout.mFirstLine);
+  const int64_t firstAddress = reg->GetAddress();
+  int64_t secondAddress = firstAddress;
+  if (mLayout.mLineCount > 1)
+  {
+    mScanLineSelector->SetValue(mLayout.mFirstLine + 1);
+    secondAddress = reg->GetAddress();
+  }
+  if (firstAddress < 0 || secondAddress < firstAddress)
+  {
+    return false;
+  }
+  field.mOffset = static_cast<size_t>(firstAddress);
+  field.mStride = static_cast<size_t>(secondAddress - firstAddress);
+  const size_t lastEnd = field.mOffset
+    + (mLayout.mLineCount - 1) * field.mStride + field.mLength;
+  if (lastEnd > mLayout.mChunkLength)
+  {
+    return false;
+  }
+
+  GenICam::gcstring property;
+  field.mBigEndian = getProperty(registerNode, "Endianess", property)
+    && property == "BigEndian";
+  field.mSigned = getProperty(registerNode, "Sign", property)
+    && property == "Signed";
+
+  // Masked registers number their bits from the msb when big endian
+  const unsigned width = static_cast<unsigned>(field.mLength * 8);
+  unsigned lsb = 0;
+  unsigned msb = width - 1;
+  GenICam::gcstring msbValue;
+  bool masked = true;
+  if (getProperty(registerNode, "Bit", property))
+  {
+    lsb = static_cast<unsigned>(std::strtoul(property.c_str(), nullptr, 10));
+    msb = lsb;
+  }
+  else if (getProperty(registerNode, "LSB", property)
+           && getProperty(registerNode, "MSB", msbValue))
+  {
+    lsb = static_cast<unsigned>(std::strtoul(property.c_str(), nullptr, 10));
+    msb = static_cast<unsigned>(std::strtoul(msbValue.c_str(), nullptr, 10));
+  }
+  else
+  {
+    masked = false;
+  }
+  if (lsb >= width || msb >= width)
+  {
+    return false;
+  }
+  if (field.mBigEndian && masked)
+  {
+    lsb = width - 1 - lsb;
+    msb = width - 1 - msb;
+  }
+  field.mLsb = std::min(lsb, msb);
+  field.mMsb = std::max(lsb, msb);
+
+  if (isBoolean && getProperty(feature, "OnValue", property))
+  {
+    field.mOnValue = std::strtoll(property.c_str(), nullptr, 10);
+  }
+  field.mValid = true;
+  return true;
+}
+
+/** Compare the decoded first, middle and last line with the node map. */
+bool ChunkAdapter::validateLayout()
+{
+  mLayout.mValid = true;
+  LineMetadata direct;
+  readLineMetadata(direct);
+  mLayout.mValid = false;
+
+  LineMetadata reference;
+  reference.resize(mLayout.mLineCount);
+  const size_t lines[] = { 0, mLayout.mLineCount / 2, mLayout.mLineCount - 1 };
+  const int64_t selectedLine = mScanLineSelector->GetValue();
+  bool matches = true;
+  for (size_t i = 0; i < 3 && matches; ++i)
+  {
+    const size_t line = lines[i];
+    readLineFromNodeMap(mLayout.mFirstLine + static_cast<int64_t>(line),
+                        reference,
+                        line);
+    matches = direct.mTimestamp[line] == reference.mTimestamp[line]
+      && direct.mEncoderValue[line] == reference.mEncoderValue[line]
+      && direct.mOvertriggerCount[line] == reference.mOvertriggerCount[line]
+      && direct.mEncoderA[line] == reference.mEncoderA[line]
+      && direct.mEncoderB[line] == reference.mEncoderB[line]
+      && direct.mFrameTriggerActive[line]
+         == reference.mFrameTriggerActive[line];
+  }
+  mScanLineSelector->SetValue(selectedLine);
+  return matches;
 }
 
 /**
@@ -2,6 +2,7 @@
 
 #include "Consumer.h"
 
+#include <cstdlib>
 #include <iostream>
 #include <memory>
 #include <sstream>
@@ -24,9 +25,9 @@ LocalUrl parseLocalUrl(const std::string &url)
   char *endptr_addr, *endptr_len;
   LocalUrl localUrl;
   localUrl.filename = tokens[0];
-  localUrl.address = _strtoui64(tokens[1].c_str(), &endptr_addr, 16);
-  localUrl.length = static_cast<size_t>(_strtoui64(tokens[2].c_str(),
-                                                   &endptr_len, 16));
+  localUrl.address = std::strtoull(tokens[1].c_str(), &endptr_addr, 16);
+  localUrl.length = static_cast<size_t>(std::strtoull(tokens[2].c_str(),
+                                                     &endptr_len, 16));
   return localUrl;
 }
 
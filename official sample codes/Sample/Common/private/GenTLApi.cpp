@@ -13,27 +13,41 @@ GenTLApi::GenTLApi(HMODULE module) : mModule(module)
 
 GenTLApi::~GenTLApi()
 {
+#ifdef _WIN32
   FreeLibrary(mModule);
+#else
+  dlclose(mModule);
+#endif
 }
 
 std::unique_ptr<GenTLApi> loadProducer(std::string ctiFile)
 {
+#ifdef _WIN32
   HMODULE module = LoadLibrary(ctiFile.c_str());
+#else
+  HMODULE module = dlopen(ctiFile.c_str(), RTLD_NOW | RTLD_LOCAL);
+#endif
   if (module == nullptr)
   {
     std::stringstream sstr;
     sstr << "Could not load: " << ctiFile;
     std::string errorMessage(sstr.str());
     std::cerr << errorMessage << std::endl;
-    throw std::exception(errorMessage.c_str());
+    throw std::runtime_error(errorMessage);
   }
   std::unique_ptr<GenTLApi> tl(new GenTLApi(module));
 
+#ifdef _WIN32
+#define GET_PROC_ADDRESS GetProcAddress
+#else
+#define GET_PROC_ADDRESS dlsym
+#endif
 #define LOAD_PROC_ADDRESS(func) \
-    tl->func = (GenTL::P##func) GetProcAddress(module, #func); \
+    tl->func = (GenTL::P##func) GET_PROC_ADDRESS(module, #func); \
     assert(tl->func);
 
   API_LIST(LOAD_PROC_ADDRESS)
 #undef LOAD_PROC_ADDRESS
+#undef GET_PROC_ADDRESS
     return tl;
 }
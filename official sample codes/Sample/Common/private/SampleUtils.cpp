@@ -11,6 +11,7 @@
 #include <cctype>
 #include <conio.h>
 #include <cstdio>
+#include <cstdlib>
 #include <ctime>
 #include <fstream>
 #include <string>
@@ -29,6 +30,13 @@ bool fileExists(const std::string& pathToFile)
 
 std::string getPathToProducer()
 {
+  // E.g., the simulated producer, for running without a camera
+  const char* producer = std::getenv("SICK_GENTL_PRODUCER");
+  if (producer != nullptr && *producer != '\0')
+  {
+    return producer;
+  }
+
   char pathToExe[FILENAME_MAX];
 
   // First we want to verify that the user has placed the .cti-file in the same
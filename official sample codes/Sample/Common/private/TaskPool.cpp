@@ -0,0 +1,240 @@
+// Copyright 2018 SICK AG. All rights reserved.
+
+#include "TaskPool.h"
+
+namespace Sample
+{
+
+TaskPool::TaskPool(size_t threadCount)
+  : mNextHome(0)
+  , mQueuedTasks(0)
+  , mUnfinishedTasks(0)
+  , mSleepingWorkers(0)
+  , mStopping(false)
+  , mTasksExecuted(0)
+  , mTasksStolen(0)
+  , mTasksFailed(0)
+{
+  if (threadCount == 0)
+  {
+    threadCount = std::thread::hardware_concurrency();
+  }
+  if (threadCount == 0)
+  {
+    threadCount = 1;
+  }
+  for (size_t i = 0; i < threadCount; ++i)
+  {
+    mQueues.push_back(std::unique_ptr<WorkerQueue>(new WorkerQueue()));
+  }
+  // All queues must exist before a worker may steal from them
+  for (size_t i = 0; i < threadCount; ++i)
+  {
+    mWorkers.push_back(std::thread(&TaskPool::workerLoop, this, i));
+  }
+}
+
+TaskPool::~TaskPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mWakeMutex);
+    mStopping = true;
+  }
+  mWake.notify_all();
+  for (size_t i = 0; i < mWorkers.size(); ++i)
+  {
+    mWorkers[i].join();
+  }
+}
+
+void TaskPool::submit(Task task)
+{
+  submitTo(nextHome(), task);
+}
+
+void TaskPool::waitIdle()
+{
+  std::unique_lock<std::mutex> lock(mWakeMutex);
+  mIdle.wait(lock, [this] { return mUnfinishedTasks == 0; });
+}
+
+TaskPool::Statistics TaskPool::statistics() const
+{
+  Statistics statistics;
+  statistics.mTasksExecuted = mTasksExecuted.load();
+  statistics.mTasksStolen = mTasksStolen.load();
+  statistics.mTasksFailed = mTasksFailed.load();
+  return statistics;
+}
+
+void TaskPool::submitTo(size_t home, Task task)
+{
+  ++mUnfinishedTasks;
+  // Counted before it is in the queue, so that the count never drops below
+  // zero when a worker takes the task at once
+  ++mQueuedTasks;
+  {
+    WorkerQueue& queue = *mQueues[home % mQueues.size()];
+    std::lock_guard<std::mutex> lock(queue.mMutex);
+    queue.mTasks.push_back(task);
+  }
+  // A worker counts itself as sleeping before it checks the queued tasks,
+  // so either it is seen here or it sees the task
+  if (mSleepingWorkers > 0)
+  {
+    std::lock_guard<std::mutex> lock(mWakeMutex);
+    mWake.notify_one();
+  }
+}
+
+size_t TaskPool::nextHome()
+{
+  return mNextHome++ % mQueues.size();
+}
+
+bool TaskPool::takeTask(size_t worker, Task& task)
+{
+  // The own queue first, then the others starting with the next one, so
+  // that the thieves spread over the busy queues
+  for (size_t i = 0; i < mQueues.size(); ++i)
+  {
+    WorkerQueue& queue = *mQueues[(worker + i) % mQueues.size()];
+    std::lock_guard<std::mutex> lock(queue.mMutex);
+    if (!queue.mTasks.empty())
+    {
+      task = std::move(queue.mTasks.front());
+      queue.mTasks.pop_front();
+      --mQueuedTasks;
+      if (i != 0)
+      {
+        ++mTasksStolen;
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+void TaskPool::workerLoop(size_t worker)
+{
+  for (;;)
+  {
+    Task task;
+    if (takeTask(worker, task))
+    {
+      try
+      {
+        task();
+      }
+      catch (...)
+      {
+        ++mTasksFailed;
+      }
+      ++mTasksExecuted;
+      finishTask();
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(mWakeMutex);
+    ++mSleepingWorkers;
+    mWake.wait(lock, [this] { return mQueuedTasks > 0 || mStopping; });
+    --mSleepingWorkers;
+    if (mStopping && mQueuedTasks == 0)
+    {
+      return;
+    }
+  }
+}
+
+void TaskPool::finishTask()
+{
+  if (--mUnfinishedTasks == 0)
+  {
+    std::lock_guard<std::mutex> lock(mWakeMutex);
+    mIdle.notify_all();
+  }
+}
+
+TaskSequence::TaskSequence(TaskPool& pool)
+  : mPool(pool)
+  , mHome(pool.nextHome())
+  , mNextTicket(0)
+  , mNextToComplete(0)
+  , mCompleting(false)
+{
+  // Empty
+}
+
+void TaskSequence::submit(TaskPool::Task work, TaskPool::Task completion)
+{
+  uint64_t ticket;
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    ticket = mNextTicket++;
+  }
+  mPool.submitTo(mHome, [this, ticket, work, completion]()
+  {
+    bool succeeded = true;
+    try
+    {
+      work();
+    }
+    catch (...)
+    {
+      ++mPool.mTasksFailed;
+      succeeded = false;
+    }
+    // Completing must happen even if the work failed, or the following jobs
+    // would wait forever
+    complete(ticket, succeeded ? completion : TaskPool::Task());
+  });
+}
+
+void TaskSequence::waitIdle()
+{
+  std::unique_lock<std::mutex> lock(mMutex);
+  mIdle.wait(lock, [this]
+  {
+    return mNextToComplete == mNextTicket && !mCompleting;
+  });
+}
+
+void TaskSequence::complete(uint64_t ticket, TaskPool::Task completion)
+{
+  std::unique_lock<std::mutex> lock(mMutex);
+  mWaiting[ticket] = completion;
+  if (mCompleting)
+  {
+    // The worker already completing runs this one too, when it is due
+    return;
+  }
+  mCompleting = true;
+  while (!mWaiting.empty() && mWaiting.begin()->first == mNextToComplete)
+  {
+    TaskPool::Task next = std::move(mWaiting.begin()->second);
+    mWaiting.erase(mWaiting.begin());
+    ++mNextToComplete;
+    lock.unlock();
+    if (next)
+    {
+      try
+      {
+        next();
+      }
+      catch (...)
+      {
+        ++mPool.mTasksFailed;
+      }
+    }
+    lock.lock();
+  }
+  mCompleting = false;
+  // Notified with the lock held, the sequence may be destroyed as soon as a
+  // waiting thread gets the lock
+  if (mNextToComplete == mNextTicket)
+  {
+    mIdle.notify_all();
+  }
+}
+
+}
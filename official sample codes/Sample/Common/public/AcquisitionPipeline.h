@@ -0,0 +1,253 @@
+// Copyright 2018 SICK AG. All rights reserved.
+
+#ifndef ACQUISITION_PIPELINE_H
+#define ACQUISITION_PIPELINE_H
+
+#include "Consumer.h"
+#include "StreamData.h"
+#include "TaskPool.h"
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Sample
+{
+
+/** A received buffer as seen by the stages of an AcquisitionPipeline. */
+struct AcquiredBuffer
+{
+  /** Index of the data stream, in the order they were added. */
+  size_t mStreamIndex;
+  GenTL::DS_HANDLE mDataStreamHandle;
+  GenTL::BUFFER_HANDLE mBufferHandle;
+  uint8_t* mData;
+  size_t mSizeFilled;
+  uint64_t mFrameId;
+  bool mIncomplete;
+
+  /** Free for the stages to fill in, e.g., a view of the buffer parts made by
+      one stage and saved by the next.
+  */
+  GenIRanger::RangeFrame mFrame;
+
+  /** Keeps the buffer from being re-queued until the returned token, and all
+      copies of it, are released. E.g., capture it in the release callback of
+      a GenIRanger::Component view of the buffer to re-queue the buffer when
+      an AsyncFrameWriter has written it.
+  */
+  std::shared_ptr<void> retain() const { return mRequeueToken; }
+
+  /** Set by the pipeline. */
+  std::shared_ptr<void> mRequeueToken;
+  std::chrono::steady_clock::time_point mReceiveTime;
+};
+
+/** Receives buffers from one or more data streams and processes them in a
+    number of stages on a TaskPool, which may be shared by several pipelines.
+
+    Each data stream has a receive thread, which only waits for new buffer
+    events and submits the buffers to the pool, as jobs of a TaskSequence of
+    the data stream. A worker fetches the buffer info and runs the stages
+    added with addStage() in order. Different buffers are processed at the
+    same time on different workers, so these stages must be thread safe and
+    buffers may finish them out of order. The throughput is then limited by
+    the slowest stage divided by the number of workers, rather than the sum
+    of all stages.
+
+    The stages added with addOrderedStage() run after the other stages, one
+    buffer at a time per data stream, in the order the buffers were received.
+    E.g., the buffers of a camera are unpacked and their chunks parsed in
+    parallel, but saved in order.
+
+    A buffer is re-queued to the producer as soon as the last stage has
+    returned and every token from AcquiredBuffer::retain() is released.
+
+    If the workers cannot keep up, the received buffers wait in the pool and
+    the BackpressurePolicy decides what happens with a received buffer when
+    too many are waiting.
+
+    Usage:
+      1. Announce and queue buffers, add the data streams and stages.
+      2. start(), then start the acquisition on the devices.
+      3. Stop the acquisition on the devices, then stop().
+*/
+class AcquisitionPipeline
+{
+public:
+  /** What a receive thread does with a buffer when queueCapacity buffers
+      are waiting for a worker.
+  */
+  enum class BackpressurePolicy
+  {
+    /** Wait for room in the queue. The producer runs out of buffers and
+        drops data itself if this goes on for too long.
+    */
+    Block,
+    /** Re-queue the oldest waiting buffer without processing it. */
+    DropOldest,
+    /** Re-queue the received buffer without processing it. */
+    DropNewest
+  };
+
+  /** A processing stage. Returns false to skip the remaining stages for the
+      buffer, including the ordered ones. Exceptions are counted as errors and
+      skip the remaining stages.
+  */
+  typedef std::function<bool(AcquiredBuffer& buffer)> Stage;
+
+  struct Options
+  {
+    Options()
+      : queueCapacity(16)
+      , policy(BackpressurePolicy::Block)
+      , eventTimeoutMs(100)
+    {
+    }
+
+    /** Buffers received but not yet picked up by a worker. */
+    size_t queueCapacity;
+    BackpressurePolicy policy;
+    /** How often the receive threads check for stop(). */
+    uint64_t eventTimeoutMs;
+  };
+
+  /** Latency of one stage, in microseconds. */
+  struct StageStatistics
+  {
+    std::string mName;
+    uint64_t mCount;
+    uint64_t mTotalUs;
+    uint64_t mMaxUs;
+  };
+
+  struct Statistics
+  {
+    uint64_t mBuffersReceived;
+    uint64_t mBuffersProcessed;
+    uint64_t mBuffersDropped;
+    uint64_t mStageErrors;
+    /** From the new buffer event until a worker picks up the buffer. */
+    StageStatistics mQueueWait;
+    std::vector<StageStatistics> mStages;
+  };
+
+  /** \param pool Runs the stages, it must outlive the pipeline */
+  AcquisitionPipeline(Consumer& consumer,
+                      TaskPool& pool,
+                      const Options& options = Options());
+
+  /** Calls stop(). */
+  ~AcquisitionPipeline();
+
+  /** Registers a new buffer event on the data stream. Only before start().
+      \return The stream index passed to the stages
+  */
+  size_t addDataStream(GenTL::DS_HANDLE dataStreamHandle);
+
+  /** Adds a stage run after the stages added before. Only before start(). */
+  void addStage(const std::string& name, Stage stage);
+
+  /** Adds a stage run in the order the buffers of a data stream were
+      received, after all stages added with addStage(). Only before start().
+  */
+  void addOrderedStage(const std::string& name, Stage stage);
+
+  /** Starts the receive threads. */
+  void start();
+
+  /** Stops receiving, waits for the workers to process the received buffers
+      and unregisters the events. Buffers retained by stages are re-queued
+      when released, which may be after stop() has returned.
+  */
+  void stop();
+
+  Statistics statistics() const;
+
+private:
+  AcquisitionPipeline(const AcquisitionPipeline&);
+  AcquisitionPipeline& operator=(const AcquisitionPipeline&);
+
+  struct Received
+  {
+    size_t mStreamIndex;
+    GenTL::BUFFER_HANDLE mBufferHandle;
+    std::chrono::steady_clock::time_point mReceiveTime;
+  };
+
+  struct DataStream
+  {
+    GenTL::DS_HANDLE mHandle;
+    GenTL::EVENT_HANDLE mNewBufferEvent;
+    std::shared_ptr<TaskSequence> mSequence;
+  };
+
+  /** A received buffer submitted to the pool. */
+  struct Job
+  {
+    Received mReceived;
+    /** Set by the worker that starts the job, or when it is dropped. */
+    std::atomic<bool> mTaken;
+    AcquiredBuffer mBuffer;
+    /** The buffer info has been fetched. */
+    bool mStarted;
+    /** No stage has skipped the remaining ones. */
+    bool mProceed;
+  };
+
+  class LatencyCounter
+  {
+  public:
+    LatencyCounter();
+    void add(std::chrono::steady_clock::duration latency);
+    StageStatistics read(const std::string& name) const;
+
+  private:
+    std::atomic<uint64_t> mCount;
+    std::atomic<uint64_t> mTotalUs;
+    std::atomic<uint64_t> mMaxUs;
+  };
+
+  void receiveLoop(size_t streamIndex);
+  void handOver(const Received& received);
+  void dropOldest();
+  bool take(Job& job);
+  void process(Job& job);
+  void complete(Job& job);
+  bool runStages(AcquiredBuffer& buffer, bool ordered);
+  void requeue(size_t streamIndex, GenTL::BUFFER_HANDLE bufferHandle);
+
+private:
+  GenTLApi* mTl;
+  TaskPool& mPool;
+  const Options mOptions;
+  std::vector<DataStream> mDataStreams;
+  std::vector<std::string> mStageNames;
+  std::vector<Stage> mStages;
+  std::vector<bool> mStageOrdered;
+
+  std::vector<std::thread> mReceiveThreads;
+  std::atomic<bool> mStopReceiving;
+
+  // Jobs not yet taken by a worker. Only kept in order for DropOldest.
+  std::atomic<size_t> mWaitingJobCount;
+  std::mutex mWaitingJobsMutex;
+  std::deque<std::shared_ptr<Job>> mWaitingJobs;
+
+  std::atomic<uint64_t> mBuffersReceived;
+  std::atomic<uint64_t> mBuffersProcessed;
+  std::atomic<uint64_t> mBuffersDropped;
+  std::atomic<uint64_t> mStageErrors;
+  LatencyCounter mQueueWait;
+  std::vector<std::unique_ptr<LatencyCounter>> mStageLatency;
+};
+
+}
+
+#endif
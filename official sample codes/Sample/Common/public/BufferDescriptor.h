@@ -0,0 +1,120 @@
+// Copyright 2018 SICK AG. All rights reserved.
+
+#ifndef BUFFER_DESCRIPTOR_H
+#define BUFFER_DESCRIPTOR_H
+
+#include "GenTLApi.h"
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+
+namespace Sample
+{
+
+/** The info of one part of a multi-part buffer. */
+struct BufferPartDescriptor
+{
+  uint8_t* mData;
+  size_t mDataSize;
+  /** GenTL::PART_DATATYPE_LIST */
+  size_t mDataType;
+  /** Pixel format, PFNC value */
+  uint64_t mDataFormat;
+  size_t mWidth;
+  size_t mHeight;
+};
+
+/** The info of a received buffer commonly used when processing it. Fixed
+    size and cheap to copy, so it can be handed over between threads with
+    the buffer handle.
+*/
+struct BufferDescriptor
+{
+  /** Ranger3 sends at most range, reflectance and scatter. */
+  static const uint32_t MAX_PARTS = 4;
+
+  GenTL::BUFFER_HANDLE mHandle;
+  uint8_t* mData;
+  /** Size of the announced memory. */
+  size_t mBufferSize;
+  /** Size of the data intended to be written this time. */
+  size_t mDataSize;
+  size_t mSizeFilled;
+  uint64_t mFrameId;
+  bool mIncomplete;
+  /** GenTL::PAYLOADTYPE_INFO_IDS */
+  size_t mPayloadType;
+
+  /** Only for a buffer that is not multi-part. */
+  size_t mWidth;
+  size_t mHeight;
+
+  /** Zero for a buffer that is not multi-part. */
+  uint32_t mPartCount;
+  BufferPartDescriptor mParts[MAX_PARTS];
+};
+
+/** Fills in BufferDescriptors for the buffers of a data stream, with as few
+    calls to the producer as possible. Each DSGetBufferInfo and
+    DSGetBufferPartInfo call takes a lock in the producer.
+
+    What cannot change while the parameters are locked is queried from the
+    first buffer only, i.e., payload type, part count and the data type,
+    pixel format and width of each part. The address and size of the
+    announced memory are queried once per buffer handle. Only what differs
+    from buffer to buffer is queried every time, i.e., frame ID, sizes,
+    incomplete flag and the address, size and height of each part.
+
+    Call reset() when the device parameters have been unlocked, and when
+    buffers are revoked. Safe to use from several threads.
+*/
+class BufferDescriptorReader
+{
+public:
+  BufferDescriptorReader(GenTLApi* tl, GenTL::DS_HANDLE dataStreamHandle);
+
+  /** Throws if a call to the producer fails. */
+  void read(GenTL::BUFFER_HANDLE bufferHandle, BufferDescriptor& descriptor);
+
+  /** Forgets everything learned from earlier buffers. */
+  void reset();
+
+private:
+  BufferDescriptorReader(const BufferDescriptorReader&);
+  BufferDescriptorReader& operator=(const BufferDescriptorReader&);
+
+  struct BufferMemory
+  {
+    uint8_t* mData;
+    size_t mSize;
+  };
+
+  void readLayout(GenTL::BUFFER_HANDLE bufferHandle,
+                  BufferDescriptor& layout);
+  BufferMemory readMemory(GenTL::BUFFER_HANDLE bufferHandle);
+
+  template<typename T>
+  void getInfo(GenTL::BUFFER_HANDLE bufferHandle,
+               GenTL::BUFFER_INFO_CMD command,
+               T& value);
+  template<typename T>
+  void getPartInfo(GenTL::BUFFER_HANDLE bufferHandle,
+                   uint32_t partNumber,
+                   GenTL::BUFFER_PART_INFO_CMD command,
+                   T& value);
+
+private:
+  GenTLApi* mTl;
+  GenTL::DS_HANDLE mDataStreamHandle;
+
+  std::mutex mMutex;
+  bool mHasLayout;
+  // The fields that do not change, as read from the first buffer
+  BufferDescriptor mLayout;
+  std::map<GenTL::BUFFER_HANDLE, BufferMemory> mMemory;
+};
+
+}
+
+#endif
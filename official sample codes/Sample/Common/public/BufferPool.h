@@ -0,0 +1,102 @@
+// Copyright 2018 SICK AG. All rights reserved.
+
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Sample
+{
+
+/** Memory for the buffers announced to a data stream with DSAnnounceBuffer.
+
+    All buffers are allocated as one region, which is
+    <ul>
+    <li> backed by 2 MB huge pages if requested and possible, falling back to
+         normal pages otherwise. Huge pages need fewer TLB entries when the
+         producer writes received packets and when the data is processed.
+         On Windows the user must hold the "Lock pages in memory" privilege.
+         On Linux huge pages must be reserved, e.g., in
+         /proc/sys/vm/nr_hugepages, otherwise transparent huge pages are
+         requested for the normal pages.
+    <li> placed on a NUMA node, preferably the node of the network card and
+         the processing threads, to avoid remote memory traffic. Memory is
+         taken from other nodes only if the node runs out.
+    <li> pre-faulted, so that no page fault happens while receiving.
+    <li> optionally locked in physical memory. Huge pages on Windows are
+         always locked.
+    </ul>
+    Each buffer starts at the chosen alignment, e.g., 64 bytes for a cache
+    line or 4 KB for a page.
+
+    The buffers must be revoked from the data stream before the pool is
+    destroyed.
+*/
+class BufferPool
+{
+public:
+  struct Options
+  {
+    Options()
+      : hugePages(true)
+      , alignment(4096)
+      , lockMemory(false)
+      , numaNode(-1)
+    {
+    }
+
+    /** Try to use 2 MB huge pages. */
+    bool hugePages;
+    /** Alignment of each buffer, a power of two. */
+    size_t alignment;
+    /** Lock the buffers in physical memory, never paged out. */
+    bool lockMemory;
+    /** NUMA node to allocate from, -1 for the default of the system. */
+    int numaNode;
+  };
+
+  /** Allocates the buffers. Throws if the memory cannot be allocated at all,
+      falling back to normal pages or unlocked memory is not an error.
+  */
+  BufferPool(size_t bufferCount,
+             size_t bufferSize,
+             const Options& options = Options());
+
+  ~BufferPool();
+
+  uint8_t* buffer(size_t index) const;
+  size_t bufferCount() const { return mBufferCount; }
+  size_t bufferSize() const { return mBufferSize; }
+
+  /** True if the buffers are on huge pages. On Linux, with transparent huge
+      pages, this is only a request to the kernel.
+  */
+  bool usesHugePages() const { return mHugePages; }
+
+  /** True if the buffers are locked in physical memory. */
+  bool isLocked() const { return mLocked; }
+
+private:
+  BufferPool(const BufferPool&);
+  BufferPool& operator=(const BufferPool&);
+
+  void allocate(const Options& options);
+  void lock();
+  void preFault();
+  void release();
+
+private:
+  size_t mBufferCount;
+  size_t mBufferSize;
+  // Distance between the starts of two buffers
+  size_t mStride;
+  uint8_t* mRegion;
+  size_t mRegionSize;
+  bool mHugePages;
+  bool mLocked;
+};
+
+}
+
+#endif
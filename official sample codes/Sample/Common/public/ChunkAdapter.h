@@ -4,13 +4,32 @@
 #define CHUNK_ADAPTER_H
 
 #include <GenApi/ChunkAdapterGEV.h>
+#include <GenApi/GenApi.h>
 #include <GenTLApi.h>
+#include <StreamData.h>
 
 #include <memory>
+#include <vector>
 
 namespace Sample
 {
 
+/** The line metadata of a buffer, one array per field indexed by line. Fields
+    without a matching chunk feature are zero.
+*/
+struct LineMetadata
+{
+  size_t lineCount() const { return mTimestamp.size(); }
+  void resize(size_t lineCount);
+
+  std::vector<uint64_t> mTimestamp;
+  std::vector<int64_t> mEncoderValue;
+  std::vector<uint32_t> mOvertriggerCount;
+  std::vector<uint8_t> mEncoderA;
+  std::vector<uint8_t> mEncoderB;
+  std::vector<uint8_t> mFrameTriggerActive;
+};
+
 /**
    Wrapper class for a GigE Vision chunk adapter. Creating an instance
    of this class and attaching it to a node map and a buffer will make
@@ -37,13 +56,134 @@ public:
   /** Detach the from the buffer when done with it. */
   void detachBuffer();
 
+  /** Call after setting TLParamsLocked to 1. The chunk layout cannot change
+      while the parameters are locked, so the next attached buffer is
+      validated and the buffers after it with the same chunk payload size
+      only move the chunk adapter to the new address, keeping the chunk
+      offsets and the learned layout. A buffer with another chunk payload
+      size is validated again.
+
+      While locked, detachBuffer() leaves the chunk adapter on the last
+      buffer, so the chunk features of the node map must not be read
+      between detachBuffer() and the next attachBuffer().
+  */
+  void lockLayout();
+
+  /** Call before setting TLParamsLocked to 0. Every attached buffer is
+      validated again.
+  */
+  void unlockLayout();
+
+  /** Read the line metadata of the attached buffer into marks, one LineMark
+      per line. Requires an attached node map. Values without a matching
+      chunk feature are set to zero, timestamps are truncated to 32 bits.
+      \param scanId Stored in every line, e.g., the frame ID of the buffer.
+  */
+  void readLineMarks(GenIRanger::LineMarks& marks, uint32_t scanId);
+
+  /** Read the line metadata of the attached buffer. Requires an attached
+      node map.
+
+      When a buffer is attached the first time, the position of the metadata
+      chunk in the buffer and of each field within a line is learned from
+      the chunk features of the node map. The metadata is then decoded
+      straight from the buffer, in one pass per field, instead of selecting
+      each line and reading each feature through the node map. The layout is
+      learned again when the chunk payload size changes. If it cannot be
+      learned, or the decoded values do not match the node map, the node map
+      is used for every buffer instead.
+  */
+  void readLineMetadata(LineMetadata& metadata);
+
+  /** Read the line metadata of the attached buffer through the node map,
+      one line at a time. Much slower than readLineMetadata() but useful to
+      validate it.
+  */
+  void readLineMetadataFromNodeMap(LineMetadata& metadata);
+
+  /** True if readLineMetadata() decodes the attached buffer directly. */
+  bool hasDirectLayout() const { return mLayout.mValid; }
+
 private:
+  /** Where a chunk feature is found in the metadata chunk. */
+  struct Field
+  {
+    Field();
+
+    bool mValid;
+    // Byte offset of the register of the first line, and from line to line
+    size_t mOffset;
+    size_t mStride;
+    size_t mLength;
+    bool mBigEndian;
+    bool mSigned;
+    // Bits of the register holding the value, numbered from the lsb
+    unsigned mLsb;
+    unsigned mMsb;
+    // Value of a boolean feature when it is true
+    int64_t mOnValue;
+  };
+
+  struct Layout
+  {
+    Layout();
+
+    bool mValid;
+    size_t mChunkPayloadSize;
+    // Byte offset and length of the metadata chunk data in the buffer
+    size_t mChunkOffset;
+    size_t mChunkLength;
+    int64_t mFirstLine;
+    size_t mLineCount;
+
+    Field mTimestamp;
+    Field mEncoderValue;
+    Field mOvertriggerCount;
+    Field mEncoderA;
+    Field mEncoderB;
+    Field mFrameTriggerActive;
+  };
+
   size_t getChunkPayloadSize(GenTL::BUFFER_HANDLE handle);
 
+  void learnLayout(const uint8_t* buffer, size_t chunkPayloadSize);
+  bool findMetadataChunk(const uint8_t* buffer, size_t chunkPayloadSize);
+  bool learnField(GenApi::IValue* value, bool isBoolean, Field& field);
+  bool validateLayout();
+  void readLineFromNodeMap(int64_t line, LineMetadata& metadata, size_t index);
+
+  template<typename T>
+  static void decodeColumn(const uint8_t* chunk,
+                           const Field& field,
+                           std::vector<T>& column);
+  static void decodeFlags(const uint8_t* chunk,
+                          const Field& field,
+                          std::vector<uint8_t>& column);
+
 private:
   GenTLApi* mTl;
   GenTL::DS_HANDLE mDataStreamHandle;
   std::unique_ptr<GenApi::CChunkAdapterGEV> mAdapter;
+
+  // Chunk features looked up once when the node map is attached
+  GenApi::CIntegerPtr mScanLineSelector;
+  GenApi::CIntegerPtr mEncoderValue;
+  GenApi::CIntegerPtr mTimestamp;
+  GenApi::CIntegerPtr mOvertriggerCount;
+  GenApi::CBooleanPtr mEncoderA;
+  GenApi::CBooleanPtr mEncoderB;
+  GenApi::CBooleanPtr mFrameTriggerActive;
+
+  GenApi::INodeMap* mNodeMap;
+  const uint8_t* mBuffer;
+  // The adapter stays attached between buffers while the layout is locked
+  bool mAdapterAttached;
+  bool mLayoutLocked;
+  // Chunk payload size of the buffer validated since locking, 0 if none
+  size_t mValidatedPayloadSize;
+  Layout mLayout;
+  // Read by readLineMarks(), kept to avoid reallocating for every buffer
+  LineMetadata mMetadata;
 };
 
 }
@@ -5,11 +5,18 @@
 
 #include "TLI/GenTL.h"
 
-#include <exception>
+#include <cstring>
 #include <map>
 #include <memory>
 #include <sstream>
+#include <stdexcept>
+
+#ifdef _WIN32
 #include <windows.h>
+#else
+#include <dlfcn.h>
+typedef void* HMODULE;
+#endif
 
 
 #define API_LIST(code)\
@@ -104,7 +111,7 @@ std::unique_ptr<GenTLApi> loadProducer(std::string ctiFile);
   tl->GCGetLastError(&errorCode, message, &size);\
   std::stringstream ss;\
   ss << "GenTL call failed: " << errorCode << ", Message: " << message;\
-  throw std::exception(ss.str().c_str());\
+  throw std::runtime_error(ss.str());\
 }
 
 #endif
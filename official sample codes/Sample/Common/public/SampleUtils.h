@@ -19,7 +19,8 @@ struct InputWaiter
 namespace Sample
 {
 /**  Returns the absolute path to the SICKGigEVisionTL.cti-file which
-     should be located next to the built executable.
+     should be located next to the built executable, unless another
+     producer is given by the environment variable SICK_GENTL_PRODUCER.
 */
 std::string getPathToProducer();
 
@@ -0,0 +1,166 @@
+// Copyright 2018 SICK AG. All rights reserved.
+
+#ifndef TASK_POOL_H
+#define TASK_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Sample
+{
+
+/** Worker threads shared by the buffer processing of all cameras, e.g.,
+    unpacking, chunk parsing and saving.
+
+    Each worker has a queue of its own. A worker takes the oldest task from
+    its own queue and, when that is empty, steals the oldest task from the
+    queue of another worker. The tasks of a camera are put in the queue of
+    the same worker, see TaskSequence, so a camera keeps to one core while
+    the load is even. When one camera is busier than the others, the idle
+    workers take over its tasks, so the processors follow the load rather
+    than a fixed partition of cameras to threads.
+
+    A task that throws is counted as failed, the exception is not passed on.
+
+    Example, with one sequence per camera:
+
+      Sample::TaskPool pool;
+      Sample::TaskSequence camera1(pool);
+      Sample::TaskSequence camera2(pool);
+      ...
+      // From the receive thread of camera 1
+      camera1.submit([=] { unpack(buffer); parseChunks(buffer); },
+                     [=] { save(buffer); });
+*/
+class TaskPool
+{
+public:
+  typedef std::function<void()> Task;
+
+  struct Statistics
+  {
+    uint64_t mTasksExecuted;
+    /** Tasks taken from the queue of another worker. */
+    uint64_t mTasksStolen;
+    uint64_t mTasksFailed;
+  };
+
+  /** \param threadCount Number of worker threads, 0 means one per hardware
+                         thread.
+  */
+  explicit TaskPool(size_t threadCount = 0);
+
+  /** Executes all submitted tasks before the threads are joined. */
+  ~TaskPool();
+
+  size_t threadCount() const { return mWorkers.size(); }
+
+  /** Queues a task to be executed by any worker. */
+  void submit(Task task);
+
+  /** Blocks until all submitted tasks are finished. */
+  void waitIdle();
+
+  Statistics statistics() const;
+
+private:
+  friend class TaskSequence;
+
+  TaskPool(const TaskPool&);
+  TaskPool& operator=(const TaskPool&);
+
+  struct WorkerQueue
+  {
+    std::mutex mMutex;
+    std::deque<Task> mTasks;
+  };
+
+  /** Queues a task to the worker home, the others may steal it. */
+  void submitTo(size_t home, Task task);
+  size_t nextHome();
+  bool takeTask(size_t worker, Task& task);
+  void workerLoop(size_t worker);
+  void finishTask();
+
+private:
+  std::vector<std::unique_ptr<WorkerQueue>> mQueues;
+  std::vector<std::thread> mWorkers;
+  std::atomic<size_t> mNextHome;
+
+  // Tasks in the queues, and tasks submitted but not finished
+  std::atomic<size_t> mQueuedTasks;
+  std::atomic<size_t> mUnfinishedTasks;
+
+  // Workers sleep here when all queues are empty
+  std::mutex mWakeMutex;
+  std::condition_variable mWake;
+  std::condition_variable mIdle;
+  std::atomic<int> mSleepingWorkers;
+  bool mStopping;
+
+  std::atomic<uint64_t> mTasksExecuted;
+  std::atomic<uint64_t> mTasksStolen;
+  std::atomic<uint64_t> mTasksFailed;
+};
+
+/** The jobs of one camera in a TaskPool, completed in the order they were
+    submitted.
+
+    Each job has two parts. The work of different jobs runs in parallel on
+    any worker. The completion runs after the work, and only once the
+    completions of all jobs submitted before it have run. A job that
+    finishes its work early is set aside, without blocking a worker, and
+    completed by the worker finishing the job before it. E.g., frames of a
+    camera may be unpacked out of order but are always saved in order.
+
+    If the work throws the completion is skipped, the following jobs are
+    completed as usual.
+
+    The sequence must outlive its jobs, e.g., call waitIdle() before
+    destroying it.
+*/
+class TaskSequence
+{
+public:
+  explicit TaskSequence(TaskPool& pool);
+
+  /** Queues a job, from any thread. */
+  void submit(TaskPool::Task work, TaskPool::Task completion);
+
+  /** Blocks until all jobs submitted so far are completed. Other jobs in the
+      pool may still run.
+  */
+  void waitIdle();
+
+private:
+  TaskSequence(const TaskSequence&);
+  TaskSequence& operator=(const TaskSequence&);
+
+  void complete(uint64_t ticket, TaskPool::Task completion);
+
+private:
+  TaskPool& mPool;
+  // Worker that gets the jobs of the sequence while the load is even
+  const size_t mHome;
+
+  std::mutex mMutex;
+  uint64_t mNextTicket;
+  uint64_t mNextToComplete;
+  // Completions waiting for earlier jobs, by ticket
+  std::map<uint64_t, TaskPool::Task> mWaiting;
+  // True while a worker runs completions, which it does in order
+  bool mCompleting;
+  std::condition_variable mIdle;
+};
+
+}
+
+#endif
@@ -1,5 +1,7 @@
 // Copyright 2016-2018 SICK AG. All rights reserved.
 
+#include "AsyncFrameWriter.h"
+#include "BufferDescriptor.h"
 #include "ChunkAdapter.h"
 #include "Consumer.h"
 #include "GenIRanger.h"
@@ -31,138 +33,28 @@ void usage(int, char* argv[])
 
 
 // ----------------------------------------------------------------------------
-// Class declarations
+// Buffer information logging
 
-class BufferInfo
+void logBufferInfo(std::ostream& logFile,
+                   const Sample::BufferDescriptor& buffer)
 {
-public:
-  BufferInfo(GenTLApi* tl,
-             GenTL::DS_HANDLE dataStreamHandle,
-             GenTL::BUFFER_HANDLE bufferHandle);
-  void log(std::ostream& logFile) const;
-public:
-  bool8_t mBufferIncomplete;
-  size_t mBufferFilledSize;
-  size_t mBufferDataSize;
-  uint64_t mBufferFrameID;
-  size_t mBufferPayloadType;
-  uint32_t mPartCount;
-};
-
-class BufferPartInfo
-{
-public:
-  BufferPartInfo(GenTLApi* tl,
-                 GenTL::DS_HANDLE dataStreamHandle,
-                 GenTL::BUFFER_HANDLE bufferHandle,
-                 uint32_t partNumber);
-  void log(std::ostream& logFile) const;
-
-public:
-  uint32_t mPartNumber;
-  uint8_t* mPartDataPointer;
-  size_t mPartDataType;
-  uint64_t mPartDataFormat;
-  size_t mPartDataSize;
-  size_t mPartDataWidth;
-  size_t mPartDataHeight;
-};
-
-
-// ----------------------------------------------------------------------------
-// BufferInfo function definitions
-
-BufferInfo::BufferInfo(GenTLApi* tl,
-                       GenTL::DS_HANDLE dataStreamHandle,
-                       GenTL::BUFFER_HANDLE bufferHandle)
-{
-  GenTL::INFO_DATATYPE infoType = GenTL::INFO_DATATYPE_UNKNOWN;
-  size_t infoSize = sizeof(mBufferIncomplete);
-  CC(tl, tl->DSGetBufferInfo(dataStreamHandle, bufferHandle,
-                             GenTL::BUFFER_INFO_IS_INCOMPLETE,
-                             &infoType, &mBufferIncomplete, &infoSize));
-
-  infoSize = sizeof(mBufferFilledSize);
-  CC(tl, tl->DSGetBufferInfo(dataStreamHandle, bufferHandle,
-                             GenTL::BUFFER_INFO_SIZE_FILLED,
-                             &infoType, &mBufferFilledSize, &infoSize));
-
-  infoSize = sizeof(mBufferDataSize);
-  CC(tl, tl->DSGetBufferInfo(dataStreamHandle, bufferHandle,
-                             GenTL::BUFFER_INFO_DATA_SIZE,
-                             &infoType, &mBufferDataSize, &infoSize));
-
-  infoSize = sizeof(mBufferFrameID);
-  CC(tl, tl->DSGetBufferInfo(dataStreamHandle, bufferHandle,
-                             GenTL::BUFFER_INFO_FRAMEID,
-                             &infoType, &mBufferFrameID, &infoSize));
-
-  infoSize = sizeof(mBufferPayloadType);
-  CC(tl, tl->DSGetBufferInfo(dataStreamHandle, bufferHandle,
-                             GenTL::BUFFER_INFO_PAYLOADTYPE,
-                             &infoType, &mBufferPayloadType, &infoSize));
-
-  CC(tl, tl->DSGetNumBufferParts(dataStreamHandle, bufferHandle, &mPartCount));
+  logFile << "Frame ID: " << buffer.mFrameId
+          << ", Incomplete buffers: " << buffer.mIncomplete
+          << ", Buffer size filled: " << buffer.mSizeFilled
+          << ", Buffer data size:" << buffer.mDataSize << std::endl;
 }
 
-void BufferInfo::log(std::ostream& logFile) const
+void logBufferPartInfo(std::ostream& logFile,
+                       const Sample::BufferDescriptor& buffer,
+                       uint32_t partNumber)
 {
-  logFile << "Frame ID: " << mBufferFrameID
-          << ", Incomplete buffers: " << mBufferIncomplete
-          << ", Buffer size filled: " << mBufferFilledSize
-          << ", Buffer data size:" << mBufferDataSize << std::endl;
-}
-
-
-// ----------------------------------------------------------------------------
-// BufferPartInfo function definitions
-
-BufferPartInfo::BufferPartInfo(GenTLApi* tl,
-                               GenTL::DS_HANDLE dataStreamHandle,
-                               GenTL::BUFFER_HANDLE bufferHandle,
-                               uint32_t partNumber)
-  : mPartNumber(partNumber)
-{
-  GenTL::INFO_DATATYPE infoType = GenTL::INFO_DATATYPE_UNKNOWN;
-  size_t infoSize = static_cast<size_t>(sizeof(mPartDataPointer));
-  CC(tl, tl->DSGetBufferPartInfo(dataStreamHandle, bufferHandle, mPartNumber,
-                                 GenTL::BUFFER_PART_INFO_BASE,
-                                 &infoType, &mPartDataPointer,  &infoSize));
-
-  infoSize = static_cast<size_t>(sizeof(mPartDataType));
-  CC(tl, tl->DSGetBufferPartInfo(dataStreamHandle, bufferHandle, mPartNumber,
-                                 GenTL::BUFFER_PART_INFO_DATA_TYPE,
-                                 &infoType, &mPartDataType, &infoSize));
-
-  infoSize = static_cast<size_t>(sizeof(mPartDataFormat));
-  CC(tl, tl->DSGetBufferPartInfo(dataStreamHandle, bufferHandle, mPartNumber,
-                                 GenTL::BUFFER_PART_INFO_DATA_FORMAT,
-                                 &infoType, &mPartDataFormat, &infoSize));
-
-  infoSize = static_cast<size_t>(sizeof(mPartDataSize));
-  CC(tl, tl->DSGetBufferPartInfo(dataStreamHandle, bufferHandle, mPartNumber,
-                                 GenTL::BUFFER_PART_INFO_DATA_SIZE,
-                                 &infoType, &mPartDataSize, &infoSize));
-
-  infoSize = static_cast<size_t>(sizeof(mPartDataWidth));
-  CC(tl, tl->DSGetBufferPartInfo(dataStreamHandle, bufferHandle, mPartNumber,
-                                 GenTL::BUFFER_PART_INFO_WIDTH,
-                                 &infoType, &mPartDataWidth, &infoSize));
-
-  infoSize = static_cast<size_t>(sizeof(mPartDataHeight));
-  CC(tl, tl->DSGetBufferPartInfo(dataStreamHandle, bufferHandle, mPartNumber,
-                                 GenTL::BUFFER_PART_INFO_HEIGHT,
-                                 &infoType, &mPartDataHeight, &infoSize));
-}
-
-void BufferPartInfo::log(std::ostream& logFile) const
-{
-  logFile << "Part number: " << mPartNumber << ", size: " << mPartDataSize;
-  logFile << ", Height: " << mPartDataHeight << ", Width: " << mPartDataWidth;
+  const Sample::BufferPartDescriptor& part = buffer.mParts[partNumber];
+  logFile << "Part number: " << partNumber << ", size: " << part.mDataSize;
+  logFile << ", Height: " << part.mHeight << ", Width: " << part.mWidth;
   logFile << std::endl;
 
   // Log the data format in the buffer part
-  switch (mPartDataType)
+  switch (part.mDataType)
   {
   case GenTL::PART_DATATYPE_2D_IMAGE:
     logFile << " Type: PART_DATATYPE_2D_IMAGE, ";
@@ -171,12 +63,12 @@ void BufferPartInfo::log(std::ostream& logFile) const
     logFile << " Type: PART_DATATYPE_3D_IMAGE, ";
     break;
   default:
-    logFile << " Unknown Part " << mPartDataType;
+    logFile << " Unknown Part " << part.mDataType;
     break;
   }
 
   // Log the pixel format in the buffer part
-  switch (mPartDataFormat)
+  switch (part.mDataFormat)
   {
   case PFNC_Mono8:
     // Reflectance expected as Mono8
@@ -197,7 +89,7 @@ void BufferPartInfo::log(std::ostream& logFile) const
     logFile << " Format: DATA_FORMAT_MONO_12p ";
     break;
   default:
-    logFile << " Unknown Format  " << mPartDataFormat;
+    logFile << " Unknown Format  " << part.mDataFormat;
     break;
   }
   logFile << std::endl;
@@ -411,25 +303,20 @@ int main(int argc, char* argv[])
   int64_t aoiOffsetY = offsetY->GetValue();
 
   int64_t bufferWidth = width->GetValue();
-  // 16-bit range, 8-bit reflectance
-  int64_t buffer16Size = bufferWidth * bufferHeight * (2 + 1);
 
   // Setup a sufficient amount of buffers
   GenApi::CIntegerPtr payload = device._GetNode("PayloadSize");
   const size_t payloadSize = static_cast<size_t>(payload->GetValue());
   const size_t buffersCount = 20;
 
-  // Two different sized buffers are used below. One for the 12-bit data which
-  // is sent from the device, and one for converting it to buffer with a
-  // 16-bit representation. The latter is only used for saving it to disk in
-  // the .dat/.xml format.
+  // The buffers contain the data as sent from the device. 12-bit range data
+  // is unpacked to 16-bit while being saved to disk in the .dat/.xml format,
+  // so no separate buffer is needed for the conversion.
   uint8_t* pBuffer[buffersCount];
-  uint8_t* pBuffer16;
   GenTL::BUFFER_HANDLE bufferHandles[buffersCount];
 
   // Announce and queue buffers to producer, we keep track of the buffers by
   // their index in the array
-  pBuffer16 = new uint8_t[buffer16Size];
   for (size_t i = 0; i < buffersCount; i++)
   {
     pBuffer[i] = new uint8_t[payloadSize];
@@ -457,9 +344,48 @@ int main(int argc, char* argv[])
   logFile.exceptions(std::ios::failbit | std::ios::badbit);
   logFile.open(filename, std::ios_base::app);
 
+  // With a maximum number of buffers on disk, the files are reused in turn.
+  // They are kept open and preallocated, so overwriting them is cheap.
+  std::unique_ptr<GenIRanger::FrameFileRing> fileRing;
+  if (saveToDisk && bufferRotationNum != 0)
+  {
+    fileRing.reset(new GenIRanger::FrameFileRing(
+      savePath + "\\" + bufferName, static_cast<size_t>(bufferRotationNum)));
+  }
+
+  // Buffers are saved by a background thread, so that acquisition does not
+  // have to wait for the disk. A few buffers are always left to the producer.
+  GenIRanger::AsyncFrameWriter writer(buffersCount / 2);
+  writer.setCompletionCallback(
+    [](const std::string& path, std::exception_ptr error)
+    {
+      if (error)
+      {
+        try
+        {
+          std::rethrow_exception(error);
+        }
+        catch (const std::exception& e)
+        {
+          std::cout << "Could not save " << path << ": " << e.what()
+                    << std::endl;
+        }
+      }
+    });
+  writer.setBackpressureCallback([](size_t)
+  {
+    // The disk cannot keep up, acquisition waits for the writer
+    std::cout << "W";
+  });
+
   // Lock all parameters before starting
   GenApi::CIntegerPtr paramLock = device._GetNode("TLParamsLocked");
   paramLock->SetValue(1);
+  // The chunk layout is validated on the first buffer only from now on
+  chunkAdapter->lockLayout();
+  // Likewise, the buffer and part info that cannot change is only fetched
+  // from the first buffer
+  Sample::BufferDescriptorReader bufferReader(tl, dataStreamHandle);
   // Start acquisition
   CC(tl, tl->DSStartAcquisition(dataStreamHandle, GenTL::ACQ_START_FLAGS_DEFAULT,
                                 GENTL_INFINITE));
@@ -487,81 +413,95 @@ int main(int argc, char* argv[])
 
         bufferId = reinterpret_cast<intptr_t>(bufferData.pUserPointer);
 
-        BufferInfo bufferInfo(tl, dataStreamHandle, bufferHandles[bufferId]);
-        assert(bufferInfo.mBufferPayloadType == GenTL::PAYLOAD_TYPE_MULTI_PART);
+        Sample::BufferDescriptor bufferInfo;
+        bufferReader.read(bufferHandles[bufferId], bufferInfo);
+        assert(bufferInfo.mPayloadType == GenTL::PAYLOAD_TYPE_MULTI_PART);
         assert(bufferInfo.mPartCount == 2);
 
-        BufferPartInfo part0Info(tl, dataStreamHandle,
-                                 bufferHandles[bufferId], 0);
-        assert(part0Info.mPartDataWidth == bufferWidth);
-        assert(part0Info.mPartDataHeight == bufferHeight);
+        const Sample::BufferPartDescriptor& part0Info = bufferInfo.mParts[0];
+        assert(part0Info.mWidth == bufferWidth);
+        assert(part0Info.mHeight == bufferHeight);
         // Part 0 should be the 3D Range data
-        assert(part0Info.mPartDataType == GenTL::PART_DATATYPE_3D_IMAGE);
+        assert(part0Info.mDataType == GenTL::PART_DATATYPE_3D_IMAGE);
 
-        BufferPartInfo part1Info(tl, dataStreamHandle,
-                                 bufferHandles[bufferId], 1);
-        assert(part1Info.mPartDataWidth == bufferWidth);
-        assert(part1Info.mPartDataHeight == bufferHeight);
+        const Sample::BufferPartDescriptor& part1Info = bufferInfo.mParts[1];
+        assert(part1Info.mWidth == bufferWidth);
+        assert(part1Info.mHeight == bufferHeight);
         // Part 1 should be the Reflectance data
-        assert(part1Info.mPartDataType == GenTL::PART_DATATYPE_2D_IMAGE);
-        assert(part1Info.mPartDataFormat == PFNC_Mono8);
+        assert(part1Info.mDataType == GenTL::PART_DATATYPE_2D_IMAGE);
+        assert(part1Info.mDataFormat == PFNC_Mono8);
 
         // Attach the chunk adapter to this buffer to be able to access metadata
         chunkAdapter->attachBuffer(bufferHandles[bufferId], pBuffer[bufferId]);
 
         // Log information about the received buffer and some chunk metadata
         logFile << std::endl << "Buffer: " << i << std::endl;
-        bufferInfo.log(logFile);
-        part0Info.log(logFile);
-        part1Info.log(logFile);
+        logBufferInfo(logFile, bufferInfo);
+        logBufferPartInfo(logFile, bufferInfo, 0);
+        logBufferPartInfo(logFile, bufferInfo, 1);
         logFile << "Chunk Height: " << chunkHeight->GetValue()
           << ", Width: " << chunkWidth->GetValue() << std::endl;
 
         if (saveToDisk)
         {
-          // Convert Range data to 16-bit if needed
-          if (part0Info.mPartDataFormat == PFNC_Coord3D_C12p
-              || part0Info.mPartDataFormat == PFNC_Mono12p)
+          // Save buffer to disk
+          // To save buffers with a single part, look at saveBuffer16
+          // and saveBuffer8
+          // The frame is a view of the buffer parts. 12-bit range data is
+          // unpacked to 16-bit while writing. The buffer is re-queued when
+          // the writer releases the frame.
+          GenTL::BUFFER_HANDLE bufferHandle = bufferHandles[bufferId];
+          std::shared_ptr<void> requeue(bufferHandle,
+            [tl, dataStreamHandle](void* handle)
+            {
+              tl->DSQueueBuffer(dataStreamHandle, handle);
+            });
+          GenIRanger::ReleaseCallback release = [requeue](uint8_t*) {};
+
+          GenIRanger::PixelWidth rangeWidth =
+            part0Info.mDataFormat == PFNC_Coord3D_C12p
+            || part0Info.mDataFormat == PFNC_Mono12p
+            ? GenIRanger::PixelWidth::PW12
+            : GenIRanger::PixelWidth::PW16;
+
+          GenIRanger::RangeFrame frame;
+          frame
+            .aoiOffset(static_cast<size_t>(aoiOffsetX),
+                       static_cast<size_t>(aoiOffsetY))
+            .aoiSize(static_cast<size_t>(bufferWidth),
+                     static_cast<size_t>(aoiHeight));
+          frame.createRangeView(part0Info.mData,
+                                part0Info.mDataSize,
+                                rangeWidth,
+                                release);
+          frame.createReflectanceView(part1Info.mData,
+                                      part1Info.mDataSize,
+                                      GenIRanger::PixelWidth::PW8,
+                                      release);
+          // Full line mark data is read while the buffer is attached
+          frame.createLineMarks(0);
+          chunkAdapter->readLineMarks(
+            *frame.lineMarks(),
+            static_cast<uint32_t>(bufferInfo.mFrameId));
+          chunkAdapter->detachBuffer();
+          if (fileRing)
           {
-            GenIRanger::convert12pTo16(part0Info.mPartDataPointer,
-                                       part0Info.mPartDataSize,
-                                       pBuffer16,
-                                       &buffer16Size);
+            writer.write(frame, *fileRing);
           }
           else
           {
-            // Just copy the data to buffer16 pointer
-            assert(part0Info.mPartDataSize
-                   <= static_cast<uint64_t>(buffer16Size));
-            std::memcpy(pBuffer16, part0Info.mPartDataPointer,
-                        part0Info.mPartDataSize);
+            std::stringstream bufferPath;
+            // Append loop index to buffer name
+            bufferPath << savePath << "\\" << bufferName << "-" << i;
+            writer.write(frame, bufferPath.str());
           }
-
-
-          std::stringstream bufferPath;
-          // Append loop index to buffer name
-          bufferPath << savePath << "\\" << bufferName << "-"
-            << (bufferRotationNum == 0 ? i :
-                (i % bufferRotationNum + 1 == 0
-                 ? 1 : i % bufferRotationNum + 1));
-
-          // Save buffer to disk
-          // To save buffers with a single part, look at saveBuffer16
-          // and saveBuffer8
-          GenIRanger::saveMultiPartBuffer(pBuffer16,
-                                          part1Info.mPartDataPointer,
-                                          nullptr,
-                                          bufferWidth,
-                                          bufferHeight,
-                                          aoiHeight,
-                                          aoiOffsetX,
-                                          aoiOffsetY,
-                                          bufferPath.str());
         }
-
-        chunkAdapter->detachBuffer();
-        // Re-queue buffer
-        CC(tl, tl->DSQueueBuffer(dataStreamHandle, bufferHandles[bufferId]));
+        else
+        {
+          chunkAdapter->detachBuffer();
+          // Re-queue buffer
+          CC(tl, tl->DSQueueBuffer(dataStreamHandle, bufferHandles[bufferId]));
+        }
       }
       catch (const std::exception& e)
       {
@@ -570,6 +510,8 @@ int main(int argc, char* argv[])
       }
       std::cout << std::endl;
     }
+    // Wait for the remaining buffers to be written and re-queued
+    writer.flush();
     if (saveToDisk)
     {
       std::cout << "Saved buffers to directory " << savePath << std::endl;
@@ -579,6 +521,7 @@ int main(int argc, char* argv[])
     command = device._GetNode("AcquisitionStop");
     command->Execute();
     CC(tl, tl->DSStopAcquisition(dataStreamHandle, GenTL::ACQ_STOP_FLAGS_KILL));
+    chunkAdapter->unlockLayout();
     paramLock->SetValue(0);
 
     // Log receiver statistics.
@@ -611,6 +554,20 @@ int main(int argc, char* argv[])
             << threadPriority->GetValue() << std::endl
             << "Stream receiver statistics End" << std::endl;
 
+    GenIRanger::AsyncFrameWriter::Statistics writerStatistics
+      = writer.statistics();
+    logFile << std::endl
+            << "Writer statistics Start" << std::endl
+            << "Buffers written: "
+            << writerStatistics.framesWritten << std::endl
+            << "Buffers failed: "
+            << writerStatistics.framesFailed << std::endl
+            << "Peak queue depth: "
+            << writerStatistics.peakQueueDepth << std::endl
+            << "Queue full count: "
+            << writerStatistics.queueFullCount << std::endl
+            << "Writer statistics End" << std::endl;
+
     // Discard all buffers so that they can be revoked from stream
     CC(tl, tl->DSFlushQueue(dataStreamHandle, GenTL::ACQ_QUEUE_ALL_DISCARD));
     CC(tl, tl->GCUnregisterEvent(dataStreamHandle, GenTL::EVENT_NEW_BUFFER));
@@ -623,7 +580,6 @@ int main(int argc, char* argv[])
                                 nullptr));
       delete[] pBuffer[i];
     }
-    delete[] pBuffer16;
   }
   catch (std::exception& e)
   {
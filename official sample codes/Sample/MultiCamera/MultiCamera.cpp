@@ -1,25 +1,31 @@
 // Copyright 2016-2018 SICK AG. All rights reserved.
 
+#include "AsyncFrameWriter.h"
+#include "BufferDescriptor.h"
+#include "BufferPool.h"
 #include "Consumer.h"
 #include "GenIRanger.h"
 #include "SampleUtils.h"
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <conio.h>
 #include <ctime>
+#include <deque>
 #include <direct.h>
 #include <fstream>
+#include <functional>
+#include <mutex>
 #include <set>
 #include <string>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <thread>
 
 // Global variables
 std::string gSavePath;
 
-// Temp memory used for pixel format conversion for saving buffers to disk
-size_t gTempBufferSize;
-uint8_t* gTempBuffer;
-
 void usage(int, char* argv[])
 {
   std::cout << "Usage:" << std::endl
@@ -54,6 +60,78 @@ struct Aoi
   uint16_t mHeight;
 };
 
+class DeviceConnection;
+
+/** A buffer handed over from the receive thread of a device. */
+struct ReceivedBuffer
+{
+  DeviceConnection* mDevice;
+  Sample::BufferDescriptor mBuffer;
+  // 1-based number of the buffer in the current start-stop iteration
+  size_t mBufferNum;
+};
+
+/** Hands the received buffers of all devices over to the consuming thread,
+    in the order they arrive.
+*/
+class ReceivedBufferQueue
+{
+public:
+  explicit ReceivedBufferQueue(size_t receiverCount)
+    : mReceiverCount(receiverCount)
+  {
+  }
+
+  void push(const ReceivedBuffer& buffer)
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mBuffers.push_back(buffer);
+    mChanged.notify_one();
+  }
+
+  /** Called by each receive thread when it has stopped. */
+  void receiverFinished()
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    --mReceiverCount;
+    mChanged.notify_one();
+  }
+
+  /** Waits at most timeout for a buffer. Returns false if there was none,
+      either since all receive threads have finished or on timeout.
+  */
+  bool pop(ReceivedBuffer& buffer, std::chrono::milliseconds timeout)
+  {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mChanged.wait_for(lock, timeout, [this]()
+    {
+      return !mBuffers.empty() || mReceiverCount == 0;
+    });
+    if (mBuffers.empty())
+    {
+      return false;
+    }
+    buffer = mBuffers.front();
+    mBuffers.pop_front();
+    return true;
+  }
+
+  /** True when all receive threads have finished and all buffers have been
+      taken.
+  */
+  bool isFinished()
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mReceiverCount == 0 && mBuffers.empty();
+  }
+
+private:
+  std::mutex mMutex;
+  std::condition_variable mChanged;
+  std::deque<ReceivedBuffer> mBuffers;
+  size_t mReceiverCount;
+};
+
 /** Helper class to keep track of all connected devices */
 class DeviceConnection
 {
@@ -64,8 +142,12 @@ public:
                    std::string deviceName)
     : mTl(tl)
     , mAcquisitionRunning(false)
+    , mStopReceiving(false)
+    , mFailed(false)
+    , mPreviousUnderrunCount(0)
     , mDeviceHandle(deviceHandle)
     , mDataStreamHandle(dataStreamHandle)
+    , mBufferReader(tl, dataStreamHandle)
     , mDeviceName(deviceName)
     , mAoi(0, 0, 0, 0)
   {
@@ -96,19 +178,47 @@ public:
   void registerNewBufferEvent();
   void unregisterNewBufferEvent();
 
+  /** Starts a thread receiving numBuffers buffers from the device, handing
+      them over to queue. The acquisition is stopped on the device as soon as
+      the producer has received enough buffers.
+  */
+  void startReceiving(uint64_t numBuffers, ReceivedBufferQueue& queue);
+
+  /** Makes the receive thread stop early, without waiting for it. */
+  void abortReceiving();
+
+  /** Waits for the receive thread to finish. */
+  void joinReceiving();
+
+  /** True if there has been an error from the device. */
+  bool hasFailed() const { return mFailed; }
+  void setFailed() { mFailed = true; }
+
+private:
+  void receiveLoop(uint64_t numBuffers, ReceivedBufferQueue& queue);
+
 private:
   std::vector<GenTL::BUFFER_HANDLE> mBufferHandles;
   std::vector<void*> mBufferData;
+  std::unique_ptr<Sample::BufferPool> mBufferPool;
 
   GenTLApi* mTl;
   std::unique_ptr<Sample::GenTLPort> mDevicePort;
   std::unique_ptr<Sample::GenTLPort> mDataStreamPort;
   bool mAcquisitionRunning;
 
+  std::thread mReceiveThread;
+  std::atomic<bool> mStopReceiving;
+  std::atomic<bool> mFailed;
+  int64_t mPreviousUnderrunCount;
+
 public:
   GenTL::DEV_HANDLE mDeviceHandle;
   GenTL::DS_HANDLE mDataStreamHandle;
   GenTL::EVENT_HANDLE mNewBufferEventHandle;
+  // Fetches the info of received buffers, shared by the receive thread and
+  // the thread consuming the buffers
+  Sample::BufferDescriptorReader mBufferReader;
 
   std::string mDeviceName;
   std::ofstream mLog;
@@ -116,6 +226,9 @@ public:
 
   GenApi::CNodeMapRef mDeviceNodeMap;
   GenApi::CNodeMapRef mDataStreamNodeMap;
+
+  // Only used with a maximum number of buffers on disk
+  std::unique_ptr<GenIRanger::FrameFileRing> mFileRing;
 };
 
 void DeviceConnection::createDeviceNodeMap(Sample::Consumer& consumer)
@@ -139,13 +252,16 @@ void DeviceConnection::initializeBuffers(size_t buffersCount,
   mBufferHandles.resize(buffersCount, GENTL_INVALID_HANDLE);
   mBufferData.resize(buffersCount, nullptr);
 
+  // Page aligned buffers on huge pages if possible, all touched once so that
+  // no page faults happen while receiving. Set numaNode in the options to the
+  // node of the network card on a multi-socket computer.
+  mBufferPool.reset(new Sample::BufferPool(buffersCount, payloadSize));
+  mLog << "Buffers on huge pages: " << mBufferPool->usesHugePages()
+       << ", locked: " << mBufferPool->isLocked() << std::endl;
+
   for (size_t i = 0; i < buffersCount; i++)
   {
-    uint8_t* bufferData = new uint8_t[payloadSize];
-    if (bufferData == nullptr)
-    {
-      throw std::exception("Could not allocated enough memory for buffers");
-    }
+    uint8_t* bufferData = mBufferPool->buffer(i);
     GenTL::BUFFER_HANDLE bufferHandle;
     // Store the pointer to the raw memory in the user data for sake of
     // simplicity. This makes it easy to access the memory when a buffer has
@@ -172,8 +288,9 @@ void DeviceConnection::teardownBuffers()
                                 mBufferHandles[i],
                                 &mBufferData[i],
                                 nullptr));
-    delete[] mBufferData[i];
   }
+  mBufferPool.reset();
+  mBufferReader.reset();
 }
 
 void DeviceConnection::startAcquisition()
@@ -182,6 +299,8 @@ void DeviceConnection::startAcquisition()
     mDeviceNodeMap._GetNode("AcquisitionStart");
   acquisitionStart->Execute();
   mAcquisitionRunning = true;
+  // The parameters are locked, the buffer layout is learned again
+  mBufferReader.reset();
 }
 
 void DeviceConnection::stopAcquisition()
@@ -215,66 +334,124 @@ void DeviceConnection::unregisterNewBufferEvent()
   CC(mTl, mTl->GCUnregisterEvent(mDataStreamHandle, GenTL::EVENT_NEW_BUFFER));
 }
 
-void logBufferInformation(GenTLApi* tl,
-                          std::ostream& logFile,
-                          GenTL::DS_HANDLE dataStreamHandle,
+void logBufferInformation(std::ostream& logFile,
                           size_t bufferNum,
-                          GenTL::BUFFER_HANDLE bufferHandle)
+                          const Sample::BufferDescriptor& buffer)
 {
-  GenTL::INFO_DATATYPE bufferInfoType = GenTL::INFO_DATATYPE_UNKNOWN;
-  bool8_t bufferIncomplete;
-  size_t bufferFilledSize;
-  size_t bufferDataSize;
-  size_t bufferInfoSize;
-  uint64_t bufferFrameID;
-
-  bufferInfoSize = sizeof(bufferIncomplete);
-
-  CC(tl, tl->DSGetBufferInfo(dataStreamHandle,
-                             bufferHandle,
-                             GenTL::BUFFER_INFO_IS_INCOMPLETE,
-                             &bufferInfoType,
-                             &bufferIncomplete,
-                             &bufferInfoSize));
-  bufferInfoSize = sizeof(bufferFilledSize);
-  CC(tl, tl->DSGetBufferInfo(dataStreamHandle,
-                             bufferHandle,
-                             GenTL::BUFFER_INFO_SIZE_FILLED,
-                             &bufferInfoType,
-                             &bufferFilledSize,
-                             &bufferInfoSize));
-  bufferInfoSize = sizeof(bufferDataSize);
-  CC(tl, tl->DSGetBufferInfo(dataStreamHandle,
-                             bufferHandle,
-                             GenTL::BUFFER_INFO_DATA_SIZE,
-                             &bufferInfoType,
-                             &bufferDataSize,
-                             &bufferInfoSize));
-  bufferInfoSize = sizeof(bufferFrameID);
-  CC(tl, tl->DSGetBufferInfo(dataStreamHandle,
-                             bufferHandle,
-                             GenTL::BUFFER_INFO_FRAMEID,
-                             &bufferInfoType,
-                             &bufferFrameID,
-                             &bufferInfoSize));
-
   logFile << bufferNum << ";"
-          << bufferFrameID << ";"
-          << bufferIncomplete << ";"
-          << bufferFilledSize << ";"
-          << bufferDataSize << "\n";
+          << buffer.mFrameId << ";"
+          << buffer.mIncomplete << ";"
+          << buffer.mSizeFilled << ";"
+          << buffer.mDataSize << "\n";
 }
 
-void logBufferInformation(GenTLApi* tl,
-                          DeviceConnection& device,
-                          size_t bufferNum,
-                          GenTL::BUFFER_HANDLE bufferHandle)
+void DeviceConnection::startReceiving(uint64_t numBuffers,
+                                      ReceivedBufferQueue& queue)
 {
-  logBufferInformation(tl,
-                       device.mLog,
-                       device.mDataStreamHandle,
-                       bufferNum,
-                       bufferHandle);
+  mStopReceiving = false;
+  mReceiveThread = std::thread(&DeviceConnection::receiveLoop,
+                               this,
+                               numBuffers,
+                               std::ref(queue));
+}
+
+void DeviceConnection::abortReceiving()
+{
+  mStopReceiving = true;
+  // Wakes up the receive thread if it is waiting for a buffer
+  mTl->EventKill(mNewBufferEventHandle);
+}
+
+void DeviceConnection::joinReceiving()
+{
+  if (mReceiveThread.joinable())
+  {
+    mReceiveThread.join();
+  }
+}
+
+/** Runs on a thread of its own for each device, so that a slow or stalled
+    device does not delay the buffers of the others. Only this thread uses
+    the log and the node maps of the device while receiving.
+*/
+void DeviceConnection::receiveLoop(uint64_t numBuffers,
+                                   ReceivedBufferQueue& queue)
+{
+  SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_HIGHEST);
+  const uint64_t timeout = 1000; // ms
+
+  for (size_t i = 1; i < numBuffers + 1 && !mStopReceiving; i++)
+  {
+    try
+    {
+      // Wait for buffer to be received
+      GenTL::EVENT_NEW_BUFFER_DATA event;
+      size_t eventSize = sizeof(event);
+      GenTL::GC_ERROR result = mTl->EventGetData(mNewBufferEventHandle,
+                                                 &event,
+                                                 &eventSize,
+                                                 timeout);
+      if (result == GenTL::GC_ERR_ABORT && mStopReceiving)
+      {
+        break;
+      }
+      CC(mTl, result);
+
+      GenTL::BUFFER_HANDLE bufferHandle = event.BufferHandle;
+
+      size_t numAwaitingDelivery;
+      size_t numAwaitingDeliverySize = sizeof(numAwaitingDelivery);
+      GenTL::INFO_DATATYPE dataType;
+      CC(mTl, mTl->DSGetInfo(mDataStreamHandle,
+                             GenTL::STREAM_INFO_NUM_AWAIT_DELIVERY,
+                             &dataType,
+                             &numAwaitingDelivery,
+                             &numAwaitingDeliverySize));
+
+      if (i + numAwaitingDelivery >= numBuffers && isAcquisitionRunning())
+      {
+        // The producer has received enough buffers, tell the device to
+        // stop. We will continue to process them in our own pace
+        std::cout << "\n" << mDeviceName
+                  << " has sent enough buffers" << std::endl;
+        stopAcquisition();
+      }
+
+      // Everything needed later is fetched here, once, and handed over with
+      // the buffer
+      ReceivedBuffer received;
+      received.mDevice = this;
+      received.mBufferNum = i;
+      mBufferReader.read(bufferHandle, received.mBuffer);
+
+      // Log information about the received buffer
+      logBufferInformation(mLog, i, received.mBuffer);
+
+      GenApi::CIntegerPtr engineUnderrunCount
+        = mDataStreamNodeMap._GetNode("GevStreamEngineUnderrunCount");
+      if (engineUnderrunCount.IsValid())
+      {
+        int64_t currentUnderrunCount = engineUnderrunCount->GetValue();
+        if (currentUnderrunCount != mPreviousUnderrunCount)
+        {
+          std::cout << "U";
+          mLog << "StreamEngineUnderrunCount: "
+               << currentUnderrunCount << std::endl;
+        }
+        mPreviousUnderrunCount = currentUnderrunCount;
+      }
+
+      queue.push(received);
+    }
+    catch (const std::exception& e)
+    {
+      std::cout << std::endl
+                << "Error from " << mDeviceName << std::endl
+                << e.what() << std::endl;
+      mFailed = true;
+    }
+  }
+  queue.receiverFinished();
 }
 
 void configureAcquisition(GenApi::CNodeMapRef &device, int64_t bufferHeight)
@@ -417,58 +594,49 @@ void printStatistics(GenApi::CNodeMapRef& dataStreamNodeMap, std::ostream& out)
 }
 
 
-/** Saves a buffer in 12p format as a 16-bit file */
+/** Queues a buffer in 12p format to be saved as a 16-bit file. The data is
+    unpacked while being written by the writer thread, so no temporary 16-bit
+    buffer is needed. The buffer is re-queued to the producer once it has been
+    written. If a file ring is given the buffer is saved in it, otherwise to
+    path.
+*/
 void save12bitBufferIn16bitFormat(GenTLApi* tl,
                                   GenTL::DS_HANDLE dataStreamHandle,
-                                  GenTL::BUFFER_HANDLE bufferHandle,
-                                  uint8_t* buffer16Data,
-                                  int64_t buffer16Size,
+                                  const Sample::BufferDescriptor& buffer,
                                   const Aoi& aoi,
-                                  const std::string& path)
+                                  const std::string& path,
+                                  GenIRanger::FrameFileRing* fileRing,
+                                  GenIRanger::AsyncFrameWriter& writer)
 {
-  GenTL::INFO_DATATYPE bufferInfoType = GenTL::INFO_DATATYPE_UNKNOWN;
-  size_t bufferInfoSize = sizeof(size_t);
-
-  uint8_t* buffer12Data;
-  size_t width;
-  size_t height;
-
-  CC(tl, tl->DSGetBufferInfo(dataStreamHandle,
-                             bufferHandle,
-                             GenTL::BUFFER_INFO_BASE,
-                             &bufferInfoType,
-                             &buffer12Data,
-                             &bufferInfoSize));
-
-  CC(tl, tl->DSGetBufferInfo(dataStreamHandle,
-                             bufferHandle,
-                             GenTL::BUFFER_INFO_WIDTH,
-                             &bufferInfoType,
-                             &width,
-                             &bufferInfoSize));
-  CC(tl, tl->DSGetBufferInfo(dataStreamHandle,
-                             bufferHandle,
-                             GenTL::BUFFER_INFO_HEIGHT,
-                             &bufferInfoType,
-                             &height,
-                             &bufferInfoSize));
-
-  size_t buffer12Size = width * height * 3 / 2;
-
-  GenIRanger::convert12pTo16(buffer12Data,
-                             buffer12Size,
-                             buffer16Data,
-                             &buffer16Size);
+  uint8_t* buffer12Data = buffer.mData;
+  const size_t width = buffer.mWidth;
+  const size_t height = buffer.mHeight;
+  GenTL::BUFFER_HANDLE bufferHandle = buffer.mHandle;
+
+  // Two pixels are packed into three bytes
+  const size_t buffer12Size = (width * height * 12 + 7) / 8;
+
+  GenIRanger::RangeFrame frame;
+  frame
+    .aoiOffset(aoi.mOffsetX, aoi.mOffsetY)
+    .aoiSize(width, aoi.mHeight);
+  frame.createRangeView(buffer12Data,
+                        buffer12Size,
+                        GenIRanger::PixelWidth::PW12,
+                        [tl, dataStreamHandle, bufferHandle](uint8_t*)
+                        {
+                          tl->DSQueueBuffer(dataStreamHandle, bufferHandle);
+                        });
 
   // Save buffer to disk
-  GenIRanger::saveBuffer16(
-    buffer16Data,
-    width,
-    height,
-    aoi.mHeight,
-    aoi.mOffsetX,
-    aoi.mOffsetY,
-    path);
+  if (fileRing != nullptr)
+  {
+    writer.write(frame, *fileRing);
+  }
+  else
+  {
+    writer.write(frame, path);
+  }
 }
 
 void clearPartialBuffers(GenTLApi* tl,
@@ -492,7 +660,9 @@ void clearPartialBuffers(GenTLApi* tl,
     if (result == GenTL::GC_ERR_SUCCESS)
     {
       deviceConnection->mLog << "Flush buffer \n: ";
-      logBufferInformation(tl, *deviceConnection, 0, bufferHandle);
+      Sample::BufferDescriptor buffer;
+      deviceConnection->mBufferReader.read(bufferHandle, buffer);
+      logBufferInformation(deviceConnection->mLog, 0, buffer);
 
       // Re-queue buffer
       CC(tl, tl->DSQueueBuffer(deviceConnection->mDataStreamHandle,
@@ -552,6 +722,10 @@ void setProcessPriority(void)
    - The maximum number of buffers on disk, when this number is reached old
      buffers will be overwritten
 
+   Each device is received on a thread of its own, so the devices progress
+   independently of each other. The received buffers of all devices are
+   logged and saved by the main thread.
+
    Acquisition can be aborted by pressing the escape key.
 */
 int main(int argc, char* argv[])
@@ -757,20 +931,10 @@ int main(int argc, char* argv[])
     int16_t aoiHeight = 200;
     deviceConnection->mAoi = Aoi(aoiOffsetX, aoiOffsetY, width, aoiHeight);
 
-    int64_t bufferWidth = width->GetValue();
-    size_t buffer16Size = static_cast<size_t>(bufferWidth * bufferHeight * 2);
-
     // Setup a sufficient amount of buffers
     GenApi::CIntegerPtr payload = device._GetNode("PayloadSize");
     const size_t payloadSize = static_cast<size_t>(payload->GetValue());
 
-    // A temporary buffer used for 12-to-16-bit conversion before saving to disk.
-    if (gTempBuffer == nullptr || buffer16Size > gTempBufferSize)
-    {
-      gTempBufferSize = buffer16Size;
-      gTempBuffer = new uint8_t[gTempBufferSize];
-    }
-
     // Announce and queue buffers to producer, we keep track of the buffers by
     // their index in the array. These will contain the 12-bit format sent from
     // the device
@@ -780,14 +944,48 @@ int main(int argc, char* argv[])
     // Register event so that we can be notified when new buffers have
     // been received
     deviceConnection->registerNewBufferEvent();
+
+    if (saveToDisk && rotationBufferCount != 0)
+    {
+      // The files are reused in turn. They are kept open and preallocated,
+      // so overwriting them is cheap.
+      deviceConnection->mFileRing.reset(new GenIRanger::FrameFileRing(
+        gSavePath + "\\" + bufferName + "-" + deviceConnection->mDeviceName,
+        static_cast<size_t>(rotationBufferCount)));
+    }
   }
 
   std::cout << "Total memory used for buffers: "
             << (totalAllocatedMemory / 1024 / 1024) << " MB"
             << std::endl;
 
+  // Buffers are saved by a background thread, so that a slow disk does not
+  // cause buffer underruns. A few buffers are always left to the producers.
+  GenIRanger::AsyncFrameWriter writer(
+    connectedDevices.size() * buffersCount / 2);
+  writer.setCompletionCallback(
+    [](const std::string& path, std::exception_ptr error)
+    {
+      if (error)
+      {
+        try
+        {
+          std::rethrow_exception(error);
+        }
+        catch (const std::exception& e)
+        {
+          std::cout << std::endl << "Could not save " << path << ": "
+                    << e.what() << std::endl;
+        }
+      }
+    });
+  writer.setBackpressureCallback([](size_t)
+  {
+    // The disk cannot keep up, acquisition waits for the writer
+    std::cout << "W";
+  });
+
   bool aborted = false;
-  const uint64_t timeout = 1000; // ms
 
   // Loop index is 1-based since it is printed to the user
   for (int j = 1; j <= startStopIterationsCount; ++j)
@@ -819,119 +1017,97 @@ int main(int argc, char* argv[])
 
     std::cout << "Acquiring buffers..." << std::endl;
 
-    int64_t currentUnderrunCount = 0;
-    int64_t previousUnderrunCount = 0;
+    ReceivedBufferQueue receivedBuffers(connectedDevices.size());
+    for (DeviceConnections::iterator it = connectedDevices.begin();
+         it != connectedDevices.end();
+         ++it)
+    {
+      (*it)->startReceiving(numBuffersToAcquire, receivedBuffers);
+    }
 
-    for (size_t i = 1; i < numBuffersToAcquire + 1; i++)
+    // The buffers of all devices are consumed here, in the order they arrive,
+    // until every device has received its buffers
+    for (;;)
     {
-      for (DeviceConnections::iterator it = connectedDevices.begin();
-           it != connectedDevices.end();
-           ++it)
+      if (!aborted && GetAsyncKeyState(VK_ESCAPE))
       {
-        std::shared_ptr<DeviceConnection> deviceConnection = *it;
+        std::cout << "Aborting acquisition..." << std::endl;
+        aborted = true;
+        for (DeviceConnections::iterator it = connectedDevices.begin();
+             it != connectedDevices.end();
+             ++it)
+        {
+          (*it)->abortReceiving();
+        }
+      }
 
-        try
+      // Woken by a buffer or by the last receive thread finishing. The
+      // timeout only bounds how long it takes to notice the escape key.
+      ReceivedBuffer buffer;
+      if (!receivedBuffers.pop(buffer, std::chrono::milliseconds(100)))
+      {
+        if (receivedBuffers.isFinished())
         {
-          if (GetAsyncKeyState(VK_ESCAPE))
-          {
-            std::cout << "Aborting acquisition..." << std::endl;
-            aborted = true;
-            break;
-          }
-
-          // Wait for buffer to be received
-          GenTL::EVENT_NEW_BUFFER_DATA event;
-          size_t eventSize = sizeof(event);
-          CC(tl, tl->EventGetData(deviceConnection->mNewBufferEventHandle,
-                                  &event,
-                                  &eventSize,
-                                  timeout));
-
-          std::cout << ".";
-
-          GenTL::BUFFER_HANDLE bufferHandle = event.BufferHandle;
-
-          size_t numAwaitingDelivery;
-          size_t numAwaitingDeliverySize = sizeof(numAwaitingDelivery);
-          GenTL::INFO_DATATYPE dataType;
-          CC(tl, tl->DSGetInfo(deviceConnection->mDataStreamHandle,
-                               GenTL::STREAM_INFO_NUM_AWAIT_DELIVERY,
-                               &dataType,
-                               &numAwaitingDelivery,
-                               &numAwaitingDeliverySize));
-
-          if (i + numAwaitingDelivery >= numBuffersToAcquire
-              && deviceConnection->isAcquisitionRunning())
-          {
-            // The producer has received enough buffers, tell the device to
-            // stop. We will continue to process them in our own pace
-            std::cout << "\n" << deviceConnection->mDeviceName
-                      << " has sent enough buffers" << std::endl;
-            deviceConnection->stopAcquisition();
-          }
-
-          // Log information about the received buffer
-          logBufferInformation(tl, *deviceConnection, i, bufferHandle);
-
-          GenApi::CIntegerPtr engineUnderrunCount = deviceConnection
-            ->mDataStreamNodeMap._GetNode("GevStreamEngineUnderrunCount");
-          if (engineUnderrunCount.IsValid())
-          {
-            currentUnderrunCount = engineUnderrunCount->GetValue();
-            if (currentUnderrunCount != previousUnderrunCount)
-            {
-              std::cout << "U";
-              deviceConnection->mLog << "StreamEngineUnderrunCount: "
-                                     << currentUnderrunCount << std::endl;
-            }
-            previousUnderrunCount = currentUnderrunCount;
-          }
-
-          if (saveToDisk)
-          {
-            // Append loop index to buffer name
-            size_t fileSuffix = i;
-            if (rotationBufferCount != 0)
-            {
-              fileSuffix = i % rotationBufferCount;
-            }
-
-            std::stringstream bufferPath;
-            bufferPath << gSavePath << "\\" << bufferName << "-"
-                       << deviceConnection->mDeviceName << "-" << fileSuffix;
-
-            uint8_t* bufferData = static_cast<uint8_t*>(event.pUserPointer);
-            save12bitBufferIn16bitFormat(tl,
-                                         deviceConnection->mDataStreamHandle,
-                                         event.BufferHandle,
-                                         gTempBuffer,
-                                         gTempBufferSize,
-                                         deviceConnection->mAoi,
-                                         bufferPath.str());
-          }
+          break;
+        }
+        continue;
+      }
 
-          // Re-queue buffer
-          CC(tl, tl->DSQueueBuffer(deviceConnection->mDataStreamHandle,
-                                   bufferHandle));
+      DeviceConnection* deviceConnection = buffer.mDevice;
+      try
+      {
+        std::cout << ".";
+        if (saveToDisk)
+        {
+          // Append loop index to buffer name
+          std::stringstream bufferPath;
+          bufferPath << gSavePath << "\\" << bufferName << "-"
+                     << deviceConnection->mDeviceName << "-"
+                     << buffer.mBufferNum;
+
+          // The buffer is re-queued once it has been written
+          save12bitBufferIn16bitFormat(tl,
+                                       deviceConnection->mDataStreamHandle,
+                                       buffer.mBuffer,
+                                       deviceConnection->mAoi,
+                                       bufferPath.str(),
+                                       deviceConnection->mFileRing.get(),
+                                       writer);
         }
-        catch (const std::exception& e)
+        else
         {
-          std::cout << std::endl
-                    << "Error from " << deviceConnection->mDeviceName
-                    << std::endl;
-          std::cout << e.what() << std::endl;
-          exitStatus = 1;
+          // Re-queue buffer
+          CC(tl, tl->DSQueueBuffer(deviceConnection->mDataStreamHandle,
+                                   buffer.mBuffer.mHandle));
         }
       }
-      if (aborted)
+      catch (const std::exception& e)
       {
-        break;
+        std::cout << std::endl
+                  << "Error from " << deviceConnection->mDeviceName
+                  << std::endl;
+        std::cout << e.what() << std::endl;
+        deviceConnection->setFailed();
+      }
+    }
+
+    for (DeviceConnections::iterator it = connectedDevices.begin();
+         it != connectedDevices.end();
+         ++it)
+    {
+      (*it)->joinReceiving();
+      if ((*it)->hasFailed())
+      {
+        exitStatus = 1;
       }
     }
 
     // Force a newline after previous progress output
     std::cout << std::endl;
 
+    // Wait for the remaining buffers to be written and re-queued
+    writer.flush();
+
     for (DeviceConnections::iterator it = connectedDevices.begin();
          it != connectedDevices.end();
          ++it)
@@ -986,9 +1162,6 @@ int main(int argc, char* argv[])
     consumer.closeDevice(deviceConnection->mDeviceHandle);
   }
 
-  delete[] gTempBuffer;
-  gTempBuffer = nullptr;
-
   for (std::set<GenTL::IF_HANDLE>::iterator it = openInterfaces.begin();
        it != openInterfaces.end();
        ++it)
@@ -0,0 +1,125 @@
+// Copyright 2018 SICK AG. All rights reserved.
+
+#include "GenIRanger.h"
+#include "StreamData.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Size of the synthetic frame, a full width Ranger3 range frame
+const size_t FRAME_WIDTH = 2560;
+const size_t FRAME_LINES = 4000;
+const size_t ITERATIONS = 20;
+
+void usage(int, char* argv[])
+{
+  std::cout << "Usage:" << std::endl
+            << argv[0] << " [file path for benchmark files]" << std::endl;
+  std::cout << std::endl;
+  std::cout << "Compares the time to save a multipart range frame with the "
+            << "library, to a plain" << std::endl
+            << "stream based implementation writing each value separately."
+            << std::endl;
+  std::cout << "File path should include the name of the file to save without "
+            << "extension." << std::endl
+            << "E.g. C:\\MyBuffers\\benchmark, by default save_benchmark in "
+            << "the current directory." << std::endl;
+}
+
+/** Saves the DAT-file the way it was done before gathered writes, with one
+    stream write per component and one per mark value.
+*/
+void saveWithStream(GenIRanger::RangeFrame& frame, const std::string& filePath)
+{
+  std::ofstream dat(filePath + ".dat",
+                    std::ios::binary | std::ios::trunc | std::ios::out);
+  dat.exceptions(std::ios::failbit | std::ios::badbit);
+
+  GenIRanger::ComponentPtr components[] =
+  {
+    frame.range(), frame.reflectance(), frame.scatter()
+  };
+  for (size_t i = 0; i < 3; ++i)
+  {
+    dat.write(reinterpret_cast<const char*>(components[i]->bytes()),
+              components[i]->sizeInBytes());
+  }
+
+  const GenIRanger::Metadata notUsed = 0;
+  for (auto encoderValue : *frame.lineEncoderValues())
+  {
+    dat.write(reinterpret_cast<const char*>(&encoderValue),
+              sizeof(encoderValue));
+    for (size_t i = 0; i < 4; ++i)
+    {
+      dat.write(reinterpret_cast<const char*>(&notUsed), sizeof(notUsed));
+    }
+  }
+}
+
+template<class SAVE>
+double timeMs(SAVE save)
+{
+  auto start = std::chrono::steady_clock::now();
+  save();
+  auto stop = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::milli>(stop - start).count();
+}
+
+/**
+   This sample measures how long it takes to save a synthetic range frame.
+   It needs no console input and runs on Linux as well as Windows.
+
+   The program takes one optional command line argument, the file path to
+   save to without extension.
+*/
+int main(int argc, char* argv[])
+{
+  if (argc > 2)
+  {
+    usage(argc, argv);
+    return 1;
+  }
+  const std::string filePath = argc > 1 ? argv[1] : "save_benchmark";
+
+  const size_t pixelCount = FRAME_WIDTH * FRAME_LINES;
+  GenIRanger::RangeFrame frame;
+  frame.aoiSize(FRAME_WIDTH, 832).aoiOffset(0, 0);
+  frame.createRange(pixelCount * 2, GenIRanger::PixelWidth::PW16);
+  frame.createReflectance(pixelCount, GenIRanger::PixelWidth::PW8);
+  frame.createScatter(pixelCount, GenIRanger::PixelWidth::PW8);
+  frame.createLineEncoderValues(FRAME_LINES);
+  for (size_t i = 0; i < FRAME_LINES; ++i)
+  {
+    (*frame.lineEncoderValues())[i] = static_cast<GenIRanger::Metadata>(i);
+  }
+
+  const std::string streamPath = filePath + "-stream";
+  const std::string libraryPath = filePath + "-library";
+
+  std::cout << "Saving a " << FRAME_WIDTH << "x" << FRAME_LINES
+            << " frame with reflectance, scatter and marks, best of "
+            << ITERATIONS << " runs" << std::endl;
+  // The two ways are alternated, so that both see the same amount of earlier
+  // written data still being flushed to disk
+  double streamMs = 0;
+  double libraryMs = 0;
+  for (size_t i = 0; i < ITERATIONS; ++i)
+  {
+    double elapsed = timeMs([&]() { saveWithStream(frame, streamPath); });
+    streamMs = (i == 0) ? elapsed : std::min(streamMs, elapsed);
+    elapsed = timeMs([&]()
+    {
+      GenIRanger::saveMultipartRangeFrame(frame, libraryPath);
+    });
+    libraryMs = (i == 0) ? elapsed : std::min(libraryMs, elapsed);
+  }
+  std::cout << "Stream writes:           " << streamMs << " ms" << std::endl;
+  std::cout << "saveMultipartRangeFrame: " << libraryMs << " ms"
+            << " (including the XML-file)" << std::endl;
+  return 0;
+}
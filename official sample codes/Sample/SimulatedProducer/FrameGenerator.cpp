@@ -0,0 +1,318 @@
+// Copyright 2018 SICK AG. All rights reserved.
+
+#include "FrameGenerator.h"
+
+#include "TLI/GenTL.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace Simulator
+{
+
+namespace
+{
+
+// Lines in the template of each part. Even, so that every other line of
+// 12 bit packed data starts on a byte.
+const size_t TEMPLATE_LINES = 64;
+
+const size_t CHUNK_TRAILER_SIZE = 8;
+
+const uint32_t ENCODER_A_BIT = 1 << 8;
+const uint32_t ENCODER_B_BIT = 1 << 9;
+const uint32_t FRAME_TRIGGER_ACTIVE_BIT = 1 << 10;
+
+size_t bitsPerPixel(Component component)
+{
+  switch (component)
+  {
+  case COMPONENT_RANGE:
+    return 12;
+  case COMPONENT_SCATTER:
+    return 16;
+  default:
+    return 8;
+  }
+}
+
+size_t roundUp4(size_t size)
+{
+  return (size + 3) & ~size_t(3);
+}
+
+void writeLittleEndian32(uint8_t* data, uint32_t value)
+{
+  data[0] = static_cast<uint8_t>(value);
+  data[1] = static_cast<uint8_t>(value >> 8);
+  data[2] = static_cast<uint8_t>(value >> 16);
+  data[3] = static_cast<uint8_t>(value >> 24);
+}
+
+void writeLittleEndian64(uint8_t* data, uint64_t value)
+{
+  writeLittleEndian32(data, static_cast<uint32_t>(value));
+  writeLittleEndian32(data + 4, static_cast<uint32_t>(value >> 32));
+}
+
+void writeBigEndian32(uint8_t* data, uint32_t value)
+{
+  data[0] = static_cast<uint8_t>(value >> 24);
+  data[1] = static_cast<uint8_t>(value >> 16);
+  data[2] = static_cast<uint8_t>(value >> 8);
+  data[3] = static_cast<uint8_t>(value);
+}
+
+void writeChunkTrailer(uint8_t* data, uint32_t chunkId, size_t length)
+{
+  writeBigEndian32(data, chunkId);
+  writeBigEndian32(data + 4, static_cast<uint32_t>(length));
+}
+
+/** Range of a template pixel, 0 means missing data. */
+uint16_t rangeValue(size_t x, size_t y, size_t width)
+{
+  const size_t bandStart = width / 10;
+  const size_t bandEnd = bandStart + std::max<size_t>(width / 20, 1);
+  if (x >= bandStart && x < bandEnd && y % 16 < 4)
+  {
+    return 0;
+  }
+  const double pi = 3.14159265358979;
+  const double phase = 2 * pi
+    * (3.0 * x / width + static_cast<double>(y) / TEMPLATE_LINES);
+  const double value = 2048 + 1500 * std::sin(phase);
+  return static_cast<uint16_t>(std::min(std::max(value, 1.0), 4095.0));
+}
+
+}
+
+FrameLayout::FrameLayout()
+  : mPayloadType(GenTL::PAYLOAD_TYPE_UNKNOWN)
+  , mWidth(0)
+  , mHeight(0)
+  , mPartCount(0)
+  , mHasChunks(false)
+  , mMetadataOffset(0)
+  , mMetadataLength(0)
+  , mPayloadSize(0)
+  , mLineRate(0)
+{
+  std::memset(mParts, 0, sizeof(mParts));
+}
+
+FrameLayout makeFrameLayout(ScanType scanType,
+                            size_t width,
+                            size_t height,
+                            const bool* componentEnabled,
+                            bool chunkModeActive,
+                            double lineRate)
+{
+  FrameLayout layout;
+  layout.mWidth = width;
+  layout.mHeight = height;
+  layout.mLineRate = lineRate;
+
+  if (scanType == AREASCAN)
+  {
+    PartLayout& part = layout.mParts[0];
+    part.mComponent = COMPONENT_REFLECTANCE;
+    part.mSize = width * height;
+    part.mDataType = GenTL::PART_DATATYPE_2D_IMAGE;
+    part.mPixelFormat = PFNC_MONO8;
+    part.mWidth = width;
+    part.mHeight = height;
+    layout.mPartCount = 1;
+    layout.mPayloadType = GenTL::PAYLOAD_TYPE_IMAGE;
+    layout.mPayloadSize = part.mSize;
+    return layout;
+  }
+
+  size_t offset = 0;
+  for (int i = 0; i < COMPONENT_COUNT; ++i)
+  {
+    if (!componentEnabled[i])
+    {
+      continue;
+    }
+    const Component component = static_cast<Component>(i);
+    PartLayout& part = layout.mParts[layout.mPartCount++];
+    part.mComponent = component;
+    part.mOffset = offset;
+    part.mSize = (width * height * bitsPerPixel(component) + 7) / 8;
+    part.mWidth = width;
+    part.mHeight = height;
+    if (component == COMPONENT_RANGE)
+    {
+      part.mDataType = GenTL::PART_DATATYPE_3D_IMAGE;
+      part.mPixelFormat = PFNC_COORD3D_C12P;
+    }
+    else
+    {
+      part.mDataType = GenTL::PART_DATATYPE_2D_IMAGE;
+      part.mPixelFormat = component == COMPONENT_SCATTER
+        ? PFNC_MONO16
+        : PFNC_MONO8;
+    }
+    offset += part.mSize;
+  }
+  if (layout.mPartCount == 0)
+  {
+    return layout;
+  }
+
+  layout.mPayloadType = GenTL::PAYLOAD_TYPE_MULTI_PART;
+  layout.mPayloadSize = offset;
+  if (chunkModeActive)
+  {
+    // The image chunk must keep the following chunk 32 bit aligned
+    layout.mHasChunks = true;
+    layout.mMetadataOffset = roundUp4(offset) + CHUNK_TRAILER_SIZE;
+    layout.mMetadataLength =
+      METADATA_HEADER_SIZE + height * METADATA_LINE_SIZE;
+    layout.mPayloadSize = layout.mMetadataOffset + layout.mMetadataLength
+      + CHUNK_TRAILER_SIZE;
+  }
+  return layout;
+}
+
+FrameGenerator::FrameGenerator(const FrameLayout& layout)
+  : mLayout(layout)
+{
+  for (uint32_t i = 0; i < mLayout.mPartCount; ++i)
+  {
+    const PartLayout& part = mLayout.mParts[i];
+    prepareTemplate(part, mTemplates[part.mComponent]);
+  }
+}
+
+void FrameGenerator::fill(uint8_t* buffer,
+                          uint64_t frameId,
+                          const LineClock& clock) const
+{
+  size_t imageEnd = 0;
+  for (uint32_t i = 0; i < mLayout.mPartCount; ++i)
+  {
+    const PartLayout& part = mLayout.mParts[i];
+    fillPart(buffer, part, mTemplates[part.mComponent], frameId);
+    imageEnd = part.mOffset + part.mSize;
+  }
+  if (!mLayout.mHasChunks)
+  {
+    return;
+  }
+
+  const size_t imageChunkLength = roundUp4(imageEnd);
+  std::memset(buffer + imageEnd, 0, imageChunkLength - imageEnd);
+  writeChunkTrailer(buffer + imageChunkLength, IMAGE_CHUNK_ID,
+                    imageChunkLength);
+  fillMetadata(buffer + mLayout.mMetadataOffset, clock);
+  writeChunkTrailer(buffer + mLayout.mMetadataOffset
+                      + mLayout.mMetadataLength,
+                    METADATA_CHUNK_ID,
+                    mLayout.mMetadataLength);
+}
+
+void FrameGenerator::prepareTemplate(const PartLayout& part,
+                                     std::vector<uint8_t>& data)
+{
+  const size_t width = part.mWidth;
+  const size_t bits = bitsPerPixel(part.mComponent);
+  data.assign(TEMPLATE_LINES * width * bits / 8, 0);
+  uint8_t* out = data.data();
+  for (size_t y = 0; y < TEMPLATE_LINES; ++y)
+  {
+    for (size_t x = 0; x < width; ++x)
+    {
+      switch (part.mComponent)
+      {
+      case COMPONENT_RANGE:
+      {
+        // Two pixels in three bytes, the template holds an even number
+        const uint16_t value = rangeValue(x, y, width);
+        if ((y * width + x) % 2 == 0)
+        {
+          out[0] = static_cast<uint8_t>(value);
+          out[1] = static_cast<uint8_t>(value >> 8);
+        }
+        else
+        {
+          out[1] |= static_cast<uint8_t>((value & 0x0F) << 4);
+          out[2] = static_cast<uint8_t>(value >> 4);
+          out += 3;
+        }
+        break;
+      }
+      case COMPONENT_SCATTER:
+      {
+        const uint16_t value = static_cast<uint16_t>((x + y * 16) & 0xFFF);
+        out[0] = static_cast<uint8_t>(value);
+        out[1] = static_cast<uint8_t>(value >> 8);
+        out += 2;
+        break;
+      }
+      default:
+        *out++ = static_cast<uint8_t>(x * 255 / std::max<size_t>(width, 2)
+                                      + y * 4);
+        break;
+      }
+    }
+  }
+}
+
+void FrameGenerator::fillPart(uint8_t* buffer,
+                              const PartLayout& part,
+                              const std::vector<uint8_t>& data,
+                              uint64_t frameId) const
+{
+  if (data.empty())
+  {
+    return;
+  }
+  // An even start line keeps the copy on whole bytes for any format
+  const size_t startLine = static_cast<size_t>(frameId * 2 % TEMPLATE_LINES);
+  size_t source = startLine * part.mWidth
+    * bitsPerPixel(part.mComponent) / 8;
+  uint8_t* out = buffer + part.mOffset;
+  size_t remaining = part.mSize;
+  while (remaining > 0)
+  {
+    const size_t count = std::min(remaining, data.size() - source);
+    std::memcpy(out, data.data() + source, count);
+    out += count;
+    remaining -= count;
+    source = 0;
+  }
+}
+
+void FrameGenerator::fillMetadata(uint8_t* buffer,
+                                  const LineClock& clock) const
+{
+  std::memset(buffer, 0, METADATA_HEADER_SIZE);
+  writeLittleEndian32(buffer, static_cast<uint32_t>(mLayout.mWidth));
+  writeLittleEndian32(buffer + 4, static_cast<uint32_t>(mLayout.mHeight));
+
+  uint8_t* line = buffer + METADATA_HEADER_SIZE;
+  for (size_t i = 0; i < mLayout.mHeight; ++i)
+  {
+    const uint32_t encoder =
+      static_cast<uint32_t>(clock.mEncoderValue) + static_cast<uint32_t>(i);
+    // Quadrature signals of an encoder moving forward one step per line
+    uint32_t flags = FRAME_TRIGGER_ACTIVE_BIT;
+    if (((encoder + 1) >> 1) & 1)
+    {
+      flags |= ENCODER_A_BIT;
+    }
+    if ((encoder >> 1) & 1)
+    {
+      flags |= ENCODER_B_BIT;
+    }
+    writeLittleEndian64(line, clock.mTimestampNs + i * clock.mLineIntervalNs);
+    writeLittleEndian32(line + 8, encoder);
+    writeLittleEndian32(line + 12, flags);
+    line += METADATA_LINE_SIZE;
+  }
+}
+
+}
@@ -0,0 +1,116 @@
+// Copyright 2018 SICK AG. All rights reserved.
+
+#ifndef SIMULATED_FRAME_GENERATOR_H
+#define SIMULATED_FRAME_GENERATOR_H
+
+#include "NodeMaps.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace Simulator
+{
+
+const uint64_t PFNC_MONO8 = 0x01080001;
+const uint64_t PFNC_MONO16 = 0x01100007;
+const uint64_t PFNC_COORD3D_C12P = 0x010C00DA;
+
+/** Where one part is found in the payload, and what it contains. */
+struct PartLayout
+{
+  Component mComponent;
+  size_t mOffset;
+  size_t mSize;
+  /** GenTL::PART_DATATYPE_LIST */
+  size_t mDataType;
+  uint64_t mPixelFormat;
+  size_t mWidth;
+  size_t mHeight;
+};
+
+/** The layout of the payload as given by the device parameters when the
+    acquisition is started.
+
+    In Linescan3D the enabled components follow each other in the order
+    range, reflectance and scatter. With ChunkModeActive the parts are
+    wrapped in an image chunk, followed by the metadata chunk, like a
+    GigE Vision device does. In Areascan the payload is a single Mono8
+    image of Region0 without chunks.
+*/
+struct FrameLayout
+{
+  FrameLayout();
+
+  /** GenTL::PAYLOADTYPE_INFO_IDS */
+  size_t mPayloadType;
+  size_t mWidth;
+  size_t mHeight;
+  uint32_t mPartCount;
+  PartLayout mParts[COMPONENT_COUNT];
+
+  bool mHasChunks;
+  /** Start and length of the metadata chunk, without the trailer. */
+  size_t mMetadataOffset;
+  size_t mMetadataLength;
+  size_t mPayloadSize;
+
+  /** Lines per second, 0 means as fast as buffers are queued. */
+  double mLineRate;
+};
+
+/** Computes the layout for the given parameters. An empty payload means
+    that no component is enabled.
+*/
+FrameLayout makeFrameLayout(ScanType scanType,
+                            size_t width,
+                            size_t height,
+                            const bool* componentEnabled,
+                            bool chunkModeActive,
+                            double lineRate);
+
+/** Synthetic line metadata of one frame. */
+struct LineClock
+{
+  /** Timestamp of the first line, in nanoseconds. */
+  uint64_t mTimestampNs;
+  uint64_t mLineIntervalNs;
+  /** Encoder value of the first line, it counts one step per line. */
+  int32_t mEncoderValue;
+};
+
+/** Writes synthetic frames with a given layout.
+
+    The image data is copied from a template of a few lines per part,
+    prepared once, starting at a line that moves with the frame id. That
+    keeps the generator cheap enough to not limit the throughput measured
+    on the consumer side, while the frames still differ. The range data is
+    a slowly moving wave with a band of missing data, the reflectance and
+    scatter are gradients.
+*/
+class FrameGenerator
+{
+public:
+  explicit FrameGenerator(const FrameLayout& layout);
+
+  const FrameLayout& layout() const { return mLayout; }
+
+  /** Writes a frame to buffer, which must hold the payload size. */
+  void fill(uint8_t* buffer, uint64_t frameId, const LineClock& clock) const;
+
+private:
+  FrameGenerator(const FrameGenerator&);
+  FrameGenerator& operator=(const FrameGenerator&);
+
+  void prepareTemplate(const PartLayout& part, std::vector<uint8_t>& data);
+  void fillPart(uint8_t* buffer, const PartLayout& part,
+                const std::vector<uint8_t>& data, uint64_t frameId) const;
+  void fillMetadata(uint8_t* buffer, const LineClock& clock) const;
+
+private:
+  FrameLayout mLayout;
+  std::vector<uint8_t> mTemplates[COMPONENT_COUNT];
+};
+
+}
+
+#endif
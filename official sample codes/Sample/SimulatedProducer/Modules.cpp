@@ -0,0 +1,1972 @@
+// Copyright 2018 SICK AG. All rights reserved.
+
+#include "Modules.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <new>
+#include <sstream>
+#include <system_error>
+
+namespace Simulator
+{
+
+namespace
+{
+
+const char* const VENDOR = "SICK";
+const char* const MODEL = "Ranger3Simulated";
+const char* const VERSION = "1.0";
+const char* const TL_ID = "SimulatedRanger3";
+const char* const TL_TYPE = "GEV";
+
+/** Size of the GigE Vision packets a frame would be sent in, only used for
+    the stream statistics.
+*/
+const size_t PACKET_SIZE = 8000;
+
+/** Longer timeouts are treated as infinite, to not overflow the clock. */
+const uint64_t MAX_TIMEOUT_MS = 1000ull * 60 * 60 * 24 * 365;
+
+/** Room for the data of an event that is never signaled. */
+const size_t EVENT_DATA_SIZE_MAX = 1024;
+
+/** The chunk layout only changes with the parameters, the id is only used
+    to tell if there are chunks or not.
+*/
+const uint64_t CHUNK_LAYOUT_ID = 1;
+
+std::mutex lastErrorMutex;
+GenTL::GC_ERROR lastErrorCode = GenTL::GC_ERR_SUCCESS;
+std::string lastErrorMessage;
+
+bool readEnvironment(const char* name, double& value)
+{
+  const char* text = std::getenv(name);
+  if (text == nullptr || *text == '\0')
+  {
+    return false;
+  }
+  char* end = nullptr;
+  const double parsed = std::strtod(text, &end);
+  if (*end != '\0')
+  {
+    return false;
+  }
+  value = parsed;
+  return true;
+}
+
+bool overlaps(uint64_t address, size_t size, uint64_t start, size_t length)
+{
+  return address < start + length && start < address + size;
+}
+
+uint64_t regionAddress(Region region, uint64_t field)
+{
+  return DeviceRegister::REGION_TABLE
+    + region * DeviceRegister::REGION_STRIDE + field;
+}
+
+uint64_t componentAddress(int component)
+{
+  return DeviceRegister::COMPONENT_TABLE
+    + component * DeviceRegister::COMPONENT_STRIDE;
+}
+
+std::string deviceId(uint32_t index)
+{
+  std::ostringstream id;
+  id << "SimulatedRanger3_" << index;
+  return id.str();
+}
+
+std::string serialNumber(uint32_t index)
+{
+  std::ostringstream serial;
+  serial << "SIM" << std::setw(5) << std::setfill('0') << index;
+  return serial.str();
+}
+
+uint64_t nowNs()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/** Lines delivered of a frame that was filled up to sizeFilled. */
+size_t deliveredHeight(const FrameLayout& layout, size_t sizeFilled)
+{
+  if (layout.mPayloadSize == 0 || sizeFilled >= layout.mPayloadSize)
+  {
+    return layout.mHeight;
+  }
+  return static_cast<size_t>(
+    static_cast<uint64_t>(layout.mHeight) * sizeFilled / layout.mPayloadSize);
+}
+
+}
+
+Configuration::Configuration()
+  : mDeviceCount(1)
+  , mLineRate(-1)
+  , mDropEvery(0)
+  , mIncompleteEvery(0)
+{
+  // Empty
+}
+
+Configuration Configuration::fromEnvironment()
+{
+  Configuration configuration;
+  double value = 0;
+  if (readEnvironment("RANGER3_SIM_DEVICES", value)
+      && value >= 1
+      && value <= InterfaceRegister::MAX_DEVICES)
+  {
+    configuration.mDeviceCount = static_cast<uint32_t>(value);
+  }
+  if (readEnvironment("RANGER3_SIM_LINE_RATE", value))
+  {
+    configuration.mLineRate = value;
+  }
+  if (readEnvironment("RANGER3_SIM_DROP_EVERY", value) && value >= 0)
+  {
+    configuration.mDropEvery = static_cast<uint32_t>(value);
+  }
+  if (readEnvironment("RANGER3_SIM_INCOMPLETE_EVERY", value) && value >= 0)
+  {
+    configuration.mIncompleteEvery = static_cast<uint32_t>(value);
+  }
+  return configuration;
+}
+
+GenTL::GC_ERROR setLastError(GenTL::GC_ERROR code,
+                             const std::string& message)
+{
+  std::lock_guard<std::mutex> lock(lastErrorMutex);
+  lastErrorCode = code;
+  lastErrorMessage = message;
+  return code;
+}
+
+void getLastError(GenTL::GC_ERROR& code, std::string& message)
+{
+  std::lock_guard<std::mutex> lock(lastErrorMutex);
+  code = lastErrorCode;
+  message = lastErrorMessage;
+}
+
+GenTL::GC_ERROR setInfoString(const std::string& value,
+                              GenTL::INFO_DATATYPE* type,
+                              void* buffer,
+                              size_t* size)
+{
+  if (size == nullptr)
+  {
+    return setLastError(GenTL::GC_ERR_INVALID_PARAMETER, "Size is null");
+  }
+  if (type != nullptr)
+  {
+    *type = GenTL::INFO_DATATYPE_STRING;
+  }
+  const size_t needed = value.size() + 1;
+  if (buffer != nullptr)
+  {
+    if (*size < needed)
+    {
+      *size = needed;
+      return setLastError(GenTL::GC_ERR_BUFFER_TOO_SMALL,
+                          "Buffer too small for info string");
+    }
+    std::memcpy(buffer, value.c_str(), needed);
+  }
+  *size = needed;
+  return GenTL::GC_ERR_SUCCESS;
+}
+
+Handle::Handle(HandleKind kind)
+  : mMagic(MAGIC)
+  , mKind(kind)
+{
+  // Empty
+}
+
+Handle::~Handle()
+{
+  mMagic = 0;
+}
+
+bool Handle::isHandle(void* handle)
+{
+  const Handle* object = static_cast<Handle*>(handle);
+  return object != nullptr && object->mMagic == MAGIC;
+}
+
+Port::Port(HandleKind kind,
+           const std::string& portName,
+           const std::string& xml,
+           size_t registerSize,
+           bool bigEndian)
+  : Handle(kind)
+  , mPortName(portName)
+  , mXml(xml)
+  , mBigEndian(bigEndian)
+  , mRegisters(registerSize, 0)
+{
+  // Empty
+}
+
+Port::~Port()
+{
+  // Empty
+}
+
+Port* Port::fromHandle(void* handle)
+{
+  if (!isHandle(handle))
+  {
+    return nullptr;
+  }
+  Handle* object = static_cast<Handle*>(handle);
+  switch (object->kind())
+  {
+  case SYSTEM_MODULE:
+  case INTERFACE_MODULE:
+  case DEVICE_MODULE:
+  case REMOTE_DEVICE:
+  case DATA_STREAM_MODULE:
+    return static_cast<Port*>(object);
+  default:
+    return nullptr;
+  }
+}
+
+GenTL::GC_ERROR Port::read(uint64_t address, void* buffer, size_t* size)
+{
+  if (buffer == nullptr || size == nullptr)
+  {
+    return setLastError(GenTL::GC_ERR_INVALID_PARAMETER,
+                        "Buffer or size is null");
+  }
+  if (address >= XML_ADDRESS)
+  {
+    const uint64_t offset = address - XML_ADDRESS;
+    if (offset > mXml.size() || *size > mXml.size() - offset)
+    {
+      return setLastError(GenTL::GC_ERR_INVALID_ADDRESS,
+                          "Read outside of the XML");
+    }
+    std::memcpy(buffer, mXml.data() + offset, *size);
+    return GenTL::GC_ERR_SUCCESS;
+  }
+
+  std::lock_guard<std::mutex> lock(mRegisterMutex);
+  if (address > mRegisters.size() || *size > mRegisters.size() - address)
+  {
+    return setLastError(GenTL::GC_ERR_INVALID_ADDRESS,
+                        "Read outside of the registers");
+  }
+  beforeRead(address, *size);
+  std::memcpy(buffer, mRegisters.data() + address, *size);
+  return GenTL::GC_ERR_SUCCESS;
+}
+
+GenTL::GC_ERROR Port::write(uint64_t address,
+                            const void* buffer,
+                            size_t* size)
+{
+  if (buffer == nullptr || size == nullptr)
+  {
+    return setLastError(GenTL::GC_ERR_INVALID_PARAMETER,
+                        "Buffer or size is null");
+  }
+
+  std::lock_guard<std::mutex> lock(mRegisterMutex);
+  if (address > mRegisters.size() || *size > mRegisters.size() - address)
+  {
+    return setLastError(GenTL::GC_ERR_INVALID_ADDRESS,
+                        "Write outside of the registers");
+  }
+  const GenTL::GC_ERROR status = checkWrite(address, *size);
+  if (status != GenTL::GC_ERR_SUCCESS)
+  {
+    return status;
+  }
+  std::memcpy(mRegisters.data() + address, buffer, *size);
+  afterWrite(address, *size);
+  return GenTL::GC_ERR_SUCCESS;
+}
+
+GenTL::GC_ERROR Port::getInfo(GenTL::PORT_INFO_CMD command,
+                              GenTL::INFO_DATATYPE* type,
+                              void* buffer,
+                              size_t* size)
+{
+  switch (command)
+  {
+  case GenTL::PORT_INFO_ID:
+  case GenTL::PORT_INFO_PORTNAME:
+    return setInfoString(mPortName, type, buffer, size);
+  case GenTL::PORT_INFO_VENDOR:
+    return setInfoString(VENDOR, type, buffer, size);
+  case GenTL::PORT_INFO_MODEL:
+    return setInfoString(MODEL, type, buffer, size);
+  case GenTL::PORT_INFO_TLTYPE:
+    return setInfoString(TL_TYPE, type, buffer, size);
+  case GenTL::PORT_INFO_MODULE:
+    return setInfoString(moduleName(), type, buffer, size);
+  case GenTL::PORT_INFO_LITTLE_ENDIAN:
+    return setInfo(GenTL::INFO_DATATYPE_BOOL8,
+                   static_cast<bool8_t>(!mBigEndian), type, buffer, size);
+  case GenTL::PORT_INFO_BIG_ENDIAN:
+    return setInfo(GenTL::INFO_DATATYPE_BOOL8,
+                   static_cast<bool8_t>(mBigEndian), type, buffer, size);
+  case GenTL::PORT_INFO_ACCESS_READ:
+  case GenTL::PORT_INFO_ACCESS_WRITE:
+    return setInfo(GenTL::INFO_DATATYPE_BOOL8,
+                   static_cast<bool8_t>(true), type, buffer, size);
+  case GenTL::PORT_INFO_ACCESS_NA:
+  case GenTL::PORT_INFO_ACCESS_NI:
+    return setInfo(GenTL::INFO_DATATYPE_BOOL8,
+                   static_cast<bool8_t>(false), type, buffer, size);
+  case GenTL::PORT_INFO_VERSION:
+    return setInfoString(VERSION, type, buffer, size);
+  default:
+    return setLastError(GenTL::GC_ERR_NOT_IMPLEMENTED,
+                        "Port info command not supported");
+  }
+}
+
+GenTL::GC_ERROR Port::getUrlInfo(uint32_t index,
+                                 GenTL::URL_INFO_CMD command,
+                                 GenTL::INFO_DATATYPE* type,
+                                 void* buffer,
+                                 size_t* size)
+{
+  if (index != 0)
+  {
+    return setLastError(GenTL::GC_ERR_INVALID_INDEX,
+                        "Port has a single URL");
+  }
+  switch (command)
+  {
+  case GenTL::URL_INFO_URL:
+    return setInfoString(url(), type, buffer, size);
+  case GenTL::URL_INFO_SCHEMA_VER_MAJOR:
+  case GenTL::URL_INFO_SCHEMA_VER_MINOR:
+  case GenTL::URL_INFO_FILE_VER_MAJOR:
+    return setInfo(GenTL::INFO_DATATYPE_INT32, int32_t(1), type, buffer, size);
+  case GenTL::URL_INFO_FILE_VER_MINOR:
+  case GenTL::URL_INFO_FILE_VER_SUBMINOR:
+    return setInfo(GenTL::INFO_DATATYPE_INT32, int32_t(0), type, buffer, size);
+  case GenTL::URL_INFO_FILE_REGISTER_ADDRESS:
+    return setInfo(GenTL::INFO_DATATYPE_UINT64, XML_ADDRESS,
+                   type, buffer, size);
+  case GenTL::URL_INFO_FILE_SIZE:
+    return setInfo(GenTL::INFO_DATATYPE_UINT64,
+                   static_cast<uint64_t>(mXml.size()), type, buffer, size);
+  case GenTL::URL_INFO_SCHEME:
+    return setInfo(GenTL::INFO_DATATYPE_INT32,
+                   static_cast<int32_t>(GenTL::URL_SCHEME_LOCAL),
+                   type, buffer, size);
+  case GenTL::URL_INFO_FILENAME:
+    return setInfoString(mPortName + ".xml", type, buffer, size);
+  default:
+    return setLastError(GenTL::GC_ERR_NOT_IMPLEMENTED,
+                        "URL info command not supported");
+  }
+}
+
+std::string Port::url() const
+{
+  std::ostringstream url;
+  url << "local:" << mPortName << ".xml;" << std::hex << XML_ADDRESS << ";"
+      << mXml.size();
+  return url.str();
+}
+
+GenTL::GC_ERROR Port::registerEvent(GenTL::EVENT_TYPE eventType,
+                                    Event*& event)
+{
+  DataStream* dataStream = nullptr;
+  if (eventType == GenTL::EVENT_NEW_BUFFER)
+  {
+    dataStream = newBufferSource();
+    if (dataStream == nullptr)
+    {
+      return setLastError(GenTL::GC_ERR_NOT_AVAILABLE,
+                          "Only a data stream has new buffer events");
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(mEventMutex);
+  if (mEvents.find(eventType) != mEvents.end())
+  {
+    return setLastError(GenTL::GC_ERR_RESOURCE_IN_USE,
+                        "Event is already registered");
+  }
+  std::unique_ptr<Event> created(new Event(eventType, dataStream));
+  event = created.get();
+  mEvents[eventType] = std::move(created);
+  return GenTL::GC_ERR_SUCCESS;
+}
+
+GenTL::GC_ERROR Port::unregisterEvent(GenTL::EVENT_TYPE eventType)
+{
+  std::lock_guard<std::mutex> lock(mEventMutex);
+  auto it = mEvents.find(eventType);
+  if (it == mEvents.end())
+  {
+    return setLastError(GenTL::GC_ERR_NOT_AVAILABLE,
+                        "Event is not registered");
+  }
+  mEvents.erase(it);
+  return GenTL::GC_ERR_SUCCESS;
+}
+
+void Port::beforeRead(uint64_t /*address*/, size_t /*size*/)
+{
+  // Empty
+}
+
+GenTL::GC_ERROR Port::checkWrite(uint64_t /*address*/, size_t /*size*/)
+{
+  return GenTL::GC_ERR_SUCCESS;
+}
+
+void Port::afterWrite(uint64_t /*address*/, size_t /*size*/)
+{
+  // Empty
+}
+
+uint32_t Port::get32(uint64_t address) const
+{
+  const uint8_t* data = &mRegisters[static_cast<size_t>(address)];
+  if (mBigEndian)
+  {
+    return static_cast<uint32_t>(data[0]) << 24
+      | static_cast<uint32_t>(data[1]) << 16
+      | static_cast<uint32_t>(data[2]) << 8
+      | static_cast<uint32_t>(data[3]);
+  }
+  return static_cast<uint32_t>(data[0])
+    | static_cast<uint32_t>(data[1]) << 8
+    | static_cast<uint32_t>(data[2]) << 16
+    | static_cast<uint32_t>(data[3]) << 24;
+}
+
+void Port::set32(uint64_t address, uint32_t value)
+{
+  uint8_t* data = &mRegisters[static_cast<size_t>(address)];
+  for (int i = 0; i < 4; ++i)
+  {
+    const int shift = mBigEndian ? 24 - 8 * i : 8 * i;
+    data[i] = static_cast<uint8_t>(value >> shift);
+  }
+}
+
+void Port::set64(uint64_t address, uint64_t value)
+{
+  const uint32_t high = static_cast<uint32_t>(value >> 32);
+  const uint32_t low = static_cast<uint32_t>(value);
+  set32(address, mBigEndian ? high : low);
+  set32(address + 4, mBigEndian ? low : high);
+}
+
+float Port::getFloat(uint64_t address) const
+{
+  const uint32_t bits = get32(address);
+  float value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+void Port::setFloat(uint64_t address, float value)
+{
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  set32(address, bits);
+}
+
+std::string Port::getString(uint64_t address, size_t length) const
+{
+  const char* data = reinterpret_cast<const char*>(
+    &mRegisters[static_cast<size_t>(address)]);
+  return std::string(data, std::find(data, data + length, '\0'));
+}
+
+void Port::setString(uint64_t address,
+                     size_t length,
+                     const std::string& value)
+{
+  uint8_t* data = &mRegisters[static_cast<size_t>(address)];
+  std::memset(data, 0, length);
+  // Always leave room for the terminating null
+  std::memcpy(data, value.data(), std::min(value.size(), length - 1));
+}
+
+Event::Event(GenTL::EVENT_TYPE eventType, DataStream* dataStream)
+  : Handle(EVENT_OBJECT)
+  , mEventType(eventType)
+  , mDataStream(dataStream)
+  , mKilled(false)
+{
+  // Empty
+}
+
+GenTL::GC_ERROR Event::getData(void* buffer, size_t* size, uint64_t timeoutMs)
+{
+  if (size == nullptr)
+  {
+    return setLastError(GenTL::GC_ERR_INVALID_PARAMETER, "Size is null");
+  }
+
+  if (mDataStream == nullptr)
+  {
+    // Nothing is ever signaled, so only wait for the timeout or a kill
+    std::unique_lock<std::mutex> lock(mMutex);
+    auto killed = [this] { return mKilled; };
+    if (timeoutMs >= MAX_TIMEOUT_MS)
+    {
+      mKilledCondition.wait(lock, killed);
+    }
+    else if (!mKilledCondition.wait_for(
+               lock, std::chrono::milliseconds(timeoutMs), killed))
+    {
+      return setLastError(GenTL::GC_ERR_TIMEOUT, "No event data");
+    }
+    mKilled = false;
+    return setLastError(GenTL::GC_ERR_ABORT, "Wait aborted by EventKill");
+  }
+
+  if (buffer == nullptr || *size < sizeof(GenTL::EVENT_NEW_BUFFER_DATA))
+  {
+    *size = sizeof(GenTL::EVENT_NEW_BUFFER_DATA);
+    return setLastError(GenTL::GC_ERR_BUFFER_TOO_SMALL,
+                        "Buffer too small for new buffer event data");
+  }
+  GenTL::EVENT_NEW_BUFFER_DATA data;
+  const GenTL::GC_ERROR status = mDataStream->waitForBuffer(data, timeoutMs);
+  if (status != GenTL::GC_ERR_SUCCESS)
+  {
+    return status;
+  }
+  std::memcpy(buffer, &data, sizeof(data));
+  *size = sizeof(data);
+  return GenTL::GC_ERR_SUCCESS;
+}
+
+GenTL::GC_ERROR Event::getDataInfo(const void* data,
+                                   size_t dataSize,
+                                   GenTL::EVENT_DATA_INFO_CMD command,
+                                   GenTL::INFO_DATATYPE* type,
+                                   void* buffer,
+                                   size_t* size)
+{
+  if (mDataStream == nullptr)
+  {
+    return setLastError(GenTL::GC_ERR_NOT_AVAILABLE,
+                        "Event never has any data");
+  }
+  if (data == nullptr || dataSize < sizeof(GenTL::EVENT_NEW_BUFFER_DATA))
+  {
+    return setLastError(GenTL::GC_ERR_INVALID_PARAMETER,
+                        "Not new buffer event data");
+  }
+  const GenTL::EVENT_NEW_BUFFER_DATA* newBuffer =
+    static_cast<const GenTL::EVENT_NEW_BUFFER_DATA*>(data);
+  switch (command)
+  {
+  case GenTL::EVENT_DATA_ID:
+    return setInfo(GenTL::INFO_DATATYPE_PTR, newBuffer->BufferHandle,
+                   type, buffer, size);
+  case GenTL::EVENT_DATA_VALUE:
+    return setInfo(GenTL::INFO_DATATYPE_PTR, newBuffer->pUserPointer,
+                   type, buffer, size);
+  default:
+    return setLastError(GenTL::GC_ERR_NOT_IMPLEMENTED,
+                        "Event data info command not supported");
+  }
+}
+
+GenTL::GC_ERROR Event::getInfo(GenTL::EVENT_INFO_CMD command,
+                               GenTL::INFO_DATATYPE* type,
+                               void* buffer,
+                               size_t* size)
+{
+  switch (command)
+  {
+  case GenTL::EVENT_EVENT_TYPE:
+    return setInfo(GenTL::INFO_DATATYPE_INT32,
+                   static_cast<int32_t>(mEventType), type, buffer, size);
+  case GenTL::EVENT_NUM_IN_QUEUE:
+    return setInfo(GenTL::INFO_DATATYPE_SIZET,
+                   mDataStream ? mDataStream->outputQueueSize() : size_t(0),
+                   type, buffer, size);
+  case GenTL::EVENT_NUM_FIRED:
+    return setInfo(GenTL::INFO_DATATYPE_UINT64,
+                   mDataStream ? mDataStream->deliveredCount() : uint64_t(0),
+                   type, buffer, size);
+  case GenTL::EVENT_SIZE_MAX:
+    return setInfo(GenTL::INFO_DATATYPE_SIZET,
+                   mDataStream
+                     ? sizeof(GenTL::EVENT_NEW_BUFFER_DATA)
+                     : EVENT_DATA_SIZE_MAX,
+                   type, buffer, size);
+  case GenTL::EVENT_INFO_DATA_SIZE_MAX:
+    return setInfo(GenTL::INFO_DATATYPE_SIZET, sizeof(void*),
+                   type, buffer, size);
+  default:
+    return setLastError(GenTL::GC_ERR_NOT_IMPLEMENTED,
+                        "Event info command not supported");
+  }
+}
+
+GenTL::GC_ERROR Event::flush()
+{
+  if (mDataStream != nullptr)
+  {
+    mDataStream->discardOutput();
+  }
+  return GenTL::GC_ERR_SUCCESS;
+}
+
+GenTL::GC_ERROR Event::kill()
+{
+  if (mDataStream != nullptr)
+  {
+    mDataStream->killWait();
+    return GenTL::GC_ERR_SUCCESS;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mKilled = true;
+  }
+  mKilledCondition.notify_all();
+  return GenTL::GC_ERR_SUCCESS;
+}
+
+Buffer::Buffer(DataStream& owner,
+               uint8_t* data,
+               size_t size,
+               void* userData,
+               bool owned)
+  : Handle(BUFFER_OBJECT)
+  , mOwner(owner)
+  , mData(data)
+  , mSize(size)
+  , mUserData(userData)
+  , mOwned(owned)
+  , mState(ANNOUNCED)
+  , mFrameId(0)
+  , mTimestampNs(0)
+  , mSizeFilled(0)
+  , mIncomplete(false)
+  , mNewData(false)
+{
+  // Empty
+}
+
+Buffer::~Buffer()
+{
+  if (mOwned)
+  {
+    delete[] mData;
+  }
+}
+
+RemoteDevice::RemoteDevice(uint32_t index,
+                           const std::string& serialNumber,
+                           const Configuration& configuration)
+  : Port(REMOTE_DEVICE, "Device", deviceXml(), DeviceRegister::SIZE, true)
+  , mConfiguration(configuration)
+  , mDataStream(nullptr)
+  , mAcquiring(false)
+  , mAcquisitionCount(0)
+{
+  using namespace DeviceRegister;
+  std::ostringstream userId;
+  userId << "Simulated" << index;
+  setString(MODEL_NAME, STRING_LENGTH, MODEL);
+  setString(SERIAL_NUMBER, STRING_LENGTH, serialNumber);
+  setString(USER_ID, STRING_LENGTH, userId.str());
+
+  set32(SCAN_TYPE, LINESCAN_3D);
+  set32(ACQUISITION_MODE, 2);
+  setFloat(EXPOSURE_TIME, 25.0f);
+  setFloat(LINE_RATE, 1000.0f);
+  set32(REGISTERS_VALID, 1);
+
+  set32(regionAddress(REGION_0, REGION_WIDTH), 2560);
+  set32(regionAddress(REGION_0, REGION_HEIGHT), 832);
+  set32(regionAddress(REGION_1, REGION_WIDTH), 2560);
+  set32(regionAddress(REGION_1, REGION_HEIGHT), 200);
+  set32(regionAddress(REGION_1, REGION_OFFSET_Y), 316);
+  set32(regionAddress(SCAN_3D_EXTRACTION_1, REGION_WIDTH), 2560);
+  set32(regionAddress(SCAN_3D_EXTRACTION_1, REGION_HEIGHT), 512);
+  set32(componentAddress(COMPONENT_RANGE), 1);
+
+  set32(PAYLOAD_SIZE, static_cast<uint32_t>(frameLayoutLocked().mPayloadSize));
+}
+
+void RemoteDevice::attachDataStream(DataStream* dataStream)
+{
+  mDataStream = dataStream;
+}
+
+FrameLayout RemoteDevice::frameLayout() const
+{
+  std::lock_guard<std::mutex> lock(mRegisterMutex);
+  return frameLayoutLocked();
+}
+
+size_t RemoteDevice::payloadSize() const
+{
+  std::lock_guard<std::mutex> lock(mRegisterMutex);
+  return get32(DeviceRegister::PAYLOAD_SIZE);
+}
+
+std::string RemoteDevice::userId() const
+{
+  std::lock_guard<std::mutex> lock(mRegisterMutex);
+  return getString(DeviceRegister::USER_ID, DeviceRegister::STRING_LENGTH);
+}
+
+GenTL::GC_ERROR RemoteDevice::checkWrite(uint64_t address, size_t size)
+{
+  using namespace DeviceRegister;
+  if (overlaps(address, size, MODEL_NAME, 2 * STRING_LENGTH)
+      || overlaps(address, size, PAYLOAD_SIZE, 4)
+      || overlaps(address, size, REGISTERS_VALID, 4))
+  {
+    return setLastError(GenTL::GC_ERR_ACCESS_DENIED, "Register is read only");
+  }
+  if (get32(TL_PARAMS_LOCKED) != 0
+      && (overlaps(address, size, SCAN_TYPE, 4)
+          || overlaps(address, size, ACQUISITION_MODE, 4)
+          || overlaps(address, size, CHUNK_MODE_ACTIVE, 4)
+          || overlaps(address, size, REGION_TABLE,
+                      REGION_COUNT * REGION_STRIDE)
+          || overlaps(address, size, COMPONENT_TABLE,
+                      COMPONENT_COUNT * COMPONENT_STRIDE)))
+  {
+    return setLastError(GenTL::GC_ERR_ACCESS_DENIED,
+                        "Parameter is locked by TLParamsLocked");
+  }
+  return GenTL::GC_ERR_SUCCESS;
+}
+
+void RemoteDevice::afterWrite(uint64_t address, size_t size)
+{
+  using namespace DeviceRegister;
+  bool acquisitionChanged = false;
+  // Commands clear themselves once executed
+  if (overlaps(address, size, ACQUISITION_START, 4)
+      && get32(ACQUISITION_START) != 0)
+  {
+    set32(ACQUISITION_START, 0);
+    // Counted first, so that a generator seeing the device acquire also
+    // sees that the parameters may have changed
+    ++mAcquisitionCount;
+    mAcquiring = true;
+    acquisitionChanged = true;
+  }
+  if (overlaps(address, size, ACQUISITION_STOP, 4)
+      && get32(ACQUISITION_STOP) != 0)
+  {
+    set32(ACQUISITION_STOP, 0);
+    mAcquiring = false;
+    acquisitionChanged = true;
+  }
+  if (overlaps(address, size, REGISTERS_STREAMING_START, 4)
+      && get32(REGISTERS_STREAMING_START) != 0)
+  {
+    set32(REGISTERS_STREAMING_START, 0);
+    set32(REGISTERS_VALID, 0);
+  }
+  if (overlaps(address, size, REGISTERS_STREAMING_END, 4)
+      && get32(REGISTERS_STREAMING_END) != 0)
+  {
+    set32(REGISTERS_STREAMING_END, 0);
+    set32(REGISTERS_VALID, 1);
+  }
+
+  // Scan3dExtraction1 always has the width of the region it extracts from
+  set32(regionAddress(SCAN_3D_EXTRACTION_1, REGION_WIDTH),
+        get32(regionAddress(REGION_1, REGION_WIDTH)));
+  set32(PAYLOAD_SIZE, static_cast<uint32_t>(frameLayoutLocked().mPayloadSize));
+
+  if (acquisitionChanged && mDataStream != nullptr)
+  {
+    mDataStream->wake();
+  }
+}
+
+FrameLayout RemoteDevice::frameLayoutLocked() const
+{
+  using namespace DeviceRegister;
+  const ScanType scanType =
+    get32(SCAN_TYPE) == AREASCAN ? AREASCAN : LINESCAN_3D;
+  // A 3D frame is as wide as Region1 with as many profiles as the height of
+  // Scan3dExtraction1, an image is all of Region0
+  const Region widthRegion = scanType == AREASCAN ? REGION_0 : REGION_1;
+  const Region heightRegion =
+    scanType == AREASCAN ? REGION_0 : SCAN_3D_EXTRACTION_1;
+  bool componentEnabled[COMPONENT_COUNT];
+  for (int i = 0; i < COMPONENT_COUNT; ++i)
+  {
+    componentEnabled[i] = get32(componentAddress(i)) != 0;
+  }
+  const double lineRate = mConfiguration.mLineRate >= 0
+    ? mConfiguration.mLineRate
+    : getFloat(LINE_RATE);
+  return makeFrameLayout(scanType,
+                         get32(regionAddress(widthRegion, REGION_WIDTH)),
+                         get32(regionAddress(heightRegion, REGION_HEIGHT)),
+                         componentEnabled,
+                         get32(CHUNK_MODE_ACTIVE) != 0,
+                         lineRate);
+}
+
+DataStream::DataStream(Device& parent, const Configuration& configuration)
+  : Port(DATA_STREAM_MODULE,
+         "StreamPort",
+         streamXml(),
+         StreamRegister::SIZE,
+         false)
+  , mParent(parent)
+  , mConfiguration(configuration)
+  , mId("Stream0")
+  , mOpen(false)
+  , mStarted(false)
+  , mStopping(false)
+  , mWaitKilled(false)
+  , mFramesToAcquire(0)
+  , mFramesDelivered(0)
+  , mTotalDelivered(0)
+  , mTotalStarted(0)
+  , mUnderruns(0)
+  , mNextFrameId(1)
+  , mEncoderValue(0)
+{
+  for (int i = 0; i < STREAM_COUNTER_COUNT; ++i)
+  {
+    mCounters[i] = 0;
+  }
+}
+
+DataStream::~DataStream()
+{
+  stopAcquisition();
+}
+
+GenTL::GC_ERROR DataStream::open()
+{
+  if (mOpen.exchange(true))
+  {
+    return setLastError(GenTL::GC_ERR_RESOURCE_IN_USE,
+                        "Data stream is already open");
+  }
+  return GenTL::GC_ERR_SUCCESS;
+}
+
+GenTL::GC_ERROR DataStream::close()
+{
+  stopAcquisition();
+  revokeAll();
+  mOpen = false;
+  return GenTL::GC_ERR_SUCCESS;
+}
+
+GenTL::GC_ERROR DataStream::announceBuffer(void* data,
+                                           size_t size,
+                                           void* userData,
+                                           GenTL::BUFFER_HANDLE* handle)
+{
+  if (data == nullptr || size == 0 || handle == nullptr)
+  {
+    return setLastError(GenTL::GC_ERR_INVALID_PARAMETER,
+                        "Buffer, size or handle is null");
+  }
+  std::unique_ptr<Buffer> buffer(
+    new Buffer(*this, static_cast<uint8_t*>(data), size, userData, false));
+  return addBuffer(std::move(buffer), handle);
+}
+
+GenTL::GC_ERROR DataStream::allocAndAnnounceBuffer(
+  size_t size,
+  void* userData,
+  GenTL::BUFFER_HANDLE* handle)
+{
+  if (size == 0 || handle == nullptr)
+  {
+    return setLastError(GenTL::GC_ERR_INVALID_PARAMETER,
+                        "Size or handle is null");
+  }
+  uint8_t* data = new (std::nothrow) uint8_t[size];
+  if (data == nullptr)
+  {
+    return setLastError(GenTL::GC_ERR_OUT_OF_MEMORY,
+                        "Could not allocate buffer");
+  }
+  std::unique_ptr<Buffer> buffer(
+    new Buffer(*this, data, size, userData, true));
+  return addBuffer(std::move(buffer), handle);
+}
+
+GenTL::GC_ERROR DataStream::revokeBuffer(Buffer* buffer,
+                                         void** data,
+                                         void** userData)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  auto it = std::find_if(mBuffers.begin(), mBuffers.end(),
+    [buffer](const std::unique_ptr<Buffer>& announced)
+    {
+      return announced.get() == buffer;
+    });
+  if (it == mBuffers.end())
+  {
+    return setLastError(GenTL::GC_ERR_INVALID_HANDLE,
+                        "Buffer is not announced to this data stream");
+  }
+  if (buffer->mState != Buffer::ANNOUNCED
+      && buffer->mState != Buffer::DELIVERED)
+  {
+    return setLastError(GenTL::GC_ERR_BUSY, "Buffer is queued");
+  }
+  if (data != nullptr)
+  {
+    // Memory allocated by the producer is freed with the buffer
+    *data = buffer->mOwned ? nullptr : buffer->mData;
+  }
+  if (userData != nullptr)
+  {
+    *userData = buffer->mUserData;
+  }
+  mBuffers.erase(it);
+  return GenTL::GC_ERR_SUCCESS;
+}
+
+GenTL::GC_ERROR DataStream::queueBuffer(Buffer* buffer)
+{
+  if (&buffer->mOwner != this)
+  {
+    return setLastError(GenTL::GC_ERR_INVALID_HANDLE,
+                        "Buffer is not announced to this data stream");
+  }
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (buffer->mState != Buffer::ANNOUNCED
+        && buffer->mState != Buffer::DELIVERED)
+    {
+      return setLastError(GenTL::GC_ERR_RESOURCE_IN_USE,
+                          "Buffer is already queued");
+    }
+    buffer->mState = Buffer::QUEUED;
+    buffer->mNewData = false;
+    mInputQueue.push_back(buffer);
+  }
+  mGeneratorWake.notify_all();
+  return GenTL::GC_ERR_SUCCESS;
+}
+
+GenTL::GC_ERROR DataStream::flushQueue(GenTL::ACQ_QUEUE_TYPE operation)
+{
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto queueUnqueued = [this]
+    {
+      for (auto it = mBuffers.begin(); it != mBuffers.end(); ++it)
+      {
+        Buffer* buffer = it->get();
+        if (buffer->mState == Buffer::ANNOUNCED
+            || buffer->mState == Buffer::DELIVERED)
+        {
+          buffer->mState = Buffer::QUEUED;
+          buffer->mNewData = false;
+          mInputQueue.push_back(buffer);
+        }
+      }
+    };
+    auto unqueue = [](std::deque<Buffer*>& queue)
+    {
+      for (auto it = queue.begin(); it != queue.end(); ++it)
+      {
+        (*it)->mState = Buffer::ANNOUNCED;
+      }
+      queue.clear();
+    };
+
+    switch (operation)
+    {
+    case GenTL::ACQ_QUEUE_INPUT_TO_OUTPUT:
+      // Delivered without being filled
+      for (auto it = mInputQueue.begin(); it != mInputQueue.end(); ++it)
+      {
+        (*it)->mState = Buffer::OUTPUT;
+        (*it)->mNewData = false;
+        mOutputQueue.push_back(*it);
+      }
+      mInputQueue.clear();
+      break;
+    case GenTL::ACQ_QUEUE_OUTPUT_DISCARD:
+      unqueue(mOutputQueue);
+      break;
+    case GenTL::ACQ_QUEUE_ALL_TO_INPUT:
+      unqueue(mOutputQueue);
+      queueUnqueued();
+      break;
+    case GenTL::ACQ_QUEUE_UNQUEUED_TO_INPUT:
+      queueUnqueued();
+      break;
+    case GenTL::ACQ_QUEUE_ALL_DISCARD:
+      unqueue(mInputQueue);
+      unqueue(mOutputQueue);
+      break;
+    default:
+      return setLastError(GenTL::GC_ERR_INVALID_PARAMETER,
+                          "Unknown queue operation");
+    }
+  }
+  mGeneratorWake.notify_all();
+  mBufferDelivered.notify_all();
+  return GenTL::GC_ERR_SUCCESS;
+}
+
+GenTL::GC_ERROR DataStream::startAcquisition(uint64_t frameCount)
+{
+  std::lock_guard<std::mutex> control(mControlMutex);
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mStarted)
+    {
+      return setLastError(GenTL::GC_ERR_RESOURCE_IN_USE,
+                          "Acquisition is already started");
+    }
+    mStarted = true;
+    mStopping = false;
+    mFramesToAcquire = frameCount;
+    mFramesDelivered = 0;
+    ++mTotalStarted;
+  }
+  mNextFrameId = 1;
+  mEncoderValue = 0;
+  try
+  {
+    mGenerator = std::thread(&DataStream::generatorLoop, this);
+  }
+  catch (const std::system_error&)
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStarted = false;
+    return setLastError(GenTL::GC_ERR_RESOURCE_EXHAUSTED,
+                        "Could not start the frame generator");
+  }
+  return GenTL::GC_ERR_SUCCESS;
+}
+
+GenTL::GC_ERROR DataStream::stopAcquisition()
+{
+  std::lock_guard<std::mutex> control(mControlMutex);
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (!mStarted)
+    {
+      return GenTL::GC_ERR_SUCCESS;
+    }
+    mStopping = true;
+  }
+  mGeneratorWake.notify_all();
+  mGenerator.join();
+
+  std::lock_guard<std::mutex> lock(mMutex);
+  mStarted = false;
+  mStopping = false;
+  return GenTL::GC_ERR_SUCCESS;
+}
+
+GenTL::GC_ERROR DataStream::getInfo(GenTL::STREAM_INFO_CMD command,
+                                    GenTL::INFO_DATATYPE* type,
+                                    void* buffer,
+                                    size_t* size)
+{
+  // Asked for before locking, the device is locked before the stream
+  if (command == GenTL::STREAM_INFO_PAYLOAD_SIZE)
+  {
+    return setInfo(GenTL::INFO_DATATYPE_SIZET,
+                   mParent.remote().payloadSize(), type, buffer, size);
+  }
+
+  std::lock_guard<std::mutex> lock(mMutex);
+  switch (command)
+  {
+  case GenTL::STREAM_INFO_ID:
+    return setInfoString(mId, type, buffer, size);
+  case GenTL::STREAM_INFO_NUM_DELIVERED:
+    return setInfo(GenTL::INFO_DATATYPE_UINT64, mTotalDelivered,
+                   type, buffer, size);
+  case GenTL::STREAM_INFO_NUM_UNDERRUN:
+    return setInfo(GenTL::INFO_DATATYPE_UINT64, mUnderruns,
+                   type, buffer, size);
+  case GenTL::STREAM_INFO_NUM_ANNOUNCED:
+    return setInfo(GenTL::INFO_DATATYPE_SIZET, mBuffers.size(),
+                   type, buffer, size);
+  case GenTL::STREAM_INFO_NUM_QUEUED:
+    return setInfo(GenTL::INFO_DATATYPE_SIZET, mInputQueue.size(),
+                   type, buffer, size);
+  case GenTL::STREAM_INFO_NUM_AWAIT_DELIVERY:
+    return setInfo(GenTL::INFO_DATATYPE_SIZET, mOutputQueue.size(),
+                   type, buffer, size);
+  case GenTL::STREAM_INFO_NUM_STARTED:
+    return setInfo(GenTL::INFO_DATATYPE_UINT64, mTotalStarted,
+                   type, buffer, size);
+  case GenTL::STREAM_INFO_IS_GRABBING:
+    return setInfo(GenTL::INFO_DATATYPE_BOOL8,
+                   static_cast<bool8_t>(mStarted && !mStopping),
+                   type, buffer, size);
+  case GenTL::STREAM_INFO_DEFINES_PAYLOADSIZE:
+    return setInfo(GenTL::INFO_DATATYPE_BOOL8, static_cast<bool8_t>(false),
+                   type, buffer, size);
+  case GenTL::STREAM_INFO_TLTYPE:
+    return setInfoString(TL_TYPE, type, buffer, size);
+  case GenTL::STREAM_INFO_NUM_CHUNKS_MAX:
+    return setInfo(GenTL::INFO_DATATYPE_SIZET, size_t(2), type, buffer, size);
+  case GenTL::STREAM_INFO_BUF_ANNOUNCE_MIN:
+  case GenTL::STREAM_INFO_BUF_ALIGNMENT:
+    return setInfo(GenTL::INFO_DATATYPE_SIZET, size_t(1), type, buffer, size);
+  default:
+    return setLastError(GenTL::GC_ERR_NOT_IMPLEMENTED,
+                        "Stream info command not supported");
+  }
+}
+
+GenTL::GC_ERROR DataStream::getBufferId(uint32_t index,
+                                        GenTL::BUFFER_HANDLE* handle)
+{
+  if (handle == nullptr)
+  {
+    return setLastError(GenTL::GC_ERR_INVALID_PARAMETER, "Handle is null");
+  }
+  std::lock_guard<std::mutex> lock(mMutex);
+  if (index >= mBuffers.size())
+  {
+    return setLastError(GenTL::GC_ERR_INVALID_INDEX,
+                        "No buffer with that index");
+  }
+  *handle = mBuffers[index]->handle();
+  return GenTL::GC_ERR_SUCCESS;
+}
+
+GenTL::GC_ERROR DataStream::getBufferInfo(Buffer* buffer,
+                                          GenTL::BUFFER_INFO_CMD command,
+                                          GenTL::INFO_DATATYPE* type,
+                                          void* value,
+                                          size_t* size)
+{
+  if (&buffer->mOwner != this)
+  {
+    return setLastError(GenTL::GC_ERR_INVALID_HANDLE,
+                        "Buffer is not announced to this data stream");
+  }
+
+  std::lock_guard<std::mutex> lock(mMutex);
+  // No layout until the buffer has been filled once
+  const FrameLayout* layout = buffer->mLayout.get();
+  const bool hasChunks = layout != nullptr && layout->mHasChunks;
+  switch (command)
+  {
+  case GenTL::BUFFER_INFO_BASE:
+    return setInfo(GenTL::INFO_DATATYPE_PTR,
+                   static_cast<void*>(buffer->mData), type, value, size);
+  case GenTL::BUFFER_INFO_SIZE:
+    return setInfo(GenTL::INFO_DATATYPE_SIZET, buffer->mSize,
+                   type, value, size);
+  case GenTL::BUFFER_INFO_USER_PTR:
+    return setInfo(GenTL::INFO_DATATYPE_PTR, buffer->mUserData,
+                   type, value, size);
+  case GenTL::BUFFER_INFO_TIMESTAMP:
+  case GenTL::BUFFER_INFO_TIMESTAMP_NS:
+    return setInfo(GenTL::INFO_DATATYPE_UINT64, buffer->mTimestampNs,
+                   type, value, size);
+  case GenTL::BUFFER_INFO_NEW_DATA:
+    return setInfo(GenTL::INFO_DATATYPE_BOOL8,
+                   static_cast<bool8_t>(buffer->mNewData), type, value, size);
+  case GenTL::BUFFER_INFO_IS_QUEUED:
+    return setInfo(GenTL::INFO_DATATYPE_BOOL8,
+                   static_cast<bool8_t>(buffer->mState == Buffer::QUEUED
+                                        || buffer->mState == Buffer::FILLING
+                                        || buffer->mState == Buffer::OUTPUT),
+                   type, value, size);
+  case GenTL::BUFFER_INFO_IS_ACQUIRING:
+    return setInfo(GenTL::INFO_DATATYPE_BOOL8,
+                   static_cast<bool8_t>(buffer->mState == Buffer::FILLING),
+                   type, value, size);
+  case GenTL::BUFFER_INFO_IS_INCOMPLETE:
+    return setInfo(GenTL::INFO_DATATYPE_BOOL8,
+                   static_cast<bool8_t>(buffer->mIncomplete),
+                   type, value, size);
+  case GenTL::BUFFER_INFO_TLTYPE:
+    return setInfoString(TL_TYPE, type, value, size);
+  case GenTL::BUFFER_INFO_SIZE_FILLED:
+    return setInfo(GenTL::INFO_DATATYPE_SIZET, buffer->mSizeFilled,
+                   type, value, size);
+  case GenTL::BUFFER_INFO_WIDTH:
+    return setInfo(GenTL::INFO_DATATYPE_SIZET,
+                   layout ? layout->mWidth : size_t(0), type, value, size);
+  case GenTL::BUFFER_INFO_HEIGHT:
+    return setInfo(GenTL::INFO_DATATYPE_SIZET,
+                   layout ? layout->mHeight : size_t(0), type, value, size);
+  case GenTL::BUFFER_INFO_XOFFSET:
+  case GenTL::BUFFER_INFO_YOFFSET:
+  case GenTL::BUFFER_INFO_XPADDING:
+  case GenTL::BUFFER_INFO_YPADDING:
+  case GenTL::BUFFER_INFO_IMAGEOFFSET:
+    return setInfo(GenTL::INFO_DATATYPE_SIZET, size_t(0), type, value, size);
+  case GenTL::BUFFER_INFO_FRAMEID:
+    return setInfo(GenTL::INFO_DATATYPE_UINT64, buffer->mFrameId,
+                   type, value, size);
+  case GenTL::BUFFER_INFO_IMAGEPRESENT:
+    return setInfo(GenTL::INFO_DATATYPE_BOOL8,
+                   static_cast<bool8_t>(layout && buffer->mSizeFilled > 0),
+                   type, value, size);
+  case GenTL::BUFFER_INFO_PAYLOADTYPE:
+    return setInfo(GenTL::INFO_DATATYPE_SIZET,
+                   layout
+                     ? layout->mPayloadType
+                     : static_cast<size_t>(GenTL::PAYLOAD_TYPE_UNKNOWN),
+                   type, value, size);
+  case GenTL::BUFFER_INFO_PIXELFORMAT:
+    return setInfo(GenTL::INFO_DATATYPE_UINT64,
+                   layout ? layout->mParts[0].mPixelFormat : uint64_t(0),
+                   type, value, size);
+  case GenTL::BUFFER_INFO_PIXELFORMAT_NAMESPACE:
+    return setInfo(GenTL::INFO_DATATYPE_UINT64,
+                   static_cast<uint64_t>(
+                     GenTL::PIXELFORMAT_NAMESPACE_PFNC_32BIT),
+                   type, value, size);
+  case GenTL::BUFFER_INFO_DELIVERED_IMAGEHEIGHT:
+    return setInfo(GenTL::INFO_DATATYPE_SIZET,
+                   layout
+                     ? deliveredHeight(*layout, buffer->mSizeFilled)
+                     : size_t(0),
+                   type, value, size);
+  case GenTL::BUFFER_INFO_DELIVERED_CHUNKPAYLOADSIZE:
+    return setInfo(GenTL::INFO_DATATYPE_SIZET,
+                   hasChunks ? buffer->mSizeFilled : size_t(0),
+                   type, value, size);
+  case GenTL::BUFFER_INFO_CHUNKLAYOUTID:
+    return setInfo(GenTL::INFO_DATATYPE_UINT64,
+                   hasChunks ? CHUNK_LAYOUT_ID : uint64_t(0),
+                   type, value, size);
+  case GenTL::BUFFER_INFO_DATA_SIZE:
+    return setInfo(GenTL::INFO_DATATYPE_SIZET,
+                   layout ? layout->mPayloadSize : size_t(0),
+                   type, value, size);
+  case GenTL::BUFFER_INFO_DATA_LARGER_THAN_BUFFER:
+    return setInfo(GenTL::INFO_DATATYPE_BOOL8,
+                   static_cast<bool8_t>(
+                     layout && layout->mPayloadSize > buffer->mSize),
+                   type, value, size);
+  case GenTL::BUFFER_INFO_CONTAINS_CHUNKDATA:
+    return setInfo(GenTL::INFO_DATATYPE_BOOL8,
+                   static_cast<bool8_t>(hasChunks), type, value, size);
+  default:
+    return setLastError(GenTL::GC_ERR_NOT_IMPLEMENTED,
+                        "Buffer info command not supported");
+  }
+}
+
+GenTL::GC_ERROR DataStream::getNumBufferParts(Buffer* buffer,
+                                              uint32_t* partCount)
+{
+  if (&buffer->mOwner != this || partCount == nullptr)
+  {
+    return setLastError(GenTL::GC_ERR_INVALID_PARAMETER,
+                        "Not a buffer of this data stream");
+  }
+  std::lock_guard<std::mutex> lock(mMutex);
+  const FrameLayout* layout = buffer->mLayout.get();
+  *partCount =
+    layout && layout->mPayloadType == GenTL::PAYLOAD_TYPE_MULTI_PART
+      ? layout->mPartCount
+      : 0;
+  return GenTL::GC_ERR_SUCCESS;
+}
+
+GenTL::GC_ERROR DataStream::getBufferPartInfo(
+  Buffer* buffer,
+  uint32_t partIndex,
+  GenTL::BUFFER_PART_INFO_CMD command,
+  GenTL::INFO_DATATYPE* type,
+  void* value,
+  size_t* size)
+{
+  if (&buffer->mOwner != this)
+  {
+    return setLastError(GenTL::GC_ERR_INVALID_HANDLE,
+                        "Buffer is not announced to this data stream");
+  }
+
+  std::lock_guard<std::mutex> lock(mMutex);
+  const FrameLayout* layout = buffer->mLayout.get();
+  if (layout == nullptr
+      || layout->mPayloadType != GenTL::PAYLOAD_TYPE_MULTI_PART
+      || partIndex >= layout->mPartCount)
+  {
+    return setLastError(GenTL::GC_ERR_INVALID_INDEX,
+                        "Buffer has no part with that index");
+  }
+  const PartLayout& part = layout->mParts[partIndex];
+  switch (command)
+  {
+  case GenTL::BUFFER_PART_INFO_BASE:
+    return setInfo(GenTL::INFO_DATATYPE_PTR,
+                   static_cast<void*>(buffer->mData + part.mOffset),
+                   type, value, size);
+  case GenTL::BUFFER_PART_INFO_DATA_SIZE:
+    return setInfo(GenTL::INFO_DATATYPE_SIZET, part.mSize,
+                   type, value, size);
+  case GenTL::BUFFER_PART_INFO_DATA_TYPE:
+    return setInfo(GenTL::INFO_DATATYPE_SIZET, part.mDataType,
+                   type, value, size);
+  case GenTL::BUFFER_PART_INFO_DATA_FORMAT:
+    return setInfo(GenTL::INFO_DATATYPE_UINT64, part.mPixelFormat,
+                   type, value, size);
+  case GenTL::BUFFER_PART_INFO_DATA_FORMAT_NAMESPACE:
+    return setInfo(GenTL::INFO_DATATYPE_UINT64,
+                   static_cast<uint64_t>(
+                     GenTL::PIXELFORMAT_NAMESPACE_PFNC_32BIT),
+                   type, value, size);
+  case GenTL::BUFFER_PART_INFO_WIDTH:
+    return setInfo(GenTL::INFO_DATATYPE_SIZET, part.mWidth,
+                   type, value, size);
+  case GenTL::BUFFER_PART_INFO_HEIGHT:
+    return setInfo(GenTL::INFO_DATATYPE_SIZET, part.mHeight,
+                   type, value, size);
+  case GenTL::BUFFER_PART_INFO_XOFFSET:
+  case GenTL::BUFFER_PART_INFO_YOFFSET:
+  case GenTL::BUFFER_PART_INFO_XPADDING:
+    return setInfo(GenTL::INFO_DATATYPE_SIZET, size_t(0), type, value, size);
+  case GenTL::BUFFER_PART_INFO_SOURCE_ID:
+    return setInfo(GenTL::INFO_DATATYPE_UINT64, uint64_t(0),
+                   type, value, size);
+  case GenTL::BUFFER_PART_INFO_DELIVERED_IMAGEHEIGHT:
+    return setInfo(GenTL::INFO_DATATYPE_SIZET,
+                   deliveredHeight(*layout, buffer->mSizeFilled),
+                   type, value, size);
+  default:
+    return setLastError(GenTL::GC_ERR_NOT_IMPLEMENTED,
+                        "Buffer part info command not supported");
+  }
+}
+
+GenTL::GC_ERROR DataStream::getBufferChunkData(
+  Buffer* buffer,
+  GenTL::SINGLE_CHUNK_DATA* chunks,
+  size_t* chunkCount)
+{
+  if (&buffer->mOwner != this || chunkCount == nullptr)
+  {
+    return setLastError(GenTL::GC_ERR_INVALID_PARAMETER,
+                        "Not a buffer of this data stream");
+  }
+
+  std::lock_guard<std::mutex> lock(mMutex);
+  const FrameLayout* layout = buffer->mLayout.get();
+  if (layout == nullptr || !layout->mHasChunks)
+  {
+    *chunkCount = 0;
+    return GenTL::GC_ERR_SUCCESS;
+  }
+  if (buffer->mSizeFilled < layout->mPayloadSize)
+  {
+    return setLastError(GenTL::GC_ERR_NO_DATA,
+                        "Buffer is incomplete, the chunks are missing");
+  }
+  const size_t CHUNKS = 2;
+  if (chunks == nullptr || *chunkCount < CHUNKS)
+  {
+    const bool queryOnly = chunks == nullptr;
+    *chunkCount = CHUNKS;
+    return queryOnly
+      ? GenTL::GC_ERR_SUCCESS
+      : setLastError(GenTL::GC_ERR_BUFFER_TOO_SMALL,
+                     "Room for two chunks needed");
+  }
+  // Each chunk is followed by its 8 byte trailer
+  chunks[0].ChunkID = IMAGE_CHUNK_ID;
+  chunks[0].ChunkOffset = 0;
+  chunks[0].ChunkLength = layout->mMetadataOffset - 8;
+  chunks[1].ChunkID = METADATA_CHUNK_ID;
+  chunks[1].ChunkOffset = static_cast<ptrdiff_t>(layout->mMetadataOffset);
+  chunks[1].ChunkLength = layout->mMetadataLength;
+  *chunkCount = CHUNKS;
+  return GenTL::GC_ERR_SUCCESS;
+}
+
+GenTL::GC_ERROR DataStream::waitForBuffer(GenTL::EVENT_NEW_BUFFER_DATA& data,
+                                          uint64_t timeoutMs)
+{
+  std::unique_lock<std::mutex> lock(mMutex);
+  auto ready = [this] { return !mOutputQueue.empty() || mWaitKilled; };
+  if (timeoutMs >= MAX_TIMEOUT_MS)
+  {
+    mBufferDelivered.wait(lock, ready);
+  }
+  else if (!mBufferDelivered.wait_for(
+             lock, std::chrono::milliseconds(timeoutMs), ready))
+  {
+    return setLastError(GenTL::GC_ERR_TIMEOUT,
+                        "No buffer delivered before the timeout");
+  }
+  if (mWaitKilled)
+  {
+    mWaitKilled = false;
+    return setLastError(GenTL::GC_ERR_ABORT, "Wait aborted by EventKill");
+  }
+
+  Buffer* buffer = mOutputQueue.front();
+  mOutputQueue.pop_front();
+  buffer->mState = Buffer::DELIVERED;
+  ++mTotalDelivered;
+  data.BufferHandle = buffer->handle();
+  data.pUserPointer = buffer->mUserData;
+  return GenTL::GC_ERR_SUCCESS;
+}
+
+void DataStream::killWait()
+{
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mWaitKilled = true;
+  }
+  mBufferDelivered.notify_all();
+}
+
+void DataStream::discardOutput()
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  for (auto it = mOutputQueue.begin(); it != mOutputQueue.end(); ++it)
+  {
+    (*it)->mState = Buffer::ANNOUNCED;
+  }
+  mOutputQueue.clear();
+}
+
+size_t DataStream::outputQueueSize()
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  return mOutputQueue.size();
+}
+
+uint64_t DataStream::deliveredCount()
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  return mTotalDelivered;
+}
+
+void DataStream::wake()
+{
+  {
+    // Taken so that the generator cannot miss the wake up between checking
+    // the device and waiting
+    std::lock_guard<std::mutex> lock(mMutex);
+  }
+  mGeneratorWake.notify_all();
+}
+
+void DataStream::beforeRead(uint64_t address, size_t size)
+{
+  using namespace StreamRegister;
+  if (!overlaps(address, size, COUNTER_TABLE,
+                STREAM_COUNTER_COUNT * COUNTER_STRIDE))
+  {
+    return;
+  }
+  for (int i = 0; i < STREAM_COUNTER_COUNT; ++i)
+  {
+    set64(COUNTER_TABLE + i * COUNTER_STRIDE, mCounters[i].load());
+  }
+}
+
+void DataStream::afterWrite(uint64_t address, size_t size)
+{
+  using namespace StreamRegister;
+  // The priority is only stored, the generator keeps the default priority
+  if (overlaps(address, size, THREAD_APPLY_PRIORITY, 4))
+  {
+    set32(THREAD_APPLY_PRIORITY, 0);
+  }
+}
+
+GenTL::GC_ERROR DataStream::addBuffer(std::unique_ptr<Buffer> buffer,
+                                      GenTL::BUFFER_HANDLE* handle)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  mBuffers.push_back(std::move(buffer));
+  *handle = mBuffers.back()->handle();
+  return GenTL::GC_ERR_SUCCESS;
+}
+
+void DataStream::generatorLoop()
+{
+  RemoteDevice& remote = mParent.remote();
+  uint64_t acquisition = 0;
+  std::shared_ptr<const FrameLayout> layout;
+  std::unique_ptr<FrameGenerator> generator;
+  std::chrono::steady_clock::time_point nextFrame;
+  try
+  {
+    while (true)
+    {
+      {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mGeneratorWake.wait(lock, [this, &remote]
+        {
+          return mStopping || remote.isAcquiring();
+        });
+        const bool allDelivered = mFramesToAcquire != GENTL_INFINITE
+          && mFramesDelivered >= mFramesToAcquire;
+        if (allDelivered)
+        {
+          mGeneratorWake.wait(lock, [this] { return mStopping; });
+        }
+        if (mStopping)
+        {
+          return;
+        }
+      }
+
+      // Each AcquisitionStart may come with new parameters
+      const uint64_t current = remote.acquisitionCount();
+      if (current != acquisition)
+      {
+        acquisition = current;
+        layout = std::make_shared<FrameLayout>(remote.frameLayout());
+        generator.reset(new FrameGenerator(*layout));
+        nextFrame = std::chrono::steady_clock::now();
+      }
+      if (layout->mPayloadSize == 0)
+      {
+        // No component enabled, nothing to do until the next start
+        std::unique_lock<std::mutex> lock(mMutex);
+        mGeneratorWake.wait(lock, [this, &remote, acquisition]
+        {
+          return mStopping || remote.acquisitionCount() != acquisition;
+        });
+        continue;
+      }
+      if (waitForNextFrame(nextFrame, *layout, acquisition))
+      {
+        produceFrame(*generator, layout, acquisition);
+      }
+    }
+  }
+  catch (const std::exception& e)
+  {
+    // Nothing more is delivered, which the consumer sees as timeouts
+    setLastError(GenTL::GC_ERR_ERROR,
+                 std::string("Frame generator stopped: ") + e.what());
+  }
+}
+
+bool DataStream::waitForNextFrame(
+  std::chrono::steady_clock::time_point& nextFrame,
+  const FrameLayout& layout,
+  uint64_t acquisition)
+{
+  std::unique_lock<std::mutex> lock(mMutex);
+  if (layout.mLineRate <= 0)
+  {
+    // As fast as the consumer queues buffers
+    mGeneratorWake.wait(lock, [this, acquisition]
+    {
+      return isInterrupted(acquisition) || !mInputQueue.empty();
+    });
+    return !isInterrupted(acquisition);
+  }
+
+  if (mGeneratorWake.wait_until(lock, nextFrame, [this, acquisition]
+      {
+        return isInterrupted(acquisition);
+      }))
+  {
+    return false;
+  }
+  // A frame that could not be produced in time is not made up for, like a
+  // camera running into overtrigger
+  const std::chrono::duration<double> period(layout.mHeight
+                                             / layout.mLineRate);
+  nextFrame = std::max(
+    nextFrame
+      + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        period),
+    std::chrono::steady_clock::now());
+  return true;
+}
+
+void DataStream::produceFrame(const FrameGenerator& generator,
+                              const std::shared_ptr<const FrameLayout>& layout,
+                              uint64_t acquisition)
+{
+  const FrameLayout& frame = *layout;
+  const uint64_t frameId = mNextFrameId++;
+  const uint64_t packets =
+    (frame.mPayloadSize + PACKET_SIZE - 1) / PACKET_SIZE + 2;
+
+  LineClock clock;
+  clock.mTimestampNs = nowNs();
+  clock.mLineIntervalNs = frame.mLineRate > 0
+    ? static_cast<uint64_t>(1e9 / frame.mLineRate)
+    : 0;
+  clock.mEncoderValue = mEncoderValue;
+  mEncoderValue += static_cast<int32_t>(frame.mHeight);
+
+  if (mConfiguration.mDropEvery != 0
+      && frameId % mConfiguration.mDropEvery == 0)
+  {
+    count(LOST_PACKETS, packets);
+    count(SKIPPED_BLOCKS, 1);
+    return;
+  }
+
+  Buffer* buffer = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (isInterrupted(acquisition))
+    {
+      return;
+    }
+    if (mInputQueue.empty())
+    {
+      ++mUnderruns;
+      count(SEEN_PACKETS, packets);
+      count(ENGINE_UNDERRUNS, 1);
+      count(DISCARDED_BLOCKS, 1);
+      return;
+    }
+    buffer = mInputQueue.front();
+    mInputQueue.pop_front();
+    buffer->mState = Buffer::FILLING;
+  }
+
+  // Filled without the lock, the buffer cannot be revoked or moved while
+  // it is being filled
+  count(SEEN_PACKETS, packets);
+  size_t sizeFilled = frame.mPayloadSize;
+  bool incomplete = false;
+  if (buffer->mSize < frame.mPayloadSize)
+  {
+    sizeFilled = 0;
+    incomplete = true;
+    count(OVERSIZED_BLOCKS, 1);
+  }
+  else
+  {
+    generator.fill(buffer->mData, frameId, clock);
+    if (mConfiguration.mIncompleteEvery != 0
+        && frameId % mConfiguration.mIncompleteEvery == 0)
+    {
+      // The second half of the frame is lost on the way
+      sizeFilled = frame.mPayloadSize / 2;
+      incomplete = true;
+      count(LOST_PACKETS, packets / 2);
+    }
+  }
+  if (incomplete)
+  {
+    count(INCOMPLETE_BLOCKS, 1);
+  }
+  else
+  {
+    count(DELIVERED_PACKETS, packets);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    buffer->mLayout = layout;
+    buffer->mFrameId = frameId;
+    buffer->mTimestampNs = clock.mTimestampNs;
+    buffer->mSizeFilled = sizeFilled;
+    buffer->mIncomplete = incomplete;
+    buffer->mNewData = true;
+    buffer->mState = Buffer::OUTPUT;
+    mOutputQueue.push_back(buffer);
+    ++mFramesDelivered;
+  }
+  mBufferDelivered.notify_all();
+}
+
+bool DataStream::isInterrupted(uint64_t acquisition) const
+{
+  const RemoteDevice& remote = mParent.remote();
+  return mStopping
+    || !remote.isAcquiring()
+    || remote.acquisitionCount() != acquisition;
+}
+
+void DataStream::count(StreamCounter counter, uint64_t value)
+{
+  mCounters[counter] += value;
+}
+
+void DataStream::revokeAll()
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  mInputQueue.clear();
+  mOutputQueue.clear();
+  mBuffers.clear();
+}
+
+Device::Device(Interface& parent,
+               uint32_t index,
+               const Configuration& configuration)
+  : Port(DEVICE_MODULE,
+         "DevicePort",
+         moduleXml("DevicePort", "DeviceID"),
+         ModuleRegister::SIZE,
+         false)
+  , mParent(parent)
+  , mIndex(index)
+  , mId(deviceId(index))
+  , mSerialNumber(serialNumber(index))
+  , mOpen(false)
+  , mRemote(new RemoteDevice(index, mSerialNumber, configuration))
+  , mDataStream(new DataStream(*this, configuration))
+{
+  mRemote->attachDataStream(mDataStream.get());
+  setString(ModuleRegister::ID, ModuleRegister::ID_LENGTH, mId);
+}
+
+Device::~Device()
+{
+  // Empty
+}
+
+uint32_t Device::ipAddress() const
+{
+  // 192.168.0.10 and up
+  return 0xC0A8000A + mIndex;
+}
+
+uint64_t Device::macAddress() const
+{
+  // In the range of SICK
+  return 0x000677000000ull + mIndex;
+}
+
+GenTL::GC_ERROR Device::open()
+{
+  if (mOpen.exchange(true))
+  {
+    return setLastError(GenTL::GC_ERR_RESOURCE_IN_USE,
+                        "Device is already open");
+  }
+  return GenTL::GC_ERR_SUCCESS;
+}
+
+GenTL::GC_ERROR Device::close()
+{
+  if (mDataStream->isOpen())
+  {
+    mDataStream->close();
+  }
+  mOpen = false;
+  return GenTL::GC_ERR_SUCCESS;
+}
+
+GenTL::GC_ERROR Device::getInfo(GenTL::DEVICE_INFO_CMD command,
+                                GenTL::INFO_DATATYPE* type,
+                                void* buffer,
+                                size_t* size)
+{
+  switch (command)
+  {
+  case GenTL::DEVICE_INFO_ID:
+    return setInfoString(mId, type, buffer, size);
+  case GenTL::DEVICE_INFO_VENDOR:
+    return setInfoString(VENDOR, type, buffer, size);
+  case GenTL::DEVICE_INFO_MODEL:
+    return setInfoString(MODEL, type, buffer, size);
+  case GenTL::DEVICE_INFO_TLTYPE:
+    return setInfoString(TL_TYPE, type, buffer, size);
+  case GenTL::DEVICE_INFO_DISPLAYNAME:
+    return setInfoString(std::string(MODEL) + " " + mSerialNumber,
+                         type, buffer, size);
+  case GenTL::DEVICE_INFO_ACCESS_STATUS:
+  {
+    const int32_t status = isOpen()
+      ? static_cast<int32_t>(GenTL::DEVICE_ACCESS_STATUS_OPEN_READWRITE)
+      : static_cast<int32_t>(GenTL::DEVICE_ACCESS_STATUS_READWRITE);
+    return setInfo(GenTL::INFO_DATATYPE_INT32, status, type, buffer, size);
+  }
+  case GenTL::DEVICE_INFO_USER_DEFINED_NAME:
+    return setInfoString(mRemote->userId(), type, buffer, size);
+  case GenTL::DEVICE_INFO_SERIAL_NUMBER:
+    return setInfoString(mSerialNumber, type, buffer, size);
+  case GenTL::DEVICE_INFO_VERSION:
+    return setInfoString(VERSION, type, buffer, size);
+  case GenTL::DEVICE_INFO_TIMESTAMP_FREQUENCY:
+    // Timestamps are in nanoseconds
+    return setInfo(GenTL::INFO_DATATYPE_UINT64, uint64_t(1000000000),
+                   type, buffer, size);
+  default:
+    return setLastError(GenTL::GC_ERR_NOT_IMPLEMENTED,
+                        "Device info command not supported");
+  }
+}
+
+Interface::Interface(System& parent, const Configuration& configuration)
+  : Port(INTERFACE_MODULE,
+         "InterfacePort",
+         interfaceXml(),
+         InterfaceRegister::SIZE,
+         false)
+  , mParent(parent)
+  , mId("SimulatedInterface")
+  , mOpen(false)
+{
+  using namespace InterfaceRegister;
+  for (uint32_t i = 0; i < configuration.mDeviceCount; ++i)
+  {
+    mDevices.push_back(
+      std::unique_ptr<Device>(new Device(*this, i, configuration)));
+    const Device& device = *mDevices.back();
+    const uint64_t entry = DEVICE_TABLE + i * DEVICE_STRIDE;
+    setString(entry + DEVICE_ID, DEVICE_ID_LENGTH, device.id());
+    set32(entry + DEVICE_IP_ADDRESS, device.ipAddress());
+    set64(entry + DEVICE_MAC_ADDRESS, device.macAddress());
+  }
+  set32(DEVICE_SELECTOR_MAX, configuration.mDeviceCount - 1);
+}
+
+Interface::~Interface()
+{
+  // Empty
+}
+
+GenTL::GC_ERROR Interface::open()
+{
+  if (mOpen.exchange(true))
+  {
+    return setLastError(GenTL::GC_ERR_RESOURCE_IN_USE,
+                        "Interface is already open");
+  }
+  return GenTL::GC_ERR_SUCCESS;
+}
+
+GenTL::GC_ERROR Interface::close()
+{
+  for (auto it = mDevices.begin(); it != mDevices.end(); ++it)
+  {
+    if ((*it)->isOpen())
+    {
+      (*it)->close();
+    }
+  }
+  mOpen = false;
+  return GenTL::GC_ERR_SUCCESS;
+}
+
+uint32_t Interface::deviceCount() const
+{
+  return static_cast<uint32_t>(mDevices.size());
+}
+
+Device* Interface::device(uint32_t index)
+{
+  return index < mDevices.size() ? mDevices[index].get() : nullptr;
+}
+
+Device* Interface::findDevice(const char* id)
+{
+  if (id == nullptr)
+  {
+    return nullptr;
+  }
+  for (auto it = mDevices.begin(); it != mDevices.end(); ++it)
+  {
+    if ((*it)->id() == id)
+    {
+      return it->get();
+    }
+  }
+  return nullptr;
+}
+
+GenTL::GC_ERROR Interface::getInfo(GenTL::INTERFACE_INFO_CMD command,
+                                   GenTL::INFO_DATATYPE* type,
+                                   void* buffer,
+                                   size_t* size)
+{
+  switch (command)
+  {
+  case GenTL::INTERFACE_INFO_ID:
+    return setInfoString(mId, type, buffer, size);
+  case GenTL::INTERFACE_INFO_DISPLAYNAME:
+    return setInfoString("Simulated network", type, buffer, size);
+  case GenTL::INTERFACE_INFO_TLTYPE:
+    return setInfoString(TL_TYPE, type, buffer, size);
+  default:
+    return setLastError(GenTL::GC_ERR_NOT_IMPLEMENTED,
+                        "Interface info command not supported");
+  }
+}
+
+System::System(const Configuration& configuration)
+  : Port(SYSTEM_MODULE,
+         "TLPort",
+         moduleXml("TLPort", "TLID"),
+         ModuleRegister::SIZE,
+         false)
+  , mInterface(new Interface(*this, configuration))
+{
+  setString(ModuleRegister::ID, ModuleRegister::ID_LENGTH, TL_ID);
+}
+
+System::~System()
+{
+  // Empty
+}
+
+GenTL::GC_ERROR System::getInfo(GenTL::TL_INFO_CMD command,
+                                GenTL::INFO_DATATYPE* type,
+                                void* buffer,
+                                size_t* size)
+{
+  switch (command)
+  {
+  case GenTL::TL_INFO_ID:
+    return setInfoString(TL_ID, type, buffer, size);
+  case GenTL::TL_INFO_VENDOR:
+    return setInfoString(VENDOR, type, buffer, size);
+  case GenTL::TL_INFO_MODEL:
+    return setInfoString(MODEL, type, buffer, size);
+  case GenTL::TL_INFO_VERSION:
+    return setInfoString(VERSION, type, buffer, size);
+  case GenTL::TL_INFO_TLTYPE:
+    return setInfoString(TL_TYPE, type, buffer, size);
+  case GenTL::TL_INFO_NAME:
+  case GenTL::TL_INFO_PATHNAME:
+    return setInfoString("SimulatedRanger3.cti", type, buffer, size);
+  case GenTL::TL_INFO_DISPLAYNAME:
+    return setInfoString("Simulated Ranger3", type, buffer, size);
+  case GenTL::TL_INFO_CHAR_ENCODING:
+    return setInfo(GenTL::INFO_DATATYPE_INT32,
+                   static_cast<int32_t>(GenTL::TL_CHAR_ENCODING_ASCII),
+                   type, buffer, size);
+  case GenTL::TL_INFO_GENTL_VER_MAJOR:
+    return setInfo(GenTL::INFO_DATATYPE_UINT32, uint32_t(1),
+                   type, buffer, size);
+  case GenTL::TL_INFO_GENTL_VER_MINOR:
+    return setInfo(GenTL::INFO_DATATYPE_UINT32, uint32_t(5),
+                   type, buffer, size);
+  default:
+    return setLastError(GenTL::GC_ERR_NOT_IMPLEMENTED,
+                        "System info command not supported");
+  }
+}
+
+}
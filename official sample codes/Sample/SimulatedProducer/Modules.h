@@ -0,0 +1,550 @@
+// Copyright 2018 SICK AG. All rights reserved.
+
+#ifndef SIMULATED_MODULES_H
+#define SIMULATED_MODULES_H
+
+#include "FrameGenerator.h"
+#include "NodeMaps.h"
+
+#include "TLI/GenTL.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Simulator
+{
+
+class DataStream;
+class Device;
+class Event;
+class Interface;
+class System;
+
+/** Settings of the simulation, read from the environment when the library
+    is initialized.
+*/
+struct Configuration
+{
+  Configuration();
+
+  /** Reads RANGER3_SIM_DEVICES, RANGER3_SIM_LINE_RATE,
+      RANGER3_SIM_DROP_EVERY and RANGER3_SIM_INCOMPLETE_EVERY, keeping the
+      default for any that is not set.
+  */
+  static Configuration fromEnvironment();
+
+  /** Devices found on the simulated interface. */
+  uint32_t mDeviceCount;
+  /** Lines per second for all devices, overriding AcquisitionLineRate.
+      Zero delivers a frame as soon as a buffer is queued, negative uses
+      the node map.
+  */
+  double mLineRate;
+  /** Every n:th frame is lost on the way, zero for none. */
+  uint32_t mDropEvery;
+  /** Every n:th frame is delivered incomplete, zero for none. */
+  uint32_t mIncompleteEvery;
+};
+
+/** Records the error returned by GCGetLastError and returns the code. The
+    error is shared by all threads, it is only meant for diagnostics.
+*/
+GenTL::GC_ERROR setLastError(GenTL::GC_ERROR code,
+                             const std::string& message);
+void getLastError(GenTL::GC_ERROR& code, std::string& message);
+
+/** Returns a value from one of the info functions. With a null buffer only
+    the size needed is returned.
+*/
+template<typename T>
+GenTL::GC_ERROR setInfo(GenTL::INFO_DATATYPE infoType,
+                        const T& value,
+                        GenTL::INFO_DATATYPE* type,
+                        void* buffer,
+                        size_t* size)
+{
+  if (size == nullptr)
+  {
+    return setLastError(GenTL::GC_ERR_INVALID_PARAMETER, "Size is null");
+  }
+  if (type != nullptr)
+  {
+    *type = infoType;
+  }
+  if (buffer != nullptr)
+  {
+    if (*size < sizeof(T))
+    {
+      *size = sizeof(T);
+      return setLastError(GenTL::GC_ERR_BUFFER_TOO_SMALL,
+                          "Buffer too small for info value");
+    }
+    std::memcpy(buffer, &value, sizeof(T));
+  }
+  *size = sizeof(T);
+  return GenTL::GC_ERR_SUCCESS;
+}
+
+/** As setInfo, for a string including the terminating null. */
+GenTL::GC_ERROR setInfoString(const std::string& value,
+                              GenTL::INFO_DATATYPE* type,
+                              void* buffer,
+                              size_t* size);
+
+enum HandleKind
+{
+  SYSTEM_MODULE,
+  INTERFACE_MODULE,
+  DEVICE_MODULE,
+  REMOTE_DEVICE,
+  DATA_STREAM_MODULE,
+  BUFFER_OBJECT,
+  EVENT_OBJECT
+};
+
+/** Base of every object handed out as a handle, so that a handle of the
+    wrong kind is rejected rather than used.
+*/
+class Handle
+{
+public:
+  explicit Handle(HandleKind kind);
+  virtual ~Handle();
+
+  HandleKind kind() const { return mKind; }
+  void* handle() { return static_cast<Handle*>(this); }
+
+  /** The object of a handle from the consumer, nullptr if it is not an
+      object of the kind.
+  */
+  template<typename T>
+  static T* from(void* handle, HandleKind kind)
+  {
+    Handle* object = static_cast<Handle*>(handle);
+    if (object == nullptr || object->mMagic != MAGIC || object->mKind != kind)
+    {
+      return nullptr;
+    }
+    return static_cast<T*>(object);
+  }
+
+protected:
+  static bool isHandle(void* handle);
+
+private:
+  Handle(const Handle&);
+  Handle& operator=(const Handle&);
+
+  static const uint32_t MAGIC = 0x52334753;
+
+  uint32_t mMagic;
+  HandleKind mKind;
+};
+
+/** Register memory and a GenICam XML describing it, what the consumer
+    reaches with GCReadPort and GCWritePort. The XML is read from
+    XML_ADDRESS, as given by the port URL.
+*/
+class Port : public Handle
+{
+public:
+  Port(HandleKind kind,
+       const std::string& portName,
+       const std::string& xml,
+       size_t registerSize,
+       bool bigEndian);
+  virtual ~Port();
+
+  /** Any module with a port, nullptr for other handles. */
+  static Port* fromHandle(void* handle);
+
+  GenTL::GC_ERROR read(uint64_t address, void* buffer, size_t* size);
+  GenTL::GC_ERROR write(uint64_t address, const void* buffer, size_t* size);
+
+  GenTL::GC_ERROR getInfo(GenTL::PORT_INFO_CMD command,
+                          GenTL::INFO_DATATYPE* type,
+                          void* buffer,
+                          size_t* size);
+  GenTL::GC_ERROR getUrlInfo(uint32_t index,
+                             GenTL::URL_INFO_CMD command,
+                             GenTL::INFO_DATATYPE* type,
+                             void* buffer,
+                             size_t* size);
+  std::string url() const;
+
+  GenTL::GC_ERROR registerEvent(GenTL::EVENT_TYPE eventType,
+                                Event*& event);
+  GenTL::GC_ERROR unregisterEvent(GenTL::EVENT_TYPE eventType);
+
+protected:
+  /** Where the new buffer events come from, only a data stream has one. */
+  virtual DataStream* newBufferSource() { return nullptr; }
+  /** Name of the module for PORT_INFO_MODULE. */
+  virtual const char* moduleName() const = 0;
+
+  // Called with the register lock held, before a read to update registers
+  // computed on demand, and around a write to validate and act on it
+  virtual void beforeRead(uint64_t address, size_t size);
+  virtual GenTL::GC_ERROR checkWrite(uint64_t address, size_t size);
+  virtual void afterWrite(uint64_t address, size_t size);
+
+  // Register access in the byte order of the port, with the lock held
+  uint32_t get32(uint64_t address) const;
+  void set32(uint64_t address, uint32_t value);
+  void set64(uint64_t address, uint64_t value);
+  float getFloat(uint64_t address) const;
+  void setFloat(uint64_t address, float value);
+  std::string getString(uint64_t address, size_t length) const;
+  void setString(uint64_t address, size_t length, const std::string& value);
+
+  mutable std::mutex mRegisterMutex;
+
+private:
+  const std::string mPortName;
+  const std::string mXml;
+  const bool mBigEndian;
+  std::vector<uint8_t> mRegisters;
+
+  std::mutex mEventMutex;
+  std::map<GenTL::EVENT_TYPE, std::unique_ptr<Event>> mEvents;
+};
+
+/** An event object. The new buffer event of a data stream takes its data
+    from the output queue of the stream, any other kind of event is never
+    signaled but may be waited for and killed.
+*/
+class Event : public Handle
+{
+public:
+  Event(GenTL::EVENT_TYPE eventType, DataStream* dataStream);
+
+  GenTL::EVENT_TYPE eventType() const { return mEventType; }
+
+  GenTL::GC_ERROR getData(void* buffer, size_t* size, uint64_t timeoutMs);
+  GenTL::GC_ERROR getDataInfo(const void* data,
+                              size_t dataSize,
+                              GenTL::EVENT_DATA_INFO_CMD command,
+                              GenTL::INFO_DATATYPE* type,
+                              void* buffer,
+                              size_t* size);
+  GenTL::GC_ERROR getInfo(GenTL::EVENT_INFO_CMD command,
+                          GenTL::INFO_DATATYPE* type,
+                          void* buffer,
+                          size_t* size);
+  GenTL::GC_ERROR flush();
+  /** Aborts the current wait, or the next one if none is waiting. */
+  GenTL::GC_ERROR kill();
+
+private:
+  const GenTL::EVENT_TYPE mEventType;
+  DataStream* const mDataStream;
+
+  // Only for an event without a data stream
+  std::mutex mMutex;
+  std::condition_variable mKilledCondition;
+  bool mKilled;
+};
+
+/** A buffer announced to a data stream. Only accessed by the stream, with
+    its lock held.
+*/
+class Buffer : public Handle
+{
+public:
+  enum State
+  {
+    /** Announced, in no queue. */
+    ANNOUNCED,
+    /** In the input queue. */
+    QUEUED,
+    /** Being written by the generator. */
+    FILLING,
+    /** In the output queue, waiting for an event to deliver it. */
+    OUTPUT,
+    /** Handed to the consumer. */
+    DELIVERED
+  };
+
+  Buffer(DataStream& owner,
+         uint8_t* data,
+         size_t size,
+         void* userData,
+         bool owned);
+  ~Buffer();
+
+  DataStream& mOwner;
+  uint8_t* const mData;
+  const size_t mSize;
+  void* const mUserData;
+  const bool mOwned;
+  State mState;
+
+  // The last frame written, no layout before the first one
+  std::shared_ptr<const FrameLayout> mLayout;
+  uint64_t mFrameId;
+  uint64_t mTimestampNs;
+  size_t mSizeFilled;
+  bool mIncomplete;
+  bool mNewData;
+};
+
+/** The registers of the simulated camera itself, behind DevGetPort. */
+class RemoteDevice : public Port
+{
+public:
+  RemoteDevice(uint32_t index,
+               const std::string& serialNumber,
+               const Configuration& configuration);
+
+  /** Receives the AcquisitionStart and AcquisitionStop commands. */
+  void attachDataStream(DataStream* dataStream);
+
+  /** The layout of frames with the current parameters. */
+  FrameLayout frameLayout() const;
+  size_t payloadSize() const;
+  std::string userId() const;
+
+  bool isAcquiring() const { return mAcquiring.load(); }
+  /** Increases with each AcquisitionStart. */
+  uint64_t acquisitionCount() const { return mAcquisitionCount.load(); }
+
+protected:
+  const char* moduleName() const { return "Device"; }
+  GenTL::GC_ERROR checkWrite(uint64_t address, size_t size);
+  void afterWrite(uint64_t address, size_t size);
+
+private:
+  FrameLayout frameLayoutLocked() const;
+
+private:
+  const Configuration mConfiguration;
+  DataStream* mDataStream;
+  std::atomic<bool> mAcquiring;
+  std::atomic<uint64_t> mAcquisitionCount;
+};
+
+/** A data stream, generating frames into the queued buffers on a thread of
+    its own while acquisition is started both on the stream and on the
+    device.
+*/
+class DataStream : public Port
+{
+public:
+  DataStream(Device& parent, const Configuration& configuration);
+  ~DataStream();
+
+  Device& parent() { return mParent; }
+  const std::string& id() const { return mId; }
+
+  bool isOpen() const { return mOpen.load(); }
+  GenTL::GC_ERROR open();
+  /** Stops the acquisition and revokes all buffers. */
+  GenTL::GC_ERROR close();
+
+  GenTL::GC_ERROR announceBuffer(void* data,
+                                 size_t size,
+                                 void* userData,
+                                 GenTL::BUFFER_HANDLE* handle);
+  GenTL::GC_ERROR allocAndAnnounceBuffer(size_t size,
+                                         void* userData,
+                                         GenTL::BUFFER_HANDLE* handle);
+  GenTL::GC_ERROR revokeBuffer(Buffer* buffer, void** data, void** userData);
+  GenTL::GC_ERROR queueBuffer(Buffer* buffer);
+  GenTL::GC_ERROR flushQueue(GenTL::ACQ_QUEUE_TYPE operation);
+  GenTL::GC_ERROR startAcquisition(uint64_t frameCount);
+  GenTL::GC_ERROR stopAcquisition();
+
+  GenTL::GC_ERROR getInfo(GenTL::STREAM_INFO_CMD command,
+                          GenTL::INFO_DATATYPE* type,
+                          void* buffer,
+                          size_t* size);
+  GenTL::GC_ERROR getBufferId(uint32_t index, GenTL::BUFFER_HANDLE* handle);
+  GenTL::GC_ERROR getBufferInfo(Buffer* buffer,
+                                GenTL::BUFFER_INFO_CMD command,
+                                GenTL::INFO_DATATYPE* type,
+                                void* value,
+                                size_t* size);
+  GenTL::GC_ERROR getNumBufferParts(Buffer* buffer, uint32_t* partCount);
+  GenTL::GC_ERROR getBufferPartInfo(Buffer* buffer,
+                                    uint32_t partIndex,
+                                    GenTL::BUFFER_PART_INFO_CMD command,
+                                    GenTL::INFO_DATATYPE* type,
+                                    void* value,
+                                    size_t* size);
+  GenTL::GC_ERROR getBufferChunkData(Buffer* buffer,
+                                     GenTL::SINGLE_CHUNK_DATA* chunks,
+                                     size_t* chunkCount);
+
+  // For the new buffer event
+  GenTL::GC_ERROR waitForBuffer(GenTL::EVENT_NEW_BUFFER_DATA& data,
+                                uint64_t timeoutMs);
+  void killWait();
+  void discardOutput();
+  size_t outputQueueSize();
+  uint64_t deliveredCount();
+
+  /** Called by the device when it starts or stops acquiring. */
+  void wake();
+
+protected:
+  DataStream* newBufferSource() { return this; }
+  const char* moduleName() const { return "TLDataStream"; }
+  void beforeRead(uint64_t address, size_t size);
+  void afterWrite(uint64_t address, size_t size);
+
+private:
+  GenTL::GC_ERROR addBuffer(std::unique_ptr<Buffer> buffer,
+                            GenTL::BUFFER_HANDLE* handle);
+  void generatorLoop();
+  bool waitForNextFrame(std::chrono::steady_clock::time_point& nextFrame,
+                        const FrameLayout& layout,
+                        uint64_t acquisition);
+  void produceFrame(const FrameGenerator& generator,
+                    const std::shared_ptr<const FrameLayout>& layout,
+                    uint64_t acquisition);
+  bool isInterrupted(uint64_t acquisition) const;
+  void count(StreamCounter counter, uint64_t value);
+  void revokeAll();
+
+private:
+  Device& mParent;
+  const Configuration mConfiguration;
+  const std::string mId;
+  std::atomic<bool> mOpen;
+
+  // Serializes starting and stopping, which is done without mMutex held
+  std::mutex mControlMutex;
+  std::mutex mMutex;
+  // Wakes the generator, on start, stop and queued buffers
+  std::condition_variable mGeneratorWake;
+  // Wakes the consumer waiting for a new buffer event
+  std::condition_variable mBufferDelivered;
+  std::vector<std::unique_ptr<Buffer>> mBuffers;
+  std::deque<Buffer*> mInputQueue;
+  std::deque<Buffer*> mOutputQueue;
+  std::thread mGenerator;
+  bool mStarted;
+  bool mStopping;
+  bool mWaitKilled;
+  uint64_t mFramesToAcquire;
+  uint64_t mFramesDelivered;
+  uint64_t mTotalDelivered;
+  uint64_t mTotalStarted;
+  uint64_t mUnderruns;
+
+  // Only used by the generator thread
+  uint64_t mNextFrameId;
+  int32_t mEncoderValue;
+
+  std::atomic<uint64_t> mCounters[STREAM_COUNTER_COUNT];
+};
+
+/** The device module, owning the remote device and its data stream. */
+class Device : public Port
+{
+public:
+  Device(Interface& parent,
+         uint32_t index,
+         const Configuration& configuration);
+  ~Device();
+
+  Interface& parent() { return mParent; }
+  const std::string& id() const { return mId; }
+  uint32_t ipAddress() const;
+  uint64_t macAddress() const;
+
+  RemoteDevice& remote() { return *mRemote; }
+  DataStream& dataStream() { return *mDataStream; }
+
+  bool isOpen() const { return mOpen.load(); }
+  GenTL::GC_ERROR open();
+  /** Closes the data stream too, if open. */
+  GenTL::GC_ERROR close();
+
+  GenTL::GC_ERROR getInfo(GenTL::DEVICE_INFO_CMD command,
+                          GenTL::INFO_DATATYPE* type,
+                          void* buffer,
+                          size_t* size);
+
+protected:
+  const char* moduleName() const { return "TLDevice"; }
+
+private:
+  Interface& mParent;
+  const uint32_t mIndex;
+  const std::string mId;
+  const std::string mSerialNumber;
+  std::atomic<bool> mOpen;
+  std::unique_ptr<RemoteDevice> mRemote;
+  std::unique_ptr<DataStream> mDataStream;
+};
+
+/** The only interface, with all simulated devices. */
+class Interface : public Port
+{
+public:
+  Interface(System& parent, const Configuration& configuration);
+  ~Interface();
+
+  System& parent() { return mParent; }
+  const std::string& id() const { return mId; }
+
+  bool isOpen() const { return mOpen.load(); }
+  GenTL::GC_ERROR open();
+  /** Closes all devices too. */
+  GenTL::GC_ERROR close();
+
+  uint32_t deviceCount() const;
+  Device* device(uint32_t index);
+  Device* findDevice(const char* id);
+
+  GenTL::GC_ERROR getInfo(GenTL::INTERFACE_INFO_CMD command,
+                          GenTL::INFO_DATATYPE* type,
+                          void* buffer,
+                          size_t* size);
+
+protected:
+  const char* moduleName() const { return "TLInterface"; }
+
+private:
+  System& mParent;
+  const std::string mId;
+  std::atomic<bool> mOpen;
+  std::vector<std::unique_ptr<Device>> mDevices;
+};
+
+/** The system module, opened with TLOpen. */
+class System : public Port
+{
+public:
+  explicit System(const Configuration& configuration);
+  ~System();
+
+  Interface& simulatedInterface() { return *mInterface; }
+
+  /** Also used by GCGetInfo, before the system is opened. */
+  static GenTL::GC_ERROR getInfo(GenTL::TL_INFO_CMD command,
+                                 GenTL::INFO_DATATYPE* type,
+                                 void* buffer,
+                                 size_t* size);
+
+protected:
+  const char* moduleName() const { return "TLSystem"; }
+
+private:
+  std::unique_ptr<Interface> mInterface;
+};
+
+}
+
+#endif
@@ -0,0 +1,839 @@
+// Copyright 2018 SICK AG. All rights reserved.
+
+#include "NodeMaps.h"
+
+namespace Simulator
+{
+
+namespace
+{
+
+// The addresses must match the registers in NodeMaps.h. Each XML is split
+// in several literals since the compiler limits the length of each one.
+
+const char* const XML_HEADER = R"(<?xml version="1.0" encoding="utf-8"?>
+<RegisterDescription
+  ModelName="Ranger3Simulated"
+  VendorName="SICK"
+  ToolTip="Simulated Ranger3 for testing without a camera"
+  StandardNameSpace="GEV"
+  SchemaMajorVersion="1"
+  SchemaMinorVersion="1"
+  SchemaSubMinorVersion="0"
+  MajorVersion="1"
+  MinorVersion="0"
+  SubMinorVersion="0"
+  ProductGuid="3B1C4E2A-7D54-4F0B-9C61-52A8E0D1F001"
+  VersionGuid="3B1C4E2A-7D54-4F0B-9C61-52A8E0D1F002"
+  xmlns="http://www.genicam.org/GenApi/Version_1_1"
+  xmlns:xsi="http://www.w3.org/2001/XMLSchema-instance"
+  xsi:schemaLocation="http://www.genicam.org/GenApi/Version_1_1 )"
+  R"(http://www.genicam.org/GenApi/GenApiSchema_Version_1_1.xsd">
+)";
+
+const char* const XML_FOOTER = R"(</RegisterDescription>
+)";
+
+const char* const DEVICE_CONTROL = R"(
+  <Category Name="Root" NameSpace="Standard">
+    <pFeature>DeviceControl</pFeature>
+    <pFeature>ImageFormatControl</pFeature>
+    <pFeature>AcquisitionControl</pFeature>
+    <pFeature>ChunkDataControl</pFeature>
+    <pFeature>TransportLayerControl</pFeature>
+  </Category>
+
+  <Category Name="DeviceControl" NameSpace="Standard">
+    <pFeature>DeviceModelName</pFeature>
+    <pFeature>DeviceSerialNumber</pFeature>
+    <pFeature>DeviceUserID</pFeature>
+    <pFeature>DeviceScanType</pFeature>
+    <pFeature>DeviceRegistersStreamingStart</pFeature>
+    <pFeature>DeviceRegistersStreamingEnd</pFeature>
+    <pFeature>DeviceRegistersValid</pFeature>
+  </Category>
+
+  <StringReg Name="DeviceModelName" NameSpace="Standard">
+    <Visibility>Beginner</Visibility>
+    <Address>0x0000</Address>
+    <Length>32</Length>
+    <AccessMode>RO</AccessMode>
+    <pPort>Device</pPort>
+  </StringReg>
+
+  <StringReg Name="DeviceSerialNumber" NameSpace="Standard">
+    <Visibility>Beginner</Visibility>
+    <Address>0x0020</Address>
+    <Length>32</Length>
+    <AccessMode>RO</AccessMode>
+    <pPort>Device</pPort>
+  </StringReg>
+
+  <StringReg Name="DeviceUserID" NameSpace="Standard">
+    <Visibility>Beginner</Visibility>
+    <Streamable>Yes</Streamable>
+    <Address>0x0040</Address>
+    <Length>32</Length>
+    <AccessMode>RW</AccessMode>
+    <pPort>Device</pPort>
+    <Cachable>NoCache</Cachable>
+  </StringReg>
+
+  <Enumeration Name="DeviceScanType" NameSpace="Standard">
+    <Visibility>Beginner</Visibility>
+    <pIsLocked>TLParamsLocked</pIsLocked>
+    <Streamable>Yes</Streamable>
+    <EnumEntry Name="Areascan" NameSpace="Standard">
+      <Value>0</Value>
+    </EnumEntry>
+    <EnumEntry Name="Linescan3D" NameSpace="Custom">
+      <Value>1</Value>
+    </EnumEntry>
+    <pValue>DeviceScanTypeReg</pValue>
+  </Enumeration>
+
+  <IntReg Name="DeviceScanTypeReg">
+    <Address>0x0100</Address>
+    <Length>4</Length>
+    <AccessMode>RW</AccessMode>
+    <pPort>Device</pPort>
+    <Cachable>NoCache</Cachable>
+    <Endianess>BigEndian</Endianess>
+  </IntReg>
+
+  <Command Name="DeviceRegistersStreamingStart" NameSpace="Standard">
+    <Visibility>Guru</Visibility>
+    <pValue>DeviceRegistersStreamingStartReg</pValue>
+    <CommandValue>1</CommandValue>
+  </Command>
+
+  <IntReg Name="DeviceRegistersStreamingStartReg">
+    <Address>0x012C</Address>
+    <Length>4</Length>
+    <AccessMode>RW</AccessMode>
+    <pPort>Device</pPort>
+    <Cachable>NoCache</Cachable>
+    <Endianess>BigEndian</Endianess>
+  </IntReg>
+
+  <Command Name="DeviceRegistersStreamingEnd" NameSpace="Standard">
+    <Visibility>Guru</Visibility>
+    <pValue>DeviceRegistersStreamingEndReg</pValue>
+    <CommandValue>1</CommandValue>
+  </Command>
+
+  <IntReg Name="DeviceRegistersStreamingEndReg">
+    <Address>0x0130</Address>
+    <Length>4</Length>
+    <AccessMode>RW</AccessMode>
+    <pPort>Device</pPort>
+    <Cachable>NoCache</Cachable>
+    <Endianess>BigEndian</Endianess>
+  </IntReg>
+
+  <Boolean Name="DeviceRegistersValid" NameSpace="Standard">
+    <Visibility>Guru</Visibility>
+    <pValue>DeviceRegistersValidReg</pValue>
+    <OnValue>1</OnValue>
+    <OffValue>0</OffValue>
+  </Boolean>
+
+  <IntReg Name="DeviceRegistersValidReg">
+    <Address>0x0134</Address>
+    <Length>4</Length>
+    <AccessMode>RO</AccessMode>
+    <pPort>Device</pPort>
+    <Cachable>NoCache</Cachable>
+    <Endianess>BigEndian</Endianess>
+  </IntReg>
+)";
+
+const char* const IMAGE_FORMAT_CONTROL = R"(
+  <Category Name="ImageFormatControl" NameSpace="Standard">
+    <pFeature>RegionSelector</pFeature>
+    <pFeature>Width</pFeature>
+    <pFeature>Height</pFeature>
+    <pFeature>OffsetX</pFeature>
+    <pFeature>OffsetY</pFeature>
+    <pFeature>ComponentSelector</pFeature>
+    <pFeature>ComponentEnable</pFeature>
+  </Category>
+
+  <Enumeration Name="RegionSelector" NameSpace="Standard">
+    <Visibility>Beginner</Visibility>
+    <EnumEntry Name="Region0" NameSpace="Standard">
+      <Value>0</Value>
+    </EnumEntry>
+    <EnumEntry Name="Region1" NameSpace="Standard">
+      <Value>1</Value>
+    </EnumEntry>
+    <EnumEntry Name="Scan3dExtraction1" NameSpace="Standard">
+      <Value>2</Value>
+    </EnumEntry>
+    <pValue>RegionSelectorReg</pValue>
+    <pSelected>Width</pSelected>
+    <pSelected>Height</pSelected>
+    <pSelected>OffsetX</pSelected>
+    <pSelected>OffsetY</pSelected>
+  </Enumeration>
+
+  <IntReg Name="RegionSelectorReg">
+    <Address>0x0124</Address>
+    <Length>4</Length>
+    <AccessMode>RW</AccessMode>
+    <pPort>Device</pPort>
+    <Cachable>NoCache</Cachable>
+    <Endianess>BigEndian</Endianess>
+  </IntReg>
+
+  <IntReg Name="Width" NameSpace="Standard">
+    <Visibility>Beginner</Visibility>
+    <pIsLocked>TLParamsLocked</pIsLocked>
+    <Streamable>Yes</Streamable>
+    <Address>0x0200</Address>
+    <pIndex Offset="16">RegionSelectorReg</pIndex>
+    <Length>4</Length>
+    <AccessMode>RW</AccessMode>
+    <pPort>Device</pPort>
+    <Cachable>NoCache</Cachable>
+    <Endianess>BigEndian</Endianess>
+  </IntReg>
+
+  <IntReg Name="Height" NameSpace="Standard">
+    <Visibility>Beginner</Visibility>
+    <pIsLocked>TLParamsLocked</pIsLocked>
+    <Streamable>Yes</Streamable>
+    <Address>0x0204</Address>
+    <pIndex Offset="16">RegionSelectorReg</pIndex>
+    <Length>4</Length>
+    <AccessMode>RW</AccessMode>
+    <pPort>Device</pPort>
+    <Cachable>NoCache</Cachable>
+    <Endianess>BigEndian</Endianess>
+  </IntReg>
+
+  <IntReg Name="OffsetX" NameSpace="Standard">
+    <Visibility>Beginner</Visibility>
+    <pIsLocked>TLParamsLocked</pIsLocked>
+    <Streamable>Yes</Streamable>
+    <Address>0x0208</Address>
+    <pIndex Offset="16">RegionSelectorReg</pIndex>
+    <Length>4</Length>
+    <AccessMode>RW</AccessMode>
+    <pPort>Device</pPort>
+    <Cachable>NoCache</Cachable>
+    <Endianess>BigEndian</Endianess>
+  </IntReg>
+
+  <IntReg Name="OffsetY" NameSpace="Standard">
+    <Visibility>Beginner</Visibility>
+    <pIsLocked>TLParamsLocked</pIsLocked>
+    <Streamable>Yes</Streamable>
+    <Address>0x020C</Address>
+    <pIndex Offset="16">RegionSelectorReg</pIndex>
+    <Length>4</Length>
+    <AccessMode>RW</AccessMode>
+    <pPort>Device</pPort>
+    <Cachable>NoCache</Cachable>
+    <Endianess>BigEndian</Endianess>
+  </IntReg>
+
+  <Enumeration Name="ComponentSelector" NameSpace="Standard">
+    <Visibility>Beginner</Visibility>
+    <EnumEntry Name="Range" NameSpace="Standard">
+      <Value>0</Value>
+    </EnumEntry>
+    <EnumEntry Name="Reflectance" NameSpace="Standard">
+      <Value>1</Value>
+    </EnumEntry>
+    <EnumEntry Name="Scatter" NameSpace="Standard">
+      <Value>2</Value>
+    </EnumEntry>
+    <pValue>ComponentSelectorReg</pValue>
+    <pSelected>ComponentEnable</pSelected>
+  </Enumeration>
+
+  <IntReg Name="ComponentSelectorReg">
+    <Address>0x0128</Address>
+    <Length>4</Length>
+    <AccessMode>RW</AccessMode>
+    <pPort>Device</pPort>
+    <Cachable>NoCache</Cachable>
+    <Endianess>BigEndian</Endianess>
+  </IntReg>
+
+  <Boolean Name="ComponentEnable" NameSpace="Standard">
+    <Visibility>Beginner</Visibility>
+    <pIsLocked>TLParamsLocked</pIsLocked>
+    <Streamable>Yes</Streamable>
+    <pValue>ComponentEnableReg</pValue>
+    <OnValue>1</OnValue>
+    <OffValue>0</OffValue>
+  </Boolean>
+
+  <IntReg Name="ComponentEnableReg">
+    <Address>0x0300</Address>
+    <pIndex Offset="4">ComponentSelectorReg</pIndex>
+    <Length>4</Length>
+    <AccessMode>RW</AccessMode>
+    <pPort>Device</pPort>
+    <Cachable>NoCache</Cachable>
+    <Endianess>BigEndian</Endianess>
+  </IntReg>
+)";
+
+const char* const ACQUISITION_CONTROL = R"(
+  <Category Name="AcquisitionControl" NameSpace="Standard">
+    <pFeature>AcquisitionMode</pFeature>
+    <pFeature>AcquisitionStart</pFeature>
+    <pFeature>AcquisitionStop</pFeature>
+    <pFeature>AcquisitionLineRate</pFeature>
+    <pFeature>ExposureTime</pFeature>
+  </Category>
+
+  <Enumeration Name="AcquisitionMode" NameSpace="Standard">
+    <Visibility>Beginner</Visibility>
+    <pIsLocked>TLParamsLocked</pIsLocked>
+    <Streamable>Yes</Streamable>
+    <EnumEntry Name="Continuous" NameSpace="Standard">
+      <Value>2</Value>
+    </EnumEntry>
+    <pValue>AcquisitionModeReg</pValue>
+  </Enumeration>
+
+  <IntReg Name="AcquisitionModeReg">
+    <Address>0x0104</Address>
+    <Length>4</Length>
+    <AccessMode>RW</AccessMode>
+    <pPort>Device</pPort>
+    <Cachable>NoCache</Cachable>
+    <Endianess>BigEndian</Endianess>
+  </IntReg>
+
+  <Command Name="AcquisitionStart" NameSpace="Standard">
+    <Visibility>Beginner</Visibility>
+    <pValue>AcquisitionStartReg</pValue>
+    <CommandValue>1</CommandValue>
+  </Command>
+
+  <IntReg Name="AcquisitionStartReg">
+    <Address>0x0108</Address>
+    <Length>4</Length>
+    <AccessMode>RW</AccessMode>
+    <pPort>Device</pPort>
+    <Cachable>NoCache</Cachable>
+    <Endianess>BigEndian</Endianess>
+  </IntReg>
+
+  <Command Name="AcquisitionStop" NameSpace="Standard">
+    <Visibility>Beginner</Visibility>
+    <pValue>AcquisitionStopReg</pValue>
+    <CommandValue>1</CommandValue>
+  </Command>
+
+  <IntReg Name="AcquisitionStopReg">
+    <Address>0x010C</Address>
+    <Length>4</Length>
+    <AccessMode>RW</AccessMode>
+    <pPort>Device</pPort>
+    <Cachable>NoCache</Cachable>
+    <Endianess>BigEndian</Endianess>
+  </IntReg>
+
+  <Float Name="AcquisitionLineRate" NameSpace="Standard">
+    <Visibility>Beginner</Visibility>
+    <Streamable>Yes</Streamable>
+    <pValue>AcquisitionLineRateReg</pValue>
+    <Min>1</Min>
+    <Max>100000</Max>
+    <Unit>Hz</Unit>
+  </Float>
+
+  <FloatReg Name="AcquisitionLineRateReg">
+    <Address>0x011C</Address>
+    <Length>4</Length>
+    <AccessMode>RW</AccessMode>
+    <pPort>Device</pPort>
+    <Cachable>NoCache</Cachable>
+    <Endianess>BigEndian</Endianess>
+  </FloatReg>
+
+  <Float Name="ExposureTime" NameSpace="Standard">
+    <Visibility>Beginner</Visibility>
+    <Streamable>Yes</Streamable>
+    <pValue>ExposureTimeReg</pValue>
+    <Min>1</Min>
+    <Max>100000</Max>
+    <Unit>us</Unit>
+  </Float>
+
+  <FloatReg Name="ExposureTimeReg">
+    <Address>0x0118</Address>
+    <Length>4</Length>
+    <AccessMode>RW</AccessMode>
+    <pPort>Device</pPort>
+    <Cachable>NoCache</Cachable>
+    <Endianess>BigEndian</Endianess>
+  </FloatReg>
+
+  <Category Name="TransportLayerControl" NameSpace="Standard">
+    <pFeature>PayloadSize</pFeature>
+    <pFeature>TLParamsLocked</pFeature>
+  </Category>
+
+  <IntReg Name="PayloadSize" NameSpace="Standard">
+    <Visibility>Expert</Visibility>
+    <Address>0x0114</Address>
+    <Length>4</Length>
+    <AccessMode>RO</AccessMode>
+    <pPort>Device</pPort>
+    <Cachable>NoCache</Cachable>
+    <Endianess>BigEndian</Endianess>
+  </IntReg>
+
+  <Integer Name="TLParamsLocked" NameSpace="Standard">
+    <Visibility>Invisible</Visibility>
+    <pValue>TLParamsLockedReg</pValue>
+    <Min>0</Min>
+    <Max>1</Max>
+  </Integer>
+
+  <IntReg Name="TLParamsLockedReg">
+    <Address>0x0110</Address>
+    <Length>4</Length>
+    <AccessMode>RW</AccessMode>
+    <pPort>Device</pPort>
+    <Cachable>NoCache</Cachable>
+    <Endianess>BigEndian</Endianess>
+  </IntReg>
+
+  <Port Name="Device" NameSpace="Standard">
+  </Port>
+)";
+
+const char* const CHUNK_DATA_CONTROL = R"(
+  <Category Name="ChunkDataControl" NameSpace="Standard">
+    <pFeature>ChunkModeActive</pFeature>
+    <pFeature>ChunkWidth</pFeature>
+    <pFeature>ChunkHeight</pFeature>
+    <pFeature>ChunkScanLineSelector</pFeature>
+    <pFeature>ChunkTimestamp</pFeature>
+    <pFeature>ChunkEncoderValue</pFeature>
+    <pFeature>ChunkOvertriggerCount</pFeature>
+    <pFeature>ChunkEncoderA</pFeature>
+    <pFeature>ChunkEncoderB</pFeature>
+    <pFeature>ChunkFrameTriggerActive</pFeature>
+  </Category>
+
+  <Boolean Name="ChunkModeActive" NameSpace="Standard">
+    <Visibility>Expert</Visibility>
+    <pIsLocked>TLParamsLocked</pIsLocked>
+    <Streamable>Yes</Streamable>
+    <pValue>ChunkModeActiveReg</pValue>
+    <OnValue>1</OnValue>
+    <OffValue>0</OffValue>
+  </Boolean>
+
+  <IntReg Name="ChunkModeActiveReg">
+    <Address>0x0120</Address>
+    <Length>4</Length>
+    <AccessMode>RW</AccessMode>
+    <pPort>Device</pPort>
+    <Cachable>NoCache</Cachable>
+    <Endianess>BigEndian</Endianess>
+  </IntReg>
+
+  <Port Name="ChunkPort" NameSpace="Custom">
+    <ChunkID>4000000F</ChunkID>
+  </Port>
+
+  <IntReg Name="ChunkWidth" NameSpace="Custom">
+    <Visibility>Expert</Visibility>
+    <Address>0x0</Address>
+    <Length>4</Length>
+    <AccessMode>RO</AccessMode>
+    <pPort>ChunkPort</pPort>
+    <Cachable>NoCache</Cachable>
+    <Endianess>LittleEndian</Endianess>
+  </IntReg>
+
+  <IntReg Name="ChunkHeight" NameSpace="Custom">
+    <Visibility>Expert</Visibility>
+    <Address>0x4</Address>
+    <Length>4</Length>
+    <AccessMode>RO</AccessMode>
+    <pPort>ChunkPort</pPort>
+    <Cachable>NoCache</Cachable>
+    <Endianess>LittleEndian</Endianess>
+  </IntReg>
+
+  <Integer Name="ChunkScanLineSelector" NameSpace="Custom">
+    <Visibility>Expert</Visibility>
+    <Value>0</Value>
+    <Min>0</Min>
+    <pMax>ChunkScanLineSelectorMax</pMax>
+    <pSelected>ChunkTimestamp</pSelected>
+    <pSelected>ChunkEncoderValue</pSelected>
+    <pSelected>ChunkOvertriggerCount</pSelected>
+    <pSelected>ChunkEncoderA</pSelected>
+    <pSelected>ChunkEncoderB</pSelected>
+    <pSelected>ChunkFrameTriggerActive</pSelected>
+  </Integer>
+
+  <IntSwissKnife Name="ChunkScanLineSelectorMax">
+    <pVariable Name="H">ChunkHeight</pVariable>
+    <Formula>(H &gt; 0) ? (H - 1) : 0</Formula>
+  </IntSwissKnife>
+)";
+
+const char* const CHUNK_LINE_FEATURES = R"(
+  <Integer Name="ChunkTimestamp" NameSpace="Standard">
+    <Visibility>Expert</Visibility>
+    <pValue>ChunkTimestampReg</pValue>
+  </Integer>
+
+  <IntReg Name="ChunkTimestampReg">
+    <Address>0x10</Address>
+    <pIndex Offset="16">ChunkScanLineSelector</pIndex>
+    <Length>8</Length>
+    <AccessMode>RO</AccessMode>
+    <pPort>ChunkPort</pPort>
+    <Cachable>NoCache</Cachable>
+    <Endianess>LittleEndian</Endianess>
+  </IntReg>
+
+  <Integer Name="ChunkEncoderValue" NameSpace="Standard">
+    <Visibility>Expert</Visibility>
+    <pValue>ChunkEncoderValueReg</pValue>
+  </Integer>
+
+  <IntReg Name="ChunkEncoderValueReg">
+    <Address>0x18</Address>
+    <pIndex Offset="16">ChunkScanLineSelector</pIndex>
+    <Length>4</Length>
+    <AccessMode>RO</AccessMode>
+    <pPort>ChunkPort</pPort>
+    <Cachable>NoCache</Cachable>
+    <Sign>Signed</Sign>
+    <Endianess>LittleEndian</Endianess>
+  </IntReg>
+
+  <Integer Name="ChunkOvertriggerCount" NameSpace="Custom">
+    <Visibility>Expert</Visibility>
+    <pValue>ChunkOvertriggerCountReg</pValue>
+  </Integer>
+
+  <MaskedIntReg Name="ChunkOvertriggerCountReg">
+    <Address>0x1C</Address>
+    <pIndex Offset="16">ChunkScanLineSelector</pIndex>
+    <Length>4</Length>
+    <AccessMode>RO</AccessMode>
+    <pPort>ChunkPort</pPort>
+    <Cachable>NoCache</Cachable>
+    <LSB>0</LSB>
+    <MSB>7</MSB>
+    <Endianess>LittleEndian</Endianess>
+  </MaskedIntReg>
+
+  <Boolean Name="ChunkEncoderA" NameSpace="Custom">
+    <Visibility>Expert</Visibility>
+    <pValue>ChunkEncoderAReg</pValue>
+    <OnValue>1</OnValue>
+    <OffValue>0</OffValue>
+  </Boolean>
+
+  <MaskedIntReg Name="ChunkEncoderAReg">
+    <Address>0x1C</Address>
+    <pIndex Offset="16">ChunkScanLineSelector</pIndex>
+    <Length>4</Length>
+    <AccessMode>RO</AccessMode>
+    <pPort>ChunkPort</pPort>
+    <Cachable>NoCache</Cachable>
+    <Bit>8</Bit>
+    <Endianess>LittleEndian</Endianess>
+  </MaskedIntReg>
+
+  <Boolean Name="ChunkEncoderB" NameSpace="Custom">
+    <Visibility>Expert</Visibility>
+    <pValue>ChunkEncoderBReg</pValue>
+    <OnValue>1</OnValue>
+    <OffValue>0</OffValue>
+  </Boolean>
+
+  <MaskedIntReg Name="ChunkEncoderBReg">
+    <Address>0x1C</Address>
+    <pIndex Offset="16">ChunkScanLineSelector</pIndex>
+    <Length>4</Length>
+    <AccessMode>RO</AccessMode>
+    <pPort>ChunkPort</pPort>
+    <Cachable>NoCache</Cachable>
+    <Bit>9</Bit>
+    <Endianess>LittleEndian</Endianess>
+  </MaskedIntReg>
+
+  <Boolean Name="ChunkFrameTriggerActive" NameSpace="Custom">
+    <Visibility>Expert</Visibility>
+    <pValue>ChunkFrameTriggerActiveReg</pValue>
+    <OnValue>1</OnValue>
+    <OffValue>0</OffValue>
+  </Boolean>
+
+  <MaskedIntReg Name="ChunkFrameTriggerActiveReg">
+    <Address>0x1C</Address>
+    <pIndex Offset="16">ChunkScanLineSelector</pIndex>
+    <Length>4</Length>
+    <AccessMode>RO</AccessMode>
+    <pPort>ChunkPort</pPort>
+    <Cachable>NoCache</Cachable>
+    <Bit>10</Bit>
+    <Endianess>LittleEndian</Endianess>
+  </MaskedIntReg>
+)";
+
+const char* const INTERFACE_FEATURES = R"(
+  <Category Name="Root" NameSpace="Standard">
+    <pFeature>DeviceEnumeration</pFeature>
+  </Category>
+
+  <Category Name="DeviceEnumeration" NameSpace="Standard">
+    <pFeature>DeviceSelector</pFeature>
+    <pFeature>DeviceID</pFeature>
+    <pFeature>GevDeviceIPAddress</pFeature>
+    <pFeature>GevDeviceMACAddress</pFeature>
+  </Category>
+
+  <Integer Name="DeviceSelector" NameSpace="Standard">
+    <Visibility>Expert</Visibility>
+    <pValue>DeviceSelectorReg</pValue>
+    <Min>0</Min>
+    <pMax>DeviceSelectorMax</pMax>
+    <pSelected>DeviceID</pSelected>
+    <pSelected>GevDeviceIPAddress</pSelected>
+    <pSelected>GevDeviceMACAddress</pSelected>
+  </Integer>
+
+  <IntReg Name="DeviceSelectorReg">
+    <Address>0x0000</Address>
+    <Length>4</Length>
+    <AccessMode>RW</AccessMode>
+    <pPort>InterfacePort</pPort>
+    <Cachable>NoCache</Cachable>
+    <Endianess>LittleEndian</Endianess>
+  </IntReg>
+
+  <IntReg Name="DeviceSelectorMax">
+    <Address>0x0004</Address>
+    <Length>4</Length>
+    <AccessMode>RO</AccessMode>
+    <pPort>InterfacePort</pPort>
+    <Cachable>NoCache</Cachable>
+    <Endianess>LittleEndian</Endianess>
+  </IntReg>
+
+  <StringReg Name="DeviceID" NameSpace="Standard">
+    <Visibility>Expert</Visibility>
+    <Address>0x0100</Address>
+    <pIndex Offset="64">DeviceSelectorReg</pIndex>
+    <Length>32</Length>
+    <AccessMode>RO</AccessMode>
+    <pPort>InterfacePort</pPort>
+    <Cachable>NoCache</Cachable>
+  </StringReg>
+
+  <IntReg Name="GevDeviceIPAddress" NameSpace="Standard">
+    <Visibility>Expert</Visibility>
+    <Address>0x0120</Address>
+    <pIndex Offset="64">DeviceSelectorReg</pIndex>
+    <Length>4</Length>
+    <AccessMode>RO</AccessMode>
+    <pPort>InterfacePort</pPort>
+    <Cachable>NoCache</Cachable>
+    <Endianess>LittleEndian</Endianess>
+    <Representation>IPV4Address</Representation>
+  </IntReg>
+
+  <IntReg Name="GevDeviceMACAddress" NameSpace="Standard">
+    <Visibility>Expert</Visibility>
+    <Address>0x0128</Address>
+    <pIndex Offset="64">DeviceSelectorReg</pIndex>
+    <Length>8</Length>
+    <AccessMode>RO</AccessMode>
+    <pPort>InterfacePort</pPort>
+    <Cachable>NoCache</Cachable>
+    <Endianess>LittleEndian</Endianess>
+    <Representation>MACAddress</Representation>
+  </IntReg>
+
+  <Port Name="InterfacePort" NameSpace="Standard">
+  </Port>
+)";
+
+const char* const STREAM_FEATURES = R"(
+  <Category Name="Root" NameSpace="Standard">
+    <pFeature>StreamThreadPriority</pFeature>
+    <pFeature>StreamThreadApplyPriority</pFeature>
+    <pFeature>GevStreamStatistics</pFeature>
+  </Category>
+
+  <Integer Name="StreamThreadPriority" NameSpace="Custom">
+    <Visibility>Expert</Visibility>
+    <pValue>StreamThreadPriorityReg</pValue>
+    <Min>0</Min>
+    <Max>31</Max>
+  </Integer>
+
+  <IntReg Name="StreamThreadPriorityReg">
+    <Address>0x0000</Address>
+    <Length>4</Length>
+    <AccessMode>RW</AccessMode>
+    <pPort>StreamPort</pPort>
+    <Cachable>NoCache</Cachable>
+    <Endianess>LittleEndian</Endianess>
+  </IntReg>
+
+  <Command Name="StreamThreadApplyPriority" NameSpace="Custom">
+    <Visibility>Expert</Visibility>
+    <pValue>StreamThreadApplyPriorityReg</pValue>
+    <CommandValue>1</CommandValue>
+  </Command>
+
+  <IntReg Name="StreamThreadApplyPriorityReg">
+    <Address>0x0004</Address>
+    <Length>4</Length>
+    <AccessMode>RW</AccessMode>
+    <pPort>StreamPort</pPort>
+    <Cachable>NoCache</Cachable>
+    <Endianess>LittleEndian</Endianess>
+  </IntReg>
+
+  <Category Name="GevStreamStatistics" NameSpace="Custom">
+    <pFeature>GevStreamSeenPacketCount</pFeature>
+    <pFeature>GevStreamLostPacketCount</pFeature>
+    <pFeature>GevStreamResendPacketCount</pFeature>
+    <pFeature>GevStreamDeliveredPacketCount</pFeature>
+    <pFeature>GevStreamUnavailablePacketCount</pFeature>
+    <pFeature>GevStreamDuplicatePacketCount</pFeature>
+    <pFeature>GevStreamSkippedBlockCount</pFeature>
+    <pFeature>GevStreamDiscardedBlockCount</pFeature>
+    <pFeature>GevStreamIncompleteBlockCount</pFeature>
+    <pFeature>GevStreamOversizedBlockCount</pFeature>
+    <pFeature>GevStreamEngineUnderrunCount</pFeature>
+  </Category>
+)";
+
+// Counters at StreamRegister::COUNTER_TABLE, in the order of StreamCounter
+const char* const STREAM_COUNTERS[] =
+{
+  "GevStreamSeenPacketCount",
+  "GevStreamLostPacketCount",
+  "GevStreamResendPacketCount",
+  "GevStreamDeliveredPacketCount",
+  "GevStreamUnavailablePacketCount",
+  "GevStreamDuplicatePacketCount",
+  "GevStreamSkippedBlockCount",
+  "GevStreamDiscardedBlockCount",
+  "GevStreamIncompleteBlockCount",
+  "GevStreamOversizedBlockCount",
+  "GevStreamEngineUnderrunCount"
+};
+
+const char* const STREAM_PORT = R"(
+  <Port Name="StreamPort" NameSpace="Standard">
+  </Port>
+)";
+
+std::string hex(uint64_t value)
+{
+  const char* const digits = "0123456789ABCDEF";
+  std::string text;
+  do
+  {
+    text.insert(text.begin(), digits[value & 0xF]);
+    value >>= 4;
+  } while (value != 0);
+  return "0x" + text;
+}
+
+std::string streamCounterXml(const char* name, size_t index)
+{
+  const uint64_t address = StreamRegister::COUNTER_TABLE
+    + index * StreamRegister::COUNTER_STRIDE;
+  std::string xml;
+  xml += "\n  <IntReg Name=\"";
+  xml += name;
+  xml += "\" NameSpace=\"Custom\">\n"
+    "    <Visibility>Expert</Visibility>\n"
+    "    <Address>" + hex(address) + "</Address>\n"
+    "    <Length>8</Length>\n"
+    "    <AccessMode>RO</AccessMode>\n"
+    "    <pPort>StreamPort</pPort>\n"
+    "    <Cachable>NoCache</Cachable>\n"
+    "    <Endianess>LittleEndian</Endianess>\n"
+    "  </IntReg>\n";
+  return xml;
+}
+
+std::string buildStreamXml()
+{
+  std::string counters;
+  for (size_t i = 0; i < STREAM_COUNTER_COUNT; ++i)
+  {
+    counters += streamCounterXml(STREAM_COUNTERS[i], i);
+  }
+  return std::string(XML_HEADER)
+    + STREAM_FEATURES
+    + counters
+    + STREAM_PORT
+    + XML_FOOTER;
+}
+
+// Built when the library is loaded, before any thread may ask for them
+const std::string DEVICE_XML = std::string(XML_HEADER)
+  + DEVICE_CONTROL
+  + IMAGE_FORMAT_CONTROL
+  + ACQUISITION_CONTROL
+  + CHUNK_DATA_CONTROL
+  + CHUNK_LINE_FEATURES
+  + XML_FOOTER;
+const std::string INTERFACE_XML = std::string(XML_HEADER)
+  + INTERFACE_FEATURES
+  + XML_FOOTER;
+const std::string STREAM_XML = buildStreamXml();
+
+}
+
+const std::string& deviceXml()
+{
+  return DEVICE_XML;
+}
+
+const std::string& interfaceXml()
+{
+  return INTERFACE_XML;
+}
+
+const std::string& streamXml()
+{
+  return STREAM_XML;
+}
+
+std::string moduleXml(const std::string& portName,
+                      const std::string& idFeature)
+{
+  return std::string(XML_HEADER)
+    + "\n  <Category Name=\"Root\" NameSpace=\"Standard\">\n"
+    + "    <pFeature>" + idFeature + "</pFeature>\n"
+    + "  </Category>\n\n"
+    + "  <StringReg Name=\"" + idFeature + "\" NameSpace=\"Standard\">\n"
+    + "    <Visibility>Beginner</Visibility>\n"
+    + "    <Address>" + hex(ModuleRegister::ID) + "</Address>\n"
+    + "    <Length>64</Length>\n"
+    + "    <AccessMode>RO</AccessMode>\n"
+    + "    <pPort>" + portName + "</pPort>\n"
+    + "  </StringReg>\n\n"
+    + "  <Port Name=\"" + portName + "\" NameSpace=\"Standard\">\n"
+    + "  </Port>\n"
+    + XML_FOOTER;
+}
+
+}
@@ -0,0 +1,167 @@
+// Copyright 2018 SICK AG. All rights reserved.
+
+#ifndef SIMULATED_NODE_MAPS_H
+#define SIMULATED_NODE_MAPS_H
+
+#include <cstdint>
+#include <string>
+
+namespace Simulator
+{
+
+/** Address where the XML of a port is read from, above all registers. */
+const uint64_t XML_ADDRESS = 0x100000;
+
+/** Registers of the simulated Ranger3, 32 bit big endian unless noted.
+    The layout is made up for the simulator, it is not the one of the
+    real camera.
+*/
+namespace DeviceRegister
+{
+const uint64_t MODEL_NAME = 0x0000;
+const uint64_t SERIAL_NUMBER = 0x0020;
+const uint64_t USER_ID = 0x0040;
+/** Length of the string registers above. */
+const size_t STRING_LENGTH = 32;
+
+const uint64_t SCAN_TYPE = 0x0100;
+const uint64_t ACQUISITION_MODE = 0x0104;
+const uint64_t ACQUISITION_START = 0x0108;
+const uint64_t ACQUISITION_STOP = 0x010C;
+const uint64_t TL_PARAMS_LOCKED = 0x0110;
+const uint64_t PAYLOAD_SIZE = 0x0114;
+/** Floating point, in microseconds. */
+const uint64_t EXPOSURE_TIME = 0x0118;
+/** Floating point, in Hz. */
+const uint64_t LINE_RATE = 0x011C;
+const uint64_t CHUNK_MODE_ACTIVE = 0x0120;
+const uint64_t REGION_SELECTOR = 0x0124;
+const uint64_t COMPONENT_SELECTOR = 0x0128;
+const uint64_t REGISTERS_STREAMING_START = 0x012C;
+const uint64_t REGISTERS_STREAMING_END = 0x0130;
+const uint64_t REGISTERS_VALID = 0x0134;
+
+/** Width, height, offset x and offset y of each region. */
+const uint64_t REGION_TABLE = 0x0200;
+const uint64_t REGION_STRIDE = 0x10;
+const uint64_t REGION_WIDTH = 0x0;
+const uint64_t REGION_HEIGHT = 0x4;
+const uint64_t REGION_OFFSET_X = 0x8;
+const uint64_t REGION_OFFSET_Y = 0xC;
+
+/** Enable flag of each component. */
+const uint64_t COMPONENT_TABLE = 0x0300;
+const uint64_t COMPONENT_STRIDE = 0x4;
+
+const size_t SIZE = 0x0400;
+}
+
+/** Values of the RegionSelector, DeviceScanType and ComponentSelector. */
+enum Region
+{
+  REGION_0 = 0,
+  REGION_1 = 1,
+  SCAN_3D_EXTRACTION_1 = 2,
+  REGION_COUNT = 3
+};
+
+enum ScanType
+{
+  AREASCAN = 0,
+  LINESCAN_3D = 1
+};
+
+enum Component
+{
+  COMPONENT_RANGE = 0,
+  COMPONENT_REFLECTANCE = 1,
+  COMPONENT_SCATTER = 2,
+  COMPONENT_COUNT = 3
+};
+
+/** Id of the chunk carrying the line metadata, as in the ChunkPort. */
+const uint32_t METADATA_CHUNK_ID = 0x4000000F;
+/** Id of the chunk wrapping the image data, unknown to the node map. */
+const uint32_t IMAGE_CHUNK_ID = 0x00000001;
+/** The metadata chunk starts with width and height, then one entry per
+    line, all little endian.
+*/
+const size_t METADATA_HEADER_SIZE = 16;
+const size_t METADATA_LINE_SIZE = 16;
+
+/** Registers of the interface module, 32 bit little endian unless noted. */
+namespace InterfaceRegister
+{
+const uint64_t DEVICE_SELECTOR = 0x0000;
+const uint64_t DEVICE_SELECTOR_MAX = 0x0004;
+
+/** Id, IP address and 64 bit MAC address of each device. */
+const uint64_t DEVICE_TABLE = 0x0100;
+const uint64_t DEVICE_STRIDE = 0x40;
+const uint64_t DEVICE_ID = 0x00;
+const uint64_t DEVICE_IP_ADDRESS = 0x20;
+const uint64_t DEVICE_MAC_ADDRESS = 0x28;
+const size_t DEVICE_ID_LENGTH = 32;
+
+const size_t MAX_DEVICES = 64;
+const size_t SIZE = DEVICE_TABLE + MAX_DEVICES * DEVICE_STRIDE;
+}
+
+/** Registers of the data stream module, little endian. */
+namespace StreamRegister
+{
+const uint64_t THREAD_PRIORITY = 0x0000;
+const uint64_t THREAD_APPLY_PRIORITY = 0x0004;
+
+/** The 64 bit statistics counters, in the order of StreamCounter. */
+const uint64_t COUNTER_TABLE = 0x0010;
+const uint64_t COUNTER_STRIDE = 0x8;
+
+const size_t SIZE = 0x0100;
+}
+
+enum StreamCounter
+{
+  SEEN_PACKETS,
+  LOST_PACKETS,
+  RESEND_PACKETS,
+  DELIVERED_PACKETS,
+  UNAVAILABLE_PACKETS,
+  DUPLICATE_PACKETS,
+  SKIPPED_BLOCKS,
+  DISCARDED_BLOCKS,
+  INCOMPLETE_BLOCKS,
+  OVERSIZED_BLOCKS,
+  ENGINE_UNDERRUNS,
+  STREAM_COUNTER_COUNT
+};
+
+/** Registers of the system and device modules, little endian. */
+namespace ModuleRegister
+{
+const uint64_t ID = 0x0000;
+const size_t ID_LENGTH = 64;
+const size_t SIZE = 0x0100;
+}
+
+/** The XML of the remote device, port "Device". */
+const std::string& deviceXml();
+
+/** The XML of the interface module, port "InterfacePort". */
+const std::string& interfaceXml();
+
+/** The XML of the data stream module, port "StreamPort". */
+const std::string& streamXml();
+
+/** The XML of the system and the device module, with a single string
+    feature holding the module id.
+
+    \param portName E.g., "TLPort" or "DevicePort"
+    \param idFeature E.g., "TLID" or "DeviceID"
+*/
+std::string moduleXml(const std::string& portName,
+                      const std::string& idFeature);
+
+}
+
+#endif
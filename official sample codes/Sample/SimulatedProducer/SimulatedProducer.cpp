@@ -0,0 +1,1079 @@
+// Copyright 2018 SICK AG. All rights reserved.
+
+/** A GenTL producer simulating Ranger3 cameras, for running and benchmarking
+    the samples without a camera. Load it instead of SICKGigEVisionTL.cti,
+    e.g., by setting SICK_GENTL_PRODUCER to its path.
+
+    A single interface holds the simulated devices. Each device serves a
+    node map with the features used by the samples and, between
+    AcquisitionStart and AcquisitionStop, generates frames into the queued
+    buffers of its data stream. In Linescan3D the frames are multipart
+    buffers with the enabled components, range as Coord3D_C12p, reflectance
+    as Mono8 and scatter as Mono16, with line metadata chunks when
+    ChunkModeActive is set. In Areascan the frames are Mono8 images.
+
+    The simulation is set up by the environment when GCInitLib is called:
+    - RANGER3_SIM_DEVICES: Number of devices, 1 by default.
+    - RANGER3_SIM_LINE_RATE: Lines per second for all devices, overriding
+      AcquisitionLineRate. 0 delivers a frame as soon as a buffer is queued,
+      for measuring the throughput of the consumer.
+    - RANGER3_SIM_DROP_EVERY: Every n:th frame is lost, as counted by the
+      GevStreamStatistics of the data stream.
+    - RANGER3_SIM_INCOMPLETE_EVERY: Every n:th frame is delivered incomplete.
+*/
+
+#include "Modules.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <string>
+
+using Simulator::Buffer;
+using Simulator::DataStream;
+using Simulator::Device;
+using Simulator::Event;
+using Simulator::Handle;
+using Simulator::Interface;
+using Simulator::Port;
+using Simulator::System;
+using Simulator::setInfoString;
+using Simulator::setLastError;
+
+namespace
+{
+
+std::mutex libraryMutex;
+std::atomic<bool> initialized(false);
+Simulator::Configuration configuration;
+std::unique_ptr<System> openSystem;
+
+GenTL::GC_ERROR invalidHandle()
+{
+  return setLastError(GenTL::GC_ERR_INVALID_HANDLE, "Invalid handle");
+}
+
+GenTL::GC_ERROR invalidParameter()
+{
+  return setLastError(GenTL::GC_ERR_INVALID_PARAMETER, "Argument is null");
+}
+
+/** Runs a function of the API, making sure no exception leaves the
+    library.
+*/
+template<typename Function>
+GenTL::GC_ERROR run(Function function)
+{
+  try
+  {
+    return function();
+  }
+  catch (const std::bad_alloc&)
+  {
+    return setLastError(GenTL::GC_ERR_OUT_OF_MEMORY, "Out of memory");
+  }
+  catch (const std::exception& e)
+  {
+    return setLastError(GenTL::GC_ERR_ERROR, e.what());
+  }
+  catch (...)
+  {
+    return setLastError(GenTL::GC_ERR_ERROR, "Unknown error");
+  }
+}
+
+/** As run, for the functions that require GCInitLib to have been called. */
+template<typename Function>
+GenTL::GC_ERROR call(Function function)
+{
+  if (!initialized.load())
+  {
+    return setLastError(GenTL::GC_ERR_NOT_INITIALIZED,
+                        "GCInitLib has not been called");
+  }
+  return run(function);
+}
+
+System* toSystem(GenTL::TL_HANDLE handle)
+{
+  System* system = Handle::from<System>(handle, Simulator::SYSTEM_MODULE);
+  return system == openSystem.get() ? system : nullptr;
+}
+
+Interface* toInterface(GenTL::IF_HANDLE handle)
+{
+  return Handle::from<Interface>(handle, Simulator::INTERFACE_MODULE);
+}
+
+Device* toDevice(GenTL::DEV_HANDLE handle)
+{
+  return Handle::from<Device>(handle, Simulator::DEVICE_MODULE);
+}
+
+DataStream* toDataStream(GenTL::DS_HANDLE handle)
+{
+  return Handle::from<DataStream>(handle, Simulator::DATA_STREAM_MODULE);
+}
+
+Buffer* toBuffer(GenTL::BUFFER_HANDLE handle)
+{
+  return Handle::from<Buffer>(handle, Simulator::BUFFER_OBJECT);
+}
+
+Event* toEvent(GenTL::EVENT_HANDLE handle)
+{
+  return Handle::from<Event>(handle, Simulator::EVENT_OBJECT);
+}
+
+/** The interface, if the id is the one of the simulated interface. */
+Interface* findInterface(System& system, const char* id)
+{
+  Interface& simulated = system.simulatedInterface();
+  return id != nullptr && simulated.id() == id ? &simulated : nullptr;
+}
+
+}
+
+namespace GenTL
+{
+
+GC_API GCGetInfo(TL_INFO_CMD iInfoCmd,
+                 INFO_DATATYPE* piType,
+                 void* pBuffer,
+                 size_t* piSize)
+{
+  return run([&]() -> GC_ERROR
+  {
+    return System::getInfo(iInfoCmd, piType, pBuffer, piSize);
+  });
+}
+
+GC_API GCGetLastError(GC_ERROR* piErrorCode,
+                      char* sErrText,
+                      size_t* piSize)
+{
+  return run([&]() -> GC_ERROR
+  {
+    if (piErrorCode == nullptr || piSize == nullptr)
+    {
+      return invalidParameter();
+    }
+    std::string message;
+    Simulator::getLastError(*piErrorCode, message);
+    return setInfoString(message, nullptr, sErrText, piSize);
+  });
+}
+
+GC_API GCInitLib(void)
+{
+  return run([&]() -> GC_ERROR
+  {
+    std::lock_guard<std::mutex> lock(libraryMutex);
+    if (initialized.load())
+    {
+      return setLastError(GC_ERR_RESOURCE_IN_USE,
+                          "Library is already initialized");
+    }
+    configuration = Simulator::Configuration::fromEnvironment();
+    initialized = true;
+    return GC_ERR_SUCCESS;
+  });
+}
+
+GC_API GCCloseLib(void)
+{
+  return call([&]() -> GC_ERROR
+  {
+    std::lock_guard<std::mutex> lock(libraryMutex);
+    openSystem.reset();
+    initialized = false;
+    return GC_ERR_SUCCESS;
+  });
+}
+
+GC_API GCReadPort(PORT_HANDLE hPort,
+                  uint64_t iAddress,
+                  void* pBuffer,
+                  size_t* piSize)
+{
+  return call([&]() -> GC_ERROR
+  {
+    Port* port = Port::fromHandle(hPort);
+    return port ? port->read(iAddress, pBuffer, piSize) : invalidHandle();
+  });
+}
+
+GC_API GCWritePort(PORT_HANDLE hPort,
+                   uint64_t iAddress,
+                   const void* pBuffer,
+                   size_t* piSize)
+{
+  return call([&]() -> GC_ERROR
+  {
+    Port* port = Port::fromHandle(hPort);
+    return port ? port->write(iAddress, pBuffer, piSize) : invalidHandle();
+  });
+}
+
+GC_API GCGetPortURL(PORT_HANDLE hPort, char* sURL, size_t* piSize)
+{
+  return call([&]() -> GC_ERROR
+  {
+    Port* port = Port::fromHandle(hPort);
+    return port
+      ? setInfoString(port->url(), nullptr, sURL, piSize)
+      : invalidHandle();
+  });
+}
+
+GC_API GCGetPortInfo(PORT_HANDLE hPort,
+                     PORT_INFO_CMD iInfoCmd,
+                     INFO_DATATYPE* piType,
+                     void* pBuffer,
+                     size_t* piSize)
+{
+  return call([&]() -> GC_ERROR
+  {
+    Port* port = Port::fromHandle(hPort);
+    return port
+      ? port->getInfo(iInfoCmd, piType, pBuffer, piSize)
+      : invalidHandle();
+  });
+}
+
+GC_API GCRegisterEvent(EVENTSRC_HANDLE hEventSrc,
+                       EVENT_TYPE iEventID,
+                       EVENT_HANDLE* phEvent)
+{
+  return call([&]() -> GC_ERROR
+  {
+    Port* port = Port::fromHandle(hEventSrc);
+    if (port == nullptr)
+    {
+      return invalidHandle();
+    }
+    if (phEvent == nullptr)
+    {
+      return invalidParameter();
+    }
+    Event* event = nullptr;
+    const GC_ERROR status = port->registerEvent(iEventID, event);
+    if (status == GC_ERR_SUCCESS)
+    {
+      *phEvent = event->handle();
+    }
+    return status;
+  });
+}
+
+GC_API GCUnregisterEvent(EVENTSRC_HANDLE hEventSrc, EVENT_TYPE iEventID)
+{
+  return call([&]() -> GC_ERROR
+  {
+    Port* port = Port::fromHandle(hEventSrc);
+    return port ? port->unregisterEvent(iEventID) : invalidHandle();
+  });
+}
+
+GC_API EventGetData(EVENT_HANDLE hEvent,
+                    void* pBuffer,
+                    size_t* piSize,
+                    uint64_t iTimeout)
+{
+  return call([&]() -> GC_ERROR
+  {
+    Event* event = toEvent(hEvent);
+    return event ? event->getData(pBuffer, piSize, iTimeout) : invalidHandle();
+  });
+}
+
+GC_API EventGetDataInfo(EVENT_HANDLE hEvent,
+                        const void* pInBuffer,
+                        size_t iInSize,
+                        EVENT_DATA_INFO_CMD iInfoCmd,
+                        INFO_DATATYPE* piType,
+                        void* pOutBuffer,
+                        size_t* piOutSize)
+{
+  return call([&]() -> GC_ERROR
+  {
+    Event* event = toEvent(hEvent);
+    return event
+      ? event->getDataInfo(pInBuffer, iInSize, iInfoCmd,
+                           piType, pOutBuffer, piOutSize)
+      : invalidHandle();
+  });
+}
+
+GC_API EventGetInfo(EVENT_HANDLE hEvent,
+                    EVENT_INFO_CMD iInfoCmd,
+                    INFO_DATATYPE* piType,
+                    void* pBuffer,
+                    size_t* piSize)
+{
+  return call([&]() -> GC_ERROR
+  {
+    Event* event = toEvent(hEvent);
+    return event
+      ? event->getInfo(iInfoCmd, piType, pBuffer, piSize)
+      : invalidHandle();
+  });
+}
+
+GC_API EventFlush(EVENT_HANDLE hEvent)
+{
+  return call([&]() -> GC_ERROR
+  {
+    Event* event = toEvent(hEvent);
+    return event ? event->flush() : invalidHandle();
+  });
+}
+
+GC_API EventKill(EVENT_HANDLE hEvent)
+{
+  return call([&]() -> GC_ERROR
+  {
+    Event* event = toEvent(hEvent);
+    return event ? event->kill() : invalidHandle();
+  });
+}
+
+GC_API TLOpen(TL_HANDLE* phTL)
+{
+  return call([&]() -> GC_ERROR
+  {
+    if (phTL == nullptr)
+    {
+      return invalidParameter();
+    }
+    std::lock_guard<std::mutex> lock(libraryMutex);
+    if (openSystem)
+    {
+      return setLastError(GC_ERR_RESOURCE_IN_USE, "System is already open");
+    }
+    openSystem.reset(new System(configuration));
+    *phTL = openSystem->handle();
+    return GC_ERR_SUCCESS;
+  });
+}
+
+GC_API TLClose(TL_HANDLE hTL)
+{
+  return call([&]() -> GC_ERROR
+  {
+    std::lock_guard<std::mutex> lock(libraryMutex);
+    System* system = toSystem(hTL);
+    if (system == nullptr)
+    {
+      return invalidHandle();
+    }
+    // Stops all acquisition before anything is destroyed
+    system->simulatedInterface().close();
+    openSystem.reset();
+    return GC_ERR_SUCCESS;
+  });
+}
+
+GC_API TLGetInfo(TL_HANDLE hTL,
+                 TL_INFO_CMD iInfoCmd,
+                 INFO_DATATYPE* piType,
+                 void* pBuffer,
+                 size_t* piSize)
+{
+  return call([&]() -> GC_ERROR
+  {
+    return toSystem(hTL)
+      ? System::getInfo(iInfoCmd, piType, pBuffer, piSize)
+      : invalidHandle();
+  });
+}
+
+GC_API TLGetNumInterfaces(TL_HANDLE hTL, uint32_t* piNumIfaces)
+{
+  return call([&]() -> GC_ERROR
+  {
+    if (toSystem(hTL) == nullptr)
+    {
+      return invalidHandle();
+    }
+    if (piNumIfaces == nullptr)
+    {
+      return invalidParameter();
+    }
+    *piNumIfaces = 1;
+    return GC_ERR_SUCCESS;
+  });
+}
+
+GC_API TLGetInterfaceID(TL_HANDLE hTL,
+                        uint32_t iIndex,
+                        char* sID,
+                        size_t* piSize)
+{
+  return call([&]() -> GC_ERROR
+  {
+    System* system = toSystem(hTL);
+    if (system == nullptr)
+    {
+      return invalidHandle();
+    }
+    if (iIndex != 0)
+    {
+      return setLastError(GC_ERR_INVALID_INDEX, "No interface with index");
+    }
+    return setInfoString(system->simulatedInterface().id(),
+                         nullptr, sID, piSize);
+  });
+}
+
+GC_API TLGetInterfaceInfo(TL_HANDLE hTL,
+                          const char* sIfaceID,
+                          INTERFACE_INFO_CMD iInfoCmd,
+                          INFO_DATATYPE* piType,
+                          void* pBuffer,
+                          size_t* piSize)
+{
+  return call([&]() -> GC_ERROR
+  {
+    System* system = toSystem(hTL);
+    if (system == nullptr)
+    {
+      return invalidHandle();
+    }
+    Interface* iface = findInterface(*system, sIfaceID);
+    return iface
+      ? iface->getInfo(iInfoCmd, piType, pBuffer, piSize)
+      : setLastError(GC_ERR_INVALID_ID, "No interface with id");
+  });
+}
+
+GC_API TLOpenInterface(TL_HANDLE hTL,
+                       const char* sIfaceID,
+                       IF_HANDLE* phIface)
+{
+  return call([&]() -> GC_ERROR
+  {
+    System* system = toSystem(hTL);
+    if (system == nullptr)
+    {
+      return invalidHandle();
+    }
+    if (phIface == nullptr)
+    {
+      return invalidParameter();
+    }
+    Interface* iface = findInterface(*system, sIfaceID);
+    if (iface == nullptr)
+    {
+      return setLastError(GC_ERR_INVALID_ID, "No interface with id");
+    }
+    const GC_ERROR status = iface->open();
+    if (status == GC_ERR_SUCCESS)
+    {
+      *phIface = iface->handle();
+    }
+    return status;
+  });
+}
+
+GC_API TLUpdateInterfaceList(TL_HANDLE hTL,
+                             bool8_t* pbChanged,
+                             uint64_t /*iTimeout*/)
+{
+  return call([&]() -> GC_ERROR
+  {
+    if (toSystem(hTL) == nullptr)
+    {
+      return invalidHandle();
+    }
+    // The interface never changes
+    if (pbChanged != nullptr)
+    {
+      *pbChanged = false;
+    }
+    return GC_ERR_SUCCESS;
+  });
+}
+
+GC_API IFClose(IF_HANDLE hIface)
+{
+  return call([&]() -> GC_ERROR
+  {
+    Interface* iface = toInterface(hIface);
+    return iface ? iface->close() : invalidHandle();
+  });
+}
+
+GC_API IFGetInfo(IF_HANDLE hIface,
+                 INTERFACE_INFO_CMD iInfoCmd,
+                 INFO_DATATYPE* piType,
+                 void* pBuffer,
+                 size_t* piSize)
+{
+  return call([&]() -> GC_ERROR
+  {
+    Interface* iface = toInterface(hIface);
+    return iface
+      ? iface->getInfo(iInfoCmd, piType, pBuffer, piSize)
+      : invalidHandle();
+  });
+}
+
+GC_API IFGetNumDevices(IF_HANDLE hIface, uint32_t* piNumDevices)
+{
+  return call([&]() -> GC_ERROR
+  {
+    Interface* iface = toInterface(hIface);
+    if (iface == nullptr)
+    {
+      return invalidHandle();
+    }
+    if (piNumDevices == nullptr)
+    {
+      return invalidParameter();
+    }
+    *piNumDevices = iface->deviceCount();
+    return GC_ERR_SUCCESS;
+  });
+}
+
+GC_API IFGetDeviceID(IF_HANDLE hIface,
+                     uint32_t iIndex,
+                     char* sIDeviceID,
+                     size_t* piSize)
+{
+  return call([&]() -> GC_ERROR
+  {
+    Interface* iface = toInterface(hIface);
+    if (iface == nullptr)
+    {
+      return invalidHandle();
+    }
+    Device* device = iface->device(iIndex);
+    return device
+      ? setInfoString(device->id(), nullptr, sIDeviceID, piSize)
+      : setLastError(GC_ERR_INVALID_INDEX, "No device with index");
+  });
+}
+
+GC_API IFUpdateDeviceList(IF_HANDLE hIface,
+                          bool8_t* pbChanged,
+                          uint64_t /*iTimeout*/)
+{
+  return call([&]() -> GC_ERROR
+  {
+    if (toInterface(hIface) == nullptr)
+    {
+      return invalidHandle();
+    }
+    // The devices are created with the system and never change
+    if (pbChanged != nullptr)
+    {
+      *pbChanged = false;
+    }
+    return GC_ERR_SUCCESS;
+  });
+}
+
+GC_API IFGetDeviceInfo(IF_HANDLE hIface,
+                       const char* sDeviceID,
+                       DEVICE_INFO_CMD iInfoCmd,
+                       INFO_DATATYPE* piType,
+                       void* pBuffer,
+                       size_t* piSize)
+{
+  return call([&]() -> GC_ERROR
+  {
+    Interface* iface = toInterface(hIface);
+    if (iface == nullptr)
+    {
+      return invalidHandle();
+    }
+    Device* device = iface->findDevice(sDeviceID);
+    return device
+      ? device->getInfo(iInfoCmd, piType, pBuffer, piSize)
+      : setLastError(GC_ERR_INVALID_ID, "No device with id");
+  });
+}
+
+GC_API IFOpenDevice(IF_HANDLE hIface,
+                    const char* sDeviceID,
+                    DEVICE_ACCESS_FLAGS /*iOpenFlags*/,
+                    DEV_HANDLE* phDevice)
+{
+  return call([&]() -> GC_ERROR
+  {
+    Interface* iface = toInterface(hIface);
+    if (iface == nullptr)
+    {
+      return invalidHandle();
+    }
+    if (phDevice == nullptr)
+    {
+      return invalidParameter();
+    }
+    Device* device = iface->findDevice(sDeviceID);
+    if (device == nullptr)
+    {
+      return setLastError(GC_ERR_INVALID_ID, "No device with id");
+    }
+    const GC_ERROR status = device->open();
+    if (status == GC_ERR_SUCCESS)
+    {
+      *phDevice = device->handle();
+    }
+    return status;
+  });
+}
+
+GC_API DevGetPort(DEV_HANDLE hDevice, PORT_HANDLE* phRemoteDevice)
+{
+  return call([&]() -> GC_ERROR
+  {
+    Device* device = toDevice(hDevice);
+    if (device == nullptr)
+    {
+      return invalidHandle();
+    }
+    if (phRemoteDevice == nullptr)
+    {
+      return invalidParameter();
+    }
+    *phRemoteDevice = device->remote().handle();
+    return GC_ERR_SUCCESS;
+  });
+}
+
+GC_API DevGetNumDataStreams(DEV_HANDLE hDevice, uint32_t* piNumDataStreams)
+{
+  return call([&]() -> GC_ERROR
+  {
+    if (toDevice(hDevice) == nullptr)
+    {
+      return invalidHandle();
+    }
+    if (piNumDataStreams == nullptr)
+    {
+      return invalidParameter();
+    }
+    *piNumDataStreams = 1;
+    return GC_ERR_SUCCESS;
+  });
+}
+
+GC_API DevGetDataStreamID(DEV_HANDLE hDevice,
+                          uint32_t iIndex,
+                          char* sDataStreamID,
+                          size_t* piSize)
+{
+  return call([&]() -> GC_ERROR
+  {
+    Device* device = toDevice(hDevice);
+    if (device == nullptr)
+    {
+      return invalidHandle();
+    }
+    if (iIndex != 0)
+    {
+      return setLastError(GC_ERR_INVALID_INDEX, "No data stream with index");
+    }
+    return setInfoString(device->dataStream().id(),
+                         nullptr, sDataStreamID, piSize);
+  });
+}
+
+GC_API DevOpenDataStream(DEV_HANDLE hDevice,
+                         const char* sDataStreamID,
+                         DS_HANDLE* phDataStream)
+{
+  return call([&]() -> GC_ERROR
+  {
+    Device* device = toDevice(hDevice);
+    if (device == nullptr)
+    {
+      return invalidHandle();
+    }
+    if (phDataStream == nullptr)
+    {
+      return invalidParameter();
+    }
+    DataStream& dataStream = device->dataStream();
+    if (sDataStreamID == nullptr || dataStream.id() != sDataStreamID)
+    {
+      return setLastError(GC_ERR_INVALID_ID, "No data stream with id");
+    }
+    const GC_ERROR status = dataStream.open();
+    if (status == GC_ERR_SUCCESS)
+    {
+      *phDataStream = dataStream.handle();
+    }
+    return status;
+  });
+}
+
+GC_API DevGetInfo(DEV_HANDLE hDevice,
+                  DEVICE_INFO_CMD iInfoCmd,
+                  INFO_DATATYPE* piType,
+                  void* pBuffer,
+                  size_t* piSize)
+{
+  return call([&]() -> GC_ERROR
+  {
+    Device* device = toDevice(hDevice);
+    return device
+      ? device->getInfo(iInfoCmd, piType, pBuffer, piSize)
+      : invalidHandle();
+  });
+}
+
+GC_API DevClose(DEV_HANDLE hDevice)
+{
+  return call([&]() -> GC_ERROR
+  {
+    Device* device = toDevice(hDevice);
+    return device ? device->close() : invalidHandle();
+  });
+}
+
+GC_API DSAnnounceBuffer(DS_HANDLE hDataStream,
+                        void* pBuffer,
+                        size_t iSize,
+                        void* pPrivate,
+                        BUFFER_HANDLE* phBuffer)
+{
+  return call([&]() -> GC_ERROR
+  {
+    DataStream* dataStream = toDataStream(hDataStream);
+    return dataStream
+      ? dataStream->announceBuffer(pBuffer, iSize, pPrivate, phBuffer)
+      : invalidHandle();
+  });
+}
+
+GC_API DSAllocAndAnnounceBuffer(DS_HANDLE hDataStream,
+                                size_t iSize,
+                                void* pPrivate,
+                                BUFFER_HANDLE* phBuffer)
+{
+  return call([&]() -> GC_ERROR
+  {
+    DataStream* dataStream = toDataStream(hDataStream);
+    return dataStream
+      ? dataStream->allocAndAnnounceBuffer(iSize, pPrivate, phBuffer)
+      : invalidHandle();
+  });
+}
+
+GC_API DSFlushQueue(DS_HANDLE hDataStream, ACQ_QUEUE_TYPE iOperation)
+{
+  return call([&]() -> GC_ERROR
+  {
+    DataStream* dataStream = toDataStream(hDataStream);
+    return dataStream ? dataStream->flushQueue(iOperation) : invalidHandle();
+  });
+}
+
+GC_API DSStartAcquisition(DS_HANDLE hDataStream,
+                          ACQ_START_FLAGS /*iStartFlags*/,
+                          uint64_t iNumToAcquire)
+{
+  return call([&]() -> GC_ERROR
+  {
+    DataStream* dataStream = toDataStream(hDataStream);
+    return dataStream
+      ? dataStream->startAcquisition(iNumToAcquire)
+      : invalidHandle();
+  });
+}
+
+GC_API DSStopAcquisition(DS_HANDLE hDataStream,
+                         ACQ_STOP_FLAGS /*iStopFlags*/)
+{
+  return call([&]() -> GC_ERROR
+  {
+    DataStream* dataStream = toDataStream(hDataStream);
+    return dataStream ? dataStream->stopAcquisition() : invalidHandle();
+  });
+}
+
+GC_API DSGetInfo(DS_HANDLE hDataStream,
+                 STREAM_INFO_CMD iInfoCmd,
+                 INFO_DATATYPE* piType,
+                 void* pBuffer,
+                 size_t* piSize)
+{
+  return call([&]() -> GC_ERROR
+  {
+    DataStream* dataStream = toDataStream(hDataStream);
+    return dataStream
+      ? dataStream->getInfo(iInfoCmd, piType, pBuffer, piSize)
+      : invalidHandle();
+  });
+}
+
+GC_API DSGetBufferID(DS_HANDLE hDataStream,
+                     uint32_t iIndex,
+                     BUFFER_HANDLE* phBuffer)
+{
+  return call([&]() -> GC_ERROR
+  {
+    DataStream* dataStream = toDataStream(hDataStream);
+    return dataStream
+      ? dataStream->getBufferId(iIndex, phBuffer)
+      : invalidHandle();
+  });
+}
+
+GC_API DSClose(DS_HANDLE hDataStream)
+{
+  return call([&]() -> GC_ERROR
+  {
+    DataStream* dataStream = toDataStream(hDataStream);
+    return dataStream ? dataStream->close() : invalidHandle();
+  });
+}
+
+GC_API DSRevokeBuffer(DS_HANDLE hDataStream,
+                      BUFFER_HANDLE hBuffer,
+                      void** pBuffer,
+                      void** pPrivate)
+{
+  return call([&]() -> GC_ERROR
+  {
+    DataStream* dataStream = toDataStream(hDataStream);
+    Buffer* buffer = toBuffer(hBuffer);
+    return dataStream && buffer
+      ? dataStream->revokeBuffer(buffer, pBuffer, pPrivate)
+      : invalidHandle();
+  });
+}
+
+GC_API DSQueueBuffer(DS_HANDLE hDataStream, BUFFER_HANDLE hBuffer)
+{
+  return call([&]() -> GC_ERROR
+  {
+    DataStream* dataStream = toDataStream(hDataStream);
+    Buffer* buffer = toBuffer(hBuffer);
+    return dataStream && buffer
+      ? dataStream->queueBuffer(buffer)
+      : invalidHandle();
+  });
+}
+
+GC_API DSGetBufferInfo(DS_HANDLE hDataStream,
+                       BUFFER_HANDLE hBuffer,
+                       BUFFER_INFO_CMD iInfoCmd,
+                       INFO_DATATYPE* piType,
+                       void* pBuffer,
+                       size_t* piSize)
+{
+  return call([&]() -> GC_ERROR
+  {
+    DataStream* dataStream = toDataStream(hDataStream);
+    Buffer* buffer = toBuffer(hBuffer);
+    return dataStream && buffer
+      ? dataStream->getBufferInfo(buffer, iInfoCmd, piType, pBuffer, piSize)
+      : invalidHandle();
+  });
+}
+
+GC_API GCGetNumPortURLs(PORT_HANDLE hPort, uint32_t* piNumURLs)
+{
+  return call([&]() -> GC_ERROR
+  {
+    if (Port::fromHandle(hPort) == nullptr)
+    {
+      return invalidHandle();
+    }
+    if (piNumURLs == nullptr)
+    {
+      return invalidParameter();
+    }
+    *piNumURLs = 1;
+    return GC_ERR_SUCCESS;
+  });
+}
+
+GC_API GCGetPortURLInfo(PORT_HANDLE hPort,
+                        uint32_t iURLIndex,
+                        URL_INFO_CMD iInfoCmd,
+                        INFO_DATATYPE* piType,
+                        void* pBuffer,
+                        size_t* piSize)
+{
+  return call([&]() -> GC_ERROR
+  {
+    Port* port = Port::fromHandle(hPort);
+    return port
+      ? port->getUrlInfo(iURLIndex, iInfoCmd, piType, pBuffer, piSize)
+      : invalidHandle();
+  });
+}
+
+GC_API GCReadPortStacked(PORT_HANDLE hPort,
+                         PORT_REGISTER_STACK_ENTRY* pEntries,
+                         size_t* piNumEntries)
+{
+  return call([&]() -> GC_ERROR
+  {
+    Port* port = Port::fromHandle(hPort);
+    if (port == nullptr)
+    {
+      return invalidHandle();
+    }
+    if (pEntries == nullptr || piNumEntries == nullptr)
+    {
+      return invalidParameter();
+    }
+    // On failure the count tells how many entries were read
+    for (size_t i = 0; i < *piNumEntries; ++i)
+    {
+      PORT_REGISTER_STACK_ENTRY& entry = pEntries[i];
+      const GC_ERROR status =
+        port->read(entry.Address, entry.pBuffer, &entry.Size);
+      if (status != GC_ERR_SUCCESS)
+      {
+        *piNumEntries = i;
+        return status;
+      }
+    }
+    return GC_ERR_SUCCESS;
+  });
+}
+
+GC_API GCWritePortStacked(PORT_HANDLE hPort,
+                          PORT_REGISTER_STACK_ENTRY* pEntries,
+                          size_t* piNumEntries)
+{
+  return call([&]() -> GC_ERROR
+  {
+    Port* port = Port::fromHandle(hPort);
+    if (port == nullptr)
+    {
+      return invalidHandle();
+    }
+    if (pEntries == nullptr || piNumEntries == nullptr)
+    {
+      return invalidParameter();
+    }
+    // On failure the count tells how many entries were written
+    for (size_t i = 0; i < *piNumEntries; ++i)
+    {
+      PORT_REGISTER_STACK_ENTRY& entry = pEntries[i];
+      const GC_ERROR status =
+        port->write(entry.Address, entry.pBuffer, &entry.Size);
+      if (status != GC_ERR_SUCCESS)
+      {
+        *piNumEntries = i;
+        return status;
+      }
+    }
+    return GC_ERR_SUCCESS;
+  });
+}
+
+GC_API DSGetBufferChunkData(DS_HANDLE hDataStream,
+                            BUFFER_HANDLE hBuffer,
+                            SINGLE_CHUNK_DATA* pChunkData,
+                            size_t* piNumChunks)
+{
+  return call([&]() -> GC_ERROR
+  {
+    DataStream* dataStream = toDataStream(hDataStream);
+    Buffer* buffer = toBuffer(hBuffer);
+    return dataStream && buffer
+      ? dataStream->getBufferChunkData(buffer, pChunkData, piNumChunks)
+      : invalidHandle();
+  });
+}
+
+GC_API IFGetParentTL(IF_HANDLE hIface, TL_HANDLE* phSystem)
+{
+  return call([&]() -> GC_ERROR
+  {
+    Interface* iface = toInterface(hIface);
+    if (iface == nullptr)
+    {
+      return invalidHandle();
+    }
+    if (phSystem == nullptr)
+    {
+      return invalidParameter();
+    }
+    *phSystem = iface->parent().handle();
+    return GC_ERR_SUCCESS;
+  });
+}
+
+GC_API DevGetParentIF(DEV_HANDLE hDevice, IF_HANDLE* phIface)
+{
+  return call([&]() -> GC_ERROR
+  {
+    Device* device = toDevice(hDevice);
+    if (device == nullptr)
+    {
+      return invalidHandle();
+    }
+    if (phIface == nullptr)
+    {
+      return invalidParameter();
+    }
+    *phIface = device->parent().handle();
+    return GC_ERR_SUCCESS;
+  });
+}
+
+GC_API DSGetParentDev(DS_HANDLE hDataStream, DEV_HANDLE* phDevice)
+{
+  return call([&]() -> GC_ERROR
+  {
+    DataStream* dataStream = toDataStream(hDataStream);
+    if (dataStream == nullptr)
+    {
+      return invalidHandle();
+    }
+    if (phDevice == nullptr)
+    {
+      return invalidParameter();
+    }
+    *phDevice = dataStream->parent().handle();
+    return GC_ERR_SUCCESS;
+  });
+}
+
+GC_API DSGetNumBufferParts(DS_HANDLE hDataStream,
+                           BUFFER_HANDLE hBuffer,
+                           uint32_t* piNumParts)
+{
+  return call([&]() -> GC_ERROR
+  {
+    DataStream* dataStream = toDataStream(hDataStream);
+    Buffer* buffer = toBuffer(hBuffer);
+    return dataStream && buffer
+      ? dataStream->getNumBufferParts(buffer, piNumParts)
+      : invalidHandle();
+  });
+}
+
+GC_API DSGetBufferPartInfo(DS_HANDLE hDataStream,
+                           BUFFER_HANDLE hBuffer,
+                           uint32_t iPartIndex,
+                           BUFFER_PART_INFO_CMD iInfoCmd,
+                           INFO_DATATYPE* piType,
+                           void* pBuffer,
+                           size_t* piSize)
+{
+  return call([&]() -> GC_ERROR
+  {
+    DataStream* dataStream = toDataStream(hDataStream);
+    Buffer* buffer = toBuffer(hBuffer);
+    return dataStream && buffer
+      ? dataStream->getBufferPartInfo(buffer, iPartIndex, iInfoCmd,
+                                      piType, pBuffer, piSize)
+      : invalidHandle();
+  });
+}
+
+}